@@ -0,0 +1,183 @@
+#include "async_readback.h"
+
+#define READBACK_FLUSH_TIMEOUT 1000000000 // 1 second in nanoseconds.
+#define READBACK_MAX_FREE_BUFFERS 4
+#define READBACK_MAX_POOLED_SIZE (8 * 1024 * 1024) // One-off copies such as the atmosphere tables are not kept around.
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static GLenum texture_binding(GLenum target)
+{
+    switch (target)
+    {
+        case GL_TEXTURE_CUBE_MAP:
+            return GL_TEXTURE_BINDING_CUBE_MAP;
+        case GL_TEXTURE_3D:
+            return GL_TEXTURE_BINDING_3D;
+        case GL_TEXTURE_2D_ARRAY:
+            return GL_TEXTURE_BINDING_2D_ARRAY;
+        default:
+            return GL_TEXTURE_BINDING_2D;
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+AsyncReadback::~AsyncReadback()
+{
+    for (auto& request : m_requests)
+        glDeleteSync(request.fence);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void AsyncReadback::request(dw::Texture* texture, uint32_t width, uint32_t height, uint32_t levels, uint32_t pixel_size, Callback callback)
+{
+    GLenum   target = texture->target();
+    uint32_t faces  = target == GL_TEXTURE_CUBE_MAP ? 6 : 1;
+    size_t   size   = 0;
+
+    for (uint32_t level = 0; level < levels; level++)
+        size += size_t(width >> level) * (height >> level) * pixel_size * faces;
+
+    Request request;
+
+    request.buffer   = acquire(size);
+    request.size     = size;
+    request.callback = callback;
+
+    // Requests are made from within frame graph passes, so the binding of the active unit is restored afterwards to
+    // keep it in line with what GLState has cached for that unit.
+    GLint previous = 0;
+    glGetIntegerv(texture_binding(target), &previous);
+
+    request.buffer->bind();
+    glBindTexture(target, texture->id());
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+    size_t offset = 0;
+
+    // With a pack buffer bound the pointer argument is an offset into the buffer and the copy is queued on the GPU.
+    for (uint32_t level = 0; level < levels; level++)
+    {
+        size_t face_size = size_t(width >> level) * (height >> level) * pixel_size;
+
+        for (uint32_t face = 0; face < faces; face++)
+        {
+            glGetTexImage(faces == 6 ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face : target, level, texture->format(), texture->type(), (void*)offset);
+            offset += face_size;
+        }
+    }
+
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glBindTexture(target, GLuint(previous));
+    request.buffer->unbind();
+
+    request.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    m_requests.push_back(std::move(request));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void AsyncReadback::update()
+{
+    // Requests complete in submission order, so stop at the first one still in flight.
+    size_t completed = 0;
+
+    while (completed < m_requests.size() && complete(m_requests[completed], 0))
+        completed++;
+
+    m_requests.erase(m_requests.begin(), m_requests.begin() + completed);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void AsyncReadback::flush()
+{
+    for (auto& request : m_requests)
+    {
+        // A copy that has not landed by now is given up on, and its fence and buffer go with it.
+        if (!complete(request, READBACK_FLUSH_TIMEOUT))
+        {
+            glDeleteSync(request.fence);
+            m_buffer_size -= request.buffer->size();
+        }
+    }
+
+    m_requests.clear();
+
+    // Nothing is in flight anymore, so the idle buffers can go as well.
+    for (auto& buffer : m_free)
+        m_buffer_size -= buffer->size();
+
+    m_free.clear();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool AsyncReadback::complete(Request& request, GLuint64 timeout)
+{
+    GLenum status = glClientWaitSync(request.fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+
+    if (status == GL_TIMEOUT_EXPIRED)
+        return false;
+
+    glDeleteSync(request.fence);
+    request.fence = nullptr;
+
+    if (status != GL_WAIT_FAILED)
+    {
+        request.buffer->bind();
+
+        const uint8_t* data = (const uint8_t*)request.buffer->map_range(GL_MAP_READ_BIT, 0, request.size);
+
+        if (data)
+            request.callback(data, request.size);
+
+        request.buffer->unmap();
+        request.buffer->unbind();
+    }
+
+    recycle(std::move(request.buffer));
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+std::unique_ptr<dw::Buffer> AsyncReadback::acquire(size_t size)
+{
+    // The smallest idle buffer that fits, so that a large export does not tie up the buffer of a small periodic copy.
+    int32_t best = -1;
+
+    for (int32_t i = 0; i < int32_t(m_free.size()); i++)
+    {
+        if (m_free[i]->size() >= size && (best < 0 || m_free[i]->size() < m_free[best]->size()))
+            best = i;
+    }
+
+    if (best >= 0)
+    {
+        std::unique_ptr<dw::Buffer> buffer = std::move(m_free[best]);
+        m_free.erase(m_free.begin() + best);
+
+        return buffer;
+    }
+
+    m_buffer_size += size;
+
+    return std::make_unique<dw::Buffer>(GL_PIXEL_PACK_BUFFER, GL_STREAM_READ, size, nullptr);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void AsyncReadback::recycle(std::unique_ptr<dw::Buffer> buffer)
+{
+    if (m_free.size() < READBACK_MAX_FREE_BUFFERS && buffer->size() <= READBACK_MAX_POOLED_SIZE)
+        m_free.push_back(std::move(buffer));
+    else
+        m_buffer_size -= buffer->size();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <ogl.h>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Copies texture contents into pixel pack buffers without stalling the pipeline. Every request is fenced and its
+// callback runs from update() once the GPU has finished the copy, usually a frame or two later. Pack buffers are
+// recycled once their callback has run, so a steady stream of requests settles on a small ring of buffers instead of
+// allocating one per copy.
+class AsyncReadback
+{
+public:
+    // 'data' is level-major: every face of a level back to back with tightly packed rows, largest level first. It is
+    // only valid during the callback.
+    typedef std::function<void(const uint8_t* data, size_t size)> Callback;
+
+    ~AsyncReadback();
+
+    // Queues a copy of mip levels [0, levels) of every face of 'texture' in its own format and type. A 3D texture is
+    // read as a single level whose 'height' covers every slice.
+    void request(dw::Texture* texture, uint32_t width, uint32_t height, uint32_t levels, uint32_t pixel_size, Callback callback);
+
+    // Runs the callbacks of every request whose copy has completed. Never blocks.
+    void update();
+
+    // Blocks until every pending request has completed.
+    void flush();
+
+    inline size_t pending() const { return m_requests.size(); }
+
+    // Bytes of all pack buffers, in flight or waiting to be reused.
+    inline size_t buffer_size() const { return m_buffer_size; }
+
+private:
+    struct Request
+    {
+        std::unique_ptr<dw::Buffer> buffer;
+        size_t                      size  = 0; // Of the copy, the buffer may be larger.
+        GLsync                      fence = nullptr;
+        Callback                    callback;
+    };
+
+    bool                        complete(Request& request, GLuint64 timeout);
+    std::unique_ptr<dw::Buffer> acquire(size_t size);
+    void                        recycle(std::unique_ptr<dw::Buffer> buffer);
+
+    std::vector<Request>                     m_requests;
+    std::vector<std::unique_ptr<dw::Buffer>> m_free;
+    size_t                                   m_buffer_size = 0;
+};
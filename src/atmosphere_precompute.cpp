@@ -0,0 +1,920 @@
+#include "atmosphere_precompute.h"
+#include "disk_cache.h"
+#include "parallel.h"
+#include <logger.h>
+#include <algorithm>
+#include <thread>
+#include <string.h>
+#define _USE_MATH_DEFINES
+#include <math.h>
+
+// Bruneton and Neyret, "Precomputed Atmospheric Scattering" (2008). This is a direct port of the reference GLSL
+// implementation, using the non-linear transmittance and inscatter parameterizations that atmosphere.glsl expects.
+
+#define ATMOSPHERE_CACHE_VERSION 1
+#define ATMOSPHERE_CACHE_MAGIC 0x534f4d41 // 'AMOS'
+
+namespace
+{
+const float Rg = 6360.0f;
+const float Rt = 6420.0f;
+const float RL = 6421.0f;
+
+const int TRANSMITTANCE_INTEGRAL_SAMPLES       = 500;
+const int INSCATTER_INTEGRAL_SAMPLES           = 50;
+const int IRRADIANCE_INTEGRAL_SAMPLES          = 32;
+const int INSCATTER_SPHERICAL_INTEGRAL_SAMPLES = 16;
+
+const float RES_R    = float(ATMOSPHERE_INSCATTER_R);
+const float RES_MU   = float(ATMOSPHERE_INSCATTER_MU);
+const float RES_MU_S = float(ATMOSPHERE_INSCATTER_MU_S);
+const float RES_NU   = float(ATMOSPHERE_INSCATTER_NU);
+
+struct CacheHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t hash;
+    uint32_t transmittance_size;
+    uint32_t irradiance_size;
+    uint32_t inscatter_size;
+    uint32_t padding;
+};
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Bilinear fetch with clamp-to-edge addressing, matching a GL_LINEAR sampler.
+glm::vec4 sample_2d(const std::vector<glm::vec4>& table, int w, int h, float u, float v)
+{
+    float x  = u * w - 0.5f;
+    float y  = v * h - 0.5f;
+    float fx = floorf(x);
+    float fy = floorf(y);
+    float tx = x - fx;
+    float ty = y - fy;
+
+    int x0 = glm::clamp(int(fx), 0, w - 1);
+    int x1 = glm::clamp(int(fx) + 1, 0, w - 1);
+    int y0 = glm::clamp(int(fy), 0, h - 1);
+    int y1 = glm::clamp(int(fy) + 1, 0, h - 1);
+
+    glm::vec4 a = table[y0 * w + x0] * (1.0f - tx) + table[y0 * w + x1] * tx;
+    glm::vec4 b = table[y1 * w + x0] * (1.0f - tx) + table[y1 * w + x1] * tx;
+
+    return a * (1.0f - ty) + b * ty;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+glm::vec4 sample_3d(const std::vector<glm::vec4>& table, float u, float v, float w)
+{
+    const int W = ATMOSPHERE_INSCATTER_W;
+    const int H = ATMOSPHERE_INSCATTER_H;
+    const int D = ATMOSPHERE_INSCATTER_D;
+
+    float z  = w * D - 0.5f;
+    float fz = floorf(z);
+    float tz = z - fz;
+
+    int z0 = glm::clamp(int(fz), 0, D - 1);
+    int z1 = glm::clamp(int(fz) + 1, 0, D - 1);
+
+    float x  = u * W - 0.5f;
+    float y  = v * H - 0.5f;
+    float fx = floorf(x);
+    float fy = floorf(y);
+    float tx = x - fx;
+    float ty = y - fy;
+
+    int x0 = glm::clamp(int(fx), 0, W - 1);
+    int x1 = glm::clamp(int(fx) + 1, 0, W - 1);
+    int y0 = glm::clamp(int(fy), 0, H - 1);
+    int y1 = glm::clamp(int(fy) + 1, 0, H - 1);
+
+    auto slice = [&](int z) {
+        // Each depth slice is a regular 2D table.
+        const glm::vec4* s = &table[z * W * H];
+        glm::vec4        a = s[y0 * W + x0] * (1.0f - tx) + s[y0 * W + x1] * tx;
+        glm::vec4        b = s[y1 * W + x0] * (1.0f - tx) + s[y1 * W + x1] * tx;
+        return a * (1.0f - ty) + b * ty;
+    };
+
+    return slice(z0) * (1.0f - tz) + slice(z1) * tz;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+glm::vec3 exp3(const glm::vec3& v)
+{
+    return glm::vec3(expf(v.x), expf(v.y), expf(v.z));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+glm::vec3 min3(const glm::vec3& v, float m)
+{
+    return glm::vec3(fminf(v.x, m), fminf(v.y, m), fminf(v.z, m));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+class Precompute
+{
+public:
+    Precompute(const AtmosphereParameters& params, AtmosphereTables& tables, uint32_t num_threads) :
+        m_params(params), m_tables(tables), m_num_threads(num_threads)
+    {
+        m_beta_m_ex = m_params.beta_m_sca * m_params.mie_extinction;
+
+        m_delta_e.resize(ATMOSPHERE_IRRADIANCE_W * ATMOSPHERE_IRRADIANCE_H);
+        m_delta_sr.resize(ATMOSPHERE_INSCATTER_W * ATMOSPHERE_INSCATTER_H * ATMOSPHERE_INSCATTER_D);
+        m_delta_sm.resize(m_delta_sr.size());
+        m_delta_j.resize(m_delta_sr.size());
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void run()
+    {
+        // Single scattering.
+        for_each_2d(ATMOSPHERE_TRANSMITTANCE_W, ATMOSPHERE_TRANSMITTANCE_H, [&](int x, int y) { transmittance_texel(x, y); });
+        for_each_2d(ATMOSPHERE_IRRADIANCE_W, ATMOSPHERE_IRRADIANCE_H, [&](int x, int y) { irradiance_1_texel(x, y); });
+        for_each_3d([&](int x, int y, int layer, float r, const glm::vec4& dhdh) { inscatter_1_texel(x, y, layer, r, dhdh); });
+
+        std::fill(m_tables.irradiance.begin(), m_tables.irradiance.end(), glm::vec4(0.0f));
+
+        // Multiple scattering, one order at a time.
+        for (int order = 2; order <= m_params.scattering_orders; order++)
+        {
+            bool first = order == 2;
+
+            for_each_3d([&](int x, int y, int layer, float r, const glm::vec4& dhdh) { inscatter_s_texel(x, y, layer, r, dhdh, first); });
+            for_each_2d(ATMOSPHERE_IRRADIANCE_W, ATMOSPHERE_IRRADIANCE_H, [&](int x, int y) { irradiance_n_texel(x, y, first); });
+            for_each_3d([&](int x, int y, int layer, float r, const glm::vec4& dhdh) { inscatter_n_texel(x, y, layer, r, dhdh); });
+        }
+    }
+
+private:
+    template <typename F>
+    void for_each_2d(int w, int h, F func)
+    {
+        parallel_for(h, m_num_threads, [&](uint32_t y) {
+            for (int x = 0; x < w; x++)
+                func(x, int(y));
+        });
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    // Iterates over every inscatter texel, one row per task, providing the layer radius and the distance bounds used by
+    // the non-linear mu parameterization.
+    template <typename F>
+    void for_each_3d(F func)
+    {
+        parallel_for(ATMOSPHERE_INSCATTER_H * ATMOSPHERE_INSCATTER_D, m_num_threads, [&](uint32_t row) {
+            int layer = row / ATMOSPHERE_INSCATTER_H;
+            int y     = row % ATMOSPHERE_INSCATTER_H;
+
+            float r = float(layer) / (RES_R - 1.0f);
+            r       = r * r;
+            r       = sqrtf(Rg * Rg + r * (Rt * Rt - Rg * Rg)) + (layer == 0 ? 0.01f : (layer == ATMOSPHERE_INSCATTER_R - 1 ? -0.001f : 0.0f));
+
+            float     dmin  = Rt - r;
+            float     dmax  = sqrtf(r * r - Rg * Rg) + sqrtf(Rt * Rt - Rg * Rg);
+            float     dminp = r - Rg;
+            float     dmaxp = sqrtf(r * r - Rg * Rg);
+            glm::vec4 dhdh  = glm::vec4(dmin, dmax, dminp, dmaxp);
+
+            for (int x = 0; x < ATMOSPHERE_INSCATTER_W; x++)
+                func(x, y, layer, r, dhdh);
+        });
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    static size_t index_3d(int x, int y, int layer)
+    {
+        return (size_t(layer) * ATMOSPHERE_INSCATTER_H + y) * ATMOSPHERE_INSCATTER_W + x;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+    // Parameterization ------------------------------------------------------------------------------------------------------------------
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    static void mu_mu_s_nu(int x, int y, float r, const glm::vec4& dhdh, float& mu, float& mu_s, float& nu)
+    {
+        float fy = float(y);
+
+        if (fy < RES_MU / 2.0f)
+        {
+            float d = 1.0f - fy / (RES_MU / 2.0f - 1.0f);
+            d       = fminf(fmaxf(dhdh.z, d * dhdh.w), dhdh.w * 0.999f);
+            mu      = (Rg * Rg - r * r - d * d) / (2.0f * r * d);
+            mu      = fminf(mu, -sqrtf(1.0f - (Rg / r) * (Rg / r)) - 0.001f);
+        }
+        else
+        {
+            float d = (fy - RES_MU / 2.0f) / (RES_MU / 2.0f - 1.0f);
+            d       = fminf(fmaxf(dhdh.x, d * dhdh.y), dhdh.y * 0.999f);
+            mu      = (Rt * Rt - r * r - d * d) / (2.0f * r * d);
+        }
+
+        mu_s = fmodf(float(x), RES_MU_S) / (RES_MU_S - 1.0f);
+        mu_s = tanf((2.0f * mu_s - 1.0f + 0.26f) * 1.1f) / tanf(1.26f * 1.1f);
+        nu   = -1.0f + floorf(float(x) / RES_MU_S) / (RES_NU - 1.0f) * 2.0f;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    static void irradiance_r_mu_s(int x, int y, float& r, float& mu_s)
+    {
+        r    = Rg + float(y) / (float(ATMOSPHERE_IRRADIANCE_H) - 1.0f) * (Rt - Rg);
+        mu_s = -0.2f + float(x) / (float(ATMOSPHERE_IRRADIANCE_W) - 1.0f) * (1.0f + 0.2f);
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    glm::vec4 texture_4d(const std::vector<glm::vec4>& table, float r, float mu, float mu_s, float nu) const
+    {
+        float H   = sqrtf(Rt * Rt - Rg * Rg);
+        float rho = sqrtf(fmaxf(r * r - Rg * Rg, 0.0f));
+
+        float     rmu   = r * mu;
+        float     delta = rmu * rmu - r * r + Rg * Rg;
+        glm::vec4 cst   = rmu < 0.0f && delta > 0.0f ? glm::vec4(1.0f, 0.0f, 0.0f, 0.5f - 0.5f / RES_MU) : glm::vec4(-1.0f, H * H, H, 0.5f + 0.5f / RES_MU);
+        float     u_r   = 0.5f / RES_R + rho / H * (1.0f - 1.0f / RES_R);
+        float     u_mu  = cst.w + (rmu * cst.x + sqrtf(fmaxf(delta + cst.y, 0.0f))) / (rho + cst.z) * (0.5f - 1.0f / RES_MU);
+        float     u_mus = 0.5f / RES_MU_S + (atanf(fmaxf(mu_s, -0.1975f) * tanf(1.26f * 1.1f)) / 1.1f + (1.0f - 0.26f)) * 0.5f * (1.0f - 1.0f / RES_MU_S);
+
+        float lep  = (nu + 1.0f) / 2.0f * (RES_NU - 1.0f);
+        float u_nu = floorf(lep);
+        lep        = lep - u_nu;
+
+        return sample_3d(table, (u_nu + u_mus) / RES_NU, u_mu, u_r) * (1.0f - lep) + sample_3d(table, (u_nu + u_mus + 1.0f) / RES_NU, u_mu, u_r) * lep;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+    // Physics ---------------------------------------------------------------------------------------------------------------------------
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    static float limit(float r, float mu)
+    {
+        float dout   = -r * mu + sqrtf(r * r * (mu * mu - 1.0f) + RL * RL);
+        float delta2 = r * r * (mu * mu - 1.0f) + Rg * Rg;
+
+        if (delta2 >= 0.0f)
+        {
+            float din = -r * mu - sqrtf(delta2);
+
+            if (din >= 0.0f)
+                dout = fminf(dout, din);
+        }
+
+        return dout;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    static float optical_depth(float H, float r, float mu)
+    {
+        float result = 0.0f;
+        float dx     = limit(r, mu) / float(TRANSMITTANCE_INTEGRAL_SAMPLES);
+        float yi     = expf(-(r - Rg) / H);
+
+        for (int i = 1; i <= TRANSMITTANCE_INTEGRAL_SAMPLES; ++i)
+        {
+            float xj = float(i) * dx;
+            float yj = expf(-(sqrtf(r * r + xj * xj + 2.0f * xj * r * mu) - Rg) / H);
+            result += (yi + yj) / 2.0f * dx;
+            yi = yj;
+        }
+
+        return mu < -sqrtf(1.0f - (Rg / r) * (Rg / r)) ? 1e9f : result;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    glm::vec3 transmittance(float r, float mu) const
+    {
+        float u_r  = sqrtf(fmaxf((r - Rg) / (Rt - Rg), 0.0f));
+        float u_mu = atanf((mu + 0.15f) / (1.0f + 0.15f) * tanf(1.5f)) / 1.5f;
+
+        return glm::vec3(sample_2d(m_tables.transmittance, ATMOSPHERE_TRANSMITTANCE_W, ATMOSPHERE_TRANSMITTANCE_H, u_mu, u_r));
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    // Transmittance between the point at (r, mu) and the point at distance d along the same ray.
+    glm::vec3 transmittance(float r, float mu, float d) const
+    {
+        float r1  = sqrtf(r * r + d * d + 2.0f * r * mu * d);
+        float mu1 = (r * mu + d) / r1;
+
+        if (mu > 0.0f)
+            return min3(transmittance(r, mu) / transmittance(r1, mu1), 1.0f);
+        else
+            return min3(transmittance(r1, -mu1) / transmittance(r, -mu), 1.0f);
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    glm::vec3 irradiance(const std::vector<glm::vec4>& table, float r, float mu_s) const
+    {
+        float u_r   = (r - Rg) / (Rt - Rg);
+        float u_mus = (mu_s + 0.2f) / (1.0f + 0.2f);
+
+        return glm::vec3(sample_2d(table, ATMOSPHERE_IRRADIANCE_W, ATMOSPHERE_IRRADIANCE_H, u_mus, u_r));
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    static float phase_function_r(float mu)
+    {
+        return (3.0f / (16.0f * float(M_PI))) * (1.0f + mu * mu);
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    float phase_function_m(float mu) const
+    {
+        float g = m_params.mie_g;
+        return 1.5f * 1.0f / (4.0f * float(M_PI)) * (1.0f - g * g) * powf(1.0f + (g * g) - 2.0f * g * mu, -3.0f / 2.0f) * (1.0f + mu * mu) / (2.0f + g * g);
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+    // Passes ----------------------------------------------------------------------------------------------------------------------------
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void transmittance_texel(int x, int y)
+    {
+        float r  = (float(y) + 0.5f) / float(ATMOSPHERE_TRANSMITTANCE_H);
+        float mu = (float(x) + 0.5f) / float(ATMOSPHERE_TRANSMITTANCE_W);
+
+        r  = Rg + (r * r) * (Rt - Rg);
+        mu = -0.15f + tanf(1.5f * mu) / tanf(1.5f) * (1.0f + 0.15f);
+
+        glm::vec3 depth = m_params.beta_r * optical_depth(m_params.hr, r, mu) + m_beta_m_ex * optical_depth(m_params.hm, r, mu);
+
+        m_tables.transmittance[y * ATMOSPHERE_TRANSMITTANCE_W + x] = glm::vec4(exp3(-depth), 0.0f);
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void irradiance_1_texel(int x, int y)
+    {
+        float r, mu_s;
+        irradiance_r_mu_s(x, y, r, mu_s);
+
+        m_delta_e[y * ATMOSPHERE_IRRADIANCE_W + x] = glm::vec4(transmittance(r, mu_s) * fmaxf(mu_s, 0.0f), 0.0f);
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void inscatter_1_integrand(float r, float mu, float mu_s, float nu, float t, glm::vec3& ray, glm::vec3& mie) const
+    {
+        ray = glm::vec3(0.0f);
+        mie = glm::vec3(0.0f);
+
+        float ri    = sqrtf(r * r + t * t + 2.0f * r * mu * t);
+        float mu_si = (nu * t + mu_s * r) / ri;
+        ri          = fmaxf(Rg, ri);
+
+        if (mu_si >= -sqrtf(1.0f - Rg * Rg / (ri * ri)))
+        {
+            glm::vec3 ti = transmittance(r, mu, t) * transmittance(ri, mu_si);
+            ray          = expf(-(ri - Rg) / m_params.hr) * ti;
+            mie          = expf(-(ri - Rg) / m_params.hm) * ti;
+        }
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void inscatter_1_texel(int x, int y, int layer, float r, const glm::vec4& dhdh)
+    {
+        float mu, mu_s, nu;
+        mu_mu_s_nu(x, y, r, dhdh, mu, mu_s, nu);
+
+        glm::vec3 ray = glm::vec3(0.0f);
+        glm::vec3 mie = glm::vec3(0.0f);
+        float     dx  = limit(r, mu) / float(INSCATTER_INTEGRAL_SAMPLES);
+
+        glm::vec3 ray_i, mie_i;
+        inscatter_1_integrand(r, mu, mu_s, nu, 0.0f, ray_i, mie_i);
+
+        for (int i = 1; i <= INSCATTER_INTEGRAL_SAMPLES; ++i)
+        {
+            float     xj = float(i) * dx;
+            glm::vec3 ray_j, mie_j;
+            inscatter_1_integrand(r, mu, mu_s, nu, xj, ray_j, mie_j);
+
+            ray += (ray_i + ray_j) / 2.0f * dx;
+            mie += (mie_i + mie_j) / 2.0f * dx;
+            ray_i = ray_j;
+            mie_i = mie_j;
+        }
+
+        ray *= m_params.beta_r;
+        mie *= m_params.beta_m_sca;
+
+        size_t idx = index_3d(x, y, layer);
+
+        m_delta_sr[idx]         = glm::vec4(ray, 0.0f);
+        m_delta_sm[idx]         = glm::vec4(mie, 0.0f);
+        m_tables.inscatter[idx] = glm::vec4(ray, mie.x);
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    // Radiance scattered towards the viewer at every point (deltaJ), from the previous order's inscatter and irradiance.
+    void inscatter_s_texel(int x, int y, int layer, float r, const glm::vec4& dhdh, bool first)
+    {
+        float mu, mu_s, nu;
+        mu_mu_s_nu(x, y, r, dhdh, mu, mu_s, nu);
+
+        const float dphi   = float(M_PI) / float(INSCATTER_SPHERICAL_INTEGRAL_SAMPLES);
+        const float dtheta = float(M_PI) / float(INSCATTER_SPHERICAL_INTEGRAL_SAMPLES);
+
+        r    = glm::clamp(r, Rg, Rt);
+        mu   = glm::clamp(mu, -1.0f, 1.0f);
+        mu_s = glm::clamp(mu_s, -1.0f, 1.0f);
+
+        float var = sqrtf(1.0f - mu * mu) * sqrtf(1.0f - mu_s * mu_s);
+        nu        = glm::clamp(nu, mu_s * mu - var, mu_s * mu + var);
+
+        float cthetamin = -sqrtf(1.0f - (Rg / r) * (Rg / r));
+
+        glm::vec3 v  = glm::vec3(sqrtf(1.0f - mu * mu), 0.0f, mu);
+        float     sx = v.x == 0.0f ? 0.0f : (nu - mu_s * mu) / v.x;
+        glm::vec3 s  = glm::vec3(sx, sqrtf(fmaxf(0.0f, 1.0f - sx * sx - mu_s * mu_s)), mu_s);
+
+        glm::vec3 density_r = m_params.beta_r * expf(-(r - Rg) / m_params.hr);
+        glm::vec3 density_m = m_params.beta_m_sca * expf(-(r - Rg) / m_params.hm);
+        glm::vec3 raymie    = glm::vec3(0.0f);
+
+        for (int itheta = 0; itheta < INSCATTER_SPHERICAL_INTEGRAL_SAMPLES; ++itheta)
+        {
+            float theta  = (float(itheta) + 0.5f) * dtheta;
+            float ctheta = cosf(theta);
+            float stheta = sinf(theta);
+
+            float     greflectance = 0.0f;
+            float     dground      = 0.0f;
+            glm::vec3 gtransp      = glm::vec3(0.0f);
+
+            if (ctheta < cthetamin)
+            {
+                // Ground is visible in direction w, add the light reflected by it.
+                greflectance = m_params.ground_reflectance / float(M_PI);
+                dground      = -r * ctheta - sqrtf(r * r * (ctheta * ctheta - 1.0f) + Rg * Rg);
+                gtransp      = transmittance(Rg, -(r * ctheta + dground) / Rg, dground);
+            }
+
+            for (int iphi = 0; iphi < 2 * INSCATTER_SPHERICAL_INTEGRAL_SAMPLES; ++iphi)
+            {
+                float     phi = (float(iphi) + 0.5f) * dphi;
+                float     dw  = dtheta * dphi * stheta;
+                glm::vec3 w   = glm::vec3(cosf(phi) * stheta, sinf(phi) * stheta, ctheta);
+
+                float nu1 = glm::dot(s, w);
+                float nu2 = glm::dot(v, w);
+                float pr2 = phase_function_r(nu2);
+                float pm2 = phase_function_m(nu2);
+
+                glm::vec3 gnormal     = (glm::vec3(0.0f, 0.0f, r) + dground * w) / Rg;
+                glm::vec3 girradiance = irradiance(m_delta_e, Rg, glm::dot(gnormal, s));
+
+                glm::vec3 raymie1 = greflectance * girradiance * gtransp;
+
+                if (first)
+                {
+                    float     pr1  = phase_function_r(nu1);
+                    float     pm1  = phase_function_m(nu1);
+                    glm::vec3 ray1 = glm::vec3(texture_4d(m_delta_sr, r, w.z, mu_s, nu1));
+                    glm::vec3 mie1 = glm::vec3(texture_4d(m_delta_sm, r, w.z, mu_s, nu1));
+                    raymie1 += ray1 * pr1 + mie1 * pm1;
+                }
+                else
+                    raymie1 += glm::vec3(texture_4d(m_delta_sr, r, w.z, mu_s, nu1));
+
+                raymie += raymie1 * (density_r * pr2 + density_m * pm2) * dw;
+            }
+        }
+
+        m_delta_j[index_3d(x, y, layer)] = glm::vec4(raymie, 0.0f);
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    // Ground irradiance due to the previous scattering order (deltaE), accumulated into the final irradiance table.
+    void irradiance_n_texel(int x, int y, bool first)
+    {
+        float r, mu_s;
+        irradiance_r_mu_s(x, y, r, mu_s);
+
+        const float dphi   = float(M_PI) / float(IRRADIANCE_INTEGRAL_SAMPLES);
+        const float dtheta = float(M_PI) / float(IRRADIANCE_INTEGRAL_SAMPLES);
+
+        glm::vec3 s      = glm::vec3(fmaxf(sqrtf(1.0f - mu_s * mu_s), 0.0f), 0.0f, mu_s);
+        glm::vec3 result = glm::vec3(0.0f);
+
+        for (int iphi = 0; iphi < 2 * IRRADIANCE_INTEGRAL_SAMPLES; ++iphi)
+        {
+            float phi = (float(iphi) + 0.5f) * dphi;
+
+            for (int itheta = 0; itheta < IRRADIANCE_INTEGRAL_SAMPLES / 2; ++itheta)
+            {
+                float     theta = (float(itheta) + 0.5f) * dtheta;
+                float     dw    = dtheta * dphi * sinf(theta);
+                glm::vec3 w     = glm::vec3(cosf(phi) * sinf(theta), sinf(phi) * sinf(theta), cosf(theta));
+                float     nu    = glm::dot(s, w);
+
+                if (first)
+                {
+                    float     pr1  = phase_function_r(nu);
+                    float     pm1  = phase_function_m(nu);
+                    glm::vec3 ray1 = glm::vec3(texture_4d(m_delta_sr, r, w.z, mu_s, nu));
+                    glm::vec3 mie1 = glm::vec3(texture_4d(m_delta_sm, r, w.z, mu_s, nu));
+                    result += (ray1 * pr1 + mie1 * pm1) * w.z * dw;
+                }
+                else
+                    result += glm::vec3(texture_4d(m_delta_sr, r, w.z, mu_s, nu)) * w.z * dw;
+            }
+        }
+
+        size_t idx = y * ATMOSPHERE_IRRADIANCE_W + x;
+
+        m_delta_e[idx] = glm::vec4(result, 0.0f);
+        m_tables.irradiance[idx] += glm::vec4(result, 0.0f);
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    // Inscattered light of the current order (deltaS), integrated from deltaJ along the view ray.
+    void inscatter_n_texel(int x, int y, int layer, float r, const glm::vec4& dhdh)
+    {
+        float mu, mu_s, nu;
+        mu_mu_s_nu(x, y, r, dhdh, mu, mu_s, nu);
+
+        auto integrand = [&](float t) {
+            float ri    = sqrtf(r * r + t * t + 2.0f * r * mu * t);
+            float mui   = (r * mu + t) / ri;
+            float mu_si = (nu * t + mu_s * r) / ri;
+
+            return glm::vec3(texture_4d(m_delta_j, ri, mui, mu_si, nu)) * transmittance(r, mu, t);
+        };
+
+        glm::vec3 raymie   = glm::vec3(0.0f);
+        float     dx       = limit(r, mu) / float(INSCATTER_INTEGRAL_SAMPLES);
+        glm::vec3 raymie_i = integrand(0.0f);
+
+        for (int i = 1; i <= INSCATTER_INTEGRAL_SAMPLES; ++i)
+        {
+            float     xj       = float(i) * dx;
+            glm::vec3 raymie_j = integrand(xj);
+
+            raymie += (raymie_i + raymie_j) / 2.0f * dx;
+            raymie_i = raymie_j;
+        }
+
+        size_t idx = index_3d(x, y, layer);
+
+        m_delta_sr[idx] = glm::vec4(raymie, 0.0f);
+        m_tables.inscatter[idx] += glm::vec4(raymie / phase_function_r(nu), 0.0f);
+    }
+
+private:
+    const AtmosphereParameters& m_params;
+    AtmosphereTables&           m_tables;
+    uint32_t                    m_num_threads;
+    glm::vec3                   m_beta_m_ex;
+    std::vector<glm::vec4>      m_delta_e;
+    std::vector<glm::vec4>      m_delta_sr;
+    std::vector<glm::vec4>      m_delta_sm;
+    std::vector<glm::vec4>      m_delta_j;
+};
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+std::string cache_path(const AtmosphereParameters& params)
+{
+    return disk_cache::path("atmosphere_" + disk_cache::to_hex(params.hash()) + ".bin");
+}
+} // namespace
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+uint64_t AtmosphereParameters::hash() const
+{
+    const int32_t dims[] = { ATMOSPHERE_CACHE_VERSION,
+                             ATMOSPHERE_TRANSMITTANCE_W,
+                             ATMOSPHERE_TRANSMITTANCE_H,
+                             ATMOSPHERE_IRRADIANCE_W,
+                             ATMOSPHERE_IRRADIANCE_H,
+                             ATMOSPHERE_INSCATTER_R,
+                             ATMOSPHERE_INSCATTER_MU,
+                             ATMOSPHERE_INSCATTER_MU_S,
+                             ATMOSPHERE_INSCATTER_NU };
+
+    // Hash field by field so that struct padding never leaks into the key.
+    uint64_t h = disk_cache::hash(dims, sizeof(dims));
+    h          = disk_cache::hash(&beta_r[0], sizeof(float) * 3, h);
+    h          = disk_cache::hash(&beta_m_sca[0], sizeof(float) * 3, h);
+    h          = disk_cache::hash(&mie_extinction, sizeof(float), h);
+    h          = disk_cache::hash(&mie_g, sizeof(float), h);
+    h          = disk_cache::hash(&hr, sizeof(float), h);
+    h          = disk_cache::hash(&hm, sizeof(float), h);
+    h          = disk_cache::hash(&ground_reflectance, sizeof(float), h);
+    h          = disk_cache::hash(&scattering_orders, sizeof(int32_t), h);
+
+    return h;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void AtmosphereTables::resize()
+{
+    transmittance.resize(ATMOSPHERE_TRANSMITTANCE_W * ATMOSPHERE_TRANSMITTANCE_H);
+    irradiance.resize(ATMOSPHERE_IRRADIANCE_W * ATMOSPHERE_IRRADIANCE_H);
+    inscatter.resize(ATMOSPHERE_INSCATTER_W * ATMOSPHERE_INSCATTER_H * ATMOSPHERE_INSCATTER_D);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void precompute_atmosphere_cpu(const AtmosphereParameters& params, AtmosphereTables& tables, uint32_t num_threads)
+{
+    if (num_threads == 0)
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+
+    tables.resize();
+
+    Precompute precompute(params, tables, num_threads);
+    precompute.run();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool load_atmosphere_cache(const AtmosphereParameters& params, AtmosphereTables& tables)
+{
+    std::vector<uint8_t> data;
+
+    if (!disk_cache::read(cache_path(params), data) || data.size() < sizeof(CacheHeader))
+        return false;
+
+    CacheHeader header;
+    memcpy(&header, data.data(), sizeof(CacheHeader));
+
+    tables.resize();
+
+    size_t transmittance_size = tables.transmittance.size() * sizeof(glm::vec4);
+    size_t irradiance_size    = tables.irradiance.size() * sizeof(glm::vec4);
+    size_t inscatter_size     = tables.inscatter.size() * sizeof(glm::vec4);
+
+    if (header.magic != ATMOSPHERE_CACHE_MAGIC || header.version != ATMOSPHERE_CACHE_VERSION || header.hash != params.hash() ||
+        header.transmittance_size != transmittance_size || header.irradiance_size != irradiance_size || header.inscatter_size != inscatter_size ||
+        data.size() != sizeof(CacheHeader) + transmittance_size + irradiance_size + inscatter_size)
+    {
+        DW_LOG_WARNING("Ignoring stale atmosphere cache entry");
+        return false;
+    }
+
+    const uint8_t* ptr = data.data() + sizeof(CacheHeader);
+
+    memcpy(tables.transmittance.data(), ptr, transmittance_size);
+    ptr += transmittance_size;
+    memcpy(tables.irradiance.data(), ptr, irradiance_size);
+    ptr += irradiance_size;
+    memcpy(tables.inscatter.data(), ptr, inscatter_size);
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool save_atmosphere_cache(const AtmosphereParameters& params, const AtmosphereTables& tables)
+{
+    CacheHeader header;
+
+    header.magic              = ATMOSPHERE_CACHE_MAGIC;
+    header.version            = ATMOSPHERE_CACHE_VERSION;
+    header.hash               = params.hash();
+    header.transmittance_size = uint32_t(tables.transmittance.size() * sizeof(glm::vec4));
+    header.irradiance_size    = uint32_t(tables.irradiance.size() * sizeof(glm::vec4));
+    header.inscatter_size     = uint32_t(tables.inscatter.size() * sizeof(glm::vec4));
+    header.padding            = 0;
+
+    std::vector<uint8_t> data(sizeof(CacheHeader) + header.transmittance_size + header.irradiance_size + header.inscatter_size);
+    uint8_t*             ptr = data.data();
+
+    memcpy(ptr, &header, sizeof(CacheHeader));
+    ptr += sizeof(CacheHeader);
+    memcpy(ptr, tables.transmittance.data(), header.transmittance_size);
+    ptr += header.transmittance_size;
+    memcpy(ptr, tables.irradiance.data(), header.irradiance_size);
+    ptr += header.irradiance_size;
+    memcpy(ptr, tables.inscatter.data(), header.inscatter_size);
+
+    return disk_cache::write(cache_path(params), data.data(), data.size());
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool AtmosphereComputeBaker::initialize(ProgramCache& program_cache)
+{
+    static const char* pass_defines[] = { "PASS_TRANSMITTANCE", "PASS_IRRADIANCE_1", "PASS_INSCATTER_1", "PASS_INSCATTER_S", "PASS_IRRADIANCE_N", "PASS_INSCATTER_N" };
+
+    for (int i = 0; i < PASS_COUNT; i++)
+    {
+        m_programs[i] = program_cache.create({ { GL_COMPUTE_SHADER, "shader/atmosphere_precompute_cs.glsl" } }, { pass_defines[i] });
+
+        if (!m_programs[i])
+        {
+            DW_LOG_ERROR("Failed to create Atmosphere Precompute Shader Program");
+            return false;
+        }
+    }
+
+    // The tables are baked right after this, so there is nothing to overlap the compile with.
+    if (!program_cache.finish())
+    {
+        DW_LOG_ERROR("Failed to link Atmosphere Precompute Shader Programs");
+        return false;
+    }
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void AtmosphereComputeBaker::precompute(const AtmosphereParameters& params, dw::Texture2D* transmittance, dw::Texture2D* irradiance, dw::Texture3D* inscatter, GpuMemoryRegistry& memory)
+{
+    const GLbitfield barrier = GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT;
+
+    const uint32_t inscatter_groups_x = ATMOSPHERE_INSCATTER_W / 8;
+    const uint32_t inscatter_groups_y = ATMOSPHERE_INSCATTER_H / 8;
+
+    // The deltas are about 50 MB of scratch that is only needed while baking, and most runs load the tables from the
+    // cache instead, so they only exist for the duration of a bake.
+    m_delta_e  = std::make_unique<dw::Texture2D>(ATMOSPHERE_IRRADIANCE_W, ATMOSPHERE_IRRADIANCE_H, 1, 1, 1, GL_RGBA32F, GL_RGBA, GL_FLOAT);
+    m_delta_sr = std::make_unique<dw::Texture3D>(ATMOSPHERE_INSCATTER_W, ATMOSPHERE_INSCATTER_H, ATMOSPHERE_INSCATTER_D, 1, GL_RGBA32F, GL_RGBA, GL_FLOAT);
+    m_delta_sm = std::make_unique<dw::Texture3D>(ATMOSPHERE_INSCATTER_W, ATMOSPHERE_INSCATTER_H, ATMOSPHERE_INSCATTER_D, 1, GL_RGBA32F, GL_RGBA, GL_FLOAT);
+    m_delta_j  = std::make_unique<dw::Texture3D>(ATMOSPHERE_INSCATTER_W, ATMOSPHERE_INSCATTER_H, ATMOSPHERE_INSCATTER_D, 1, GL_RGBA32F, GL_RGBA, GL_FLOAT);
+
+    dw::Texture* deltas[] = { m_delta_e.get(), m_delta_sr.get(), m_delta_sm.get(), m_delta_j.get() };
+
+    for (auto delta : deltas)
+    {
+        delta->set_min_filter(GL_LINEAR);
+        delta->set_mag_filter(GL_LINEAR);
+        delta->set_wrapping(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
+    }
+
+    size_t delta_3d_size = gpu_texture_size(ATMOSPHERE_INSCATTER_W, ATMOSPHERE_INSCATTER_H, ATMOSPHERE_INSCATTER_D, 1, GL_RGBA32F);
+
+    memory.track(m_delta_e.get(), "Atmosphere Delta E", GPU_MEMORY_ATMOSPHERE, gpu_texture_size(ATMOSPHERE_IRRADIANCE_W, ATMOSPHERE_IRRADIANCE_H, 1, 1, GL_RGBA32F));
+    memory.track(m_delta_sr.get(), "Atmosphere Delta SR", GPU_MEMORY_ATMOSPHERE, delta_3d_size);
+    memory.track(m_delta_sm.get(), "Atmosphere Delta SM", GPU_MEMORY_ATMOSPHERE, delta_3d_size);
+    memory.track(m_delta_j.get(), "Atmosphere Delta J", GPU_MEMORY_ATMOSPHERE, delta_3d_size);
+
+    // Transmittance
+    {
+        ShaderProgram* program = m_programs[PASS_TRANSMITTANCE].get();
+        program->use();
+        set_parameters(program, params);
+
+        transmittance->bind_image(0, 0, 0, GL_WRITE_ONLY, GL_RGBA32F);
+
+        glDispatchCompute(ATMOSPHERE_TRANSMITTANCE_W / 8, ATMOSPHERE_TRANSMITTANCE_H / 8, 1);
+        glMemoryBarrier(barrier);
+    }
+
+    // Ground irradiance due to direct sunlight.
+    {
+        ShaderProgram* program = m_programs[PASS_IRRADIANCE_1].get();
+        program->use();
+        set_parameters(program, params);
+
+        if (program->set_uniform("s_Transmittance", 0))
+            transmittance->bind(0);
+
+        m_delta_e->bind_image(0, 0, 0, GL_WRITE_ONLY, GL_RGBA32F);
+
+        glDispatchCompute(ATMOSPHERE_IRRADIANCE_W / 8, ATMOSPHERE_IRRADIANCE_H / 8, 1);
+        glMemoryBarrier(barrier);
+    }
+
+    // Single scattering, also initializes the final inscatter table.
+    {
+        ShaderProgram* program = m_programs[PASS_INSCATTER_1].get();
+        program->use();
+        set_parameters(program, params);
+
+        if (program->set_uniform("s_Transmittance", 0))
+            transmittance->bind(0);
+
+        bind_image_3d(0, m_delta_sr.get(), GL_WRITE_ONLY);
+        bind_image_3d(1, m_delta_sm.get(), GL_WRITE_ONLY);
+        bind_image_3d(2, inscatter, GL_WRITE_ONLY);
+
+        glDispatchCompute(inscatter_groups_x, inscatter_groups_y, ATMOSPHERE_INSCATTER_D);
+        glMemoryBarrier(barrier);
+    }
+
+    // The final irradiance table only contains indirect light, the direct part is computed at render time.
+    std::vector<glm::vec4> zero(ATMOSPHERE_IRRADIANCE_W * ATMOSPHERE_IRRADIANCE_H, glm::vec4(0.0f));
+    irradiance->set_data(0, 0, zero.data());
+
+    for (int order = 2; order <= params.scattering_orders; order++)
+    {
+        int first = order == 2 ? 1 : 0;
+
+        {
+            ShaderProgram* program = m_programs[PASS_INSCATTER_S].get();
+            program->use();
+            set_parameters(program, params);
+            program->set_uniform("u_First", first);
+
+            if (program->set_uniform("s_Transmittance", 0))
+                transmittance->bind(0);
+
+            if (program->set_uniform("s_DeltaE", 1))
+                m_delta_e->bind(1);
+
+            if (program->set_uniform("s_DeltaSR", 2))
+                m_delta_sr->bind(2);
+
+            if (program->set_uniform("s_DeltaSM", 3))
+                m_delta_sm->bind(3);
+
+            bind_image_3d(0, m_delta_j.get(), GL_WRITE_ONLY);
+
+            glDispatchCompute(inscatter_groups_x, inscatter_groups_y, ATMOSPHERE_INSCATTER_D);
+            glMemoryBarrier(barrier);
+        }
+
+        {
+            ShaderProgram* program = m_programs[PASS_IRRADIANCE_N].get();
+            program->use();
+            set_parameters(program, params);
+            program->set_uniform("u_First", first);
+
+            if (program->set_uniform("s_DeltaSR", 2))
+                m_delta_sr->bind(2);
+
+            if (program->set_uniform("s_DeltaSM", 3))
+                m_delta_sm->bind(3);
+
+            m_delta_e->bind_image(0, 0, 0, GL_WRITE_ONLY, GL_RGBA32F);
+            irradiance->bind_image(1, 0, 0, GL_READ_WRITE, GL_RGBA32F);
+
+            glDispatchCompute(ATMOSPHERE_IRRADIANCE_W / 8, ATMOSPHERE_IRRADIANCE_H / 8, 1);
+            glMemoryBarrier(barrier);
+        }
+
+        {
+            ShaderProgram* program = m_programs[PASS_INSCATTER_N].get();
+            program->use();
+            set_parameters(program, params);
+
+            if (program->set_uniform("s_Transmittance", 0))
+                transmittance->bind(0);
+
+            if (program->set_uniform("s_DeltaJ", 4))
+                m_delta_j->bind(4);
+
+            bind_image_3d(0, m_delta_sr.get(), GL_WRITE_ONLY);
+            bind_image_3d(1, inscatter, GL_READ_WRITE);
+
+            glDispatchCompute(inscatter_groups_x, inscatter_groups_y, ATMOSPHERE_INSCATTER_D);
+            glMemoryBarrier(barrier);
+        }
+    }
+
+    // Deleting the textures only queues their release behind the dispatches that still use them.
+    memory.destroy(m_delta_e);
+    memory.destroy(m_delta_sr);
+    memory.destroy(m_delta_sm);
+    memory.destroy(m_delta_j);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void AtmosphereComputeBaker::set_parameters(ShaderProgram* program, const AtmosphereParameters& params)
+{
+    program->set_uniform("u_BetaR", params.beta_r);
+    program->set_uniform("u_BetaMSca", params.beta_m_sca);
+    program->set_uniform("u_BetaMEx", params.beta_m_sca * params.mie_extinction);
+    program->set_uniform("u_MieG", params.mie_g);
+    program->set_uniform("u_HR", params.hr);
+    program->set_uniform("u_HM", params.hm);
+    program->set_uniform("u_GroundReflectance", params.ground_reflectance);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void AtmosphereComputeBaker::bind_image_3d(uint32_t unit, dw::Texture3D* texture, GLenum access)
+{
+    // Texture::bind_image() only binds layered images for array textures, a 3D texture needs every slice bound.
+    glBindImageTexture(unit, texture->id(), 0, GL_TRUE, 0, access, GL_RGBA32F);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
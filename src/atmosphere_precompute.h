@@ -0,0 +1,93 @@
+#pragma once
+
+#include "gpu_memory.h"
+#include "program_cache.h"
+#include <ogl.h>
+#include <memory>
+#include <vector>
+
+// Table resolutions. These must match the RES_* defines in atmosphere.glsl and atmosphere_precompute_cs.glsl.
+#define ATMOSPHERE_TRANSMITTANCE_W 256
+#define ATMOSPHERE_TRANSMITTANCE_H 64
+#define ATMOSPHERE_IRRADIANCE_W 64
+#define ATMOSPHERE_IRRADIANCE_H 16
+#define ATMOSPHERE_INSCATTER_R 32
+#define ATMOSPHERE_INSCATTER_MU 128
+#define ATMOSPHERE_INSCATTER_MU_S 32
+#define ATMOSPHERE_INSCATTER_NU 8
+#define ATMOSPHERE_INSCATTER_W (ATMOSPHERE_INSCATTER_MU_S * ATMOSPHERE_INSCATTER_NU)
+#define ATMOSPHERE_INSCATTER_H ATMOSPHERE_INSCATTER_MU
+#define ATMOSPHERE_INSCATTER_D ATMOSPHERE_INSCATTER_R
+
+// Physical description of an atmosphere, in kilometers. Everything that influences the precomputed tables lives in here
+// so that hash() can be used as a cache key.
+struct AtmosphereParameters
+{
+    glm::vec3 beta_r             = glm::vec3(0.0058f, 0.0135f, 0.0331f); // Rayleigh scattering at sea level
+    glm::vec3 beta_m_sca         = glm::vec3(0.004f);                    // Mie scattering at sea level
+    float     mie_extinction     = 1.0f / 0.9f;                          // Mie extinction / scattering ratio
+    float     mie_g              = 0.75f;                                // Mie phase function asymmetry
+    float     hr                 = 8.0f;                                 // Rayleigh scale height
+    float     hm                 = 1.2f;                                 // Mie scale height
+    float     ground_reflectance = 0.1f;
+    int32_t   scattering_orders  = 4;
+
+    uint64_t hash() const;
+};
+
+// CPU side copy of the three tables, RGBA32F, in the layout expected by dw::Texture2D/dw::Texture3D::set_data.
+struct AtmosphereTables
+{
+    std::vector<glm::vec4> transmittance;
+    std::vector<glm::vec4> irradiance;
+    std::vector<glm::vec4> inscatter;
+
+    void resize();
+};
+
+enum AtmosphereBackend
+{
+    ATMOSPHERE_BACKEND_CPU = 0,
+    ATMOSPHERE_BACKEND_COMPUTE
+};
+
+// Multithreaded reference implementation of Bruneton's precomputation. 'num_threads' of zero uses every hardware thread.
+void precompute_atmosphere_cpu(const AtmosphereParameters& params, AtmosphereTables& tables, uint32_t num_threads = 0);
+
+// Cache entries are keyed by AtmosphereParameters::hash(), so identical presets are only ever computed once per machine.
+bool load_atmosphere_cache(const AtmosphereParameters& params, AtmosphereTables& tables);
+bool save_atmosphere_cache(const AtmosphereParameters& params, const AtmosphereTables& tables);
+
+// Compute shader implementation of the same precomputation. Writes straight into the textures used for rendering.
+class AtmosphereComputeBaker
+{
+public:
+    bool initialize(ProgramCache& program_cache);
+
+    // Allocates the scratch textures of the multiple scattering passes and frees them again before returning. They are
+    // tracked in 'memory' while they exist.
+    void precompute(const AtmosphereParameters& params, dw::Texture2D* transmittance, dw::Texture2D* irradiance, dw::Texture3D* inscatter, GpuMemoryRegistry& memory);
+
+private:
+    void set_parameters(ShaderProgram* program, const AtmosphereParameters& params);
+    void bind_image_3d(uint32_t unit, dw::Texture3D* texture, GLenum access);
+
+private:
+    enum Pass
+    {
+        PASS_TRANSMITTANCE = 0,
+        PASS_IRRADIANCE_1,
+        PASS_INSCATTER_1,
+        PASS_INSCATTER_S,
+        PASS_IRRADIANCE_N,
+        PASS_INSCATTER_N,
+        PASS_COUNT
+    };
+
+    std::unique_ptr<ShaderProgram> m_programs[PASS_COUNT];
+
+    std::unique_ptr<dw::Texture2D> m_delta_e;
+    std::unique_ptr<dw::Texture3D> m_delta_sr;
+    std::unique_ptr<dw::Texture3D> m_delta_sm;
+    std::unique_ptr<dw::Texture3D> m_delta_j;
+};
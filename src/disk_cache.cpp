@@ -0,0 +1,130 @@
+#include "disk_cache.h"
+#include <stdio.h>
+#include <sys/stat.h>
+#if defined(_WIN32)
+#    include <direct.h>
+#endif
+
+#define CACHE_DIRECTORY "cache"
+
+namespace disk_cache
+{
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static bool create_directory()
+{
+#if defined(_WIN32)
+    _mkdir(CACHE_DIRECTORY);
+#else
+    mkdir(CACHE_DIRECTORY, 0755);
+#endif
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+std::string path(const std::string& name)
+{
+    // Startup tasks call this from several threads, static initialisation runs exactly once.
+    static bool created = create_directory();
+    (void)created;
+
+    return std::string(CACHE_DIRECTORY) + "/" + name;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+uint64_t hash(const void* data, size_t size, uint64_t seed)
+{
+    const uint8_t* bytes = (const uint8_t*)data;
+    uint64_t       h     = seed;
+
+    for (size_t i = 0; i < size; i++)
+    {
+        h ^= bytes[i];
+        h *= 1099511628211ull;
+    }
+
+    return h;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+uint64_t hash(const std::string& str, uint64_t seed)
+{
+    return hash(str.data(), str.size(), seed);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+std::string to_hex(uint64_t hash)
+{
+    char buffer[17];
+    snprintf(buffer, sizeof(buffer), "%016llx", (unsigned long long)hash);
+    return std::string(buffer);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool exists(const std::string& path)
+{
+    struct stat info;
+    return stat(path.c_str(), &info) == 0;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool read(const std::string& path, std::vector<uint8_t>& data)
+{
+    FILE* f = fopen(path.c_str(), "rb");
+
+    if (!f)
+        return false;
+
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    if (size < 0)
+    {
+        fclose(f);
+        return false;
+    }
+
+    data.resize(size);
+
+    bool ok = size == 0 || fread(data.data(), size, 1, f) == 1;
+
+    fclose(f);
+
+    return ok;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool write(const std::string& path, const void* data, size_t size)
+{
+    std::string tmp = path + ".tmp";
+    FILE*       f   = fopen(tmp.c_str(), "wb");
+
+    if (!f)
+        return false;
+
+    bool ok = size == 0 || fwrite(data, size, 1, f) == 1;
+
+    fclose(f);
+
+    if (!ok)
+    {
+        remove(tmp.c_str());
+        return false;
+    }
+
+    // rename() does not replace an existing file on Windows.
+    remove(path.c_str());
+
+    return rename(tmp.c_str(), path.c_str()) == 0;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+} // namespace disk_cache
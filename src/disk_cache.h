@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Small helpers shared by everything that persists derived data (baked tables, binaries, tuning results) between runs.
+namespace disk_cache
+{
+// Returns the path of a file inside the cache directory, creating the directory on first use.
+std::string path(const std::string& name);
+
+// 64-bit FNV-1a. Chain calls through 'seed' to hash several fields into one key.
+uint64_t hash(const void* data, size_t size, uint64_t seed = 14695981039346656037ull);
+uint64_t hash(const std::string& str, uint64_t seed = 14695981039346656037ull);
+
+// Formats a hash as a fixed width hex string suitable for file names.
+std::string to_hex(uint64_t hash);
+
+bool exists(const std::string& path);
+bool read(const std::string& path, std::vector<uint8_t>& data);
+
+// Writes to a temporary file first and renames it over the target so that a crash never leaves a truncated cache entry.
+bool write(const std::string& path, const void* data, size_t size);
+} // namespace disk_cache
@@ -0,0 +1,361 @@
+#include "frame_graph.h"
+#include "gl_state.h"
+#include "gpu_memory.h"
+
+// Pooled textures left unused for this many frames are freed.
+#define FRAME_GRAPH_POOL_FRAMES 120
+
+static const GLbitfield kAccessBarriers[FRAME_ACCESS_COUNT] = {
+    GL_TEXTURE_FETCH_BARRIER_BIT,
+    GL_SHADER_IMAGE_ACCESS_BARRIER_BIT,
+    GL_SHADER_STORAGE_BARRIER_BIT,
+    GL_UNIFORM_BARRIER_BIT,
+    GL_FRAMEBUFFER_BARRIER_BIT,
+    GL_TEXTURE_UPDATE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT | GL_PIXEL_BUFFER_BARRIER_BIT
+};
+
+static const GLbitfield kAllBarriers = GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT | GL_UNIFORM_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT | GL_PIXEL_BUFFER_BARRIER_BIT;
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+std::string frame_barrier_string(GLbitfield barriers)
+{
+    static const struct
+    {
+        GLbitfield  bit;
+        const char* name;
+    } kNames[] = {
+        { GL_TEXTURE_FETCH_BARRIER_BIT, "FETCH" },
+        { GL_SHADER_IMAGE_ACCESS_BARRIER_BIT, "IMAGE" },
+        { GL_SHADER_STORAGE_BARRIER_BIT, "STORAGE" },
+        { GL_UNIFORM_BARRIER_BIT, "UNIFORM" },
+        { GL_FRAMEBUFFER_BARRIER_BIT, "FRAMEBUFFER" },
+        { GL_TEXTURE_UPDATE_BARRIER_BIT, "TEXTURE_UPDATE" },
+        { GL_BUFFER_UPDATE_BARRIER_BIT, "BUFFER_UPDATE" },
+        { GL_PIXEL_BUFFER_BARRIER_BIT, "PIXEL_BUFFER" }
+    };
+
+    std::string result;
+
+    for (const auto& name : kNames)
+    {
+        if (barriers & name.bit)
+            result += (result.empty() ? "" : "|") + std::string(name.name);
+    }
+
+    return result.empty() ? "none" : result;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool FrameTextureDesc::operator==(const FrameTextureDesc& other) const
+{
+    return width == other.width && height == other.height && layers == other.layers && mip_levels == other.mip_levels && internal_format == other.internal_format && format == other.format && type == other.type && filter == other.filter;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+uint32_t FrameGraph::import(const void* resource, const std::string& name)
+{
+    auto it = m_imported.find(resource);
+
+    if (it != m_imported.end())
+        return it->second;
+
+    Resource entry;
+
+    entry.name   = name;
+    entry.object = resource;
+
+    uint32_t id = uint32_t(m_resources.size());
+
+    m_resources.push_back(entry);
+    m_imported[resource] = id;
+
+    return id;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+uint32_t FrameGraph::create_texture(const std::string& name, const FrameTextureDesc& desc)
+{
+    Resource entry;
+
+    entry.name = name;
+    entry.desc = desc;
+
+    m_resources.push_back(entry);
+
+    return uint32_t(m_resources.size() - 1);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+uint32_t FrameGraph::add_pass(const std::string& name, std::initializer_list<FrameResourceUse> reads, std::initializer_list<FrameResourceUse> writes, Function function, bool side_effects)
+{
+    Pass pass;
+
+    pass.name         = name;
+    pass.reads        = reads;
+    pass.writes       = writes;
+    pass.function     = function;
+    pass.side_effects = side_effects;
+
+    m_passes.push_back(pass);
+
+    return uint32_t(m_passes.size() - 1);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void FrameGraph::execute(GLState& gl, GpuMemoryRegistry& memory)
+{
+    // Walk backwards so that a pass is only kept if something that runs after it consumes its output.
+    std::vector<bool> needed(m_resources.size(), false);
+
+    for (int32_t i = int32_t(m_passes.size()) - 1; i >= 0; i--)
+    {
+        Pass& pass = m_passes[i];
+        bool  live = pass.side_effects;
+
+        for (const auto& use : pass.writes)
+            live = live || needed[use.resource];
+
+        pass.culled = !live;
+
+        if (live)
+        {
+            for (const auto& use : pass.reads)
+                needed[use.resource] = true;
+        }
+    }
+
+    for (int32_t i = 0; i < int32_t(m_passes.size()); i++)
+    {
+        if (m_passes[i].culled)
+            continue;
+
+        for (const auto* uses : { &m_passes[i].reads, &m_passes[i].writes })
+        {
+            for (const auto& use : *uses)
+            {
+                Resource& resource = m_resources[use.resource];
+
+                if (resource.first < 0)
+                    resource.first = i;
+
+                resource.last = i;
+            }
+        }
+    }
+
+    // Transients are assigned in order of first use, so a texture freed by an earlier pass is picked up by a later one.
+    for (auto& texture : m_pool)
+        texture.busy_until = -1;
+
+    m_transient_count = 0;
+
+    for (int32_t i = 0; i < int32_t(m_passes.size()); i++)
+    {
+        for (auto& resource : m_resources)
+        {
+            if (!resource.object && resource.first == i)
+            {
+                resource.physical = acquire(resource.desc, resource.first, resource.last, memory);
+                m_transient_count++;
+            }
+        }
+    }
+
+    m_report.clear();
+    m_barrier_count = 0;
+
+    for (auto& pass : m_passes)
+    {
+        FramePassReport report = { pass.name, 0, pass.culled };
+
+        if (pass.culled)
+        {
+            m_report.push_back(report);
+            continue;
+        }
+
+        GLbitfield barriers = 0;
+
+        for (const auto* uses : { &pass.reads, &pass.writes })
+        {
+            for (const auto& use : *uses)
+            {
+                ResourceState& resource_state = state(key(use.resource));
+
+                barriers |= resource_state.pending & kAccessBarriers[use.access];
+                resource_state.last_frame = m_frame;
+            }
+        }
+
+        if (barriers)
+        {
+            gl.memory_barrier(barriers);
+            m_barrier_count++;
+
+            for (auto& entry : m_states)
+                entry.second.pending &= ~barriers;
+        }
+
+        pass.function();
+
+        // Image and storage stores are the only writes GL does not order against later commands by itself.
+        for (const auto& use : pass.writes)
+        {
+            if (use.access == FRAME_ACCESS_IMAGE || use.access == FRAME_ACCESS_STORAGE)
+                state(key(use.resource)).pending = kAllBarriers;
+        }
+
+        report.barriers = barriers;
+        m_report.push_back(report);
+    }
+
+    // Objects that were not used this frame may be destroyed and their address reused.
+    for (auto it = m_states.begin(); it != m_states.end();)
+    {
+        if (it->second.last_frame != m_frame)
+            it = m_states.erase(it);
+        else
+            ++it;
+    }
+
+    release_unused(memory);
+
+    m_resources.clear();
+    m_passes.clear();
+    m_imported.clear();
+
+    m_frame++;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+dw::Texture2D* FrameGraph::texture(uint32_t resource) const
+{
+    int32_t physical = m_resources[resource].physical;
+
+    return physical >= 0 ? m_pool[physical].texture.get() : nullptr;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+dw::Texture2D* FrameGraph::scratch_texture(const FrameTextureDesc& desc, GpuMemoryRegistry& memory)
+{
+    // Outside execute() no transient is live, so every matching texture is free.
+    for (auto& texture : m_pool)
+        texture.busy_until = -1;
+
+    int32_t physical = acquire(desc, 0, 0, memory);
+
+    // Its barrier state is unknown to the graph from now on.
+    m_states.erase(m_pool[physical].texture.get());
+
+    return m_pool[physical].texture.get();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void FrameGraph::invalidate()
+{
+    for (auto& state : m_states)
+        state.second.pending = kAllBarriers;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void FrameGraph::shutdown(GpuMemoryRegistry& memory)
+{
+    for (auto& texture : m_pool)
+        memory.destroy(texture.texture);
+
+    m_pool.clear();
+    m_states.clear();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+int32_t FrameGraph::acquire(const FrameTextureDesc& desc, int32_t first, int32_t last, GpuMemoryRegistry& memory)
+{
+    int32_t physical = -1;
+
+    for (int32_t i = 0; i < int32_t(m_pool.size()); i++)
+    {
+        if (m_pool[i].desc == desc && m_pool[i].busy_until < first)
+        {
+            physical = i;
+            break;
+        }
+    }
+
+    if (physical < 0)
+    {
+        PooledTexture texture;
+
+        texture.desc    = desc;
+        texture.texture = std::make_unique<dw::Texture2D>(desc.width, desc.height, desc.layers, desc.mip_levels, 1, desc.internal_format, desc.format, desc.type);
+
+        texture.texture->set_min_filter(desc.filter);
+        texture.texture->set_mag_filter(desc.filter);
+
+        memory.track(texture.texture.get(), "Frame Graph Texture " + std::to_string(m_pool_serial++), GPU_MEMORY_TRANSIENT, gpu_texture_size(desc.width, desc.height, desc.layers, desc.mip_levels, desc.internal_format));
+
+        // Nothing has written the new texture yet.
+        state(texture.texture.get()).pending = 0;
+
+        m_pool.push_back(std::move(texture));
+        physical = int32_t(m_pool.size() - 1);
+    }
+
+    m_pool[physical].busy_until = last;
+    m_pool[physical].last_frame = m_frame;
+
+    return physical;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+const void* FrameGraph::key(uint32_t resource) const
+{
+    const Resource& entry = m_resources[resource];
+
+    return entry.object ? entry.object : m_pool[entry.physical].texture.get();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+FrameGraph::ResourceState& FrameGraph::state(const void* resource)
+{
+    auto it = m_states.find(resource);
+
+    // Anything the graph has not seen yet may have been written by anyone.
+    if (it == m_states.end())
+    {
+        it = m_states.emplace(resource, ResourceState()).first;
+        it->second.pending = kAllBarriers;
+    }
+
+    return it->second;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void FrameGraph::release_unused(GpuMemoryRegistry& memory)
+{
+    for (auto it = m_pool.begin(); it != m_pool.end();)
+    {
+        if (it->last_frame + FRAME_GRAPH_POOL_FRAMES < m_frame)
+        {
+            memory.destroy(it->texture);
+            it = m_pool.erase(it);
+        }
+        else
+            ++it;
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <ogl.h>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class GLState;
+class GpuMemoryRegistry;
+
+// How a pass touches a resource. Each one maps to the glMemoryBarrier() bit that makes earlier image and storage
+// writes visible to it.
+enum FrameAccess
+{
+    FRAME_ACCESS_SAMPLED = 0,   // Texture fetches.
+    FRAME_ACCESS_IMAGE,         // Image loads and stores.
+    FRAME_ACCESS_STORAGE,       // Shader storage reads, writes and atomics.
+    FRAME_ACCESS_UNIFORM,       // Uniform block reads.
+    FRAME_ACCESS_RENDER_TARGET, // Framebuffer attachments.
+    FRAME_ACCESS_TRANSFER,      // Texture and buffer uploads, copies and readbacks.
+    FRAME_ACCESS_COUNT
+};
+
+// Short names of the bits in 'barriers' for the UI, e.g. "FETCH|IMAGE".
+std::string frame_barrier_string(GLbitfield barriers);
+
+struct FrameTextureDesc
+{
+    uint32_t width           = 1;
+    uint32_t height          = 1;
+    uint32_t layers          = 1;
+    uint32_t mip_levels      = 1;
+    GLenum   internal_format = GL_RGBA8;
+    GLenum   format          = GL_RGBA;
+    GLenum   type            = GL_UNSIGNED_BYTE;
+    GLenum   filter          = GL_LINEAR;
+
+    bool operator==(const FrameTextureDesc& other) const;
+};
+
+struct FrameResourceUse
+{
+    uint32_t    resource;
+    FrameAccess access;
+};
+
+// What happened to one pass in the last execute().
+struct FramePassReport
+{
+    std::string name;
+    GLbitfield  barriers;
+    bool        culled;
+};
+
+// Declarative description of one frame. Passes list what they read and write, and execute() derives the rest: passes
+// nobody consumes are culled, every pass waits only for the barrier bits its own accesses need, and transient textures
+// exist only between their first and last use. Transients with the same description and disjoint lifetimes share one
+// texture, which is as close as GL gets to aliasing memory. The graph is rebuilt every frame, while the barrier state of
+// imported resources carries over, so writes from the previous frame are waited for where they are first read.
+class FrameGraph
+{
+public:
+    typedef std::function<void()> Function;
+
+    // A persistent object, keyed by its address. Importing the same object twice returns the same handle.
+    uint32_t import(const void* resource, const std::string& name);
+
+    // Contents are undefined until the first pass writing it has run.
+    uint32_t create_texture(const std::string& name, const FrameTextureDesc& desc);
+
+    // Passes run in the order they are added. One without 'side_effects' is culled unless a later pass that runs reads
+    // something it writes. A pass that modifies part of a resource has to list it among its reads as well.
+    uint32_t add_pass(const std::string& name, std::initializer_list<FrameResourceUse> reads, std::initializer_list<FrameResourceUse> writes, Function function, bool side_effects = false);
+
+    // Runs the passes and clears the graph for the next frame.
+    void execute(GLState& gl, GpuMemoryRegistry& memory);
+
+    // The texture behind a transient. Only valid inside the passes that use it.
+    dw::Texture2D* texture(uint32_t resource) const;
+
+    // A pooled texture for work outside the graph, such as tuning. Valid until the next execute().
+    dw::Texture2D* scratch_texture(const FrameTextureDesc& desc, GpuMemoryRegistry& memory);
+
+    // Resources may have been written by image or storage stores issued outside the graph. Their next use waits for all
+    // of them.
+    void invalidate();
+
+    void shutdown(GpuMemoryRegistry& memory);
+
+    inline const std::vector<FramePassReport>& last_frame() const { return m_report; }
+    inline uint32_t                            barrier_count() const { return m_barrier_count; }
+    inline uint32_t                            transient_count() const { return m_transient_count; }
+    inline uint32_t                            pool_count() const { return uint32_t(m_pool.size()); }
+
+private:
+    struct Resource
+    {
+        std::string      name;
+        const void*      object = nullptr; // nullptr for transients.
+        FrameTextureDesc desc;
+        int32_t          physical = -1;
+        int32_t          first    = -1;
+        int32_t          last     = -1;
+    };
+
+    struct Pass
+    {
+        std::string                   name;
+        std::vector<FrameResourceUse> reads;
+        std::vector<FrameResourceUse> writes;
+        Function                      function;
+        bool                          side_effects = false;
+        bool                          culled       = false;
+    };
+
+    struct PooledTexture
+    {
+        FrameTextureDesc               desc;
+        std::unique_ptr<dw::Texture2D> texture;
+        uint64_t                       last_frame = 0;
+        int32_t                        busy_until = -1; // Index of the last pass using it this frame.
+    };
+
+    struct ResourceState
+    {
+        GLbitfield pending    = 0; // Barrier bits not issued since the last incoherent write.
+        uint64_t   last_frame = 0;
+    };
+
+    int32_t        acquire(const FrameTextureDesc& desc, int32_t first, int32_t last, GpuMemoryRegistry& memory);
+    const void*    key(uint32_t resource) const;
+    ResourceState& state(const void* resource);
+    void           release_unused(GpuMemoryRegistry& memory);
+
+private:
+    std::vector<Resource>                          m_resources;
+    std::vector<Pass>                              m_passes;
+    std::unordered_map<const void*, uint32_t>      m_imported;
+    std::unordered_map<const void*, ResourceState> m_states;
+    std::vector<PooledTexture>                     m_pool;
+    std::vector<FramePassReport>                   m_report;
+    uint64_t                                       m_frame           = 1;
+    uint32_t                                       m_pool_serial     = 0;
+    uint32_t                                       m_barrier_count   = 0;
+    uint32_t                                       m_transient_count = 0;
+};
@@ -0,0 +1,231 @@
+#include "gl_state.h"
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void GLState::begin_frame()
+{
+    m_last_frame = m_counters;
+    m_counters   = GLCounters();
+
+    invalidate();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void GLState::invalidate()
+{
+    m_depth_test   = -1;
+    m_cull_face    = -1;
+    m_blend        = -1;
+    m_depth_func   = -1;
+    m_clear_known  = false;
+    m_fbo_known    = false;
+    m_framebuffer  = nullptr;
+    m_vertex_array = nullptr;
+    m_program      = -1;
+
+    for (int i = 0; i < 4; i++)
+        m_viewport[i] = -1;
+
+    for (int i = 0; i < GL_STATE_TEXTURE_UNITS; i++)
+        m_textures[i] = nullptr;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool GLState::changed(int32_t* cached, int32_t value, uint32_t& counter)
+{
+    if (*cached == value)
+    {
+        m_counters.redundant++;
+        return false;
+    }
+
+    *cached = value;
+    counter++;
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void GLState::enable(GLenum capability, bool enabled)
+{
+    int32_t* cached = nullptr;
+
+    if (capability == GL_DEPTH_TEST)
+        cached = &m_depth_test;
+    else if (capability == GL_CULL_FACE)
+        cached = &m_cull_face;
+    else if (capability == GL_BLEND)
+        cached = &m_blend;
+
+    // Untracked capabilities are always forwarded.
+    if (cached && !changed(cached, enabled ? 1 : 0, m_counters.state_changes))
+        return;
+
+    if (!cached)
+        m_counters.state_changes++;
+
+    if (enabled)
+        glEnable(capability);
+    else
+        glDisable(capability);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void GLState::depth_func(GLenum func)
+{
+    if (changed(&m_depth_func, int32_t(func), m_counters.state_changes))
+        glDepthFunc(func);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void GLState::viewport(int32_t x, int32_t y, int32_t width, int32_t height)
+{
+    if (m_viewport[0] == x && m_viewport[1] == y && m_viewport[2] == width && m_viewport[3] == height)
+    {
+        m_counters.redundant++;
+        return;
+    }
+
+    m_viewport[0] = x;
+    m_viewport[1] = y;
+    m_viewport[2] = width;
+    m_viewport[3] = height;
+
+    m_counters.state_changes++;
+    glViewport(x, y, width, height);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void GLState::clear_color(const glm::vec4& color)
+{
+    if (m_clear_known && m_clear_color == color)
+    {
+        m_counters.redundant++;
+        return;
+    }
+
+    m_clear_color = color;
+    m_clear_known = true;
+
+    m_counters.state_changes++;
+    glClearColor(color.x, color.y, color.z, color.w);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void GLState::clear(GLbitfield mask)
+{
+    glClear(mask);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void GLState::bind_framebuffer(dw::Framebuffer* framebuffer)
+{
+    if (m_fbo_known && m_framebuffer == framebuffer)
+    {
+        m_counters.redundant++;
+        return;
+    }
+
+    m_framebuffer = framebuffer;
+    m_fbo_known   = true;
+
+    m_counters.binds++;
+
+    if (framebuffer)
+        framebuffer->bind();
+    else
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void GLState::bind_vertex_array(dw::VertexArray* vertex_array)
+{
+    if (m_vertex_array == vertex_array)
+    {
+        m_counters.redundant++;
+        return;
+    }
+
+    m_vertex_array = vertex_array;
+
+    m_counters.binds++;
+    vertex_array->bind();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void GLState::bind_texture(uint32_t unit, dw::Texture* texture)
+{
+    if (unit < GL_STATE_TEXTURE_UNITS)
+    {
+        if (m_textures[unit] == texture)
+        {
+            m_counters.redundant++;
+            return;
+        }
+
+        m_textures[unit] = texture;
+    }
+
+    m_counters.binds++;
+    texture->bind(unit);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool GLState::use_program(GLuint program)
+{
+    if (m_program == int64_t(program))
+    {
+        m_counters.redundant++;
+        return false;
+    }
+
+    m_program = int64_t(program);
+    m_counters.binds++;
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void GLState::draw_arrays(GLenum mode, int32_t first, int32_t count)
+{
+    m_counters.draws++;
+    glDrawArrays(mode, first, count);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void GLState::multi_draw_elements_indirect(GLenum mode, GLenum type, int32_t draw_count)
+{
+    m_counters.draws++;
+    glMultiDrawElementsIndirect(mode, type, nullptr, draw_count, 0);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void GLState::dispatch(uint32_t x, uint32_t y, uint32_t z)
+{
+    m_counters.dispatches++;
+    glDispatchCompute(x, y, z);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void GLState::memory_barrier(GLbitfield barriers)
+{
+    m_counters.barriers++;
+    glMemoryBarrier(barriers);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
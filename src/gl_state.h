@@ -0,0 +1,73 @@
+#pragma once
+
+#include <ogl.h>
+
+#define GL_STATE_TEXTURE_UNITS 16
+
+// API calls issued through GLState in one frame.
+struct GLCounters
+{
+    uint32_t draws           = 0;
+    uint32_t dispatches      = 0;
+    uint32_t barriers        = 0;
+    uint32_t binds           = 0; // Programs, framebuffers, vertex arrays and textures.
+    uint32_t state_changes   = 0; // Capabilities, depth function, viewport and clear colour.
+    uint32_t uniform_updates = 0; // set_uniform() calls and uniform block binds.
+    uint32_t redundant       = 0; // Binds and state changes skipped because GL already had the value.
+};
+
+// Thin layer between the sample and GL. Binds and fixed-function state set through it only reach GL when they change,
+// and every call is counted. Anything that changes the same state directly (the framework, ImGui, dw::Texture helpers
+// such as set_data() and generate_mipmaps()) has to be followed by invalidate().
+class GLState
+{
+public:
+    // Publishes the counters of the previous frame and forgets all state, since ImGui renders between frames.
+    void begin_frame();
+    void invalidate();
+
+    void enable(GLenum capability, bool enabled);
+    void depth_func(GLenum func);
+    void viewport(int32_t x, int32_t y, int32_t width, int32_t height);
+    void clear_color(const glm::vec4& color);
+    void clear(GLbitfield mask);
+
+    // nullptr binds the default framebuffer.
+    void bind_framebuffer(dw::Framebuffer* framebuffer);
+    void bind_vertex_array(dw::VertexArray* vertex_array);
+    void bind_texture(uint32_t unit, dw::Texture* texture);
+
+    // Returns false if 'program' is already current. Used by ShaderProgram::use().
+    bool use_program(GLuint program);
+
+    void draw_arrays(GLenum mode, int32_t first, int32_t count);
+    void multi_draw_elements_indirect(GLenum mode, GLenum type, int32_t draw_count);
+    void dispatch(uint32_t x, uint32_t y, uint32_t z);
+    void memory_barrier(GLbitfield barriers);
+
+    inline void count_uniform_update() { m_counters.uniform_updates++; }
+
+    inline const GLCounters& counters() const { return m_counters; } // The frame in progress.
+    inline const GLCounters& last_frame() const { return m_last_frame; }
+
+private:
+    bool changed(int32_t* cached, int32_t value, uint32_t& counter);
+
+private:
+    GLCounters m_counters;
+    GLCounters m_last_frame;
+
+    // -1, nullptr or a cleared 'known' flag means GL may hold anything.
+    int32_t          m_depth_test   = -1;
+    int32_t          m_cull_face    = -1;
+    int32_t          m_blend        = -1;
+    int32_t          m_depth_func   = -1;
+    int32_t          m_viewport[4]  = { -1, -1, -1, -1 };
+    glm::vec4        m_clear_color  = glm::vec4(-1.0f);
+    bool             m_clear_known  = false;
+    bool             m_fbo_known    = false;
+    dw::Framebuffer* m_framebuffer  = nullptr;
+    dw::VertexArray* m_vertex_array = nullptr;
+    int64_t          m_program      = -1;
+    dw::Texture*     m_textures[GL_STATE_TEXTURE_UNITS] = {};
+};
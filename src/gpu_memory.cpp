@@ -0,0 +1,194 @@
+#include "gpu_memory.h"
+#include <logger.h>
+#include <algorithm>
+#include <vector>
+#include <stdio.h>
+
+static const char* kCategoryNames[GPU_MEMORY_CATEGORY_COUNT] = { "IBL", "Atmosphere", "Source", "Streaming", "Transient" };
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+const char* gpu_memory_category_name(GpuMemoryCategory category)
+{
+    return kCategoryNames[category];
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static size_t texel_size(GLenum internal_format)
+{
+    switch (internal_format)
+    {
+        case GL_RGBA32F:
+            return 16;
+        case GL_RGB32F:
+            return 12;
+        case GL_RGBA16F:
+        case GL_RG32F:
+            return 8;
+        case GL_RGB16F:
+            return 6;
+        case GL_RG16F:
+        case GL_R32F:
+        case GL_RGBA8:
+        case GL_SRGB8_ALPHA8:
+        case GL_DEPTH_COMPONENT32F:
+        case GL_DEPTH24_STENCIL8:
+            return 4;
+        case GL_R16F:
+            return 2;
+        case GL_R8:
+            return 1;
+        default:
+            DW_LOG_WARNING("Unknown internal format " + std::to_string(internal_format) + ", assuming 4 bytes per texel");
+            return 4;
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+size_t gpu_texture_size(uint32_t width, uint32_t height, uint32_t layers, uint32_t mip_levels, GLenum internal_format)
+{
+    size_t texels = 0;
+
+    for (uint32_t mip = 0; mip < mip_levels; mip++)
+        texels += size_t(std::max(width >> mip, 1u)) * std::max(height >> mip, 1u) * layers;
+
+    return texels * texel_size(internal_format);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void GpuMemoryRegistry::track(const void* resource, const std::string& name, GpuMemoryCategory category, size_t size)
+{
+    if (!resource)
+        return;
+
+    for (auto& entry : m_entries)
+    {
+        if (entry.first != resource && entry.second.name == name)
+        {
+            DW_LOG_WARNING("GPU memory leak: " + name + " was recreated while the previous one (" + std::to_string(entry.second.size) + " bytes) is still registered");
+            m_leak_count++;
+            break;
+        }
+    }
+
+    // Re-registering the same object only updates its size.
+    release(resource);
+
+    m_entries[resource] = { name, category, size };
+
+    m_current[category] += size;
+    m_current_total += size;
+    m_peak[category] = std::max(m_peak[category], m_current[category]);
+    m_peak_total     = std::max(m_peak_total, m_current_total);
+
+    m_allocation_count++;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void GpuMemoryRegistry::release(const void* resource)
+{
+    auto it = m_entries.find(resource);
+
+    if (it == m_entries.end())
+        return;
+
+    m_current[it->second.category] -= it->second.size;
+    m_current_total -= it->second.size;
+
+    m_entries.erase(it);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void GpuMemoryRegistry::report_leaks()
+{
+    for (auto& entry : m_entries)
+    {
+        DW_LOG_WARNING("GPU memory leak: " + entry.second.name + " (" + std::to_string(entry.second.size) + " bytes) was never released");
+        m_leak_count++;
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static std::string json_string(const std::string& str)
+{
+    std::string out = "\"";
+
+    for (char c : str)
+    {
+        if (c == '"' || c == '\\')
+            out += '\\';
+
+        out += c;
+    }
+
+    return out + "\"";
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+std::string GpuMemoryRegistry::to_json() const
+{
+    // Largest resources first so that the report reads as a budget.
+    std::vector<const GpuMemoryEntry*> sorted;
+
+    for (auto& entry : m_entries)
+        sorted.push_back(&entry.second);
+
+    std::sort(sorted.begin(), sorted.end(), [](const GpuMemoryEntry* a, const GpuMemoryEntry* b) { return a->size != b->size ? a->size > b->size : a->name < b->name; });
+
+    std::string json = "{\n";
+
+    json += "    \"current_bytes\": " + std::to_string(m_current_total) + ",\n";
+    json += "    \"peak_bytes\": " + std::to_string(m_peak_total) + ",\n";
+    json += "    \"allocations\": " + std::to_string(m_allocation_count) + ",\n";
+    json += "    \"leaks\": " + std::to_string(m_leak_count) + ",\n";
+    json += "    \"categories\": {\n";
+
+    for (int i = 0; i < GPU_MEMORY_CATEGORY_COUNT; i++)
+    {
+        json += "        " + json_string(kCategoryNames[i]) + ": { \"current_bytes\": " + std::to_string(m_current[i]) + ", \"peak_bytes\": " + std::to_string(m_peak[i]) + " }";
+        json += i + 1 < GPU_MEMORY_CATEGORY_COUNT ? ",\n" : "\n";
+    }
+
+    json += "    },\n";
+    json += "    \"resources\": [\n";
+
+    for (size_t i = 0; i < sorted.size(); i++)
+    {
+        json += "        { \"name\": " + json_string(sorted[i]->name) + ", \"category\": " + json_string(kCategoryNames[sorted[i]->category]) + ", \"bytes\": " + std::to_string(sorted[i]->size) + " }";
+        json += i + 1 < sorted.size() ? ",\n" : "\n";
+    }
+
+    json += "    ]\n";
+    json += "}\n";
+
+    return json;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool GpuMemoryRegistry::write_json(const std::string& path) const
+{
+    FILE* file = fopen(path.c_str(), "wb");
+
+    if (!file)
+    {
+        DW_LOG_ERROR("Failed to open " + path);
+        return false;
+    }
+
+    std::string json    = to_json();
+    bool        written = fwrite(json.data(), 1, json.size(), file) == json.size();
+
+    fclose(file);
+
+    return written;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
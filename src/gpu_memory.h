@@ -0,0 +1,74 @@
+#pragma once
+
+#include <ogl.h>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+enum GpuMemoryCategory
+{
+    GPU_MEMORY_IBL = 0,    // Environment capture, prefiltered cubemaps, SH, BRDF LUT and their work buffers.
+    GPU_MEMORY_ATMOSPHERE, // Precomputed scattering tables.
+    GPU_MEMORY_SOURCE,     // Source environment images.
+    GPU_MEMORY_STREAMING,  // Per-frame uniforms and prefilter constants.
+    GPU_MEMORY_TRANSIENT,  // Frame graph textures shared by passes with disjoint lifetimes.
+    GPU_MEMORY_CATEGORY_COUNT
+};
+
+const char* gpu_memory_category_name(GpuMemoryCategory category);
+
+// Bytes taken by a texture of 'layers' layers (6 for a cubemap, the depth for a single level 3D texture) and
+// 'mip_levels' levels, assuming the driver stores texels tightly packed in 'internal_format'.
+size_t gpu_texture_size(uint32_t width, uint32_t height, uint32_t layers, uint32_t mip_levels, GLenum internal_format);
+
+struct GpuMemoryEntry
+{
+    std::string       name;
+    GpuMemoryCategory category;
+    size_t            size;
+};
+
+// Book-keeping of the GPU allocations made by the sample, keyed by the object owning them. Owners register a resource
+// right after creating it and release it right before destroying it. It does not allocate anything itself.
+class GpuMemoryRegistry
+{
+public:
+    // A name still registered under another object means that object was replaced without being released, which is
+    // reported as a leak.
+    void track(const void* resource, const std::string& name, GpuMemoryCategory category, size_t size);
+
+    // Unknown objects, nullptr included, are ignored.
+    void release(const void* resource);
+
+    // Releases and destroys the object held by 'resource'.
+    template <typename T>
+    void destroy(std::unique_ptr<T>& resource)
+    {
+        release(resource.get());
+        resource.reset();
+    }
+
+    // Logs every resource that is still registered. Called at shutdown once everything has been released.
+    void report_leaks();
+
+    std::string to_json() const;
+    bool        write_json(const std::string& path) const;
+
+    inline size_t   current(GpuMemoryCategory category) const { return m_current[category]; }
+    inline size_t   peak(GpuMemoryCategory category) const { return m_peak[category]; }
+    inline size_t   current_total() const { return m_current_total; }
+    inline size_t   peak_total() const { return m_peak_total; }
+    inline uint32_t allocation_count() const { return m_allocation_count; }
+    inline uint32_t leak_count() const { return m_leak_count; }
+
+    inline const std::unordered_map<const void*, GpuMemoryEntry>& entries() const { return m_entries; }
+
+private:
+    std::unordered_map<const void*, GpuMemoryEntry> m_entries;
+    size_t                                          m_current[GPU_MEMORY_CATEGORY_COUNT] = {};
+    size_t                                          m_peak[GPU_MEMORY_CATEGORY_COUNT]    = {};
+    size_t                                          m_current_total                      = 0;
+    size_t                                          m_peak_total                         = 0;
+    uint32_t                                        m_allocation_count                   = 0; // Every track() call, so that reallocations show up.
+    uint32_t                                        m_leak_count                         = 0;
+};
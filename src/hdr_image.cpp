@@ -0,0 +1,160 @@
+#include "hdr_image.h"
+#include "mapped_file.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#define HDR_MIN_RLE_WIDTH 8
+#define HDR_MAX_RLE_WIDTH 0x7fff
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static bool fail(std::string* error, const std::string& message)
+{
+    if (error)
+        *error = message;
+
+    return false;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Reads one '\n' terminated line starting at 'offset' and moves past it.
+static bool read_line(const MappedFile& file, size_t& offset, std::string& line)
+{
+    const uint8_t* begin = file.data() + offset;
+    const uint8_t* end   = (const uint8_t*)memchr(begin, '\n', file.size() - offset);
+
+    if (!end)
+        return false;
+
+    line.assign((const char*)begin, end - begin);
+    offset += (end - begin) + 1;
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Expands the four run-length encoded channel planes of one scanline into interleaved RGBE.
+static bool decode_rle_scanline(const MappedFile& file, size_t& offset, uint32_t width, uint8_t* rgbe)
+{
+    const uint8_t* data = file.data();
+    size_t         size = file.size();
+
+    for (uint32_t channel = 0; channel < 4; channel++)
+    {
+        uint32_t x = 0;
+
+        while (x < width)
+        {
+            if (offset >= size)
+                return false;
+
+            uint32_t count = data[offset++];
+
+            if (count > 128)
+            {
+                count -= 128;
+
+                if (x + count > width || offset >= size)
+                    return false;
+
+                uint8_t value = data[offset++];
+
+                for (uint32_t i = 0; i < count; i++)
+                    rgbe[(x++) * 4 + channel] = value;
+            }
+            else
+            {
+                if (count == 0 || x + count > width || offset + count > size)
+                    return false;
+
+                for (uint32_t i = 0; i < count; i++)
+                    rgbe[(x++) * 4 + channel] = data[offset++];
+            }
+        }
+    }
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool load_hdr_image(const std::string& path, HdrImage& image, std::string* error)
+{
+    MappedFile file;
+
+    if (!file.open(path))
+        return fail(error, "Failed to open " + path);
+
+    size_t      offset = 0;
+    std::string line;
+
+    if (!read_line(file, offset, line) || (line.compare(0, 10, "#?RADIANCE") != 0 && line.compare(0, 6, "#?RGBE") != 0))
+        return fail(error, path + " is not a Radiance HDR file");
+
+    // The header ends with an empty line.
+    while (true)
+    {
+        if (!read_line(file, offset, line))
+            return fail(error, "Truncated header in " + path);
+
+        if (line.empty())
+            break;
+
+        if (line.compare(0, 7, "FORMAT=") == 0 && line != "FORMAT=32-bit_rle_rgbe")
+            return fail(error, "Unsupported pixel format in " + path + ": " + line.substr(7));
+    }
+
+    int width  = 0;
+    int height = 0;
+
+    if (!read_line(file, offset, line) || sscanf(line.c_str(), "-Y %d +X %d", &height, &width) != 2 || width <= 0 || height <= 0)
+        return fail(error, "Unsupported resolution line in " + path + ": " + line);
+
+    image.width  = uint32_t(width);
+    image.height = uint32_t(height);
+    image.data.resize(size_t(width) * height * 3);
+
+    std::vector<uint8_t> rgbe(size_t(width) * 4);
+    const uint8_t*       data = file.data();
+
+    for (uint32_t y = 0; y < image.height; y++)
+    {
+        bool rle = image.width >= HDR_MIN_RLE_WIDTH && image.width <= HDR_MAX_RLE_WIDTH && offset + 4 <= file.size() && data[offset] == 2 && data[offset + 1] == 2 && ((uint32_t(data[offset + 2]) << 8) | data[offset + 3]) == image.width;
+
+        if (rle)
+        {
+            offset += 4;
+
+            if (!decode_rle_scanline(file, offset, image.width, rgbe.data()))
+                return fail(error, "Corrupt scanline " + std::to_string(y) + " in " + path);
+        }
+        else
+        {
+            if (offset + rgbe.size() > file.size())
+                return fail(error, "Truncated pixel data in " + path);
+
+            memcpy(rgbe.data(), data + offset, rgbe.size());
+            offset += rgbe.size();
+        }
+
+        // The file stores the top row first.
+        float* row = &image.data[size_t(image.height - 1 - y) * image.width * 3];
+
+        for (uint32_t x = 0; x < image.width; x++)
+        {
+            const uint8_t* texel = &rgbe[x * 4];
+            float          scale = texel[3] ? ldexpf(1.0f, int(texel[3]) - (128 + 8)) : 0.0f;
+
+            row[x * 3 + 0] = float(texel[0]) * scale;
+            row[x * 3 + 1] = float(texel[1]) * scale;
+            row[x * 3 + 2] = float(texel[2]) * scale;
+        }
+    }
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
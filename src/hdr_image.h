@@ -0,0 +1,17 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Radiance RGBE (.hdr) image decoded to RGB32F. Rows are stored bottom to top, the order glTexImage2D expects.
+struct HdrImage
+{
+    uint32_t           width  = 0;
+    uint32_t           height = 0;
+    std::vector<float> data;
+};
+
+// Decodes flat and run-length encoded scanlines of the -Y H +X W orientation written by every common tool. Touches no
+// GL state, so it can run on any thread.
+bool load_hdr_image(const std::string& path, HdrImage& image, std::string* error = nullptr);
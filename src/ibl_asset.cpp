@@ -0,0 +1,200 @@
+#include "ibl_asset.h"
+#include "disk_cache.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+static_assert(sizeof(IBLAssetMip) == 32, "IBLAssetMip layout changed, bump IBL_ASSET_VERSION");
+static_assert(sizeof(IBLAssetHeader) == 80 + IBL_ASSET_MAX_MIPS * sizeof(IBLAssetMip), "IBLAssetHeader layout changed, bump IBL_ASSET_VERSION");
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static uint64_t align_offset(uint64_t offset)
+{
+    return (offset + IBL_ASSET_ALIGNMENT - 1) & ~uint64_t(IBL_ASSET_ALIGNMENT - 1);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static bool fail(std::string* error, const std::string& msg)
+{
+    if (error)
+        *error = msg;
+
+    return false;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+uint32_t ibl_pixel_size(uint32_t format)
+{
+    switch (format)
+    {
+        case IBL_PIXEL_FORMAT_RGBA16F: return 8;
+        case IBL_PIXEL_FORMAT_RGBA32F: return 16;
+        default: return 0;
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+uint64_t ibl_header_checksum(const IBLAssetHeader& header)
+{
+    return disk_cache::hash(&header, offsetof(IBLAssetHeader, header_checksum));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool IBLAsset::open(const std::string& path, bool verify_checksums, std::string* error)
+{
+    close();
+
+    if (!m_file.open(path))
+        return fail(error, "Failed to map " + path);
+
+    if (!validate(m_file.data(), m_file.size(), verify_checksums, error))
+    {
+        m_file.close();
+        return false;
+    }
+
+    m_header = (const IBLAssetHeader*)m_file.data();
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void IBLAsset::close()
+{
+    m_file.close();
+    m_header = nullptr;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool IBLAsset::validate(const uint8_t* data, size_t size, bool verify_checksums, std::string* error)
+{
+    if (size < sizeof(IBLAssetHeader))
+        return fail(error, "File is smaller than the header");
+
+    const IBLAssetHeader* header = (const IBLAssetHeader*)data;
+
+    if (header->magic != IBL_ASSET_MAGIC)
+        return fail(error, "Bad magic");
+
+    if (header->version != IBL_ASSET_VERSION)
+        return fail(error, "Unsupported version " + std::to_string(header->version));
+
+    if (header->header_size != sizeof(IBLAssetHeader))
+        return fail(error, "Unexpected header size");
+
+    if (header->header_checksum != ibl_header_checksum(*header))
+        return fail(error, "Header checksum mismatch");
+
+    if (header->file_size != size)
+        return fail(error, "File size mismatch, file is truncated or padded");
+
+    if (header->sh_format != IBL_PIXEL_FORMAT_RGBA32F || header->sh_coefficients != IBL_ASSET_SH_COEFFICIENTS ||
+        header->sh_size != IBL_ASSET_SH_COEFFICIENTS * ibl_pixel_size(IBL_PIXEL_FORMAT_RGBA32F))
+        return fail(error, "Unexpected SH layout");
+
+    if (header->sh_offset % IBL_ASSET_ALIGNMENT != 0 || header->sh_offset + header->sh_size > size)
+        return fail(error, "SH section out of bounds");
+
+    uint32_t pixel_size = ibl_pixel_size(header->cubemap_format);
+
+    if (pixel_size == 0)
+        return fail(error, "Unknown cubemap format");
+
+    if (header->face_count != IBL_ASSET_FACE_COUNT || header->mip_count == 0 || header->mip_count > IBL_ASSET_MAX_MIPS)
+        return fail(error, "Unexpected face or mip count");
+
+    for (uint32_t i = 0; i < header->mip_count; i++)
+    {
+        const IBLAssetMip& mip  = header->mips[i];
+        uint32_t           dims = header->cubemap_size >> i;
+
+        if (dims == 0 || mip.width != dims || mip.height != dims)
+            return fail(error, "Mip " + std::to_string(i) + " has unexpected dimensions");
+
+        if (mip.size != uint64_t(mip.width) * mip.height * pixel_size * IBL_ASSET_FACE_COUNT)
+            return fail(error, "Mip " + std::to_string(i) + " has unexpected size");
+
+        if (mip.offset % IBL_ASSET_ALIGNMENT != 0 || mip.offset + mip.size > size)
+            return fail(error, "Mip " + std::to_string(i) + " out of bounds");
+
+        if (verify_checksums && disk_cache::hash(data + mip.offset, (size_t)mip.size) != mip.checksum)
+            return fail(error, "Mip " + std::to_string(i) + " checksum mismatch");
+    }
+
+    if (verify_checksums && disk_cache::hash(data + header->sh_offset, (size_t)header->sh_size) != header->sh_checksum)
+        return fail(error, "SH checksum mismatch");
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool write_ibl_asset(const std::string& path, uint32_t cubemap_format, uint32_t cubemap_size, const std::vector<std::vector<uint8_t>>& mips, const float* sh, std::string* error)
+{
+    uint32_t pixel_size = ibl_pixel_size(cubemap_format);
+
+    if (pixel_size == 0)
+        return fail(error, "Unknown cubemap format");
+
+    if (mips.empty() || mips.size() > IBL_ASSET_MAX_MIPS)
+        return fail(error, "Unsupported mip count");
+
+    IBLAssetHeader header;
+    memset(&header, 0, sizeof(IBLAssetHeader));
+
+    header.magic           = IBL_ASSET_MAGIC;
+    header.version         = IBL_ASSET_VERSION;
+    header.header_size     = sizeof(IBLAssetHeader);
+    header.sh_format       = IBL_PIXEL_FORMAT_RGBA32F;
+    header.sh_coefficients = IBL_ASSET_SH_COEFFICIENTS;
+    header.sh_offset       = align_offset(sizeof(IBLAssetHeader));
+    header.sh_size         = IBL_ASSET_SH_COEFFICIENTS * ibl_pixel_size(IBL_PIXEL_FORMAT_RGBA32F);
+    header.sh_checksum     = disk_cache::hash(sh, (size_t)header.sh_size);
+    header.cubemap_format  = cubemap_format;
+    header.cubemap_size    = cubemap_size;
+    header.mip_count       = (uint32_t)mips.size();
+    header.face_count      = IBL_ASSET_FACE_COUNT;
+
+    uint64_t offset = header.sh_offset + header.sh_size;
+
+    for (uint32_t i = 0; i < header.mip_count; i++)
+    {
+        IBLAssetMip& mip = header.mips[i];
+
+        mip.width    = cubemap_size >> i;
+        mip.height   = cubemap_size >> i;
+        mip.size     = uint64_t(mip.width) * mip.height * pixel_size * IBL_ASSET_FACE_COUNT;
+        mip.offset   = align_offset(offset);
+        mip.checksum = disk_cache::hash(mips[i].data(), mips[i].size());
+
+        if (mip.width == 0 || mips[i].size() != mip.size)
+            return fail(error, "Mip " + std::to_string(i) + " has unexpected size");
+
+        offset = mip.offset + mip.size;
+    }
+
+    header.file_size       = offset;
+    header.header_checksum = ibl_header_checksum(header);
+
+    std::vector<uint8_t> data((size_t)header.file_size, 0);
+
+    memcpy(data.data(), &header, sizeof(IBLAssetHeader));
+    memcpy(data.data() + header.sh_offset, sh, (size_t)header.sh_size);
+
+    for (uint32_t i = 0; i < header.mip_count; i++)
+        memcpy(data.data() + header.mips[i].offset, mips[i].data(), mips[i].size());
+
+    if (!disk_cache::write(path, data.data(), data.size()))
+        return fail(error, "Failed to write " + path);
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "mapped_file.h"
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Baked IBL probe container (.ibl).
+//
+// [IBLAssetHeader][SH9 coefficients][mip 0: +X -X +Y -Y +Z -Z][mip 1: ...]...
+//
+// Every section starts on an IBL_ASSET_ALIGNMENT boundary and faces are tightly packed in the exact layout that
+// glTexSubImage2D expects, so a mapped file can be uploaded without touching the data on the CPU. All values are
+// little-endian.
+
+#define IBL_ASSET_MAGIC 0x4c424950 // 'PIBL'
+#define IBL_ASSET_VERSION 1
+#define IBL_ASSET_MAX_MIPS 16
+#define IBL_ASSET_FACE_COUNT 6
+#define IBL_ASSET_SH_COEFFICIENTS 9
+#define IBL_ASSET_ALIGNMENT 256
+
+enum IBLPixelFormat : uint32_t
+{
+    IBL_PIXEL_FORMAT_RGBA16F = 0,
+    IBL_PIXEL_FORMAT_RGBA32F = 1
+};
+
+struct IBLAssetMip
+{
+    uint64_t offset; // Offset of the first face from the start of the file.
+    uint64_t size;   // Size of all six faces.
+    uint32_t width;
+    uint32_t height;
+    uint64_t checksum; // FNV-1a of all six faces.
+};
+
+struct IBLAssetHeader
+{
+    uint32_t    magic;
+    uint32_t    version;
+    uint32_t    header_size;
+    uint32_t    flags;
+    uint64_t    file_size;
+    uint32_t    sh_format;
+    uint32_t    sh_coefficients;
+    uint64_t    sh_offset;
+    uint64_t    sh_size;
+    uint64_t    sh_checksum;
+    uint32_t    cubemap_format;
+    uint32_t    cubemap_size;
+    uint32_t    mip_count;
+    uint32_t    face_count;
+    IBLAssetMip mips[IBL_ASSET_MAX_MIPS];
+    uint64_t    header_checksum; // FNV-1a of every header byte before this field.
+};
+
+uint32_t ibl_pixel_size(uint32_t format);
+uint64_t ibl_header_checksum(const IBLAssetHeader& header);
+
+// Read-only view of a baked probe. Pointers returned by sh() and face() point directly into the file mapping and stay
+// valid until close().
+class IBLAsset
+{
+public:
+    // Checksum verification touches every byte of the file, so it is optional for the runtime load path.
+    bool open(const std::string& path, bool verify_checksums, std::string* error = nullptr);
+    void close();
+
+    // Validates the header and section bounds of a mapping. Used by open() and by the validation tool.
+    static bool validate(const uint8_t* data, size_t size, bool verify_checksums, std::string* error);
+
+    inline const IBLAssetHeader& header() const { return *m_header; }
+    inline const void*           sh() const { return m_file.data() + m_header->sh_offset; }
+    inline const void*           face(uint32_t mip, uint32_t face) const { return m_file.data() + m_header->mips[mip].offset + face_size(mip) * face; }
+    inline size_t                face_size(uint32_t mip) const { return (size_t)(m_header->mips[mip].size / IBL_ASSET_FACE_COUNT); }
+
+private:
+    MappedFile            m_file;
+    const IBLAssetHeader* m_header = nullptr;
+};
+
+// 'mips' holds one entry per mip level, each containing the six faces back to back.
+bool write_ibl_asset(const std::string& path, uint32_t cubemap_format, uint32_t cubemap_size, const std::vector<std::vector<uint8_t>>& mips, const float* sh, std::string* error = nullptr);
@@ -0,0 +1,369 @@
+#include "ktx2.h"
+#include "disk_cache.h"
+#include <algorithm>
+#include <string.h>
+#if defined(IBL_HAVE_ZSTD)
+#    include <zstd.h>
+#endif
+
+static const uint8_t kKtx2Identifier[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+
+#define KTX2_ZSTD_LEVEL 9
+
+// Data Format Descriptor constants (Khronos Data Format Specification 1.3).
+#define KHR_DF_VERSION 2
+#define KHR_DF_MODEL_RGBSDA 1
+#define KHR_DF_PRIMARIES_BT709 1
+#define KHR_DF_TRANSFER_LINEAR 1
+#define KHR_DF_SAMPLE_DATATYPE_SIGNED 0x40
+#define KHR_DF_SAMPLE_DATATYPE_FLOAT 0x80
+#define KHR_DF_CHANNEL_RGBSDA_ALPHA 15
+
+struct Ktx2Header
+{
+    uint8_t  identifier[12];
+    uint32_t vk_format;
+    uint32_t type_size;
+    uint32_t pixel_width;
+    uint32_t pixel_height;
+    uint32_t pixel_depth;
+    uint32_t layer_count;
+    uint32_t face_count;
+    uint32_t level_count;
+    uint32_t supercompression_scheme;
+    uint32_t dfd_byte_offset;
+    uint32_t dfd_byte_length;
+    uint32_t kvd_byte_offset;
+    uint32_t kvd_byte_length;
+    uint64_t sgd_byte_offset;
+    uint64_t sgd_byte_length;
+};
+
+struct Ktx2LevelIndex
+{
+    uint64_t byte_offset;
+    uint64_t byte_length;
+    uint64_t uncompressed_byte_length;
+};
+
+static_assert(sizeof(Ktx2Header) == 80, "Ktx2Header must match the on-disk layout");
+static_assert(sizeof(Ktx2LevelIndex) == 24, "Ktx2LevelIndex must match the on-disk layout");
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static bool fail(std::string* error, const std::string& msg)
+{
+    if (error)
+        *error = msg;
+
+    return false;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static size_t align_to(size_t offset, size_t alignment)
+{
+    return ((offset + alignment - 1) / alignment) * alignment;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static size_t lcm4(size_t value)
+{
+    size_t result = value;
+
+    while (result % 4 != 0)
+        result += value;
+
+    return result;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static uint32_t type_size(uint32_t vk_format)
+{
+    return vk_format == KTX2_VK_FORMAT_R32G32B32A32_SFLOAT ? 4 : 2;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static void append(std::vector<uint8_t>& data, const void* src, size_t size)
+{
+    const uint8_t* bytes = (const uint8_t*)src;
+    data.insert(data.end(), bytes, bytes + size);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static void append_u32(std::vector<uint8_t>& data, uint32_t value)
+{
+    append(data, &value, sizeof(uint32_t));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Basic descriptor block for an unpacked, linear, signed float format with one sample per channel.
+static std::vector<uint8_t> create_dfd(uint32_t vk_format)
+{
+    static const uint32_t kChannelIds[] = { 0, 1, 2, KHR_DF_CHANNEL_RGBSDA_ALPHA };
+
+    uint32_t channels    = ktx2_channel_count(vk_format);
+    uint32_t bits        = type_size(vk_format) * 8;
+    uint32_t block_size  = 24 + 16 * channels;
+    uint32_t lower_bound = 0xBF800000; // -1.0f
+    uint32_t upper_bound = 0x3F800000; // 1.0f
+
+    std::vector<uint8_t> dfd;
+
+    append_u32(dfd, 4 + block_size);
+    append_u32(dfd, 0); // vendorId = KHRONOS, descriptorType = BASICFORMAT
+    append_u32(dfd, KHR_DF_VERSION | (block_size << 16));
+    append_u32(dfd, KHR_DF_MODEL_RGBSDA | (KHR_DF_PRIMARIES_BT709 << 8) | (KHR_DF_TRANSFER_LINEAR << 16));
+    append_u32(dfd, 0); // 1x1x1x1 texel blocks
+    append_u32(dfd, ktx2_pixel_size(vk_format));
+    append_u32(dfd, 0);
+
+    for (uint32_t i = 0; i < channels; i++)
+    {
+        uint32_t channel = kChannelIds[i] | KHR_DF_SAMPLE_DATATYPE_SIGNED | KHR_DF_SAMPLE_DATATYPE_FLOAT;
+
+        append_u32(dfd, (i * bits) | ((bits - 1) << 16) | (channel << 24));
+        append_u32(dfd, 0);
+        append_u32(dfd, lower_bound);
+        append_u32(dfd, upper_bound);
+    }
+
+    return dfd;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static std::vector<uint8_t> create_kvd()
+{
+    static const char kKey[]   = "KTXwriter";
+    static const char kValue[] = "RuntimeIBL";
+
+    std::vector<uint8_t> kvd;
+
+    append_u32(kvd, sizeof(kKey) + sizeof(kValue));
+    append(kvd, kKey, sizeof(kKey));
+    append(kvd, kValue, sizeof(kValue));
+    kvd.resize(align_to(kvd.size(), 4), 0);
+
+    return kvd;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+uint32_t ktx2_pixel_size(uint32_t vk_format)
+{
+    return ktx2_channel_count(vk_format) * type_size(vk_format);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+uint32_t ktx2_channel_count(uint32_t vk_format)
+{
+    switch (vk_format)
+    {
+        case KTX2_VK_FORMAT_R16G16_SFLOAT: return 2;
+        case KTX2_VK_FORMAT_R16G16B16_SFLOAT: return 3;
+        case KTX2_VK_FORMAT_R16G16B16A16_SFLOAT: return 4;
+        case KTX2_VK_FORMAT_R32G32B32A32_SFLOAT: return 4;
+        default: return 0;
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool ktx2_supercompression_available()
+{
+#if defined(IBL_HAVE_ZSTD)
+    return true;
+#else
+    return false;
+#endif
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool write_ktx2(const std::string& path, const Ktx2Image& image, bool supercompress, std::string* error)
+{
+    uint32_t pixel_size = ktx2_pixel_size(image.vk_format);
+
+    if (pixel_size == 0)
+        return fail(error, "Unsupported format");
+
+    if (image.levels.size() != image.level_count || image.level_count == 0 || (image.face_count != 1 && image.face_count != 6))
+        return fail(error, "Inconsistent image description");
+
+    if (supercompress && !ktx2_supercompression_available())
+        return fail(error, "Built without Zstandard support");
+
+    for (uint32_t i = 0; i < image.level_count; i++)
+    {
+        if (image.levels[i].size() != size_t(image.width >> i) * (image.height >> i) * pixel_size * image.face_count)
+            return fail(error, "Level " + std::to_string(i) + " has unexpected size");
+    }
+
+    std::vector<std::vector<uint8_t>> compressed(image.level_count);
+
+#if defined(IBL_HAVE_ZSTD)
+    if (supercompress)
+    {
+        for (uint32_t i = 0; i < image.level_count; i++)
+        {
+            compressed[i].resize(ZSTD_compressBound(image.levels[i].size()));
+
+            size_t size = ZSTD_compress(compressed[i].data(), compressed[i].size(), image.levels[i].data(), image.levels[i].size(), KTX2_ZSTD_LEVEL);
+
+            if (ZSTD_isError(size))
+                return fail(error, std::string("Zstandard compression failed: ") + ZSTD_getErrorName(size));
+
+            compressed[i].resize(size);
+        }
+    }
+#endif
+
+    std::vector<uint8_t> dfd = create_dfd(image.vk_format);
+    std::vector<uint8_t> kvd = create_kvd();
+
+    Ktx2Header header;
+    memset(&header, 0, sizeof(Ktx2Header));
+    memcpy(header.identifier, kKtx2Identifier, sizeof(kKtx2Identifier));
+
+    header.vk_format               = image.vk_format;
+    header.type_size               = type_size(image.vk_format);
+    header.pixel_width             = image.width;
+    header.pixel_height            = image.height;
+    header.face_count              = image.face_count;
+    header.level_count             = image.level_count;
+    header.supercompression_scheme = supercompress ? KTX2_SUPERCOMPRESSION_ZSTD : KTX2_SUPERCOMPRESSION_NONE;
+    header.dfd_byte_offset         = uint32_t(sizeof(Ktx2Header) + sizeof(Ktx2LevelIndex) * image.level_count);
+    header.dfd_byte_length         = uint32_t(dfd.size());
+    header.kvd_byte_offset         = header.dfd_byte_offset + header.dfd_byte_length;
+    header.kvd_byte_length         = uint32_t(kvd.size());
+
+    // Mip levels are stored smallest first. Uncompressed levels are aligned to lcm(texel size, 4).
+    size_t                      alignment = supercompress ? 1 : lcm4(pixel_size);
+    size_t                      offset    = header.kvd_byte_offset + header.kvd_byte_length;
+    std::vector<Ktx2LevelIndex> level_index(image.level_count);
+
+    for (int32_t i = image.level_count - 1; i >= 0; i--)
+    {
+        const std::vector<uint8_t>& data = supercompress ? compressed[i] : image.levels[i];
+
+        offset                                  = align_to(offset, alignment);
+        level_index[i].byte_offset              = offset;
+        level_index[i].byte_length              = data.size();
+        level_index[i].uncompressed_byte_length = image.levels[i].size();
+        offset += data.size();
+    }
+
+    std::vector<uint8_t> file;
+    file.reserve(offset);
+
+    append(file, &header, sizeof(Ktx2Header));
+    append(file, level_index.data(), sizeof(Ktx2LevelIndex) * level_index.size());
+    append(file, dfd.data(), dfd.size());
+    append(file, kvd.data(), kvd.size());
+
+    for (int32_t i = image.level_count - 1; i >= 0; i--)
+    {
+        const std::vector<uint8_t>& data = supercompress ? compressed[i] : image.levels[i];
+
+        file.resize(level_index[i].byte_offset, 0);
+        append(file, data.data(), data.size());
+    }
+
+    if (!disk_cache::write(path, file.data(), file.size()))
+        return fail(error, "Failed to write " + path);
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool Ktx2File::open(const std::string& path, std::string* error)
+{
+    close();
+
+    if (!m_file.open(path))
+        return fail(error, "Failed to map " + path);
+
+    const uint8_t* data = m_file.data();
+    size_t         size = m_file.size();
+
+    if (size < sizeof(Ktx2Header) || memcmp(data, kKtx2Identifier, sizeof(kKtx2Identifier)) != 0)
+        return fail(error, "Not a KTX2 file");
+
+    Ktx2Header header;
+    memcpy(&header, data, sizeof(Ktx2Header));
+
+    if (ktx2_pixel_size(header.vk_format) == 0)
+        return fail(error, "Unsupported VkFormat " + std::to_string(header.vk_format));
+
+    if (header.pixel_depth != 0 || header.layer_count > 1 || (header.face_count != 1 && header.face_count != 6))
+        return fail(error, "Only 2D textures and cubemaps are supported");
+
+    if (header.supercompression_scheme != KTX2_SUPERCOMPRESSION_NONE && header.supercompression_scheme != KTX2_SUPERCOMPRESSION_ZSTD)
+        return fail(error, "Unsupported supercompression scheme");
+
+    if (header.supercompression_scheme == KTX2_SUPERCOMPRESSION_ZSTD && !ktx2_supercompression_available())
+        return fail(error, "File is Zstandard supercompressed but this build has no Zstandard support");
+
+    // A level count of zero asks the loader to generate the mip chain, we only load the base level in that case.
+    uint32_t level_count = header.level_count == 0 ? 1 : header.level_count;
+
+    if (sizeof(Ktx2Header) + sizeof(Ktx2LevelIndex) * level_count > size)
+        return fail(error, "Truncated level index");
+
+    m_vk_format  = header.vk_format;
+    m_width      = header.pixel_width;
+    m_height     = std::max(header.pixel_height, 1u);
+    m_face_count = header.face_count;
+
+    m_levels.resize(level_count);
+    m_inflated.resize(level_count);
+
+    for (uint32_t i = 0; i < level_count; i++)
+    {
+        Ktx2LevelIndex index;
+        memcpy(&index, data + sizeof(Ktx2Header) + sizeof(Ktx2LevelIndex) * i, sizeof(Ktx2LevelIndex));
+
+        size_t expected = face_size(i) * m_face_count;
+
+        if (index.byte_offset + index.byte_length > size || index.uncompressed_byte_length != expected)
+            return fail(error, "Level " + std::to_string(i) + " out of bounds");
+
+        if (header.supercompression_scheme == KTX2_SUPERCOMPRESSION_NONE)
+        {
+            m_levels[i] = data + index.byte_offset;
+            continue;
+        }
+
+#if defined(IBL_HAVE_ZSTD)
+        m_inflated[i].resize(expected);
+
+        size_t inflated = ZSTD_decompress(m_inflated[i].data(), expected, data + index.byte_offset, (size_t)index.byte_length);
+
+        if (ZSTD_isError(inflated) || inflated != expected)
+            return fail(error, "Failed to inflate level " + std::to_string(i));
+
+        m_levels[i] = m_inflated[i].data();
+#endif
+    }
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void Ktx2File::close()
+{
+    m_file.close();
+    m_levels.clear();
+    m_inflated.clear();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "mapped_file.h"
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Minimal KTX 2.0 reader/writer for the uncompressed floating point formats produced by this sample: 2D textures and
+// cubemaps with a full or partial mip chain. Zstandard supercompression is available when built with IBL_HAVE_ZSTD.
+//
+// https://registry.khronos.org/KTX/specs/2.0/ktxspec.v2.html
+
+// VkFormat values of the formats we read and write.
+#define KTX2_VK_FORMAT_R16G16_SFLOAT 83
+#define KTX2_VK_FORMAT_R16G16B16_SFLOAT 90
+#define KTX2_VK_FORMAT_R16G16B16A16_SFLOAT 97
+#define KTX2_VK_FORMAT_R32G32B32A32_SFLOAT 109
+
+#define KTX2_SUPERCOMPRESSION_NONE 0
+#define KTX2_SUPERCOMPRESSION_ZSTD 2
+
+struct Ktx2Image
+{
+    uint32_t vk_format   = 0;
+    uint32_t width       = 0;
+    uint32_t height      = 0;
+    uint32_t face_count  = 1;
+    uint32_t level_count = 1;
+
+    // One entry per mip level, largest first. Each level holds every face back to back (+X, -X, +Y, -Y, +Z, -Z) with
+    // tightly packed rows.
+    std::vector<std::vector<uint8_t>> levels;
+};
+
+// Returns 0 for formats this implementation does not handle.
+uint32_t ktx2_pixel_size(uint32_t vk_format);
+uint32_t ktx2_channel_count(uint32_t vk_format);
+bool     ktx2_supercompression_available();
+
+bool write_ktx2(const std::string& path, const Ktx2Image& image, bool supercompress, std::string* error = nullptr);
+
+// Reads a KTX2 file. Uncompressed levels are returned as pointers into the file mapping, supercompressed levels are
+// inflated once into owned storage.
+class Ktx2File
+{
+public:
+    bool open(const std::string& path, std::string* error = nullptr);
+    void close();
+
+    inline uint32_t       vk_format() const { return m_vk_format; }
+    inline uint32_t       width() const { return m_width; }
+    inline uint32_t       height() const { return m_height; }
+    inline uint32_t       face_count() const { return m_face_count; }
+    inline uint32_t       level_count() const { return (uint32_t)m_levels.size(); }
+    inline const uint8_t* level(uint32_t level) const { return m_levels[level]; }
+    inline size_t         face_size(uint32_t level) const { return size_t(m_width >> level) * (m_height >> level) * ktx2_pixel_size(m_vk_format); }
+    inline const uint8_t* face(uint32_t level, uint32_t face) const { return m_levels[level] + face_size(level) * face; }
+
+private:
+    MappedFile                        m_file;
+    uint32_t                          m_vk_format  = 0;
+    uint32_t                          m_width      = 0;
+    uint32_t                          m_height     = 0;
+    uint32_t                          m_face_count = 0;
+    std::vector<const uint8_t*>       m_levels;
+    std::vector<std::vector<uint8_t>> m_inflated;
+};
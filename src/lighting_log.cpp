@@ -0,0 +1,200 @@
+#include "lighting_log.h"
+#include <logger.h>
+#include <chrono>
+
+#define LIGHTING_LOG_MAX_QUEUED_BYTES (64 * 1024 * 1024)
+
+static uint64_t steady_microseconds()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+LightingLog::~LightingLog()
+{
+    close();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool LightingLog::open(const std::string& path)
+{
+    close();
+
+    m_file = fopen(path.c_str(), "wb");
+
+    if (!m_file)
+    {
+        DW_LOG_ERROR("Failed to open lighting log: " + path);
+        return false;
+    }
+
+    LightingLogHeader header;
+
+    header.magic      = LIGHTING_LOG_MAGIC;
+    header.version    = LIGHTING_LOG_VERSION;
+    header.start_time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+
+    if (fwrite(&header, sizeof(header), 1, m_file) != 1)
+    {
+        DW_LOG_ERROR("Failed to write lighting log: " + path);
+        fclose(m_file);
+        m_file = nullptr;
+        return false;
+    }
+
+    m_start = steady_microseconds();
+    m_stats = LightingLogStats();
+    m_stop  = false;
+
+    m_thread = std::thread(&LightingLog::writer, this);
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void LightingLog::close()
+{
+    if (!m_file)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+
+    m_records_cv.notify_one();
+    m_thread.join();
+
+    fclose(m_file);
+    m_file = nullptr;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void LightingLog::write_sh9(uint64_t frame, const float* coefficients)
+{
+    std::vector<uint8_t> payload(sizeof(float) * 3 * 9);
+    float*               rgb = (float*)payload.data();
+
+    for (int i = 0; i < 9; i++)
+    {
+        rgb[i * 3 + 0] = coefficients[i * 4 + 0];
+        rgb[i * 3 + 1] = coefficients[i * 4 + 1];
+        rgb[i * 3 + 2] = coefficients[i * 4 + 2];
+    }
+
+    push(LIGHTING_RECORD_SH9, frame, 0, 0, std::move(payload));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void LightingLog::write_prefiltered(uint64_t frame, uint32_t size, uint32_t levels, const uint8_t* data, size_t data_size)
+{
+    push(LIGHTING_RECORD_PREFILTERED, frame, size, levels, std::vector<uint8_t>(data, data + data_size));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+LightingLogStats LightingLog::stats()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    return m_stats;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void LightingLog::push(LightingRecordType type, uint64_t frame, uint32_t width, uint32_t levels, std::vector<uint8_t>&& payload)
+{
+    if (!m_file)
+        return;
+
+    Record record;
+
+    record.header.type   = type;
+    record.header.size   = uint32_t(payload.size());
+    record.header.frame  = frame;
+    record.header.time   = steady_microseconds() - m_start;
+    record.header.width  = width;
+    record.header.levels = levels;
+    record.payload       = std::move(payload);
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (m_stats.queued + record.payload.size() > LIGHTING_LOG_MAX_QUEUED_BYTES)
+        {
+            m_stats.dropped++;
+            return;
+        }
+
+        m_stats.queued += record.payload.size();
+        m_records.push_back(std::move(record));
+    }
+
+    m_records_cv.notify_one();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void LightingLog::writer()
+{
+    std::deque<Record> batch;
+    bool               failed = false;
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_records_cv.wait(lock, [&]() { return m_stop || !m_records.empty(); });
+
+            // Whatever was queued before close() is still written.
+            if (m_stop && m_records.empty())
+                break;
+
+            batch.swap(m_records);
+        }
+
+        uint64_t records = 0;
+        uint64_t bytes   = 0;
+        uint64_t dropped = 0;
+        size_t   queued  = 0;
+
+        for (const auto& record : batch)
+        {
+            queued += record.payload.size();
+
+            if (!failed)
+            {
+                failed = fwrite(&record.header, sizeof(record.header), 1, m_file) != 1 || (!record.payload.empty() && fwrite(record.payload.data(), record.payload.size(), 1, m_file) != 1);
+
+                if (failed)
+                    DW_LOG_ERROR("Failed to write lighting log, discarding further records");
+            }
+
+            if (failed)
+            {
+                dropped++;
+                continue;
+            }
+
+            records++;
+            bytes += sizeof(record.header) + record.payload.size();
+        }
+
+        fflush(m_file);
+        batch.clear();
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        m_stats.records += records;
+        m_stats.bytes += bytes;
+        m_stats.dropped += dropped;
+        m_stats.queued -= queued;
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Lighting analytics log (.llog).
+//
+// [LightingLogHeader][LightingRecordHeader][payload][LightingRecordHeader][payload]...
+//
+// Records are appended as they arrive and the file is flushed after every batch, so a log cut short by a crash or a
+// killed instance is valid up to its last complete record. All values are little-endian.
+
+#define LIGHTING_LOG_MAGIC 0x474f4c4c // 'LLOG'
+#define LIGHTING_LOG_VERSION 1
+
+enum LightingRecordType : uint32_t
+{
+    LIGHTING_RECORD_SH9         = 0, // 9 RGB coefficients as float32, 108 bytes.
+    LIGHTING_RECORD_PREFILTERED = 1  // RGBA16F cubemap, level-major with six faces per level like an .ibl mip chain.
+};
+
+struct LightingLogHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t start_time; // Unix time in microseconds.
+};
+
+struct LightingRecordHeader
+{
+    uint32_t type;
+    uint32_t size;  // Payload bytes following the header.
+    uint64_t frame; // Frame the data was produced in.
+    uint64_t time;  // Microseconds since the log was opened.
+    uint32_t width; // Of level 0. Zero for SH.
+    uint32_t levels;
+};
+
+struct LightingLogStats
+{
+    uint64_t records = 0;
+    uint64_t bytes   = 0;
+    uint64_t dropped = 0; // Records discarded because the writer had fallen too far behind.
+    size_t   queued  = 0; // Payload bytes waiting for the writer.
+};
+
+// Writes lighting records on a thread of its own, so the render thread only pays for copying the data out of a mapped
+// pack buffer. The queue is bounded: if the disk cannot keep up, records are dropped rather than memory growing or the
+// render thread waiting.
+class LightingLog
+{
+public:
+    ~LightingLog();
+
+    bool open(const std::string& path);
+
+    // Writes everything still queued and closes the file.
+    void close();
+
+    // 'coefficients' holds 9 RGBA32F texels as read back from the SH texture. Alpha is not stored.
+    void write_sh9(uint64_t frame, const float* coefficients);
+    void write_prefiltered(uint64_t frame, uint32_t size, uint32_t levels, const uint8_t* data, size_t data_size);
+
+    LightingLogStats stats();
+
+    inline bool is_open() const { return m_file != nullptr; }
+
+private:
+    struct Record
+    {
+        LightingRecordHeader header;
+        std::vector<uint8_t> payload;
+    };
+
+    void push(LightingRecordType type, uint64_t frame, uint32_t width, uint32_t levels, std::vector<uint8_t>&& payload);
+    void writer();
+
+private:
+    FILE*                   m_file = nullptr;
+    std::thread             m_thread;
+    std::mutex              m_mutex;
+    std::condition_variable m_records_cv;
+    std::deque<Record>      m_records;
+    LightingLogStats        m_stats;
+    uint64_t                m_start = 0; // Steady clock microseconds at open().
+    bool                    m_stop  = false;
+};
@@ -8,136 +8,336 @@
 #include <stack>
 #include <random>
 #include <chrono>
+#include <thread>
+#include <algorithm>
+#include <string.h>
+#include <float.h>
+#include "atmosphere_precompute.h"
+#include "disk_cache.h"
+#include "frame_graph.h"
+#include "gl_state.h"
+#include "gpu_memory.h"
+#include "hdr_image.h"
+#include "ibl_asset.h"
+#include "ktx2.h"
+#include "lighting_log.h"
+#include "mesh_asset.h"
+#include "mesh_optimizer.h"
+#include "prefilter_cpu.h"
+#include "probe_baker.h"
+#include "async_readback.h"
+#include "program_cache.h"
+#include "scene_batch.h"
+#include "shader_permutations.h"
+#include "task_graph.h"
+#include "uniform_ring.h"
+#include "workgroup_tuning.h"
 #define _USE_MATH_DEFINES
 #include <math.h>
 
 #define CAMERA_FAR_PLANE 10000.0f
 #define ENVIRONMENT_MAP_SIZE 512
+#define ENVIRONMENT_MAP_MIP_LEVELS 9 // Stops at 2x2 so that the downsampler fits in the minimum of 8 compute image units.
+#define DOWNSAMPLE_TILE_SIZE 64
+#define DOWNSAMPLE_TILE_COUNT (ENVIRONMENT_MAP_SIZE / DOWNSAMPLE_TILE_SIZE)
 #define PREFILTER_MAP_SIZE 256
 #define PREFILTER_MIP_LEVELS 5
+#define OCTAHEDRAL_MAP_SIZE 512 // Border included. Two thirds of the texels of the prefiltered cubemap.
 #define IRRADIANCE_CUBEMAP_SIZE 128
-#define IRRADIANCE_WORK_GROUP_SIZE 8
-#define PREFILTER_WORK_GROUP_SIZE 8
-#define BRDF_WORK_GROUP_SIZE 8
 #define MAX_PREFILTER_SAMPLES 64
 #define BRDF_LUT_SIZE 512
-#define SH_INTERMEDIATE_SIZE (IRRADIANCE_CUBEMAP_SIZE / IRRADIANCE_WORK_GROUP_SIZE)
+#define SH_MIN_WORK_GROUP_SIZE 4
+#define SH_INTERMEDIATE_MAX_SIZE (IRRADIANCE_CUBEMAP_SIZE / SH_MIN_WORK_GROUP_SIZE)
+#define WORKGROUP_TUNING_ITERATIONS 5
+
+// The downsampler projects mip 2 onto SH, which has to be the level the SH projection kernel reads.
+#if (ENVIRONMENT_MAP_SIZE >> 2) != IRRADIANCE_CUBEMAP_SIZE
+#    error "IRRADIANCE_CUBEMAP_SIZE must be mip 2 of the environment map"
+#endif
+#define PREFILTER_REPORT_ITERATIONS 5
+#define PROGRESSIVE_MAX_PASSES 4
+#define MAX_SCENE_OBJECTS 16384
+#define SCENE_MESH_PATH "mesh/teapot_smooth.obj"
+#define ENVIRONMENT_MAP_PATH "hdr/Arches_E_PineTree_3k.hdr"
+#define MESH_BENCHMARK_ITERATIONS 5
+#define MESH_OVERDRAW_THRESHOLD 1.05f
+#define SKY_SH_SAMPLE_COUNT 256
+#define LIGHTING_LOG_SH_INTERVAL 60 // Frames between SH records.
+#define SKY_VIEW_LUT_WIDTH 192 // Azimuth relative to the sun, 0 to pi.
+#define SKY_VIEW_LUT_HEIGHT 108
+#define SKY_VIEW_ALTITUDE_STEP 10.0f // Camera altitude change in meters that rebuilds the sky-view LUT.
+
+// Uniform block bindings, see shader/uniforms.glsl.
+#define UNIFORM_BINDING_CAMERA 8
+#define UNIFORM_BINDING_SKY 9
+#define UNIFORM_BINDING_OBJECT 10
+#define UNIFORM_RING_REGION_SIZE (64 * 1024)
+
+struct AtmospherePreset
+{
+    const char* name;
+    glm::vec3   beta_r;
+    float       mie_g;
+};
 
-struct SkyModel
+static const AtmospherePreset kAtmospherePresets[] = {
+    { "Earth (Clear)", glm::vec3(0.0058f, 0.0135f, 0.0331f), 0.75f },
+    { "Earth (Hazy)", glm::vec3(0.0058f, 0.0135f, 0.0331f), 0.9f },
+    { "Earth (Dusk)", glm::vec3(0.0072f, 0.0135f, 0.0251f), 0.8f },
+    { "Alien (Red)", glm::vec3(0.0331f, 0.0135f, 0.0058f), 0.75f }
+};
+
+// Result of comparing the selected prefilter paths against brute force GGX sampling on every mip.
+struct PrefilterReport
+{
+    bool  valid                       = false;
+    float reference_time              = 0.0f;
+    float selected_time               = 0.0f;
+    float error[PREFILTER_MIP_LEVELS] = {}; // RMSE relative to the mean reference radiance.
+};
+
+// Part of the prefilter sample set evaluated by one progressive frame: 'count' samples starting at 'offset', 'stride'
+// apart, rotated around the normal by 'rotation' radians and added to the sums accumulated in the cubemap unless
+// 'accumulate' is false.
+struct PrefilterSubset
 {
-    const float SCALE           = 1000.0f;
-    const int   TRANSMITTANCE_W = 256;
-    const int   TRANSMITTANCE_H = 64;
+    int32_t offset;
+    int32_t stride;
+    int32_t count;
+    float   rotation;
+    bool    accumulate;
+};
+
+// std140 layouts of the uniform blocks written into the uniform ring.
+struct CameraUniforms
+{
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::vec4 position;
+};
 
-    const int IRRADIANCE_W = 64;
-    const int IRRADIANCE_H = 16;
+struct SkyUniforms
+{
+    glm::vec4 beta_r;    // w: Mie g.
+    glm::vec4 earth_pos; // w: sun intensity.
+    glm::vec4 sun_dir;
+};
 
-    const int INSCATTER_R    = 32;
-    const int INSCATTER_MU   = 128;
-    const int INSCATTER_MU_S = 32;
-    const int INSCATTER_NU   = 8;
+struct MeshUniforms
+{
+    glm::vec4 position_offset;
+    glm::vec4 position_scale;
+    glm::vec4 texcoord_transform; // xy: offset, zw: scale.
+};
 
-    glm::vec3      m_beta_r        = glm::vec3(0.0058f, 0.0135f, 0.0331f);
-    glm::vec3      m_direction     = glm::vec3(0.0f, 0.0f, 1.0f);
-    float          m_mie_g         = 0.75f;
-    float          m_sun_intensity = 100.0f;
-    dw::Texture2D* m_transmittance_t;
-    dw::Texture2D* m_irradiance_t;
-    dw::Texture3D* m_inscatter_t;
-    float          m_sun_angle = 0.0f;
+struct SkyboxUniforms
+{
+    int32_t type;
+    float   roughness;
+    float   padding[2];
+};
 
-    bool initialize()
+struct SkyModel
+{
+    const float SCALE = 1000.0f;
+
+    glm::vec3              m_beta_r        = glm::vec3(0.0058f, 0.0135f, 0.0331f);
+    glm::vec3              m_direction     = glm::vec3(0.0f, 0.0f, 1.0f);
+    float                  m_mie_g         = 0.75f;
+    float                  m_sun_intensity = 100.0f;
+    std::unique_ptr<dw::Texture2D> m_transmittance_t;
+    std::unique_ptr<dw::Texture2D> m_irradiance_t;
+    std::unique_ptr<dw::Texture3D> m_inscatter_t;
+    std::unique_ptr<dw::Texture2D> m_sky_view_t;
+    uint64_t                       m_sky_view_key = 0;
+    float                          m_sun_angle    = 0.0f;
+    int32_t                        m_backend   = ATMOSPHERE_BACKEND_COMPUTE;
+    AtmosphereComputeBaker         m_compute_baker;
+    uint64_t                       m_tables_hash       = 0;
+    float                          m_precompute_time   = 0.0f;
+    bool                           m_loaded_from_cache = false;
+    AtmosphereTables               m_prefetched_tables;
+    uint64_t                       m_prefetched_hash = 0;
+
+    bool initialize(ProgramCache& program_cache, GpuMemoryRegistry& memory, AsyncReadback& readback)
     {
-        m_transmittance_t = new_texture_2d(TRANSMITTANCE_W, TRANSMITTANCE_H);
-        m_irradiance_t    = new_texture_2d(IRRADIANCE_W, IRRADIANCE_H);
-        m_inscatter_t     = new_texture_3d(INSCATTER_MU_S * INSCATTER_NU, INSCATTER_MU, INSCATTER_R);
+        m_transmittance_t = new_texture_2d(ATMOSPHERE_TRANSMITTANCE_W, ATMOSPHERE_TRANSMITTANCE_H);
+        m_irradiance_t    = new_texture_2d(ATMOSPHERE_IRRADIANCE_W, ATMOSPHERE_IRRADIANCE_H);
+        m_inscatter_t     = new_texture_3d(ATMOSPHERE_INSCATTER_W, ATMOSPHERE_INSCATTER_H, ATMOSPHERE_INSCATTER_D);
+        m_sky_view_t      = std::make_unique<dw::Texture2D>(SKY_VIEW_LUT_WIDTH, SKY_VIEW_LUT_HEIGHT, 1, 1, 1, GL_RGBA16F, GL_RGBA, GL_HALF_FLOAT);
 
-        FILE* transmittance = fopen("texture/transmittance.raw", "r");
+        m_sky_view_t->set_min_filter(GL_LINEAR);
+        m_sky_view_t->set_wrapping(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
 
-        if (transmittance)
+        memory.track(m_transmittance_t.get(), "Transmittance Table", GPU_MEMORY_ATMOSPHERE, gpu_texture_size(ATMOSPHERE_TRANSMITTANCE_W, ATMOSPHERE_TRANSMITTANCE_H, 1, 1, GL_RGBA32F));
+        memory.track(m_irradiance_t.get(), "Irradiance Table", GPU_MEMORY_ATMOSPHERE, gpu_texture_size(ATMOSPHERE_IRRADIANCE_W, ATMOSPHERE_IRRADIANCE_H, 1, 1, GL_RGBA32F));
+        memory.track(m_inscatter_t.get(), "Inscatter Table", GPU_MEMORY_ATMOSPHERE, gpu_texture_size(ATMOSPHERE_INSCATTER_W, ATMOSPHERE_INSCATTER_H, ATMOSPHERE_INSCATTER_D, 1, GL_RGBA32F));
+        memory.track(m_sky_view_t.get(), "Sky-View LUT", GPU_MEMORY_ATMOSPHERE, gpu_texture_size(SKY_VIEW_LUT_WIDTH, SKY_VIEW_LUT_HEIGHT, 1, 1, GL_RGBA16F));
+
+        if (!m_compute_baker.initialize(program_cache))
         {
-            size_t n = sizeof(float) * TRANSMITTANCE_W * TRANSMITTANCE_H * 4;
+            DW_LOG_WARNING("Atmosphere compute backend unavailable, falling back to CPU precomputation");
+            m_backend = ATMOSPHERE_BACKEND_CPU;
+        }
 
-            void* data = malloc(n);
-            fread(data, n, 1, transmittance);
+        precompute(memory, readback);
 
-            m_transmittance_t->set_data(0, 0, data);
+        return true;
+    }
 
-            fclose(transmittance);
-            free(data);
-        }
-        else
-            return false;
+    void shutdown(GpuMemoryRegistry& memory)
+    {
+        memory.destroy(m_transmittance_t);
+        memory.destroy(m_irradiance_t);
+        memory.destroy(m_inscatter_t);
+        memory.destroy(m_sky_view_t);
+    }
 
-        FILE* irradiance = fopen("texture/irradiance.raw", "r");
+    // Reads the cache entry of the current parameters ahead of initialize(). Only touches memory, so it can run on a
+    // worker thread.
+    void prefetch_cache()
+    {
+        AtmosphereParameters params = parameters();
 
-        if (irradiance)
-        {
-            size_t n = sizeof(float) * IRRADIANCE_W * IRRADIANCE_H * 4;
+        if (load_atmosphere_cache(params, m_prefetched_tables))
+            m_prefetched_hash = params.hash();
+    }
 
-            void* data = malloc(n);
-            fread(data, n, 1, irradiance);
+    AtmosphereParameters parameters()
+    {
+        AtmosphereParameters params;
+
+        params.beta_r = m_beta_r;
+        params.mie_g  = m_mie_g;
+
+        return params;
+    }
+
+    // Rebuilds the scattering tables whenever a parameter they were computed with has changed.
+    void update(GpuMemoryRegistry& memory, AsyncReadback& readback)
+    {
+        if (parameters().hash() != m_tables_hash)
+            precompute(memory, readback);
+    }
+
+    void precompute(GpuMemoryRegistry& memory, AsyncReadback& readback)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
 
-            m_irradiance_t->set_data(0, 0, data);
+        AtmosphereParameters params = parameters();
+        AtmosphereTables     tables;
 
-            fclose(irradiance);
-            free(data);
+        if (m_prefetched_hash != 0 && m_prefetched_hash == params.hash())
+        {
+            tables              = std::move(m_prefetched_tables);
+            m_loaded_from_cache = true;
         }
         else
-            return false;
+            m_loaded_from_cache = load_atmosphere_cache(params, tables);
 
-        FILE* inscatter = fopen("texture/inscatter.raw", "r");
+        m_prefetched_hash = 0;
 
-        if (inscatter)
+        if (m_loaded_from_cache)
+            upload(tables);
+        else if (m_backend == ATMOSPHERE_BACKEND_COMPUTE)
+        {
+            m_compute_baker.precompute(params, m_transmittance_t.get(), m_irradiance_t.get(), m_inscatter_t.get(), memory);
+            save_cache_async(params, readback);
+        }
+        else
         {
-            size_t n = sizeof(float) * INSCATTER_MU_S * INSCATTER_NU * INSCATTER_MU * INSCATTER_R * 4;
+            precompute_atmosphere_cpu(params, tables);
+            upload(tables);
 
-            void* data = malloc(n);
-            fread(data, n, 1, inscatter);
+            if (!save_atmosphere_cache(params, tables))
+                DW_LOG_WARNING("Failed to write atmosphere cache");
+        }
 
-            m_inscatter_t->set_data(0, data);
+        m_tables_hash = params.hash();
 
-            fclose(inscatter);
-            free(data);
-        }
-        else
-            return false;
+        auto end          = std::chrono::high_resolution_clock::now();
+        m_precompute_time = std::chrono::duration<float, std::milli>(end - start).count();
+    }
 
-        return true;
+    // Copies the tables of a compute bake into pack buffers and writes the cache once the last of them has landed, so
+    // applying an edit does not wait for the GPU. Requests complete in order, so the inscatter table comes last.
+    void save_cache_async(const AtmosphereParameters& params, AsyncReadback& readback)
+    {
+        auto tables = std::make_shared<AtmosphereTables>();
+        tables->resize();
+
+        glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT);
+
+        readback.request(m_transmittance_t.get(), ATMOSPHERE_TRANSMITTANCE_W, ATMOSPHERE_TRANSMITTANCE_H, 1, sizeof(glm::vec4), [tables](const uint8_t* data, size_t data_size) {
+            memcpy(tables->transmittance.data(), data, data_size);
+        });
+
+        readback.request(m_irradiance_t.get(), ATMOSPHERE_IRRADIANCE_W, ATMOSPHERE_IRRADIANCE_H, 1, sizeof(glm::vec4), [tables](const uint8_t* data, size_t data_size) {
+            memcpy(tables->irradiance.data(), data, data_size);
+        });
+
+        readback.request(m_inscatter_t.get(), ATMOSPHERE_INSCATTER_W, ATMOSPHERE_INSCATTER_H * ATMOSPHERE_INSCATTER_D, 1, sizeof(glm::vec4), [tables, params](const uint8_t* data, size_t data_size) {
+            memcpy(tables->inscatter.data(), data, data_size);
+
+            if (!save_atmosphere_cache(params, *tables))
+                DW_LOG_WARNING("Failed to write atmosphere cache");
+        });
+    }
+
+    void upload(AtmosphereTables& tables)
+    {
+        m_transmittance_t->set_data(0, 0, tables.transmittance.data());
+        m_irradiance_t->set_data(0, 0, tables.irradiance.data());
+        m_inscatter_t->set_data(0, tables.inscatter.data());
+    }
+
+    // Everything the sky seen from 'camera' depends on. Moving sideways changes the view of a planet sized atmosphere
+    // by far less than a texel of the sky-view LUT, so only the altitude counts, and that in steps.
+    uint64_t sky_view_key(const glm::vec3& camera)
+    {
+        int32_t altitude = int32_t(floorf(camera.y / SKY_VIEW_ALTITUDE_STEP));
+
+        uint64_t h = parameters().hash();
+        h          = disk_cache::hash(&m_sun_angle, sizeof(float), h);
+        h          = disk_cache::hash(&m_sun_intensity, sizeof(float), h);
+        h          = disk_cache::hash(&altitude, sizeof(int32_t), h);
+
+        return h;
     }
 
-    void set_render_uniforms(dw::Program* program)
+    SkyUniforms render_uniforms()
     {
         m_direction = glm::normalize(glm::vec3(0.0f, sin(m_sun_angle), cos(m_sun_angle)));
 
-        program->set_uniform("betaR", m_beta_r / SCALE);
-        program->set_uniform("mieG", m_mie_g);
-        program->set_uniform("SUN_INTENSITY", m_sun_intensity);
-        program->set_uniform("EARTH_POS", glm::vec3(0.0f, 6360010.0f, 0.0f));
-        program->set_uniform("SUN_DIR", m_direction * -1.0f);
+        SkyUniforms uniforms;
 
-        if (program->set_uniform("s_Transmittance", 3))
-            m_transmittance_t->bind(3);
+        uniforms.beta_r    = glm::vec4(m_beta_r / SCALE, m_mie_g);
+        uniforms.earth_pos = glm::vec4(0.0f, 6360010.0f, 0.0f, m_sun_intensity);
+        uniforms.sun_dir   = glm::vec4(m_direction * -1.0f, 0.0f);
 
-        if (program->set_uniform("s_Irradiance", 4))
-            m_irradiance_t->bind(4);
+        return uniforms;
+    }
 
-        if (program->set_uniform("s_Inscatter", 5))
-            m_inscatter_t->bind(5);
+    // Texture units match the sampler bindings in atmosphere.glsl.
+    void bind_textures(GLState& state)
+    {
+        state.bind_texture(3, m_transmittance_t.get());
+        state.bind_texture(4, m_irradiance_t.get());
+        state.bind_texture(5, m_inscatter_t.get());
     }
 
-    dw::Texture2D* new_texture_2d(int width, int height)
+    std::unique_ptr<dw::Texture2D> new_texture_2d(int width, int height)
     {
-        dw::Texture2D* texture = new dw::Texture2D(width, height, 1, 1, 1, GL_RGBA32F, GL_RGBA, GL_FLOAT);
+        auto texture = std::make_unique<dw::Texture2D>(width, height, 1, 1, 1, GL_RGBA32F, GL_RGBA, GL_FLOAT);
         texture->set_min_filter(GL_LINEAR);
         texture->set_wrapping(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
 
         return texture;
     }
 
-    dw::Texture3D* new_texture_3d(int width, int height, int depth)
+    std::unique_ptr<dw::Texture3D> new_texture_3d(int width, int height, int depth)
     {
-        dw::Texture3D* texture = new dw::Texture3D(width, height, depth, 1, GL_RGBA32F, GL_RGBA, GL_FLOAT);
+        auto texture = std::make_unique<dw::Texture3D>(width, height, depth, 1, GL_RGBA32F, GL_RGBA, GL_FLOAT);
         texture->set_min_filter(GL_LINEAR);
         texture->set_wrapping(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
 
@@ -152,31 +352,115 @@ protected:
 
     bool init(int argc, const char* argv[]) override
     {
-        // Create GPU resources.
-        if (!create_shaders())
-            return false;
+        auto start = std::chrono::high_resolution_clock::now();
 
-        // Load mesh.
-        if (!load_mesh())
-            return false;
+        m_program_cache.initialize(&m_gl);
+
+        // Use the launch layouts tuned for this device, if any.
+        if (m_workgroups.load(m_program_cache.driver_hash(), PREFILTER_MIP_LEVELS, SH_MIN_WORK_GROUP_SIZE))
+            DW_LOG_INFO("Loaded tuned workgroup sizes: " + m_workgroups.to_string());
+
+        for (int i = 1; i < argc; i++)
+        {
+            if (strcmp(argv[i], "--mesh-benchmark") == 0)
+                benchmark_mesh_load(SCENE_MESH_PATH);
+        }
+
+        // File I/O and decoding run on worker threads while this thread, which owns the GL context, creates GPU resources
+        // and uploads every asset as soon as it has been decoded. Shaders keep compiling in the background until linked.
+        TaskGraph startup;
+
+        uint32_t shaders     = startup.add("Create Shaders", TASK_MAIN, [&]() { return create_shaders(); });
+        uint32_t decode_hdr  = startup.add("Decode HDR", TASK_WORKER, [&]() { return decode_environment_map(); });
+        uint32_t open_mesh   = startup.add("Open Mesh Asset", TASK_WORKER, [&]() { m_mesh_asset_valid = open_mesh_asset(SCENE_MESH_PATH, m_mesh_asset); return true; });
+        uint32_t read_tables = startup.add("Read Atmosphere Cache", TASK_WORKER, [&]() { m_model.prefetch_cache(); return true; });
+        uint32_t framebuffer = startup.add("Create Framebuffer", TASK_MAIN, [&]() { return create_framebuffer(); });
+        uint32_t uniforms    = startup.add("Create Uniform Ring", TASK_MAIN, [&]() { return create_uniform_ring(); });
+        uint32_t mesh        = startup.add("Upload Mesh", TASK_MAIN, [&]() { return load_mesh(); }, { open_mesh });
+        uint32_t env_map     = startup.add("Upload HDR", TASK_MAIN, [&]() { return load_environment_map(); }, { decode_hdr });
+        uint32_t link        = startup.add("Link Programs", TASK_MAIN, [&]() { return link_programs(); }, { shaders, framebuffer, mesh, env_map });
+        uint32_t atmosphere  = startup.add("Atmosphere Tables", TASK_MAIN, [&]() { return m_model.initialize(m_program_cache, m_memory, m_readback); }, { link, read_tables });
 
-        if (!load_environment_map())
+        startup.add("IBL Setup", TASK_MAIN, [&]() { return setup_ibl(); }, { link, atmosphere, uniforms, framebuffer, env_map });
+
+        if (!startup.run())
             return false;
 
-        if (!create_framebuffer())
+        startup.print_timeline();
+
+        glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+
+        // Optionally start from a baked probe instead of computing IBL every frame.
+        for (int i = 1; i < argc - 1; i++)
+        {
+            if (strcmp(argv[i], "--ibl") == 0)
+            {
+                strncpy(m_baked_ibl_path, argv[i + 1], sizeof(m_baked_ibl_path) - 1);
+
+                if (!load_baked_ibl(m_baked_ibl_path))
+                    return false;
+            }
+            else if (strcmp(argv[i], "--lighting-log") == 0)
+            {
+                strncpy(m_lighting_log_path, argv[i + 1], sizeof(m_lighting_log_path) - 1);
+
+                if (!m_lighting_log.open(m_lighting_log_path))
+                    return false;
+            }
+        }
+
+        for (int i = 1; i < argc; i++)
+        {
+            if (strcmp(argv[i], "--tune") == 0)
+                autotune_workgroups();
+            else if (strcmp(argv[i], "--cpu-prefilter-benchmark") == 0)
+                benchmark_cpu_prefilter();
+        }
+
+        auto end       = std::chrono::high_resolution_clock::now();
+        m_startup_time = std::chrono::duration<float, std::milli>(end - start).count();
+        m_warm_start   = m_program_cache.cached_count() == m_program_cache.program_count();
+
+        DW_LOG_INFO("Startup took " + std::to_string(m_startup_time) + " ms (" + (m_warm_start ? "warm" : "cold") + ", " + std::to_string(m_program_cache.cached_count()) + "/" + std::to_string(m_program_cache.program_count()) + " programs from binary cache)");
+
+        return true;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    bool link_programs()
+    {
+        if (!m_program_cache.finish())
+        {
+            DW_LOG_FATAL("Failed to link Shader Programs");
             return false;
+        }
+
+        return true;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
 
-        if (!m_model.initialize())
+    bool create_uniform_ring()
+    {
+        if (!m_uniforms.initialize(UNIFORM_RING_REGION_SIZE, &m_gl))
             return false;
 
-        // Create camera.
+        m_memory.track(&m_uniforms, "Uniform Ring", GPU_MEMORY_STREAMING, UNIFORM_RING_REGION_SIZE * UNIFORM_RING_FRAMES);
+
+        return true;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    // Everything computed once the programs are linked and the environment map is on the GPU.
+    bool setup_ibl()
+    {
         create_camera();
         create_cube();
         convert_env_map();
         precompute_prefilter_constants();
-        generate_brdf_lut();
-
-        glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+        generate_brdf_lut(m_workgroups);
 
         return true;
     }
@@ -187,46 +471,87 @@ protected:
     {
         DW_SCOPED_SAMPLE("Render");
 
+        // ImGui and the debug renderer changed GL state since the last frame.
+        m_gl.begin_frame();
+
         // Update camera.
         update_camera();
 
         if (m_show_gui)
             ui();
 
-        render_envmap();
+        m_model.update(m_memory, m_readback);
+
+        m_readback.update();
+        m_probe_baker.update();
+
+        if (m_readback.buffer_size() != m_readback_tracked_size)
+        {
+            m_readback_tracked_size = m_readback.buffer_size();
+            m_memory.track(&m_readback, "Readback Buffers", GPU_MEMORY_STREAMING, m_readback_tracked_size);
+        }
 
-        compute_spherical_harmonics();
+        // UI actions and the atmosphere precomputation bind textures through the framework.
+        m_gl.invalidate();
 
-        prefilter_cubemap();
+        // Conversions, tuning and imports triggered from the UI dispatch outside the graph.
+        if (m_gl.counters().dispatches > 0)
+            m_frame_graph.invalidate();
 
-        render_meshes();
+        build_frame_graph();
 
-        render_skybox();
+        m_frame_graph.execute(m_gl, m_memory);
 
         if (m_debug_mode)
             m_debug_draw.frustum(m_main_camera->m_view_projection, glm::vec3(0.0f, 1.0f, 0.0f));
 
         // Render debug draw.
         m_debug_draw.render(nullptr, m_width, m_height, m_debug_mode ? m_debug_camera->m_view_projection : m_main_camera->m_view_projection);
+
+        m_uniforms.next_frame();
+        m_frame_index++;
     }
 
     // -----------------------------------------------------------------------------------------------------------------------------------
 
     void shutdown() override
     {
+        // The last records are queued by the readback callbacks, so the log is closed after they have run.
+        m_readback.flush();
+        m_memory.release(&m_readback);
+        m_lighting_log.close();
+
+        // Joins the worker, which frees its own objects before its context goes away.
+        m_probe_baker.shutdown();
+        m_memory.release(&m_probe_baker);
+        discard_background_probe();
+
         dw::Mesh::unload(m_mesh);
+
+        // Free everything that is tracked while the context is still alive, so that whatever remains is a leak.
+        destroy_framebuffer();
+        m_model.shutdown(m_memory);
+        m_memory.destroy(m_env_map);
+        m_memory.release(&m_uniforms);
+
+        for (auto& buffer : m_sample_directions)
+            m_memory.destroy(buffer);
+
+        m_frame_graph.shutdown(m_memory);
+        m_memory.report_leaks();
     }
 
     // -----------------------------------------------------------------------------------------------------------------------------------
 
     void window_resized(int width, int height) override
     {
+        m_gl.invalidate();
+
         // Override window resized method to update camera projection.
         m_main_camera->update_projection(60.0f, 0.1f, CAMERA_FAR_PLANE, float(m_width) / float(m_height));
         m_debug_camera->update_projection(60.0f, 0.1f, CAMERA_FAR_PLANE * 2.0f, float(m_width) / float(m_height));
 
-        create_framebuffer();
-        convert_env_map();
+        // The IBL textures have fixed sizes, so nothing else depends on the window.
     }
 
     // -----------------------------------------------------------------------------------------------------------------------------------
@@ -338,488 +663,2299 @@ private:
 
         dw::profiler::ui();
 
-        ImGui::Separator();
+        ImGui::Text("Startup: %.1f ms (%s, %d/%d programs cached%s)", m_startup_time, m_warm_start ? "warm" : "cold", (int)m_program_cache.cached_count(), (int)m_program_cache.program_count(), m_program_cache.parallel_compile() ? ", parallel compile" : "");
+        ImGui::Text("Mesh: %.1f ms (%s)", m_mesh_load_time, m_mesh_from_cache ? "baked" : "source");
 
-        ImGui::Text("Prefilter Options");
+        if (m_mesh_benchmark_source > 0.0f)
+            ImGui::Text("Mesh benchmark: source %.2f ms, baked %.2f ms", m_mesh_benchmark_source, m_mesh_benchmark_cached);
 
-        int sample_count = m_sample_count;
-        ImGui::SliderInt("Sample Count", &m_sample_count, 1, 64);
+        ImGui::Text("Uniform ring: %d bytes last frame, %.2f ms fence wait, %d overflows", (int)m_uniforms.bytes_last_frame(), m_uniforms.wait_time(), (int)m_uniforms.overflow_count());
 
-        if (sample_count != m_sample_count)
-            precompute_prefilter_constants();
-    }
+        const GLCounters& counters = m_gl.last_frame();
 
-    // -----------------------------------------------------------------------------------------------------------------------------------
+        ImGui::Text("GL calls: %d draws, %d dispatches, %d barriers", (int)counters.draws, (int)counters.dispatches, (int)counters.barriers);
+        ImGui::Text("          %d binds, %d state changes, %d uniform updates, %d redundant skipped", (int)counters.binds, (int)counters.state_changes, (int)counters.uniform_updates, (int)counters.redundant);
 
-    bool load_environment_map()
-    {
-        m_env_map = std::unique_ptr<dw::Texture2D>(dw::Texture2D::create_from_files("hdr/Arches_E_PineTree_3k.hdr", true, false));
-        m_env_map->set_min_filter(GL_LINEAR);
-        m_env_map->set_mag_filter(GL_LINEAR);
-        return true;
-    }
+        ImGui::Separator();
 
-    // -----------------------------------------------------------------------------------------------------------------------------------
+        ImGui::Text("Frame Graph");
+        ImGui::Text("%d barriers, %d transients in %d pooled textures", (int)m_frame_graph.barrier_count(), (int)m_frame_graph.transient_count(), (int)m_frame_graph.pool_count());
 
-    bool create_shaders()
-    {
+        for (const auto& pass : m_frame_graph.last_frame())
         {
-            // Create general shaders
-            m_cubemap_convert_vs = std::unique_ptr<dw::Shader>(dw::Shader::create_from_file(GL_VERTEX_SHADER, "shader/equirectangular_to_cubemap_vs.glsl"));
-            m_cubemap_convert_fs = std::unique_ptr<dw::Shader>(dw::Shader::create_from_file(GL_FRAGMENT_SHADER, "shader/equirectangular_to_cubemap_fs.glsl"));
+            if (pass.culled)
+                ImGui::Text("  %s: culled", pass.name.c_str());
+            else
+                ImGui::Text("  %s: %s", pass.name.c_str(), frame_barrier_string(pass.barriers).c_str());
+        }
 
-            if (!m_cubemap_convert_vs->compiled() || !m_cubemap_convert_fs->compiled())
-            {
-                DW_LOG_FATAL("Failed to create Shaders");
-                return false;
-            }
+        ImGui::Separator();
 
-            // Create general shader program
-            dw::Shader* shaders[]     = { m_cubemap_convert_vs.get(), m_cubemap_convert_fs.get() };
-            m_cubemap_convert_program = std::make_unique<dw::Program>(2, shaders);
+        ImGui::Text("Scene");
 
-            if (!m_cubemap_convert_program)
-            {
-                DW_LOG_FATAL("Failed to create Shader Program");
-                return false;
-            }
-        }
+        if (ImGui::SliderInt("Objects", &m_scene_object_count, 1, MAX_SCENE_OBJECTS))
+            build_scene();
 
-        {
-            // Create general shaders
-            m_brdf_cs = std::unique_ptr<dw::Shader>(dw::Shader::create_from_file(GL_COMPUTE_SHADER, "shader/brdf_cs.glsl"));
+        ImGui::Checkbox("GPU Culling", &m_gpu_culling);
+        ImGui::Text("%d instances, 1 multi-draw of %d commands", (int)m_scene.instance_count(), (int)m_scene.command_count());
+        ImGui::Text("Vertex: %d bytes (unpacked %d), index: %d bytes", (int)m_scene.vertex_size(), (int)sizeof(dw::Vertex), (int)m_scene.index_size());
 
-            if (!m_brdf_cs->compiled())
-            {
-                DW_LOG_FATAL("Failed to create Shaders");
-                return false;
-            }
+        ImGui::Separator();
 
-            // Create general shader program
-            dw::Shader* shaders[] = { m_brdf_cs.get() };
-            m_brdf_program        = std::make_unique<dw::Program>(1, shaders);
+        ImGui::Text("Environment Mips");
 
-            if (!m_brdf_program)
-            {
-                DW_LOG_FATAL("Failed to create Shader Program");
-                return false;
-            }
-        }
+        ImGui::Checkbox("Compute Downsample", &m_compute_downsample);
 
-        {
-            // Create general shaders
-            m_prefilter_cs = std::unique_ptr<dw::Shader>(dw::Shader::create_from_file(GL_COMPUTE_SHADER, "shader/prefilter_cs.glsl"));
+        if (m_compute_downsample)
+            ImGui::Checkbox("SH From Downsample", &m_downsample_sh);
 
-            if (!m_prefilter_cs->compiled())
-            {
-                DW_LOG_FATAL("Failed to create Shaders");
-                return false;
-            }
+        ImGui::Checkbox("SH From Atmosphere", &m_direct_sky_sh);
+        ImGui::Checkbox("Capture From Sky-View LUT", &m_sky_view_lut);
 
-            // Create general shader program
-            dw::Shader* shaders[] = { m_prefilter_cs.get() };
-            m_prefilter_program   = std::make_unique<dw::Program>(1, shaders);
+        if (m_sky_view_lut)
+            ImGui::Text("Sky-View LUT rebuilds: %d", (int)m_sky_view_rebuilds);
 
-            if (!m_prefilter_program)
-            {
-                DW_LOG_FATAL("Failed to create Shader Program");
-                return false;
-            }
+        ImGui::Checkbox("Compute Equirect Conversion", &m_compute_equirect);
 
-            m_prefilter_program->uniform_block_binding("u_SampleDirections", 0);
-        }
+        if (m_compute_equirect)
+            ImGui::Checkbox("SH From Equirect", &m_equirect_sh);
+
+        if (ImGui::Button("Convert HDR"))
+            convert_env_map();
+
+        ImGui::SameLine();
+
+        if (ImGui::Button("Bake In Background"))
+            bake_in_background();
 
+        if (m_probe_baker.pending() > 0)
+            ImGui::Text("Background bakes in flight: %u", m_probe_baker.pending());
+        else if (m_background_probe.prefiltered)
         {
-            // Create general shaders
-            m_sh_projection_cs = std::unique_ptr<dw::Shader>(dw::Shader::create_from_file(GL_COMPUTE_SHADER, "shader/sh_projection_cs.glsl"));
+            ImGui::Text("Background bake ready: %.2f ms", m_background_bake_time);
 
-            if (!m_sh_projection_cs->compiled())
-            {
-                DW_LOG_FATAL("Failed to create Shaders");
-                return false;
-            }
+            // Applying the bake stops the live sky capture, so it is left to the user.
+            if (ImGui::Button("Apply Background Bake"))
+                apply_background_probe();
 
-            // Create general shader program
-            dw::Shader* shaders[]   = { m_sh_projection_cs.get() };
-            m_sh_projection_program = std::make_unique<dw::Program>(1, shaders);
+            ImGui::SameLine();
 
-            if (!m_sh_projection_program)
-            {
-                DW_LOG_FATAL("Failed to create Shader Program");
-                return false;
-            }
+            if (ImGui::Button("Discard"))
+                discard_background_probe();
         }
+        else if (m_background_bake_time > 0.0f)
+            ImGui::Text("Last background bake: %.2f ms", m_background_bake_time);
 
-        {
-            // Create general shaders
-            m_sh_add_cs = std::unique_ptr<dw::Shader>(dw::Shader::create_from_file(GL_COMPUTE_SHADER, "shader/sh_add_cs.glsl"));
+        // Unticking either override hands the probe back to the per-frame passes.
+        if (m_background_bake_active && !(m_use_imported_env && m_use_baked_ibl))
+            m_background_bake_active = false;
 
-            if (!m_sh_add_cs->compiled())
-            {
-                DW_LOG_FATAL("Failed to create Shaders");
-                return false;
-            }
+        if (m_background_bake_active)
+        {
+            ImGui::Text("Live sky overridden by the background bake");
 
-            // Create general shader program
-            dw::Shader* shaders[] = { m_sh_add_cs.get() };
-            m_sh_add_program      = std::make_unique<dw::Program>(1, shaders);
+            ImGui::SameLine();
 
-            if (!m_sh_add_program)
+            if (ImGui::Button("Resume Live Sky"))
             {
-                DW_LOG_FATAL("Failed to create Shader Program");
-                return false;
+                m_use_imported_env       = false;
+                m_use_baked_ibl          = false;
+                m_imported_env_loaded    = false;
+                m_baked_ibl_loaded       = false;
+                m_background_bake_active = false;
             }
         }
 
-        {
-            // Create general shaders
-            m_mesh_vs = std::unique_ptr<dw::Shader>(dw::Shader::create_from_file(GL_VERTEX_SHADER, "shader/mesh_vs.glsl"));
-            m_mesh_fs = std::unique_ptr<dw::Shader>(dw::Shader::create_from_file(GL_FRAGMENT_SHADER, "shader/mesh_fs.glsl"));
+        ImGui::Separator();
 
-            if (!m_mesh_vs->compiled() || !m_mesh_fs->compiled())
-            {
-                DW_LOG_FATAL("Failed to create Shaders");
-                return false;
-            }
+        ImGui::Text("Prefilter Options");
 
-            // Create general shader program
-            dw::Shader* shaders[] = { m_mesh_vs.get(), m_mesh_fs.get() };
-            m_mesh_program        = std::make_unique<dw::Program>(2, shaders);
+        int sample_count = m_sample_count;
+        ImGui::SliderInt("Sample Count", &m_sample_count, 1, 64);
 
-            if (!m_mesh_program)
-            {
-                DW_LOG_FATAL("Failed to create Shader Program");
-                return false;
-            }
-        }
+        if (sample_count != m_sample_count)
+            precompute_prefilter_constants();
+
+        ImGui::Checkbox("Progressive", &m_progressive_prefilter);
+
+        if (ImGui::Checkbox("Pipelined IBL", &m_pipelined_ibl))
+            create_ibl_history();
+
+        if (m_pipelined_ibl)
+            ImGui::Text("Shading one frame behind the bake, +%.2f MB%s", float(ibl_set_size()) / (1024.0f * 1024.0f), ibl_pipelined() ? "" : " (inactive)");
 
+        if (ImGui::Checkbox("Octahedral Prefiltered Map", &m_octahedral_probe))
+            create_octahedral_probe();
+
+        if (m_octahedral_probe)
+            ImGui::Text("%.2f MB instead of %.2f MB for the cubemap", float(octahedral_probe_size()) / (1024.0f * 1024.0f), float(gpu_texture_size(PREFILTER_MAP_SIZE, PREFILTER_MAP_SIZE, 6, PREFILTER_MIP_LEVELS, GL_RGBA16F)) / (1024.0f * 1024.0f));
+
+        if (m_progressive_prefilter)
         {
-            m_cubemap_vs = std::unique_ptr<dw::Shader>(dw::Shader::create_from_file(GL_VERTEX_SHADER, "shader/sky_vs.glsl"));
-            m_cubemap_fs = std::unique_ptr<dw::Shader>(dw::Shader::create_from_file(GL_FRAGMENT_SHADER, "shader/sky_fs.glsl"));
+            ImGui::SliderInt("Samples Per Frame", &m_progressive_samples, 1, 16);
+            ImGui::Text("Accumulated frames: %d", m_progressive_frame);
+        }
 
-            if (!m_cubemap_vs->compiled() || !m_cubemap_fs->compiled())
-            {
-                DW_LOG_FATAL("Failed to create Shaders");
-                return false;
-            }
+        ImGui::Checkbox("Specialised Kernels", &m_specialize_prefilter);
+        ImGui::Text("Prefilter variants: %d", (int)m_prefilter_permutations->variant_count());
 
-            // Create general shader program
-            dw::Shader* shaders[] = { m_cubemap_vs.get(), m_cubemap_fs.get() };
-            m_cubemap_program     = std::make_unique<dw::Program>(2, shaders);
+        // Mips inside the batched dispatch always use GGX sampling.
+        int batch_start = PREFILTER_MIP_LEVELS - m_workgroups.prefilter_batch;
 
-            if (!m_cubemap_program)
-            {
-                DW_LOG_FATAL("Failed to create Shader Program");
-                return false;
-            }
+        ImGui::Text("Fast Filter Mips");
+
+        for (int mip = 0; mip < batch_start; mip++)
+        {
+            ImGui::SameLine();
+            ImGui::Checkbox(std::to_string(mip).c_str(), &m_fast_prefilter[mip]);
         }
 
+        if (ImGui::Button("Compare With Reference"))
+            compare_prefilter_paths();
+
+        if (m_prefilter_report.valid)
         {
-            m_sky_envmap_vs = std::unique_ptr<dw::Shader>(dw::Shader::create_from_file(GL_VERTEX_SHADER, "shader/sky_envmap_vs.glsl"));
-            m_sky_envmap_fs = std::unique_ptr<dw::Shader>(dw::Shader::create_from_file(GL_FRAGMENT_SHADER, "shader/sky_envmap_fs.glsl"));
+            ImGui::Text("Reference: %.3f ms, Selected: %.3f ms", m_prefilter_report.reference_time, m_prefilter_report.selected_time);
 
-            if (!m_sky_envmap_vs->compiled() || !m_sky_envmap_fs->compiled())
-            {
-                DW_LOG_FATAL("Failed to create Shaders");
-                return false;
-            }
+            for (int mip = 0; mip < PREFILTER_MIP_LEVELS; mip++)
+                ImGui::Text("Mip %d (%s): %.4f", mip, mip < batch_start && m_fast_prefilter[mip] ? "fast" : "ggx", m_prefilter_report.error[mip]);
+        }
+
+        if (ImGui::Button("Benchmark CPU Prefilter"))
+            benchmark_cpu_prefilter();
 
-            // Create general shader program
-            dw::Shader* shaders[] = { m_sky_envmap_vs.get(), m_sky_envmap_fs.get() };
-            m_sky_envmap_program  = std::make_unique<dw::Program>(2, shaders);
+        for (auto& timing : m_cpu_prefilter_timings)
+            ImGui::Text("CPU, %d threads: %.1f ms (%.2fx)", (int)timing.x, timing.y, m_cpu_prefilter_timings[0].y / timing.y);
+
+        if (!m_cpu_prefilter_timings.empty())
+        {
+            ImGui::Text("CPU error");
 
-            if (!m_sky_envmap_program)
+            for (int mip = 0; mip < PREFILTER_MIP_LEVELS; mip++)
             {
-                DW_LOG_FATAL("Failed to create Shader Program");
-                return false;
+                ImGui::SameLine();
+                ImGui::Text("%.4f", m_cpu_prefilter_error[mip]);
             }
         }
 
-        return true;
-    }
+        ImGui::Separator();
 
-    // -----------------------------------------------------------------------------------------------------------------------------------
+        ImGui::Text("Workgroups");
 
-    bool create_framebuffer()
-    {
-        // uint32_t w, uint32_t h, uint32_t array_size, int32_t mip_levels, GLenum internal_format, GLenum format, GLenum type
-        m_env_cubemap       = std::make_unique<dw::TextureCube>(ENVIRONMENT_MAP_SIZE, ENVIRONMENT_MAP_SIZE, 1, 1, GL_RGB16F, GL_RGB, GL_HALF_FLOAT);
-        m_cubemap_depth     = std::make_unique<dw::Texture2D>(ENVIRONMENT_MAP_SIZE, ENVIRONMENT_MAP_SIZE, 1, 1, 1, GL_DEPTH_COMPONENT32F, GL_DEPTH_COMPONENT, GL_FLOAT);
-        m_prefilter_cubemap = std::make_unique<dw::TextureCube>(PREFILTER_MAP_SIZE, PREFILTER_MAP_SIZE, 1, PREFILTER_MIP_LEVELS, GL_RGBA16F, GL_RGBA, GL_HALF_FLOAT);
-        m_sh_intermediate   = std::make_unique<dw::Texture2D>(SH_INTERMEDIATE_SIZE * 9, SH_INTERMEDIATE_SIZE, 6, 1, 1, GL_RGBA32F, GL_RGBA, GL_FLOAT);
-        m_brdf_lut          = std::make_unique<dw::Texture2D>(BRDF_LUT_SIZE, BRDF_LUT_SIZE, 1, 1, 1, GL_RG16F, GL_RG, GL_HALF_FLOAT);
-        m_sh                = std::make_unique<dw::Texture2D>(9, 1, 1, 1, 1, GL_RGBA32F, GL_RGBA, GL_FLOAT);
+        ImGui::Text("Prefilter: %dx%dx%d, batch %d", m_workgroups.prefilter.x, m_workgroups.prefilter.y, m_workgroups.prefilter.z, m_workgroups.prefilter_batch);
+        ImGui::Text("SH Projection: %dx%dx%d", m_workgroups.sh_projection.x, m_workgroups.sh_projection.y, m_workgroups.sh_projection.z);
+        ImGui::Text("BRDF: %dx%d", m_workgroups.brdf.x, m_workgroups.brdf.y);
 
-        m_sh_intermediate->set_min_filter(GL_NEAREST);
-        m_sh_intermediate->set_mag_filter(GL_NEAREST);
+        if (ImGui::Button("Autotune"))
+            autotune_workgroups();
 
-        m_brdf_lut->set_min_filter(GL_NEAREST);
-        m_brdf_lut->set_mag_filter(GL_NEAREST);
+        ImGui::SameLine();
 
-        m_sh->set_min_filter(GL_NEAREST);
-        m_sh->set_mag_filter(GL_NEAREST);
+        if (ImGui::Button("Reset"))
+            m_workgroups = WorkgroupConfig();
 
-        for (int i = 0; i < 6; i++)
+        ImGui::Separator();
+
+        ImGui::Text("Atmosphere");
+
+        static const char* presets[] = { kAtmospherePresets[0].name, kAtmospherePresets[1].name, kAtmospherePresets[2].name, kAtmospherePresets[3].name };
+
+        if (ImGui::Combo("Preset", &m_atmosphere_preset, presets, 4))
         {
-            m_cubemap_fbos.push_back(std::make_unique<dw::Framebuffer>());
-            m_cubemap_fbos[i]->attach_render_target(0, m_env_cubemap.get(), i, 0, 0, true, true);
-            m_cubemap_fbos[i]->attach_depth_stencil_target(m_cubemap_depth.get(), 0, 0);
+            m_model.m_beta_r = kAtmospherePresets[m_atmosphere_preset].beta_r;
+            m_model.m_mie_g  = kAtmospherePresets[m_atmosphere_preset].mie_g;
         }
 
-        return true;
+        // Every change rebuilds the scattering tables and writes them to the cache, so edits are only applied once they
+        // are finished rather than on every keystroke or drag step.
+        ImGui::InputFloat3("Rayleigh Scattering", &m_beta_r_edit.x);
+
+        if (ImGui::IsItemDeactivatedAfterEdit())
+            m_model.m_beta_r = m_beta_r_edit;
+        else if (!ImGui::IsItemActive())
+            m_beta_r_edit = m_model.m_beta_r;
+
+        ImGui::SliderFloat("Mie G", &m_mie_g_edit, 0.0f, 0.99f);
+
+        if (ImGui::IsItemDeactivatedAfterEdit())
+            m_model.m_mie_g = m_mie_g_edit;
+        else if (!ImGui::IsItemActive())
+            m_mie_g_edit = m_model.m_mie_g;
+
+        static const char* backends[] = { "CPU", "Compute" };
+        ImGui::Combo("Precompute Backend", &m_model.m_backend, backends, 2);
+
+        ImGui::Text("Tables: %.1f ms (%s)", m_model.m_precompute_time, m_model.m_loaded_from_cache ? "cache" : backends[m_model.m_backend]);
+
+        ImGui::Separator();
+
+        ImGui::Text("Baked IBL");
+
+        ImGui::InputText("Path", m_baked_ibl_path, sizeof(m_baked_ibl_path));
+
+        // Without a loaded probe the baked path would shade with whatever the per-frame passes left behind. Switching it
+        // off lets those passes overwrite the probe, so it has to be loaded again before it can be switched back on.
+        if (m_baked_ibl_loaded)
+        {
+            if (ImGui::Checkbox("Use Baked IBL", &m_use_baked_ibl) && !m_use_baked_ibl)
+                m_baked_ibl_loaded = false;
+        }
+        else
+            ImGui::Text("No baked IBL loaded");
+
+        if (ImGui::Button("Save"))
+            save_baked_ibl(m_baked_ibl_path);
+
+        ImGui::SameLine();
+
+        if (ImGui::Button("Load"))
+            load_baked_ibl(m_baked_ibl_path);
+
+        ImGui::Separator();
+
+        ImGui::Text("KTX2");
+
+        if (ktx2_supercompression_available())
+            ImGui::Checkbox("Zstandard Supercompression", &m_ktx2_supercompress);
+
+        // Gated like the baked IBL toggle: without an import it would only freeze the last captured sky, and switching it
+        // off lets the capture overwrite the imported environment.
+        if (m_imported_env_loaded)
+        {
+            if (ImGui::Checkbox("Use Imported Environment", &m_use_imported_env) && !m_use_imported_env)
+                m_imported_env_loaded = false;
+        }
+        else
+            ImGui::Text("No environment imported");
+
+        // The SH coefficients travel with the prefiltered cubemap, so that an import never pairs the imported specular
+        // term with the diffuse term of whatever was computed last.
+        if (ImGui::Button("Export Prefiltered"))
+        {
+            export_ktx2("prefiltered.ktx2", shading_prefilter_cubemap(), KTX2_VK_FORMAT_R16G16B16A16_SFLOAT, PREFILTER_MAP_SIZE, PREFILTER_MAP_SIZE, PREFILTER_MIP_LEVELS);
+            export_ktx2("sh.ktx2", shading_sh(), KTX2_VK_FORMAT_R32G32B32A32_SFLOAT, 9, 1, 1);
+        }
+
+        ImGui::SameLine();
+
+        if (ImGui::Button("Import Prefiltered") && import_ktx2("sh.ktx2", m_sh.get(), KTX2_VK_FORMAT_R32G32B32A32_SFLOAT, 9, 1, 1) && import_ktx2("prefiltered.ktx2", m_prefilter_cubemap.get(), KTX2_VK_FORMAT_R16G16B16A16_SFLOAT, PREFILTER_MAP_SIZE, PREFILTER_MAP_SIZE, PREFILTER_MIP_LEVELS))
+        {
+            m_use_baked_ibl          = true;
+            m_baked_ibl_loaded       = true;
+            m_background_bake_active = false;
+        }
+
+        if (ImGui::Button("Export Environment"))
+            export_ktx2("environment.ktx2", m_env_cubemap.get(), KTX2_VK_FORMAT_R16G16B16A16_SFLOAT, ENVIRONMENT_MAP_SIZE, ENVIRONMENT_MAP_SIZE, 1);
+
+        ImGui::SameLine();
+
+        if (ImGui::Button("Import Environment") && import_ktx2("environment.ktx2", m_env_cubemap.get(), KTX2_VK_FORMAT_R16G16B16A16_SFLOAT, ENVIRONMENT_MAP_SIZE, ENVIRONMENT_MAP_SIZE, 1))
+        {
+            m_use_imported_env       = true;
+            m_imported_env_loaded    = true;
+            m_background_bake_active = false;
+        }
+
+        if (ImGui::Button("Export BRDF LUT"))
+            export_ktx2("brdf_lut.ktx2", m_brdf_lut.get(), KTX2_VK_FORMAT_R16G16_SFLOAT, BRDF_LUT_SIZE, BRDF_LUT_SIZE, 1);
+
+        ImGui::SameLine();
+
+        if (ImGui::Button("Import BRDF LUT"))
+            import_ktx2("brdf_lut.ktx2", m_brdf_lut.get(), KTX2_VK_FORMAT_R16G16_SFLOAT, BRDF_LUT_SIZE, BRDF_LUT_SIZE, 1);
+
+        if (m_readback.pending() > 0)
+            ImGui::Text("Readbacks in flight: %d", (int)m_readback.pending());
+
+        ImGui::Separator();
+
+        ImGui::Text("Lighting Log");
+
+        if (m_lighting_log.is_open())
+        {
+            LightingLogStats stats = m_lighting_log.stats();
+
+            ImGui::SliderInt("SH Interval (frames)", &m_lighting_log_interval, 1, 600);
+
+            if (octahedral_probe())
+                ImGui::Text("The prefiltered cubemap is not updated with the octahedral probe");
+            else if (ImGui::Button("Log Prefiltered Cubemap"))
+                m_log_prefiltered = true;
+
+            ImGui::Text("Records: %d, %.2f MB written, %d dropped", (int)stats.records, float(stats.bytes) / (1024.0f * 1024.0f), (int)stats.dropped);
+            ImGui::Text("Queued: %.2f MB", float(stats.queued) / (1024.0f * 1024.0f));
+
+            if (ImGui::Button("Stop Logging"))
+                m_lighting_log.close();
+        }
+        else
+        {
+            ImGui::InputText("Log Path", m_lighting_log_path, sizeof(m_lighting_log_path));
+
+            if (ImGui::Button("Start Logging"))
+                m_lighting_log.open(m_lighting_log_path);
+        }
+
+        ImGui::Separator();
+
+        ImGui::Text("GPU Memory");
+
+        const float mb = 1.0f / (1024.0f * 1024.0f);
+
+        for (int i = 0; i < GPU_MEMORY_CATEGORY_COUNT; i++)
+        {
+            GpuMemoryCategory category = (GpuMemoryCategory)i;
+            ImGui::Text("%s: %.2f MB (peak %.2f MB)", gpu_memory_category_name(category), float(m_memory.current(category)) * mb, float(m_memory.peak(category)) * mb);
+        }
+
+        ImGui::Text("Total: %.2f MB (peak %.2f MB)", float(m_memory.current_total()) * mb, float(m_memory.peak_total()) * mb);
+        ImGui::Text("Allocations: %d, Leaks: %d", (int)m_memory.allocation_count(), (int)m_memory.leak_count());
+
+        if (ImGui::Button("Write Memory Report"))
+            m_memory.write_json("gpu_memory.json");
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    // Decodes the HDR into system memory. Runs on a worker thread, a failure leaves the file to the framework loader.
+    bool decode_environment_map()
+    {
+        std::string error;
+
+        if (!load_hdr_image(ENVIRONMENT_MAP_PATH, m_env_image, &error))
+        {
+            DW_LOG_WARNING(error);
+            m_env_image = HdrImage();
+        }
+
+        return true;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    bool load_environment_map()
+    {
+        if (m_env_image.data.empty())
+            m_env_map = std::unique_ptr<dw::Texture2D>(dw::Texture2D::create_from_files(ENVIRONMENT_MAP_PATH, true, false));
+        else
+        {
+            uint32_t mip_levels = 1 + uint32_t(floorf(log2f(float(std::max(m_env_image.width, m_env_image.height)))));
+
+            m_env_map = std::make_unique<dw::Texture2D>(m_env_image.width, m_env_image.height, 1, mip_levels, 1, GL_RGB32F, GL_RGB, GL_FLOAT);
+            m_env_map->set_data(0, 0, m_env_image.data.data());
+            m_env_map->generate_mipmaps();
+
+            m_env_image = HdrImage();
+        }
+
+        if (!m_env_map)
+        {
+            DW_LOG_FATAL("Failed to load environment map!");
+            return false;
+        }
+
+        m_env_map->set_min_filter(GL_LINEAR);
+        m_env_map->set_mag_filter(GL_LINEAR);
+
+        m_memory.track(m_env_map.get(), "Environment Map (HDR)", GPU_MEMORY_SOURCE, gpu_texture_size(m_env_map->width(), m_env_map->height(), 1, m_env_map->mip_levels(), m_env_map->internal_format()));
+
+        return true;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    // Queues every program. Cached binaries are loaded immediately, everything else compiles in the background until
+    // ProgramCache::finish() or the first use of the program.
+    bool create_shaders()
+    {
+        // Keep the constants shared between C++ and GLSL in one place. Launch layouts are added per variant.
+        ShaderDefines brdf_defines;
+        brdf_defines.set("BRDF_LUT_SIZE", BRDF_LUT_SIZE);
+
+        ShaderDefines prefilter_defines;
+        prefilter_defines.set("MAX_SAMPLES", MAX_PREFILTER_SAMPLES);
+
+        ShaderDefines sh_projection_defines;
+        sh_projection_defines.set("ENVIRONMENT_MAP_SIZE", IRRADIANCE_CUBEMAP_SIZE).set("CUBEMAP_MIP_LEVEL", log2f(ENVIRONMENT_MAP_SIZE / IRRADIANCE_CUBEMAP_SIZE));
+
+        ShaderDefines downsample_defines;
+        downsample_defines.set("ENVIRONMENT_MAP_SIZE", ENVIRONMENT_MAP_SIZE).set("MIP_COUNT", ENVIRONMENT_MAP_MIP_LEVELS);
+
+        ShaderDefines equirect_defines;
+        equirect_defines.set("ENVIRONMENT_MAP_SIZE", ENVIRONMENT_MAP_SIZE).set("TILE_SIZE", DOWNSAMPLE_TILE_SIZE);
+
+        m_prefilter_permutations      = std::make_unique<ShaderPermutations>(m_program_cache, std::vector<ShaderStage>{ { GL_COMPUTE_SHADER, "shader/prefilter_cs.glsl" } }, prefilter_defines);
+        m_brdf_permutations           = std::make_unique<ShaderPermutations>(m_program_cache, std::vector<ShaderStage>{ { GL_COMPUTE_SHADER, "shader/brdf_cs.glsl" } }, brdf_defines);
+        m_sh_projection_permutations  = std::make_unique<ShaderPermutations>(m_program_cache, std::vector<ShaderStage>{ { GL_COMPUTE_SHADER, "shader/sh_projection_cs.glsl" } }, sh_projection_defines);
+        m_sh_add_permutations         = std::make_unique<ShaderPermutations>(m_program_cache, std::vector<ShaderStage>{ { GL_COMPUTE_SHADER, "shader/sh_add_cs.glsl" } });
+        m_prefilter_fast_permutations = std::make_unique<ShaderPermutations>(m_program_cache, std::vector<ShaderStage>{ { GL_COMPUTE_SHADER, "shader/prefilter_fast_cs.glsl" } });
+        m_downsample_permutations     = std::make_unique<ShaderPermutations>(m_program_cache, std::vector<ShaderStage>{ { GL_COMPUTE_SHADER, "shader/downsample_cs.glsl" } }, downsample_defines);
+        m_equirect_permutations       = std::make_unique<ShaderPermutations>(m_program_cache, std::vector<ShaderStage>{ { GL_COMPUTE_SHADER, "shader/equirectangular_to_cubemap_cs.glsl" } }, equirect_defines);
+
+        m_cubemap_convert_program = m_program_cache.create({ { GL_VERTEX_SHADER, "shader/equirectangular_to_cubemap_vs.glsl" }, { GL_FRAGMENT_SHADER, "shader/equirectangular_to_cubemap_fs.glsl" } });
+        m_mesh_program            = m_program_cache.create({ { GL_VERTEX_SHADER, "shader/mesh_vs.glsl" }, { GL_FRAGMENT_SHADER, "shader/mesh_fs.glsl" } });
+        m_mesh_octahedral_program = m_program_cache.create({ { GL_VERTEX_SHADER, "shader/mesh_vs.glsl" }, { GL_FRAGMENT_SHADER, "shader/mesh_fs.glsl" } }, ShaderDefines().set("OCTAHEDRAL_PROBE").list());
+        m_cubemap_program         = m_program_cache.create({ { GL_VERTEX_SHADER, "shader/sky_vs.glsl" }, { GL_FRAGMENT_SHADER, "shader/sky_fs.glsl" } });
+        m_sky_octahedral_program  = m_program_cache.create({ { GL_VERTEX_SHADER, "shader/sky_vs.glsl" }, { GL_FRAGMENT_SHADER, "shader/sky_fs.glsl" } }, ShaderDefines().set("OCTAHEDRAL_PROBE").list());
+        m_sky_envmap_program      = m_program_cache.create({ { GL_VERTEX_SHADER, "shader/sky_envmap_vs.glsl" }, { GL_FRAGMENT_SHADER, "shader/sky_envmap_fs.glsl" } });
+        m_sky_envmap_lut_program  = m_program_cache.create({ { GL_VERTEX_SHADER, "shader/sky_envmap_vs.glsl" }, { GL_FRAGMENT_SHADER, "shader/sky_envmap_fs.glsl" } }, ShaderDefines().set("SKY_VIEW_LUT").list());
+        m_sky_view_program        = m_program_cache.create({ { GL_COMPUTE_SHADER, "shader/sky_view_cs.glsl" } });
+        m_cull_program            = m_program_cache.create({ { GL_COMPUTE_SHADER, "shader/cull_cs.glsl" } });
+        m_sky_sh_program          = m_program_cache.create({ { GL_COMPUTE_SHADER, "shader/sky_sh_cs.glsl" } }, ShaderDefines().set("SAMPLE_COUNT", SKY_SH_SAMPLE_COUNT).list());
+
+        // Queue the variants for the current launch configuration so they compile alongside the rest.
+        ShaderProgram* programs[] = { m_cubemap_convert_program.get(), m_mesh_program.get(), m_mesh_octahedral_program.get(), m_cubemap_program.get(), m_sky_octahedral_program.get(), m_sky_envmap_program.get(), m_sky_envmap_lut_program.get(), m_sky_view_program.get(), m_cull_program.get(), m_sky_sh_program.get(), brdf_program(m_workgroups), sh_projection_program(m_workgroups), sh_add_program(m_workgroups), prefilter_program(m_workgroups, 0, 1), prefilter_fast_program(m_workgroups), downsample_program(), sh_add_partials_program(), equirect_program() };
+
+        for (auto program : programs)
+        {
+            if (!program)
+            {
+                DW_LOG_FATAL("Failed to create Shader Program");
+                return false;
+            }
+        }
+
+        int batch_start = PREFILTER_MIP_LEVELS - m_workgroups.prefilter_batch;
+
+        for (int mip = 1; mip <= batch_start; mip++)
+            prefilter_program(m_workgroups, mip, mip == batch_start ? m_workgroups.prefilter_batch : 1);
+
+        return true;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    bool create_framebuffer()
+    {
+        // Release the previous set first, so that the registry sees the replacement rather than a leak.
+        destroy_framebuffer();
+
+        // uint32_t w, uint32_t h, uint32_t array_size, int32_t mip_levels, GLenum internal_format, GLenum format, GLenum type
+        m_env_cubemap       = std::make_unique<dw::TextureCube>(ENVIRONMENT_MAP_SIZE, ENVIRONMENT_MAP_SIZE, 1, ENVIRONMENT_MAP_MIP_LEVELS, GL_RGBA16F, GL_RGBA, GL_HALF_FLOAT);
+        m_prefilter_cubemap = std::make_unique<dw::TextureCube>(PREFILTER_MAP_SIZE, PREFILTER_MAP_SIZE, 1, PREFILTER_MIP_LEVELS, GL_RGBA16F, GL_RGBA, GL_HALF_FLOAT);
+        m_brdf_lut          = std::make_unique<dw::Texture2D>(BRDF_LUT_SIZE, BRDF_LUT_SIZE, 1, 1, 1, GL_RG16F, GL_RG, GL_HALF_FLOAT);
+        m_sh                = std::make_unique<dw::Texture2D>(9, 1, 1, 1, 1, GL_RGBA32F, GL_RGBA, GL_FLOAT);
+
+        m_brdf_lut->set_min_filter(GL_NEAREST);
+        m_brdf_lut->set_mag_filter(GL_NEAREST);
+
+        m_sh->set_min_filter(GL_NEAREST);
+        m_sh->set_mag_filter(GL_NEAREST);
+
+        glBindTexture(GL_TEXTURE_CUBE_MAP, m_env_cubemap->id());
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, ENVIRONMENT_MAP_MIP_LEVELS - 1);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+
+        // The tile counters have to start at zero, the downsampler resets them itself afterwards.
+        std::vector<uint8_t> tiles(sizeof(glm::vec4) * 6 * DOWNSAMPLE_TILE_COUNT * DOWNSAMPLE_TILE_COUNT + sizeof(uint32_t) * 6, 0);
+
+        m_downsample_tiles  = std::make_unique<dw::ShaderStorageBuffer>(GL_DYNAMIC_DRAW, tiles.size(), tiles.data());
+        m_sh_partials       = std::make_unique<dw::ShaderStorageBuffer>(GL_DYNAMIC_DRAW, sizeof(glm::vec4) * 9 * 6 * DOWNSAMPLE_TILE_COUNT * DOWNSAMPLE_TILE_COUNT);
+        m_sh_partials_valid = false;
+
+        m_memory.track(m_env_cubemap.get(), "Environment Cubemap", GPU_MEMORY_IBL, gpu_texture_size(ENVIRONMENT_MAP_SIZE, ENVIRONMENT_MAP_SIZE, 6, ENVIRONMENT_MAP_MIP_LEVELS, GL_RGBA16F));
+        m_memory.track(m_prefilter_cubemap.get(), "Prefiltered Cubemap", GPU_MEMORY_IBL, gpu_texture_size(PREFILTER_MAP_SIZE, PREFILTER_MAP_SIZE, 6, PREFILTER_MIP_LEVELS, GL_RGBA16F));
+        m_memory.track(m_brdf_lut.get(), "BRDF LUT", GPU_MEMORY_IBL, gpu_texture_size(BRDF_LUT_SIZE, BRDF_LUT_SIZE, 1, 1, GL_RG16F));
+        m_memory.track(m_sh.get(), "SH Coefficients", GPU_MEMORY_IBL, gpu_texture_size(9, 1, 1, 1, GL_RGBA32F));
+        m_memory.track(m_downsample_tiles.get(), "Downsample Tiles", GPU_MEMORY_IBL, tiles.size());
+        m_memory.track(m_sh_partials.get(), "SH Partial Sums", GPU_MEMORY_IBL, sizeof(glm::vec4) * 9 * 6 * DOWNSAMPLE_TILE_COUNT * DOWNSAMPLE_TILE_COUNT);
+
+        // The prefiltered cubemap was recreated as well, so any accumulated result is gone.
+        m_env_version++;
+
+        create_ibl_history();
+        create_octahedral_probe();
+        create_cubemap_fbos();
+
+        return true;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void create_cubemap_fbos()
+    {
+        m_cubemap_fbos.clear();
+
+        // The captures draw a single cube around the camera, so they need no depth buffer.
+        for (int i = 0; i < 6; i++)
+        {
+            m_cubemap_fbos.push_back(std::make_unique<dw::Framebuffer>());
+            m_cubemap_fbos[i]->attach_render_target(0, m_env_cubemap.get(), i, 0, 0, true, true);
+        }
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void destroy_framebuffer()
+    {
+        m_cubemap_fbos.clear();
+
+        m_memory.destroy(m_env_cubemap);
+        m_memory.destroy(m_prefilter_cubemap);
+        m_memory.destroy(m_brdf_lut);
+        m_memory.destroy(m_sh);
+        m_memory.destroy(m_downsample_tiles);
+        m_memory.destroy(m_sh_partials);
+        m_memory.destroy(m_shading_prefilter_cubemap);
+        m_memory.destroy(m_shading_sh);
+        m_memory.destroy(m_prefilter_octahedral);
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    bool load_mesh()
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+
+        // The asset was mapped and validated by a startup task.
+        m_mesh = load_mesh_cached(SCENE_MESH_PATH, m_mesh_asset_valid ? &m_mesh_asset : nullptr, &m_mesh_from_cache);
+        m_mesh_asset.close();
+
+        if (!m_mesh)
+        {
+            DW_LOG_FATAL("Failed to load mesh!");
+            return false;
+        }
+
+        auto end         = std::chrono::high_resolution_clock::now();
+        m_mesh_load_time = std::chrono::duration<float, std::milli>(end - start).count();
+
+        m_mesh_roughness = std::unique_ptr<dw::Texture2D>(dw::Texture2D::create_from_files("texture/checker.png", false, true));
+
+        m_scene.initialize(m_mesh);
+        build_scene();
+
+        return true;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    // Maps the baked asset of 'path' from the disk cache and checks that it is still up to date with the source. Touches
+    // no GL state, so it can run on a worker thread.
+    bool open_mesh_asset(const std::string& path, MeshAsset& asset)
+    {
+        std::string cache_path   = disk_cache::path("mesh_" + disk_cache::to_hex(disk_cache::hash(path)) + ".mesh");
+        uint64_t    source_size  = 0;
+        int64_t     source_mtime = 0;
+        bool        has_source   = mesh_source_stamp(path, &source_size, &source_mtime);
+        std::string error;
+
+        if (!asset.open(cache_path, false, &error))
+            return false;
+
+        const MeshAssetHeader& header = asset.header();
+
+        // Without a source the baked asset is used as is, so it can ship on its own.
+        if (header.vertex_stride == sizeof(dw::Vertex) && (!has_source || (header.source_size == source_size && header.source_mtime == source_mtime)))
+            return true;
+
+        DW_LOG_INFO("Baked mesh is stale, re-importing " + path);
+        asset.close();
+
+        return false;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    // Loads a mesh from its baked asset in the disk cache. The asset is baked from the source the first time and again
+    // whenever the source file changes, later runs map it and upload the vertex and index data without parsing.
+    dw::Mesh* load_mesh_cached(const std::string& path, bool* from_cache)
+    {
+        MeshAsset asset;
+        bool      valid = open_mesh_asset(path, asset);
+
+        return load_mesh_cached(path, valid ? &asset : nullptr, from_cache);
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    // Uploads 'asset', which has to be opened by open_mesh_asset(), or imports and bakes the source if it is nullptr.
+    dw::Mesh* load_mesh_cached(const std::string& path, const MeshAsset* asset, bool* from_cache)
+    {
+        *from_cache = false;
+
+        if (asset)
+        {
+            const MeshAssetHeader&   header = asset->header();
+            std::vector<dw::SubMesh> submeshes(header.submesh_count);
+
+            for (uint32_t i = 0; i < header.submesh_count; i++)
+            {
+                const MeshAssetSubMesh& src = asset->submeshes()[i];
+
+                submeshes[i].mat         = nullptr;
+                submeshes[i].index_count = src.index_count;
+                submeshes[i].base_vertex = src.base_vertex;
+                submeshes[i].base_index  = src.base_index;
+                submeshes[i].min_extents = glm::vec3(src.min_extents[0], src.min_extents[1], src.min_extents[2]);
+                submeshes[i].max_extents = glm::vec3(src.max_extents[0], src.max_extents[1], src.max_extents[2]);
+            }
+
+            glm::vec3 min_extents = glm::vec3(header.min_extents[0], header.min_extents[1], header.min_extents[2]);
+            glm::vec3 max_extents = glm::vec3(header.max_extents[0], header.max_extents[1], header.max_extents[2]);
+
+            // The vertex and index pointers go straight from the mapping into the buffer upload.
+            dw::Mesh* mesh = dw::Mesh::load(path, header.vertex_count, (dw::Vertex*)asset->vertices(), header.index_count, (uint32_t*)asset->indices(), header.submesh_count, submeshes.data(), max_extents, min_extents);
+
+            if (mesh)
+            {
+                *from_cache = true;
+                return mesh;
+            }
+        }
+
+        std::string cache_path   = disk_cache::path("mesh_" + disk_cache::to_hex(disk_cache::hash(path)) + ".mesh");
+        uint64_t    source_size  = 0;
+        int64_t     source_mtime = 0;
+        bool        has_source   = mesh_source_stamp(path, &source_size, &source_mtime);
+        std::string error;
+
+        dw::Mesh* mesh = dw::Mesh::load(path);
+
+        if (!mesh || !has_source)
+            return mesh;
+
+        // The imported mesh is only used to get at its data, the optimised copy replaces it.
+        std::vector<dw::Vertex>  vertices(mesh->vertices(), mesh->vertices() + mesh->vertex_count());
+        std::vector<uint32_t>    indices(mesh->indices(), mesh->indices() + mesh->index_count());
+        std::vector<dw::SubMesh> submeshes(mesh->sub_meshes(), mesh->sub_meshes() + mesh->sub_mesh_count());
+        glm::vec3                min_extents = mesh->min_extents();
+        glm::vec3                max_extents = mesh->max_extents();
+
+        dw::Mesh::unload(mesh);
+
+        for (auto& submesh : submeshes)
+            submesh.mat = nullptr;
+
+        optimize_mesh(vertices, indices, submeshes);
+
+        std::vector<MeshAssetSubMesh> asset_submeshes(submeshes.size());
+
+        for (uint32_t i = 0; i < submeshes.size(); i++)
+        {
+            const dw::SubMesh& src = submeshes[i];
+
+            asset_submeshes[i]             = MeshAssetSubMesh();
+            asset_submeshes[i].index_count = src.index_count;
+            asset_submeshes[i].base_vertex = src.base_vertex;
+            asset_submeshes[i].base_index  = src.base_index;
+
+            for (int j = 0; j < 3; j++)
+            {
+                asset_submeshes[i].min_extents[j] = src.min_extents[j];
+                asset_submeshes[i].max_extents[j] = src.max_extents[j];
+            }
+        }
+
+        if (!write_mesh_asset(cache_path, source_size, source_mtime, vertices.data(), sizeof(dw::Vertex), (uint32_t)vertices.size(), indices.data(), (uint32_t)indices.size(), asset_submeshes.data(), (uint32_t)asset_submeshes.size(), &min_extents[0], &max_extents[0], &error))
+            DW_LOG_WARNING("Failed to bake mesh: " + error);
+
+        return dw::Mesh::load(path, (int)vertices.size(), vertices.data(), (int)indices.size(), indices.data(), (int)submeshes.size(), submeshes.data(), max_extents, min_extents);
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    // Reorders the triangles of every submesh for the vertex cache and overdraw, then stores the vertices in the order
+    // they are first used. Vertex reordering is skipped if submeshes share vertices.
+    void optimize_mesh(std::vector<dw::Vertex>& vertices, std::vector<uint32_t>& indices, std::vector<dw::SubMesh>& submeshes)
+    {
+        std::vector<uint32_t> vertex_counts(submeshes.size(), 0);
+        float                 acmr_before = 0.0f;
+        float                 acmr_after  = 0.0f;
+
+        for (uint32_t i = 0; i < submeshes.size(); i++)
+        {
+            dw::SubMesh& submesh = submeshes[i];
+            uint32_t*    local   = &indices[submesh.base_index];
+
+            for (uint32_t j = 0; j < submesh.index_count; j++)
+                vertex_counts[i] = std::max(vertex_counts[i], local[j] + 1);
+
+            float weight = float(submesh.index_count) / float(indices.size());
+            acmr_before += average_cache_miss_ratio(local, submesh.index_count, vertex_counts[i]) * weight;
+
+            optimize_vertex_cache(local, local, submesh.index_count, vertex_counts[i]);
+            optimize_overdraw(local, local, submesh.index_count, &vertices[submesh.base_vertex].position[0], sizeof(dw::Vertex), vertex_counts[i], MESH_OVERDRAW_THRESHOLD);
+
+            acmr_after += average_cache_miss_ratio(local, submesh.index_count, vertex_counts[i]) * weight;
+        }
+
+        DW_LOG_INFO("Optimized mesh: ACMR " + std::to_string(acmr_before) + " -> " + std::to_string(acmr_after));
+
+        std::vector<uint32_t> order(submeshes.size());
+
+        for (uint32_t i = 0; i < submeshes.size(); i++)
+            order[i] = i;
+
+        std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return submeshes[a].base_vertex < submeshes[b].base_vertex; });
+
+        for (uint32_t i = 1; i < order.size(); i++)
+        {
+            if (submeshes[order[i - 1]].base_vertex + vertex_counts[order[i - 1]] > submeshes[order[i]].base_vertex)
+                return;
+        }
+
+        std::vector<dw::Vertex> reordered;
+        std::vector<uint32_t>   remap;
+
+        reordered.reserve(vertices.size());
+
+        for (uint32_t i : order)
+        {
+            dw::SubMesh& submesh = submeshes[i];
+            uint32_t*    local   = &indices[submesh.base_index];
+
+            remap.resize(vertex_counts[i]);
+            optimize_vertex_fetch_remap(remap.data(), local, submesh.index_count, vertex_counts[i]);
+
+            uint32_t base = (uint32_t)reordered.size();
+            size_t   used = 0;
+
+            for (uint32_t v = 0; v < vertex_counts[i]; v++)
+            {
+                if (remap[v] != ~0u)
+                    used++;
+            }
+
+            reordered.resize(base + used);
+
+            for (uint32_t v = 0; v < vertex_counts[i]; v++)
+            {
+                if (remap[v] != ~0u)
+                    reordered[base + remap[v]] = vertices[submesh.base_vertex + v];
+            }
+
+            for (uint32_t j = 0; j < submesh.index_count; j++)
+                local[j] = remap[local[j]];
+
+            submesh.base_vertex = base;
+        }
+
+        vertices.swap(reordered);
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    // Times loading 'path' from the source and from the baked asset, both including the GPU upload. Runs before the
+    // scene mesh is loaded since the framework keeps one instance per path.
+    void benchmark_mesh_load(const std::string& path)
+    {
+        bool      from_cache = false;
+        dw::Mesh* mesh       = load_mesh_cached(path, &from_cache);
+
+        if (!mesh)
+            return;
+
+        dw::Mesh::unload(mesh);
+
+        float source_time = FLT_MAX;
+        float cached_time = FLT_MAX;
+
+        for (int i = 0; i < MESH_BENCHMARK_ITERATIONS; i++)
+        {
+            auto start = std::chrono::high_resolution_clock::now();
+            mesh       = dw::Mesh::load(path);
+            glFinish();
+            auto end   = std::chrono::high_resolution_clock::now();
+
+            source_time = std::min(source_time, std::chrono::duration<float, std::milli>(end - start).count());
+            dw::Mesh::unload(mesh);
+
+            start = std::chrono::high_resolution_clock::now();
+            mesh  = load_mesh_cached(path, &from_cache);
+            glFinish();
+            end   = std::chrono::high_resolution_clock::now();
+
+            cached_time = std::min(cached_time, std::chrono::duration<float, std::milli>(end - start).count());
+            dw::Mesh::unload(mesh);
+        }
+
+        m_mesh_benchmark_source = source_time;
+        m_mesh_benchmark_cached = cached_time;
+
+        DW_LOG_INFO("Mesh load benchmark (" + path + "): source " + std::to_string(source_time) + " ms, baked " + std::to_string(cached_time) + " ms");
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    // A single object reproduces the original teapot. Larger scenes are a square grid sweeping roughness along X and
+    // metallic along Z.
+    void build_scene()
+    {
+        std::vector<SceneInstance> instances(m_scene_object_count);
+
+        int32_t   side    = int32_t(ceilf(sqrtf(float(m_scene_object_count))));
+        glm::vec3 extents = m_mesh->max_extents() - m_mesh->min_extents();
+        float     spacing = std::max(extents.x, extents.z) * 0.5f * 1.25f;
+        float     offset  = float(side - 1) * spacing * 0.5f;
+
+        for (int32_t i = 0; i < m_scene_object_count; i++)
+        {
+            int32_t   x        = i % side;
+            int32_t   z        = i / side;
+            float     t_x      = side > 1 ? float(x) / float(side - 1) : 0.0f;
+            float     t_z      = side > 1 ? float(z) / float(side - 1) : 0.0f;
+            glm::vec3 position = glm::vec3(float(x) * spacing - offset, 0.0f, float(z) * spacing - offset);
+
+            instances[i].model    = glm::scale(glm::translate(glm::mat4(1.0f), position), glm::vec3(0.5f));
+            instances[i].albedo   = glm::vec4(1.0f);
+            instances[i].material = m_scene_object_count == 1 ? glm::vec4(-1.0f, 1.0f, 0.0f, 0.0f) : glm::vec4(t_x, t_z, 0.0f, 0.0f);
+        }
+
+        m_scene.set_instances(instances);
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void create_camera()
+    {
+        m_main_camera  = std::make_unique<dw::Camera>(60.0f, 0.1f, CAMERA_FAR_PLANE, float(m_width) / float(m_height), glm::vec3(0.0f, 5.0f, 150.0f), glm::vec3(0.0f, 0.0, -1.0f));
+        m_debug_camera = std::make_unique<dw::Camera>(60.0f, 0.1f, CAMERA_FAR_PLANE * 2.0f, float(m_width) / float(m_height), glm::vec3(0.0f, 5.0f, 150.0f), glm::vec3(0.0f, 0.0, -1.0f));
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    // Declares the passes of this frame with the resources they touch. Which of them run, the barriers between them and
+    // the memory behind the transients are left to the frame graph.
+    void build_frame_graph()
+    {
+        dw::Texture2D* octahedral = octahedral_probe();
+
+        uint32_t env_cubemap          = m_frame_graph.import(m_env_cubemap.get(), "Environment Cubemap");
+        uint32_t downsample_tiles     = m_frame_graph.import(m_downsample_tiles.get(), "Downsample Tiles");
+        uint32_t sh_partials          = m_frame_graph.import(m_sh_partials.get(), "SH Partial Sums");
+        uint32_t brdf_lut             = m_frame_graph.import(m_brdf_lut.get(), "BRDF LUT");
+        uint32_t sh                   = m_frame_graph.import(m_sh.get(), "SH Coefficients");
+        uint32_t prefiltered          = m_frame_graph.import(octahedral ? (dw::Texture*)octahedral : m_prefilter_cubemap.get(), "Prefiltered Map");
+        uint32_t shading_coefficients = m_frame_graph.import(shading_sh(), "Shading SH Coefficients");
+        uint32_t shading_prefiltered  = m_frame_graph.import(octahedral ? (dw::Texture*)octahedral : shading_prefilter_cubemap(), "Shading Prefiltered Map");
+
+        if (!m_use_imported_env)
+        {
+            if (m_sky_view_lut)
+            {
+                uint32_t sky_view = m_frame_graph.import(m_model.m_sky_view_t.get(), "Sky-View LUT");
+
+                if (m_model.sky_view_key(m_main_camera->m_position) != m_model.m_sky_view_key)
+                    m_frame_graph.add_pass("Sky-View LUT", {}, { { sky_view, FRAME_ACCESS_IMAGE } }, [this]() { compute_sky_view(); });
+
+                m_frame_graph.add_pass("Capture Environment", { { sky_view, FRAME_ACCESS_SAMPLED } }, { { env_cubemap, FRAME_ACCESS_RENDER_TARGET } }, [this]() { render_envmap(); });
+            }
+            else
+                m_frame_graph.add_pass("Capture Environment", {}, { { env_cubemap, FRAME_ACCESS_RENDER_TARGET } }, [this]() { render_envmap(); });
+
+            m_frame_graph.add_pass("Environment Mipmaps",
+                                   { { env_cubemap, FRAME_ACCESS_SAMPLED }, { downsample_tiles, FRAME_ACCESS_STORAGE } },
+                                   { { env_cubemap, FRAME_ACCESS_IMAGE }, { downsample_tiles, FRAME_ACCESS_STORAGE }, { sh_partials, FRAME_ACCESS_STORAGE } },
+                                   [this]() { generate_env_mipmaps(); });
+        }
+
+        if (!m_use_baked_ibl)
+        {
+            // The capture refreshes the partial sums whenever the downsampler emits them. Imported environments keep the
+            // ones left by their conversion.
+            bool partials = m_use_imported_env ? m_sh_partials_valid : (m_compute_downsample && m_downsample_sh);
+
+            if (direct_sky_sh())
+                m_frame_graph.add_pass("Sky SH", {}, { { sh, FRAME_ACCESS_IMAGE } }, [this]() { compute_sky_sh(); });
+            else if (partials)
+            {
+                m_frame_graph.add_pass("Reduce SH Partials", { { sh_partials, FRAME_ACCESS_STORAGE } }, { { sh, FRAME_ACCESS_IMAGE } }, [this]() {
+                    if (m_sh_partials_valid)
+                        reduce_sh_partials();
+                });
+            }
+            else
+            {
+                uint32_t intermediate = m_frame_graph.create_texture("SH Intermediate", sh_intermediate_desc());
+
+                m_frame_graph.add_pass("Project SH", { { env_cubemap, FRAME_ACCESS_SAMPLED } }, { { intermediate, FRAME_ACCESS_IMAGE } }, [this, intermediate]() {
+                    project_spherical_harmonics(m_workgroups, m_frame_graph.texture(intermediate));
+                });
+
+                m_frame_graph.add_pass("Sum SH", { { intermediate, FRAME_ACCESS_SAMPLED } }, { { sh, FRAME_ACCESS_IMAGE } }, [this, intermediate]() {
+                    sum_spherical_harmonics(m_workgroups, m_frame_graph.texture(intermediate));
+                });
+            }
+
+            if (!m_progressive_prefilter)
+            {
+                m_frame_graph.add_pass("Prefilter", { { env_cubemap, FRAME_ACCESS_SAMPLED } }, { { prefiltered, FRAME_ACCESS_IMAGE } }, [this, octahedral]() {
+                    prefilter_cubemap(m_workgroups, m_fast_prefilter, nullptr, octahedral);
+                });
+            }
+            else if (progressive_prefilter_pending())
+            {
+                // Blends into the previous result.
+                m_frame_graph.add_pass("Progressive Prefilter",
+                                       { { env_cubemap, FRAME_ACCESS_SAMPLED }, { prefiltered, FRAME_ACCESS_IMAGE } },
+                                       { { prefiltered, FRAME_ACCESS_IMAGE } },
+                                       [this]() { prefilter_progressive(); });
+            }
+        }
+
+        m_frame_graph.add_pass("Meshes",
+                               { { brdf_lut, FRAME_ACCESS_SAMPLED }, { shading_coefficients, FRAME_ACCESS_SAMPLED }, { shading_prefiltered, FRAME_ACCESS_SAMPLED } },
+                               {},
+                               [this]() { render_meshes(); },
+                               true);
+
+        // Only the texture the skybox displays keeps its producers alive.
+        uint32_t skybox_source = m_type == 0 ? env_cubemap : (m_type == 1 ? shading_coefficients : shading_prefiltered);
+
+        m_frame_graph.add_pass("Skybox", { { skybox_source, FRAME_ACCESS_SAMPLED } }, {}, [this]() { render_skybox(); }, true);
+
+        // Logs what this frame was shaded with. The copies are only queued here and land a few frames later.
+        if (m_lighting_log.is_open())
+        {
+            if (m_frame_index % uint64_t(m_lighting_log_interval) == 0)
+                m_frame_graph.add_pass("Log SH", { { shading_coefficients, FRAME_ACCESS_TRANSFER } }, {}, [this]() { log_sh(); }, true);
+
+            if (m_log_prefiltered && !octahedral)
+                m_frame_graph.add_pass("Log Prefiltered", { { shading_prefiltered, FRAME_ACCESS_TRANSFER } }, {}, [this]() { log_prefiltered(); }, true);
+
+            m_log_prefiltered = false;
+        }
+
+        if (ibl_pipelined())
+            m_frame_graph.add_pass("Swap IBL Sets", { { sh, FRAME_ACCESS_SAMPLED }, { prefiltered, FRAME_ACCESS_SAMPLED } }, {}, [this]() { swap_ibl_sets(); }, true);
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void render_meshes()
+    {
+        DW_SCOPED_SAMPLE("Render Meshes");
+
+        m_gl.enable(GL_DEPTH_TEST, true);
+        m_gl.enable(GL_CULL_FACE, false);
+
+        m_gl.bind_framebuffer(nullptr);
+        m_gl.viewport(0, 0, m_width, m_height);
+
+        m_gl.clear_color(glm::vec4(0.5f, 0.5f, 0.5f, 1.0f));
+        glClearDepth(1.0);
+        m_gl.clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        if (m_gpu_culling)
+            m_scene.cull(m_gl, m_cull_program.get(), m_main_camera->m_view_projection);
+
+        dw::Texture2D* octahedral = octahedral_probe();
+
+        // Bind shader program.
+        if (octahedral)
+            m_mesh_octahedral_program->use();
+        else
+            m_mesh_program->use();
+
+        push_camera_uniforms(m_main_camera->m_view, m_main_camera->m_projection);
+
+        const VertexQuantization& quantization = m_scene.quantization();
+        MeshUniforms              uniforms;
+
+        uniforms.position_offset    = glm::vec4(quantization.position_offset[0], quantization.position_offset[1], quantization.position_offset[2], 0.0f);
+        uniforms.position_scale     = glm::vec4(quantization.position_scale[0], quantization.position_scale[1], quantization.position_scale[2], 0.0f);
+        uniforms.texcoord_transform = glm::vec4(quantization.texcoord_offset[0], quantization.texcoord_offset[1], quantization.texcoord_scale[0], quantization.texcoord_scale[1]);
+
+        m_uniforms.push(UNIFORM_BINDING_OBJECT, uniforms);
+
+        // Texture units match the sampler bindings in mesh_fs.glsl.
+        m_gl.bind_texture(0, m_brdf_lut.get());
+        m_gl.bind_texture(1, shading_sh());
+        m_gl.bind_texture(2, octahedral ? (dw::Texture*)octahedral : shading_prefilter_cubemap());
+        m_gl.bind_texture(3, m_mesh_roughness.get());
+
+        // One multi-draw for the whole scene.
+        m_scene.draw(m_gl, m_gpu_culling);
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void push_camera_uniforms(const glm::mat4& view, const glm::mat4& projection)
+    {
+        CameraUniforms uniforms;
+
+        uniforms.view       = view;
+        uniforms.projection = projection;
+        uniforms.position   = glm::vec4(m_main_camera->m_position, 1.0f);
+
+        m_uniforms.push(UNIFORM_BINDING_CAMERA, uniforms);
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void render_envmap()
+    {
+        DW_SCOPED_SAMPLE("Render Envmap");
+
+        ShaderProgram* program = m_sky_view_lut ? m_sky_envmap_lut_program.get() : m_sky_envmap_program.get();
+
+        program->use();
+        m_uniforms.push(UNIFORM_BINDING_SKY, m_model.render_uniforms());
+        m_model.bind_textures(m_gl);
+
+        if (m_sky_view_lut)
+            m_gl.bind_texture(6, m_model.m_sky_view_t.get());
+
+        m_gl.enable(GL_DEPTH_TEST, false);
+
+        for (int i = 0; i < 6; i++)
+        {
+            push_camera_uniforms(m_capture_views[i], m_capture_projection);
+
+            m_gl.bind_framebuffer(m_cubemap_fbos[i].get());
+            m_gl.viewport(0, 0, ENVIRONMENT_MAP_SIZE, ENVIRONMENT_MAP_SIZE);
+
+            m_gl.clear_color(glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+            m_gl.clear(GL_COLOR_BUFFER_BIT);
+
+            m_gl.bind_vertex_array(m_cube_vao.get());
+
+            m_gl.draw_arrays(GL_TRIANGLES, 0, 36);
+        }
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    // Evaluates the atmosphere once per texel of a small latitude/longitude map around the sun, instead of once per
+    // texel of all six 512^2 capture faces. The capture then costs a single fetch per texel, and the map itself is only
+    // rebuilt when the atmosphere, the sun or the camera altitude change.
+    bool compute_sky_view()
+    {
+        DW_SCOPED_SAMPLE("Sky-View LUT");
+
+        if (!m_sky_view_program->link())
+            return false;
+
+        m_sky_view_program->use();
+
+        m_uniforms.push(UNIFORM_BINDING_SKY, m_model.render_uniforms());
+        push_camera_uniforms(m_main_camera->m_view, m_main_camera->m_projection);
+        m_model.bind_textures(m_gl);
+
+        m_model.m_sky_view_t->bind_image(0, 0, 0, GL_WRITE_ONLY, GL_RGBA16F);
+
+        m_gl.dispatch(workgroup_count(SKY_VIEW_LUT_WIDTH, 8), workgroup_count(SKY_VIEW_LUT_HEIGHT, 8), 1);
+
+        m_model.m_sky_view_key = m_model.sky_view_key(m_main_camera->m_position);
+        m_sky_view_rebuilds++;
+
+        return true;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void render_skybox()
+    {
+        DW_SCOPED_SAMPLE("Render Skybox");
+
+        m_gl.enable(GL_DEPTH_TEST, true);
+        m_gl.depth_func(GL_LEQUAL);
+        m_gl.enable(GL_CULL_FACE, false);
+
+        dw::Texture2D* octahedral = octahedral_probe();
+
+        if (octahedral)
+            m_sky_octahedral_program->use();
+        else
+            m_cubemap_program->use();
+
+        m_gl.bind_vertex_array(m_cube_vao.get());
+
+        m_gl.bind_framebuffer(nullptr);
+        m_gl.viewport(0, 0, m_width, m_height);
+
+        SkyboxUniforms uniforms = {};
+
+        uniforms.type      = m_type;
+        uniforms.roughness = m_roughness;
+
+        push_camera_uniforms(m_main_camera->m_view, m_main_camera->m_projection);
+        m_uniforms.push(UNIFORM_BINDING_OBJECT, uniforms);
+
+        // Texture units match the sampler bindings in sky_fs.glsl.
+        m_gl.bind_texture(0, m_env_cubemap.get());
+        m_gl.bind_texture(1, octahedral ? (dw::Texture*)octahedral : shading_prefilter_cubemap());
+        m_gl.bind_texture(2, shading_sh());
+
+        m_gl.draw_arrays(GL_TRIANGLES, 0, 36);
+
+        m_gl.depth_func(GL_LESS);
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    // Pipelined, the shading passes read the set baked in the previous frame and never wait on the current bake.
+    // Progressive prefiltering accumulates into a single cubemap and a baked probe is not rebuilt, so both of them shade
+    // from m_prefilter_cubemap and m_sh directly. The octahedral map has no second copy either.
+    bool ibl_pipelined() const
+    {
+        return m_pipelined_ibl && !m_use_baked_ibl && !m_progressive_prefilter && !m_octahedral_probe;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    // Octahedral map the prefilter writes and the shading passes read instead of the cubemap, or nullptr. Baked and
+    // imported probes are always cubemaps.
+    dw::Texture2D* octahedral_probe()
+    {
+        return m_octahedral_probe && !m_use_baked_ibl ? m_prefilter_octahedral.get() : nullptr;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    // Allocates the octahedral prefiltered map while it is enabled and frees it otherwise. Every mip is sampled at
+    // explicit integer levels with its own border, so no seamless or trilinear filtering is involved.
+    void create_octahedral_probe()
+    {
+        m_memory.destroy(m_prefilter_octahedral);
+
+        // Start over when switching, so that progressive prefiltering does not blend into an empty map.
+        m_progressive_inputs = 0;
+
+        if (!m_octahedral_probe)
+            return;
+
+        m_prefilter_octahedral = std::make_unique<dw::Texture2D>(OCTAHEDRAL_MAP_SIZE, OCTAHEDRAL_MAP_SIZE, 1, PREFILTER_MIP_LEVELS, 1, GL_RGBA16F, GL_RGBA, GL_HALF_FLOAT);
+
+        m_prefilter_octahedral->set_min_filter(GL_LINEAR_MIPMAP_NEAREST);
+        m_prefilter_octahedral->set_mag_filter(GL_LINEAR);
+        m_prefilter_octahedral->set_wrapping(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
+
+        m_memory.track(m_prefilter_octahedral.get(), "Prefiltered Octahedral Map", GPU_MEMORY_IBL, octahedral_probe_size());
+
+        m_gl.invalidate();
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    size_t octahedral_probe_size() const
+    {
+        return gpu_texture_size(OCTAHEDRAL_MAP_SIZE, OCTAHEDRAL_MAP_SIZE, 1, PREFILTER_MIP_LEVELS, GL_RGBA16F);
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    dw::TextureCube* shading_prefilter_cubemap()
+    {
+        return ibl_pipelined() && m_ibl_history_valid ? m_shading_prefilter_cubemap.get() : m_prefilter_cubemap.get();
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    dw::Texture2D* shading_sh()
+    {
+        return ibl_pipelined() && m_ibl_history_valid ? m_shading_sh.get() : m_sh.get();
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    // Allocates the second IBL set while pipelining is enabled and frees it otherwise. Until the first swap the shading
+    // passes fall back to the set being baked.
+    void create_ibl_history()
+    {
+        m_ibl_history_valid = false;
+
+        m_memory.destroy(m_shading_prefilter_cubemap);
+        m_memory.destroy(m_shading_sh);
+
+        if (!m_pipelined_ibl)
+            return;
+
+        m_shading_prefilter_cubemap = std::make_unique<dw::TextureCube>(PREFILTER_MAP_SIZE, PREFILTER_MAP_SIZE, 1, PREFILTER_MIP_LEVELS, GL_RGBA16F, GL_RGBA, GL_HALF_FLOAT);
+        m_shading_sh                = std::make_unique<dw::Texture2D>(9, 1, 1, 1, 1, GL_RGBA32F, GL_RGBA, GL_FLOAT);
+
+        // The two sets swap every frame, so these names follow the allocation rather than its current role.
+        m_memory.track(m_shading_prefilter_cubemap.get(), "Prefiltered Cubemap (History)", GPU_MEMORY_IBL, gpu_texture_size(PREFILTER_MAP_SIZE, PREFILTER_MAP_SIZE, 6, PREFILTER_MIP_LEVELS, GL_RGBA16F));
+        m_memory.track(m_shading_sh.get(), "SH Coefficients (History)", GPU_MEMORY_IBL, gpu_texture_size(9, 1, 1, 1, GL_RGBA32F));
+
+        m_shading_sh->set_min_filter(GL_NEAREST);
+        m_shading_sh->set_mag_filter(GL_NEAREST);
+
+        m_gl.invalidate();
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    // Memory taken by the second IBL set: the RGBA16F prefiltered mip chain and the nine RGBA32F SH coefficients.
+    size_t ibl_set_size() const
+    {
+        return gpu_texture_size(PREFILTER_MAP_SIZE, PREFILTER_MAP_SIZE, 6, PREFILTER_MIP_LEVELS, GL_RGBA16F) + gpu_texture_size(9, 1, 1, 1, GL_RGBA32F);
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    // Hands the set baked this frame to the next frame's shading passes and bakes into the other one. GL runs commands in
+    // submission order, so the next bake cannot overwrite the set before this frame's draws have read it. The frame graph
+    // pass running this declares texture reads of the baked set, so the barrier making its image stores visible to the
+    // next frame's draws is issued after this frame's draws and they do not wait on it.
+    void swap_ibl_sets()
+    {
+        std::swap(m_prefilter_cubemap, m_shading_prefilter_cubemap);
+        std::swap(m_sh, m_shading_sh);
+
+        m_ibl_history_valid = true;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    // The compute path resamples the equirectangular map into mip 0 and, if enabled, projects its texels onto SH9 in the
+    // same dispatch. Only the mip chain is left to build, and the next SH update reduces the partial sums instead of
+    // projecting the cubemap.
+    void convert_env_map()
+    {
+        DW_SCOPED_SAMPLE("Convert Env Map");
+
+        ShaderProgram* program = m_compute_equirect ? equirect_program() : nullptr;
+
+        if (program && program->link())
+        {
+            program->use();
+
+            m_gl.bind_texture(0, m_env_map.get());
+            m_env_cubemap->bind_image(0, 0, 0, GL_WRITE_ONLY, GL_RGBA16F);
+            m_sh_partials->bind_base(1);
+
+            m_gl.dispatch(DOWNSAMPLE_TILE_COUNT, DOWNSAMPLE_TILE_COUNT, 6);
+
+            // The conversion runs outside the frame graph. The downsampler reads mip 0 through a sampler.
+            m_gl.memory_barrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+            m_sh_partials_valid = m_equirect_sh;
+
+            generate_env_mipmaps(!m_equirect_sh);
+            return;
+        }
+
+        m_cubemap_convert_program->use();
+        m_gl.bind_vertex_array(m_cube_vao.get());
+        m_gl.enable(GL_DEPTH_TEST, false);
+
+        for (int i = 0; i < 6; i++)
+        {
+            m_gl.bind_framebuffer(m_cubemap_fbos[i].get());
+
+            m_gl.viewport(0, 0, ENVIRONMENT_MAP_SIZE, ENVIRONMENT_MAP_SIZE);
+            m_gl.clear(GL_COLOR_BUFFER_BIT);
+
+            push_camera_uniforms(m_capture_views[i], m_capture_projection);
+            m_gl.bind_texture(0, m_env_map.get());
+
+            m_gl.draw_arrays(GL_TRIANGLES, 0, 36);
+        }
+
+        generate_env_mipmaps();
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    // Queues the whole conversion of the HDR on the background baker. The render thread keeps shading with the current
+    // probe until the result is published, so the frame time does not spike for the duration of the bake.
+    void bake_in_background()
+    {
+        if (!m_probe_baker.initialized())
+        {
+            ProbeBakeLayout layout;
+
+            layout.environment_size     = ENVIRONMENT_MAP_SIZE;
+            layout.environment_mips     = ENVIRONMENT_MAP_MIP_LEVELS;
+            layout.irradiance_size      = IRRADIANCE_CUBEMAP_SIZE;
+            layout.sh_intermediate_size = SH_INTERMEDIATE_MAX_SIZE;
+            layout.prefilter_size       = PREFILTER_MAP_SIZE;
+            layout.prefilter_mips       = PREFILTER_MIP_LEVELS;
+            layout.tile_size            = DOWNSAMPLE_TILE_SIZE;
+            layout.max_samples          = MAX_PREFILTER_SAMPLES;
+
+            if (!m_probe_baker.initialize(layout))
+            {
+                DW_LOG_ERROR("Background baking is not available, falling back to a synchronous conversion");
+                convert_env_map();
+                return;
+            }
+
+            m_memory.track(&m_probe_baker, "Background Bake Scratch", GPU_MEMORY_IBL, m_probe_baker.scratch_size());
+        }
+
+        ProbeBakeSettings settings;
+
+        settings.workgroups   = m_workgroups;
+        settings.sample_count = m_sample_count;
+
+        m_probe_baker.submit(m_env_map.get(), settings, [this](ProbeBakeResult& result) { publish_probe(result); });
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    // Keeps a finished bake until the user applies it, since applying it replaces the live sky. Runs once its fence has
+    // signalled, so the textures are complete and nothing on this context has to wait for them.
+    void publish_probe(ProbeBakeResult& result)
+    {
+        discard_background_probe();
+
+        m_background_probe     = std::move(result);
+        m_background_bake_time = m_background_probe.time;
+
+        m_memory.track(m_background_probe.env_cubemap.get(), "Background Bake Environment", GPU_MEMORY_IBL, gpu_texture_size(ENVIRONMENT_MAP_SIZE, ENVIRONMENT_MAP_SIZE, 6, ENVIRONMENT_MAP_MIP_LEVELS, GL_RGBA16F));
+        m_memory.track(m_background_probe.prefiltered.get(), "Background Bake Prefiltered", GPU_MEMORY_IBL, gpu_texture_size(PREFILTER_MAP_SIZE, PREFILTER_MAP_SIZE, 6, PREFILTER_MIP_LEVELS, GL_RGBA16F));
+        m_memory.track(m_background_probe.sh.get(), "Background Bake SH", GPU_MEMORY_IBL, gpu_texture_size(9, 1, 1, 1, GL_RGBA32F));
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void discard_background_probe()
+    {
+        m_memory.destroy(m_background_probe.env_cubemap);
+        m_memory.destroy(m_background_probe.prefiltered);
+        m_memory.destroy(m_background_probe.sh);
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    // Swaps the kept bake in for the probe textures. The per-frame IBL passes are skipped from then on, which the UI
+    // reports until the live sky is resumed.
+    void apply_background_probe()
+    {
+        m_cubemap_fbos.clear();
+
+        m_memory.destroy(m_env_cubemap);
+        m_memory.destroy(m_prefilter_cubemap);
+        m_memory.destroy(m_sh);
+
+        m_memory.release(m_background_probe.env_cubemap.get());
+        m_memory.release(m_background_probe.prefiltered.get());
+        m_memory.release(m_background_probe.sh.get());
+
+        m_env_cubemap       = std::move(m_background_probe.env_cubemap);
+        m_prefilter_cubemap = std::move(m_background_probe.prefiltered);
+        m_sh                = std::move(m_background_probe.sh);
+
+        m_memory.track(m_env_cubemap.get(), "Environment Cubemap", GPU_MEMORY_IBL, gpu_texture_size(ENVIRONMENT_MAP_SIZE, ENVIRONMENT_MAP_SIZE, 6, ENVIRONMENT_MAP_MIP_LEVELS, GL_RGBA16F));
+        m_memory.track(m_prefilter_cubemap.get(), "Prefiltered Cubemap", GPU_MEMORY_IBL, gpu_texture_size(PREFILTER_MAP_SIZE, PREFILTER_MAP_SIZE, 6, PREFILTER_MIP_LEVELS, GL_RGBA16F));
+        m_memory.track(m_sh.get(), "SH Coefficients", GPU_MEMORY_IBL, gpu_texture_size(9, 1, 1, 1, GL_RGBA32F));
+
+        create_cubemap_fbos();
+
+        m_sh_partials_valid      = false;
+        m_use_imported_env       = true;
+        m_use_baked_ibl          = true;
+        m_imported_env_loaded    = true;
+        m_baked_ibl_loaded       = true;
+        m_background_bake_active = true;
+        m_env_version++;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    // Builds the environment mip chain. The compute path writes every level in one dispatch and, if enabled, the SH
+    // partial sums of mip 2 along with it. Without 'emit_sh' the partial sums already in place are kept.
+    void generate_env_mipmaps(bool emit_sh = true)
+    {
+        DW_SCOPED_SAMPLE("Generate Env Mipmaps");
+
+        if (emit_sh)
+            m_sh_partials_valid = false;
+
+        ShaderProgram* program = m_compute_downsample ? downsample_program(emit_sh) : nullptr;
+
+        if (!program || !program->link())
+        {
+            m_env_cubemap->generate_mipmaps();
+            m_gl.invalidate();
+            return;
+        }
+
+        program->use();
+
+        if (program->set_uniform("s_EnvMap", 1))
+            m_gl.bind_texture(1, m_env_cubemap.get());
+
+        for (int mip = 1; mip < ENVIRONMENT_MAP_MIP_LEVELS; mip++)
+            m_env_cubemap->bind_image(mip - 1, mip, 0, GL_WRITE_ONLY, GL_RGBA16F);
+
+        m_downsample_tiles->bind_base(0);
+        m_sh_partials->bind_base(1);
+
+        m_gl.dispatch(DOWNSAMPLE_TILE_COUNT, DOWNSAMPLE_TILE_COUNT, 6);
+
+        if (emit_sh)
+            m_sh_partials_valid = m_downsample_sh && !direct_sky_sh();
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    // The diffuse term only needs SH9, which is smooth enough to be projected from a few hundred sky directions evaluated
+    // straight from the atmosphere tables. That skips the 512^2 capture, its mip chain and the cubemap projection, so
+    // irradiance follows the sun at a fraction of the cost. Imported environments still go through the cubemap.
+    bool direct_sky_sh() const
+    {
+        return m_direct_sky_sh && !m_use_imported_env;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    bool compute_sky_sh()
+    {
+        DW_SCOPED_SAMPLE("Sky SH");
+
+        if (!m_sky_sh_program->link())
+            return false;
+
+        m_sky_sh_program->use();
+
+        m_uniforms.push(UNIFORM_BINDING_SKY, m_model.render_uniforms());
+        push_camera_uniforms(m_main_camera->m_view, m_main_camera->m_projection);
+        m_model.bind_textures(m_gl);
+
+        m_sh->bind_image(0, 0, 0, GL_WRITE_ONLY, GL_RGBA32F);
+
+        m_gl.dispatch(1, 1, 1);
+
+        return true;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    // Reduces the partial sums left behind by the downsampler or the equirectangular conversion.
+    bool reduce_sh_partials()
+    {
+        DW_SCOPED_SAMPLE("Reduce SH Partials");
+
+        ShaderProgram* add_program = sh_add_partials_program();
+
+        if (!add_program->link())
+            return false;
+
+        add_program->use();
+
+        m_sh->bind_image(0, 0, 0, GL_WRITE_ONLY, GL_RGBA32F);
+        m_sh_partials->bind_base(1);
+
+        m_gl.dispatch(9, 1, 1);
+
+        return true;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    // Projects the environment cubemap onto SH9 per tile into 'intermediate'.
+    bool project_spherical_harmonics(const WorkgroupConfig& config, dw::Texture2D* intermediate)
+    {
+        DW_SCOPED_SAMPLE("Project SH");
+
+        ShaderProgram* projection_program = sh_projection_program(config);
+
+        if (!projection_program->link())
+            return false;
+
+        projection_program->use();
+
+        projection_program->set_uniform("u_Width", (float)m_env_cubemap->width() / 4.0f);
+        projection_program->set_uniform("u_Height", (float)m_env_cubemap->height() / 4.0f);
+
+        if (projection_program->set_uniform("s_Cubemap", 1))
+            m_gl.bind_texture(1, m_env_cubemap.get());
+
+        intermediate->bind_image(0, 0, 0, GL_WRITE_ONLY, GL_RGBA32F);
+
+        m_gl.dispatch(IRRADIANCE_CUBEMAP_SIZE / config.sh_projection.x, IRRADIANCE_CUBEMAP_SIZE / config.sh_projection.y, 6 / config.sh_projection.z);
+
+        return true;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    // Sums the per tile coefficients in 'intermediate' into m_sh.
+    bool sum_spherical_harmonics(const WorkgroupConfig& config, dw::Texture2D* intermediate)
+    {
+        DW_SCOPED_SAMPLE("Sum SH");
+
+        ShaderProgram* add_program = sh_add_program(config);
+
+        if (!add_program->link())
+            return false;
+
+        add_program->use();
+
+        m_sh->bind_image(0, 0, 0, GL_WRITE_ONLY, GL_RGBA32F);
+
+        if (add_program->set_uniform("s_SHIntermediate", 1))
+            m_gl.bind_texture(1, intermediate);
+
+        m_gl.dispatch(9, 1, 1);
+
+        return true;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    // Both SH passes outside the frame graph, for tuning.
+    bool compute_spherical_harmonics(const WorkgroupConfig& config, dw::Texture2D* intermediate)
+    {
+        if (!project_spherical_harmonics(config, intermediate))
+            return false;
+
+        m_gl.memory_barrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+        return sum_spherical_harmonics(config, intermediate);
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    FrameTextureDesc sh_intermediate_desc() const
+    {
+        FrameTextureDesc desc;
+
+        desc.width           = SH_INTERMEDIATE_MAX_SIZE * 9;
+        desc.height          = SH_INTERMEDIATE_MAX_SIZE;
+        desc.layers          = 6;
+        desc.internal_format = GL_RGBA32F;
+        desc.format          = GL_RGBA;
+        desc.type            = GL_FLOAT;
+        desc.filter          = GL_NEAREST;
+
+        return desc;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    // 'fast_mips' selects the mips built by the fast filter instead of GGX importance sampling. It is ignored for the
+    // batched mips, which are the roughest and the ones the fast filter approximates worst. With a 'subset' only that
+    // part of the sample set is evaluated and added to the sums accumulated in the existing contents. With an
+    // 'octahedral' map the mips are written there instead of the cubemap, all of them with GGX sampling.
+    bool prefilter_cubemap(const WorkgroupConfig& config, const bool* fast_mips, const PrefilterSubset* subset = nullptr, dw::Texture2D* octahedral = nullptr)
+    {
+        DW_SCOPED_SAMPLE("Prefilter");
+
+        int32_t start_level = (ENVIRONMENT_MAP_SIZE / PREFILTER_MAP_SIZE) - 1;
+        int     batch_start = PREFILTER_MIP_LEVELS - config.prefilter_batch;
+
+        // The smallest mips barely fill the GPU on their own, so the last 'prefilter_batch' of them share one dispatch.
+        for (int mip = 0; mip <= batch_start; mip++)
+        {
+            if (mip < batch_start && fast_mips[mip] && !octahedral)
+            {
+                if (!prefilter_mip_fast(config, mip))
+                    return false;
+
+                continue;
+            }
+
+            int            batch   = mip == batch_start ? config.prefilter_batch : 1;
+            ShaderProgram* program = prefilter_program(config, mip, batch, subset != nullptr, octahedral != nullptr);
+
+            if (!program->link())
+                return false;
+
+            program->use();
+
+            if (program->set_uniform("s_EnvMap", 1))
+                m_gl.bind_texture(1, m_env_cubemap.get());
+
+            for (int i = 0; i < batch; i++)
+            {
+                m_sample_directions[mip + i]->bind_base(i);
+
+                if (octahedral)
+                    octahedral->bind_image(i, mip + i, 0, subset ? GL_READ_WRITE : GL_WRITE_ONLY, GL_RGBA16F);
+                else
+                    m_prefilter_cubemap->bind_image(i, mip + i, 0, subset ? GL_READ_WRITE : GL_WRITE_ONLY, GL_RGBA16F);
+            }
+
+            if (subset)
+            {
+                program->set_uniform("u_SubsetOffset", subset->offset);
+                program->set_uniform("u_SubsetStride", subset->stride);
+                program->set_uniform("u_SubsetSize", subset->count);
+                program->set_uniform("u_SubsetRotation", subset->rotation);
+                program->set_uniform("u_Accumulate", subset->accumulate ? 1 : 0);
+            }
+
+            uint32_t mip_size = (octahedral ? OCTAHEDRAL_MAP_SIZE : PREFILTER_MAP_SIZE) >> mip;
+
+            // Specialised variants have the roughness and sample count compiled in and ignore these.
+            float roughness = (float)mip / (float)(PREFILTER_MIP_LEVELS - 1);
+            program->set_uniform("u_StartMipLevel", start_level);
+            program->set_uniform("u_Roughness", roughness);
+            program->set_uniform("u_RoughnessStep", 1.0f / (float)(PREFILTER_MIP_LEVELS - 1));
+            program->set_uniform("u_SampleCount", m_sample_count);
+            program->set_uniform("u_Width", float(mip_size));
+
+            if (octahedral)
+                m_gl.dispatch(workgroup_count(mip_size, config.prefilter.x), workgroup_count(mip_size, config.prefilter.y), batch);
+            else
+                m_gl.dispatch(workgroup_count(mip_size, config.prefilter.x), workgroup_count(mip_size, config.prefilter.y), 6 * batch / config.prefilter.z);
+        }
+
+        return true;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    // Evaluates a few samples per texel each frame and accumulates their weighted sum and total weight in the cubemap.
+    // The first pass walks the strided subsets of the unrotated set, so after progressive_subsets() frames every sample
+    // has been taken once and the result matches the full-sample one up to fp16 rounding. Later passes are randomly
+    // rotated and keep refining it, after which prefiltering stops until an input changes.
+    void prefilter_progressive()
+    {
+        if (!progressive_prefilter_pending())
+            return;
+
+        int32_t count   = std::min(m_progressive_samples, m_sample_count);
+        int32_t subsets = progressive_subsets();
+
+        std::uniform_real_distribution<float> angle(0.0f, 2.0f * float(M_PI));
+
+        PrefilterSubset subset;
+
+        subset.offset       = m_progressive_frame % subsets;
+        subset.stride       = subsets;
+        subset.count        = count;
+        subset.rotation     = m_progressive_frame < subsets ? 0.0f : angle(m_progressive_rng);
+        subset.accumulate   = m_progressive_frame > 0;
+
+        if (prefilter_cubemap(m_workgroups, m_fast_prefilter, &subset, octahedral_probe()))
+            m_progressive_frame++;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    // Restarts the accumulation if an input changed. Returns false once it has converged.
+    bool progressive_prefilter_pending()
+    {
+        uint64_t inputs = prefilter_inputs_hash();
+
+        if (inputs != m_progressive_inputs)
+        {
+            m_progressive_inputs = inputs;
+            m_progressive_frame  = 0;
+        }
+
+        return m_progressive_frame < progressive_subsets() * PROGRESSIVE_MAX_PASSES;
     }
 
     // -----------------------------------------------------------------------------------------------------------------------------------
 
-    bool load_mesh()
+    // Frames per pass over the sample set. Rounded up, so a samples per frame count that does not divide the sample count
+    // still reaches every sample, with the last subsets one short.
+    int32_t progressive_subsets() const
     {
-        m_mesh = dw::Mesh::load("mesh/teapot_smooth.obj");
+        int32_t count = std::min(m_progressive_samples, m_sample_count);
 
-        if (!m_mesh)
+        return (m_sample_count + count - 1) / count;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    // Everything the prefiltered cubemap depends on. A change restarts the progressive accumulation. The captured sky
+    // only changes with the camera's altitude, in the same steps as the sky-view LUT, and not at all for an imported
+    // environment, so that moving around does not keep the accumulation from converging.
+    uint64_t prefilter_inputs_hash()
+    {
+        uint64_t h = disk_cache::hash(&m_sample_count, sizeof(int));
+        h          = disk_cache::hash(&m_progressive_samples, sizeof(int), h);
+        h          = disk_cache::hash(m_fast_prefilter, sizeof(m_fast_prefilter), h);
+        h          = disk_cache::hash(&m_use_imported_env, sizeof(bool), h);
+        h          = disk_cache::hash(&m_env_version, sizeof(uint32_t), h);
+        h          = disk_cache::hash(&m_octahedral_probe, sizeof(bool), h);
+
+        if (!m_use_imported_env)
         {
-            DW_LOG_FATAL("Failed to load mesh!");
-            return false;
+            uint64_t sky = m_model.sky_view_key(m_main_camera->m_position);
+            h            = disk_cache::hash(&sky, sizeof(uint64_t), h);
         }
 
-        m_mesh_roughness = std::unique_ptr<dw::Texture2D>(dw::Texture2D::create_from_files("texture/checker.png", false, true));
+        return h;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    // Builds one mip from the mipmapped environment cubemap with a small GGX weighted kernel. The pyramid level is
+    // chosen so that the kernel footprint stays constant, which makes the cost independent of the roughness.
+    bool prefilter_mip_fast(const WorkgroupConfig& config, int mip)
+    {
+        ShaderProgram* program = prefilter_fast_program(config);
+
+        if (!program->link())
+            return false;
+
+        program->use();
+
+        if (program->set_uniform("s_EnvMap", 1))
+            m_gl.bind_texture(1, m_env_cubemap.get());
+
+        m_prefilter_cubemap->bind_image(0, mip, 0, GL_WRITE_ONLY, GL_RGBA16F);
+
+        uint32_t mip_size = PREFILTER_MAP_SIZE >> mip;
+
+        program->set_uniform("u_StartMipLevel", (ENVIRONMENT_MAP_SIZE / PREFILTER_MAP_SIZE) - 1);
+        program->set_uniform("u_Roughness", (float)mip / (float)(PREFILTER_MIP_LEVELS - 1));
+        program->set_uniform("u_Width", float(mip_size));
+        program->set_uniform("u_EnvWidth", float(ENVIRONMENT_MAP_SIZE));
+
+        m_gl.dispatch(workgroup_count(mip_size, config.prefilter.x), workgroup_count(mip_size, config.prefilter.y), 6 / config.prefilter.z);
 
         return true;
     }
 
     // -----------------------------------------------------------------------------------------------------------------------------------
 
-    void create_camera()
+    // Times the brute force and the selected prefilter paths on the current environment map and measures the error of
+    // every mip against the brute force result. The cubemap is left holding the selected result.
+    void compare_prefilter_paths()
     {
-        m_main_camera  = std::make_unique<dw::Camera>(60.0f, 0.1f, CAMERA_FAR_PLANE, float(m_width) / float(m_height), glm::vec3(0.0f, 5.0f, 150.0f), glm::vec3(0.0f, 0.0, -1.0f));
-        m_debug_camera = std::make_unique<dw::Camera>(60.0f, 0.1f, CAMERA_FAR_PLANE * 2.0f, float(m_width) / float(m_height), glm::vec3(0.0f, 5.0f, 150.0f), glm::vec3(0.0f, 0.0, -1.0f));
+        bool reference_mips[PREFILTER_MIP_LEVELS] = {};
+
+        std::vector<std::vector<float>> reference;
+        std::vector<std::vector<float>> selected;
+
+        if (!prefilter_cubemap(m_workgroups, reference_mips) || !prefilter_cubemap(m_workgroups, m_fast_prefilter))
+        {
+            DW_LOG_ERROR("Failed to run the prefilter comparison");
+            return;
+        }
+
+        m_prefilter_report.reference_time = time_gpu([&]() { prefilter_cubemap(m_workgroups, reference_mips); }, PREFILTER_REPORT_ITERATIONS);
+        read_prefilter_mips(reference);
+
+        m_prefilter_report.selected_time = time_gpu([&]() { prefilter_cubemap(m_workgroups, m_fast_prefilter); }, PREFILTER_REPORT_ITERATIONS);
+        read_prefilter_mips(selected);
+
+        for (int mip = 0; mip < PREFILTER_MIP_LEVELS; mip++)
+        {
+            m_prefilter_report.error[mip] = relative_rmse(reference[mip], selected[mip].data());
+
+            DW_LOG_INFO("Prefilter mip " + std::to_string(mip) + ": relative RMSE " + std::to_string(m_prefilter_report.error[mip]));
+        }
+
+        m_prefilter_report.valid = true;
+
+        DW_LOG_INFO("Prefilter reference " + std::to_string(m_prefilter_report.reference_time) + " ms, selected " + std::to_string(m_prefilter_report.selected_time) + " ms");
     }
 
     // -----------------------------------------------------------------------------------------------------------------------------------
 
-    void render_mesh(dw::Mesh* mesh)
+    // RMSE of 'values' against 'reference' relative to the mean of the reference, both RGBA32F.
+    float relative_rmse(const std::vector<float>& reference, const float* values)
     {
-        // Bind vertex array.
-        mesh->mesh_vertex_array()->bind();
+        double squared_error = 0.0;
+        double total         = 0.0;
+        size_t count         = 0;
 
-        dw::SubMesh* submeshes = mesh->sub_meshes();
-
-        for (uint32_t i = 0; i < mesh->sub_mesh_count(); i++)
+        // Alpha is always 1, only the radiance is compared.
+        for (size_t i = 0; i < reference.size(); i++)
         {
-            dw::SubMesh& submesh = submeshes[i];
-            // Issue draw call.
-            glDrawElementsBaseVertex(GL_TRIANGLES, submesh.index_count, GL_UNSIGNED_INT, (void*)(sizeof(unsigned int) * submesh.base_index), submesh.base_vertex);
+            if (i % 4 == 3)
+                continue;
+
+            double diff = values[i] - reference[i];
+
+            squared_error += diff * diff;
+            total += fabs(reference[i]);
+            count++;
         }
+
+        double mean = total / double(count);
+
+        return mean > 0.0 ? float(sqrt(squared_error / double(count)) / mean) : 0.0f;
     }
 
     // -----------------------------------------------------------------------------------------------------------------------------------
 
-    void render_meshes()
+    // Runs the CPU prefilter on the current environment map with 1, 2, 4... up to every hardware thread and compares its
+    // output against the GGX path of the GPU prefilter.
+    void benchmark_cpu_prefilter()
     {
-        DW_SCOPED_SAMPLE("Render Meshes");
+        CpuCubemap env;
+        CpuCubemap prefiltered;
 
-        glEnable(GL_DEPTH_TEST);
-        glDisable(GL_CULL_FACE);
+        env.resize(ENVIRONMENT_MAP_SIZE, ENVIRONMENT_MAP_MIP_LEVELS);
+        prefiltered.resize(PREFILTER_MAP_SIZE, PREFILTER_MIP_LEVELS);
 
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-        glViewport(0, 0, m_width, m_height);
+        // Only the top level is read back. The pyramid is rebuilt on the CPU, as it would be on a bake node.
+        m_gl.memory_barrier(GL_TEXTURE_UPDATE_BARRIER_BIT);
 
-        glClearColor(0.5f, 0.5f, 0.5f, 1.0f);
-        glClearDepth(1.0);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, m_env_cubemap->id());
 
-        // Bind shader program.
-        m_mesh_program->use();
+        for (int face = 0; face < 6; face++)
+            glGetTexImage(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, 0, GL_RGBA, GL_FLOAT, env.face(0, face));
+
+        glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+
+        env.generate_mipmaps();
 
-        glm::mat4 m = glm::mat4(1.0f);
-        m_mesh_program->set_uniform("u_Model", glm::scale(m, glm::vec3(0.5f)));
-        m_mesh_program->set_uniform("u_View", m_main_camera->m_view);
-        m_mesh_program->set_uniform("u_Projection", m_main_camera->m_projection);
-        m_mesh_program->set_uniform("u_CameraPos", m_main_camera->m_position);
+        uint32_t start_level = (ENVIRONMENT_MAP_SIZE / PREFILTER_MAP_SIZE) - 1;
+        uint32_t max_threads = std::max(1u, std::thread::hardware_concurrency());
+
+        m_cpu_prefilter_timings.clear();
+
+        for (uint32_t threads = 1;; threads = std::min(threads * 2, max_threads))
+        {
+            auto start = std::chrono::high_resolution_clock::now();
+            prefilter_cubemap_cpu(env, start_level, m_sample_count, prefiltered, threads);
+            auto end   = std::chrono::high_resolution_clock::now();
+
+            float time = std::chrono::duration<float, std::milli>(end - start).count();
+
+            m_cpu_prefilter_timings.push_back(glm::vec2(float(threads), time));
+
+            DW_LOG_INFO("CPU prefilter, " + std::to_string(threads) + " threads: " + std::to_string(time) + " ms");
+
+            if (threads == max_threads)
+                break;
+        }
 
-        if (m_mesh_program->set_uniform("s_BRDF", 0))
-            m_brdf_lut->bind(0);
+        bool                            reference_mips[PREFILTER_MIP_LEVELS] = {};
+        std::vector<std::vector<float>> reference;
 
-        if (m_mesh_program->set_uniform("s_IrradianceSH", 1))
-            m_sh->bind(1);
+        if (!prefilter_cubemap(m_workgroups, reference_mips))
+        {
+            DW_LOG_ERROR("Failed to run the GPU prefilter for the CPU comparison");
+            return;
+        }
 
-        if (m_mesh_program->set_uniform("s_Prefiltered", 2))
-            m_prefilter_cubemap->bind(2);
+        read_prefilter_mips(reference);
 
-        if (m_mesh_program->set_uniform("s_Roughness", 3))
-            m_mesh_roughness->bind(3);
+        for (int mip = 0; mip < PREFILTER_MIP_LEVELS; mip++)
+        {
+            m_cpu_prefilter_error[mip] = relative_rmse(reference[mip], &prefiltered.mips[mip][0].x);
 
-        // Draw bunny.
-        render_mesh(m_mesh);
+            DW_LOG_INFO("CPU prefilter mip " + std::to_string(mip) + ": relative RMSE " + std::to_string(m_cpu_prefilter_error[mip]));
+        }
     }
 
     // -----------------------------------------------------------------------------------------------------------------------------------
 
-    void render_envmap()
+    void read_prefilter_mips(std::vector<std::vector<float>>& mips)
     {
-        m_sky_envmap_program->use();
-        m_model.set_render_uniforms(m_sky_envmap_program.get());
+        m_gl.memory_barrier(GL_TEXTURE_UPDATE_BARRIER_BIT);
 
-        for (int i = 0; i < 6; i++)
+        mips.resize(PREFILTER_MIP_LEVELS);
+
+        glBindTexture(GL_TEXTURE_CUBE_MAP, m_prefilter_cubemap->id());
+
+        for (int mip = 0; mip < PREFILTER_MIP_LEVELS; mip++)
         {
-            m_sky_envmap_program->set_uniform("u_Projection", m_capture_projection);
-            m_sky_envmap_program->set_uniform("u_View", m_capture_views[i]);
-            m_sky_envmap_program->set_uniform("u_CameraPos", m_main_camera->m_position);
+            size_t face_size = size_t(PREFILTER_MAP_SIZE >> mip) * (PREFILTER_MAP_SIZE >> mip) * 4;
+
+            mips[mip].resize(face_size * 6);
+
+            for (int face = 0; face < 6; face++)
+                glGetTexImage(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, mip, GL_RGBA, GL_FLOAT, mips[mip].data() + face_size * face);
+        }
+
+        glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    bool generate_brdf_lut(const WorkgroupConfig& config)
+    {
+        ShaderProgram* program = brdf_program(config);
+
+        if (!program->link())
+            return false;
+
+        program->use();
+
+        m_brdf_lut->bind_image(0, 0, 0, GL_WRITE_ONLY, GL_RG16F);
+
+        m_gl.dispatch(workgroup_count(BRDF_LUT_SIZE, config.brdf.x), workgroup_count(BRDF_LUT_SIZE, config.brdf.y), 1);
+
+        return true;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    // Returns the prefilter kernel for 'batch' mips starting at 'mip'. Specialised variants are compiled on first use
+    // for every sample count the UI selects and are kept afterwards, so switching back and forth is free.
+    ShaderProgram* prefilter_program(const WorkgroupConfig& config, int mip, int batch, bool progressive = false, bool octahedral = false)
+    {
+        // An octahedral mip is a single layer, so workgroups are one layer deep.
+        ShaderDefines defines;
+        defines.set("LOCAL_SIZE_X", config.prefilter.x).set("LOCAL_SIZE_Y", config.prefilter.y).set("LOCAL_SIZE_Z", octahedral ? 1 : config.prefilter.z).set("MIP_BATCH", batch);
 
-            m_cubemap_fbos[i]->bind();
-            glViewport(0, 0, ENVIRONMENT_MAP_SIZE, ENVIRONMENT_MAP_SIZE);
+        if (progressive)
+            defines.set("PROGRESSIVE");
 
-            glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        if (octahedral)
+            defines.set("OCTAHEDRAL");
 
-            m_cube_vao->bind();
+        if (m_specialize_prefilter)
+        {
+            defines.set("SAMPLE_COUNT", m_sample_count);
 
-            glDrawArrays(GL_TRIANGLES, 0, 36);
+            if (batch == 1)
+                defines.set("ROUGHNESS", (float)mip / (float)(PREFILTER_MIP_LEVELS - 1));
         }
 
-        m_env_cubemap->generate_mipmaps();
+        return m_prefilter_permutations->get(defines);
     }
 
     // -----------------------------------------------------------------------------------------------------------------------------------
 
-    void render_skybox()
+    ShaderProgram* prefilter_fast_program(const WorkgroupConfig& config)
     {
-        DW_SCOPED_SAMPLE("Render Skybox");
+        ShaderDefines defines;
+        defines.set("LOCAL_SIZE_X", config.prefilter.x).set("LOCAL_SIZE_Y", config.prefilter.y).set("LOCAL_SIZE_Z", config.prefilter.z);
+
+        return m_prefilter_fast_permutations->get(defines);
+    }
 
-        glEnable(GL_DEPTH_TEST);
-        glDepthFunc(GL_LEQUAL);
-        glDisable(GL_CULL_FACE);
+    // -----------------------------------------------------------------------------------------------------------------------------------
 
-        m_cubemap_program->use();
-        m_cube_vao->bind();
+    ShaderProgram* sh_projection_program(const WorkgroupConfig& config)
+    {
+        ShaderDefines defines;
+        defines.set("LOCAL_SIZE", config.sh_projection.x).set("LOCAL_SIZE_Z", config.sh_projection.z);
 
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-        glViewport(0, 0, m_width, m_height);
+        return m_sh_projection_permutations->get(defines);
+    }
 
-        m_cubemap_program->set_uniform("u_Roughness", m_roughness);
-        m_cubemap_program->set_uniform("u_Type", m_type);
-        m_cubemap_program->set_uniform("u_View", m_main_camera->m_view);
-        m_cubemap_program->set_uniform("u_Projection", m_main_camera->m_projection);
-        m_cubemap_program->set_uniform("u_CameraPos", m_main_camera->m_position);
+    // -----------------------------------------------------------------------------------------------------------------------------------
 
-        if (m_cubemap_program->set_uniform("s_Cubemap", 0))
-            m_env_cubemap->bind(0);
+    ShaderProgram* sh_add_program(const WorkgroupConfig& config)
+    {
+        ShaderDefines defines;
+        defines.set("SH_INTERMEDIATE_SIZE", IRRADIANCE_CUBEMAP_SIZE / config.sh_projection.x);
 
-        if (m_cubemap_program->set_uniform("s_Prefilter", 1))
-            m_prefilter_cubemap->bind(1);
+        return m_sh_add_permutations->get(defines);
+    }
 
-        if (m_cubemap_program->set_uniform("s_SH", 2))
-            m_sh->bind(2);
+    // -----------------------------------------------------------------------------------------------------------------------------------
 
-        glDrawArrays(GL_TRIANGLES, 0, 36);
+    ShaderProgram* sh_add_partials_program()
+    {
+        ShaderDefines defines;
+        defines.set("SH_INTERMEDIATE_SIZE", DOWNSAMPLE_TILE_COUNT).set("SH_INTERMEDIATE_BUFFER");
 
-        glDepthFunc(GL_LESS);
+        return m_sh_add_permutations->get(defines);
     }
 
     // -----------------------------------------------------------------------------------------------------------------------------------
 
-    void convert_env_map()
+    ShaderProgram* downsample_program(bool emit_sh = true)
     {
-        m_cubemap_convert_program->use();
-        m_cube_vao->bind();
+        ShaderDefines defines;
 
-        for (int i = 0; i < 6; i++)
-        {
-            m_cubemap_fbos[i]->bind();
+        // The partial sums are dead weight while the SH comes from the atmosphere.
+        if (emit_sh && m_downsample_sh && !direct_sky_sh())
+            defines.set("EMIT_SH");
+
+        return m_downsample_permutations->get(defines);
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    ShaderProgram* equirect_program()
+    {
+        ShaderDefines defines;
+
+        if (m_equirect_sh)
+            defines.set("EMIT_SH");
 
-            glViewport(0, 0, ENVIRONMENT_MAP_SIZE, ENVIRONMENT_MAP_SIZE);
-            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        return m_equirect_permutations->get(defines);
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    ShaderProgram* brdf_program(const WorkgroupConfig& config)
+    {
+        ShaderDefines defines;
+        defines.set("LOCAL_SIZE_X", config.brdf.x).set("LOCAL_SIZE_Y", config.brdf.y);
 
-            m_cubemap_convert_program->set_uniform("u_Projection", m_capture_projection);
-            m_cubemap_convert_program->set_uniform("u_View", m_capture_views[i]);
-            m_cubemap_convert_program->set_uniform("u_CameraPos", m_main_camera->m_position);
+        return m_brdf_permutations->get(defines);
+    }
 
-            if (m_cubemap_convert_program->set_uniform("s_EnvMap", 0))
-                m_env_map->bind(0);
+    // -----------------------------------------------------------------------------------------------------------------------------------
 
-            glDrawArrays(GL_TRIANGLES, 0, 36);
+    // True if batching the last 'batch' mips leaves every mip on the filter m_fast_prefilter selects for it. The last mip
+    // is always filtered with GGX, batched or not.
+    bool batch_keeps_filters(int32_t batch) const
+    {
+        for (int mip = PREFILTER_MIP_LEVELS - batch; mip < PREFILTER_MIP_LEVELS - 1; mip++)
+        {
+            if (m_fast_prefilter[mip])
+                return false;
         }
 
-        m_env_cubemap->generate_mipmaps();
+        return true;
     }
 
     // -----------------------------------------------------------------------------------------------------------------------------------
 
-    void compute_spherical_harmonics()
+    // Times every candidate launch layout of the prefilter, SH projection and BRDF kernels on this device and stores the
+    // fastest one per kernel. The kernels do not interact, so each is tuned on its own.
+    void autotune_workgroups()
     {
-        DW_SCOPED_SAMPLE("Compute Spherical Harmonics");
+        DW_LOG_INFO("Tuning workgroup sizes...");
 
-        m_sh_projection_program->use();
+        std::vector<WorkgroupLayout> rect = { { 4, 4, 1 }, { 8, 8, 1 }, { 16, 8, 1 }, { 16, 16, 1 }, { 32, 8, 1 }, { 32, 32, 1 } };
+        std::vector<WorkgroupLayout> square;
 
-        m_sh_projection_program->set_uniform("u_Width", (float)m_env_cubemap->width() / 4.0f);
-        m_sh_projection_program->set_uniform("u_Height", (float)m_env_cubemap->height() / 4.0f);
+        for (int32_t size = SH_MIN_WORK_GROUP_SIZE; size <= 16; size *= 2)
+            square.push_back({ size, size, 1 });
 
-        if (m_sh_projection_program->set_uniform("s_Cubemap", 1))
-            m_env_cubemap->bind(1);
+        WorkgroupConfig best = m_workgroups;
+        float           best_time;
 
-        m_sh_intermediate->bind_image(0, 0, 0, GL_WRITE_ONLY, GL_RGBA32F);
+        best_time = FLT_MAX;
 
-        glDispatchCompute(IRRADIANCE_CUBEMAP_SIZE / IRRADIANCE_WORK_GROUP_SIZE, IRRADIANCE_CUBEMAP_SIZE / IRRADIANCE_WORK_GROUP_SIZE, 6);
+        for (const auto& layout : workgroup_candidates(rect, { 1, 6 }))
+        {
+            for (int32_t batch = 1; batch <= PREFILTER_MIP_LEVELS - 1; batch++)
+            {
+                // Batched mips always use GGX, so a batch reaching into the fast mips would time a different filter
+                // rather than a different launch layout of the same one.
+                if (!batch_keeps_filters(batch))
+                    continue;
+
+                WorkgroupConfig candidate = best;
+                candidate.prefilter       = layout;
+                candidate.prefilter_batch = batch;
+
+                // The warm-up run inside time_gpu() would hide a variant that failed to compile.
+                if (!prefilter_cubemap(candidate, m_fast_prefilter))
+                    continue;
+
+                float time = time_gpu([&]() { prefilter_cubemap(candidate, m_fast_prefilter); }, WORKGROUP_TUNING_ITERATIONS);
+
+                if (time < best_time)
+                {
+                    best_time = time;
+                    best      = candidate;
+                }
+            }
+        }
 
-        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        best_time = FLT_MAX;
 
-        m_sh_add_program->use();
+        dw::Texture2D* intermediate = m_frame_graph.scratch_texture(sh_intermediate_desc(), m_memory);
 
-        m_sh->bind_image(0, 0, 0, GL_WRITE_ONLY, GL_RGBA32F);
+        for (const auto& layout : workgroup_candidates(square, { 1, 6 }))
+        {
+            WorkgroupConfig candidate = best;
+            candidate.sh_projection   = layout;
+
+            if (!compute_spherical_harmonics(candidate, intermediate))
+                continue;
+
+            float time = time_gpu([&]() { compute_spherical_harmonics(candidate, intermediate); }, WORKGROUP_TUNING_ITERATIONS);
+
+            if (time < best_time)
+            {
+                best_time = time;
+                best      = candidate;
+            }
+        }
+
+        best_time = FLT_MAX;
 
-        if (m_sh_add_program->set_uniform("s_SHIntermediate", 1))
-            m_sh_intermediate->bind(1);
+        for (const auto& layout : workgroup_candidates(rect, { 1 }))
+        {
+            WorkgroupConfig candidate = best;
+            candidate.brdf            = layout;
+
+            if (!generate_brdf_lut(candidate))
+                continue;
+
+            float time = time_gpu([&]() { generate_brdf_lut(candidate); }, WORKGROUP_TUNING_ITERATIONS);
+
+            if (time < best_time)
+            {
+                best_time = time;
+                best      = candidate;
+            }
+        }
+
+        m_workgroups = best;
 
-        glDispatchCompute(9, 1, 1);
+        if (!m_workgroups.save(m_program_cache.driver_hash()))
+            DW_LOG_WARNING("Failed to save workgroup configuration");
 
-        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        DW_LOG_INFO("Tuned workgroup sizes: " + m_workgroups.to_string());
     }
 
     // -----------------------------------------------------------------------------------------------------------------------------------
 
-    void prefilter_cubemap()
+    // Writes the prefiltered cubemap and SH coefficients currently used for shading into a baked probe.
+    bool save_baked_ibl(const std::string& path)
     {
-        DW_SCOPED_SAMPLE("Prefilter");
-
-        m_prefilter_program->use();
+        std::vector<std::vector<uint8_t>> mips(PREFILTER_MIP_LEVELS);
+        std::vector<glm::vec4>            sh(9);
 
-        if (m_prefilter_program->set_uniform("s_EnvMap", 1))
-            m_env_cubemap->bind(1);
+        // The set was written with image stores.
+        m_gl.memory_barrier(GL_TEXTURE_UPDATE_BARRIER_BIT);
 
-        int32_t start_level = (ENVIRONMENT_MAP_SIZE / PREFILTER_MAP_SIZE) - 1;
-        m_prefilter_program->set_uniform("u_StartMipLevel", start_level);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, shading_prefilter_cubemap()->id());
 
         for (int mip = 0; mip < PREFILTER_MIP_LEVELS; mip++)
         {
-            m_sample_directions[mip]->bind_base(0);
+            size_t face_size = size_t(PREFILTER_MAP_SIZE >> mip) * (PREFILTER_MAP_SIZE >> mip) * ibl_pixel_size(IBL_PIXEL_FORMAT_RGBA16F);
 
-            uint32_t mip_width  = PREFILTER_MAP_SIZE * std::pow(0.5, mip);
-            uint32_t mip_height = PREFILTER_MAP_SIZE * std::pow(0.5, mip);
+            mips[mip].resize(face_size * 6);
 
-            float roughness = (float)mip / (float)(PREFILTER_MIP_LEVELS - 1);
-            m_prefilter_program->set_uniform("u_Roughness", roughness);
-            m_prefilter_program->set_uniform("u_SampleCount", m_sample_count);
-            m_prefilter_program->set_uniform("u_Width", float(mip_width));
-            m_prefilter_program->set_uniform("u_Height", float(mip_height));
+            for (int face = 0; face < 6; face++)
+                glGetTexImage(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, mip, GL_RGBA, GL_HALF_FLOAT, mips[mip].data() + face_size * face);
+        }
+
+        glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+
+        glBindTexture(GL_TEXTURE_2D, shading_sh()->id());
+        glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, sh.data());
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        std::string error;
 
-            m_prefilter_cubemap->bind_image(0, mip, 0, GL_WRITE_ONLY, GL_RGBA16F);
+        if (!write_ibl_asset(path, IBL_PIXEL_FORMAT_RGBA16F, PREFILTER_MAP_SIZE, mips, &sh[0].x, &error))
+        {
+            DW_LOG_ERROR("Failed to save baked IBL: " + error);
+            return false;
+        }
+
+        DW_LOG_INFO("Saved baked IBL to " + path);
+
+        return true;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    // Uploads a baked probe straight from the file mapping and stops the per-frame SH projection and prefiltering.
+    bool load_baked_ibl(const std::string& path)
+    {
+        IBLAsset    asset;
+        std::string error;
+
+        if (!asset.open(path, false, &error))
+        {
+            DW_LOG_ERROR("Failed to load baked IBL: " + error);
+            return false;
+        }
+
+        const IBLAssetHeader& header = asset.header();
 
-            glDispatchCompute(mip_width / PREFILTER_WORK_GROUP_SIZE, mip_height / PREFILTER_WORK_GROUP_SIZE, 6);
+        if (header.cubemap_format != IBL_PIXEL_FORMAT_RGBA16F || header.cubemap_size != PREFILTER_MAP_SIZE || header.mip_count != PREFILTER_MIP_LEVELS)
+        {
+            DW_LOG_ERROR("Baked IBL does not match the prefilter cubemap layout: " + path);
+            return false;
+        }
+
+        for (uint32_t mip = 0; mip < header.mip_count; mip++)
+        {
+            for (uint32_t face = 0; face < IBL_ASSET_FACE_COUNT; face++)
+                m_prefilter_cubemap->set_data(face, 0, mip, (void*)asset.face(mip, face));
         }
 
-        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        m_sh->set_data(0, 0, (void*)asset.sh());
+
+        m_use_baked_ibl          = true;
+        m_baked_ibl_loaded       = true;
+        m_background_bake_active = false;
+
+        return true;
     }
 
     // -----------------------------------------------------------------------------------------------------------------------------------
 
-    void generate_brdf_lut()
+    // Queues an asynchronous readback of 'levels' mips of a texture and writes it as KTX2 once the copy lands.
+    void export_ktx2(const std::string& path, dw::Texture* texture, uint32_t vk_format, uint32_t width, uint32_t height, uint32_t levels)
     {
-        m_brdf_program->use();
+        uint32_t faces         = texture->target() == GL_TEXTURE_CUBE_MAP ? 6 : 1;
+        uint32_t pixel_size    = ktx2_pixel_size(vk_format);
+        bool     supercompress = m_ktx2_supercompress && ktx2_supercompression_available();
 
-        m_brdf_lut->bind_image(0, 0, 0, GL_WRITE_ONLY, GL_RG16F);
+        // The IBL textures are written with image stores, which the copy into the pack buffer does not wait for.
+        m_gl.memory_barrier(GL_TEXTURE_UPDATE_BARRIER_BIT);
+
+        m_readback.request(texture, width, height, levels, pixel_size, [=](const uint8_t* data, size_t data_size) {
+            Ktx2Image image;
+
+            image.vk_format   = vk_format;
+            image.width       = width;
+            image.height      = height;
+            image.face_count  = faces;
+            image.level_count = levels;
+
+            for (uint32_t level = 0; level < levels; level++)
+            {
+                size_t level_size = size_t(width >> level) * (height >> level) * pixel_size * faces;
+
+                image.levels.emplace_back(data, data + level_size);
+                data += level_size;
+            }
+
+            std::string error;
 
-        glDispatchCompute(BRDF_LUT_SIZE / BRDF_WORK_GROUP_SIZE, BRDF_LUT_SIZE / BRDF_WORK_GROUP_SIZE, 1);
+            if (write_ktx2(path, image, supercompress, &error))
+                DW_LOG_INFO("Exported " + path);
+            else
+                DW_LOG_ERROR("Failed to export " + path + ": " + error);
+        });
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void log_sh()
+    {
+        uint64_t frame = m_frame_index;
+
+        m_readback.request(shading_sh(), 9, 1, 1, sizeof(glm::vec4), [this, frame](const uint8_t* data, size_t data_size) {
+            m_lighting_log.write_sh9(frame, (const float*)data);
+        });
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    void log_prefiltered()
+    {
+        uint64_t frame = m_frame_index;
+
+        m_readback.request(shading_prefilter_cubemap(), PREFILTER_MAP_SIZE, PREFILTER_MAP_SIZE, PREFILTER_MIP_LEVELS, sizeof(uint16_t) * 4, [this, frame](const uint8_t* data, size_t data_size) {
+            m_lighting_log.write_prefiltered(frame, PREFILTER_MAP_SIZE, PREFILTER_MIP_LEVELS, data, data_size);
+        });
+    }
+
+    // -----------------------------------------------------------------------------------------------------------------------------------
+
+    // Uploads a KTX2 file into an existing texture. The file must match the texture's format, size and face count.
+    bool import_ktx2(const std::string& path, dw::Texture* texture, uint32_t vk_format, uint32_t width, uint32_t height, uint32_t levels)
+    {
+        Ktx2File    file;
+        std::string error;
+
+        if (!file.open(path, &error))
+        {
+            DW_LOG_ERROR("Failed to import " + path + ": " + error);
+            return false;
+        }
+
+        bool cubemap = texture->target() == GL_TEXTURE_CUBE_MAP;
+
+        if (file.vk_format() != vk_format || file.width() != width || file.height() != height || file.face_count() != (cubemap ? 6u : 1u) || file.level_count() < levels)
+        {
+            DW_LOG_ERROR("KTX2 file does not match the texture layout: " + path);
+            return false;
+        }
+
+        for (uint32_t level = 0; level < levels; level++)
+        {
+            if (cubemap)
+            {
+                for (uint32_t face = 0; face < 6; face++)
+                    static_cast<dw::TextureCube*>(texture)->set_data(face, 0, level, (void*)file.face(level, face));
+            }
+            else
+                static_cast<dw::Texture2D*>(texture)->set_data(0, level, (void*)file.level(level));
+        }
+
+        // Only the base level of the environment map is stored, the rest of the chain is regenerated.
+        if (texture == m_env_cubemap.get())
+        {
+            generate_env_mipmaps();
+            m_env_version++;
+        }
 
-        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        return true;
     }
 
     // -----------------------------------------------------------------------------------------------------------------------------------
@@ -861,301 +2997,50 @@ private:
 
     void create_cube()
     {
-        float vertices[] = {
+        // Only the position is read by the cube shaders, so each corner is three signed bytes padded to four.
+        int8_t vertices[] = {
             // back face
-            -1.0f,
-            -1.0f,
-            -1.0f,
-            0.0f,
-            0.0f,
-            -1.0f,
-            0.0f,
-            0.0f, // bottom-left
-            1.0f,
-            1.0f,
-            -1.0f,
-            0.0f,
-            0.0f,
-            -1.0f,
-            1.0f,
-            1.0f, // top-right
-            1.0f,
-            -1.0f,
-            -1.0f,
-            0.0f,
-            0.0f,
-            -1.0f,
-            1.0f,
-            0.0f, // bottom-right
-            1.0f,
-            1.0f,
-            -1.0f,
-            0.0f,
-            0.0f,
-            -1.0f,
-            1.0f,
-            1.0f, // top-right
-            -1.0f,
-            -1.0f,
-            -1.0f,
-            0.0f,
-            0.0f,
-            -1.0f,
-            0.0f,
-            0.0f, // bottom-left
-            -1.0f,
-            1.0f,
-            -1.0f,
-            0.0f,
-            0.0f,
-            -1.0f,
-            0.0f,
-            1.0f, // top-left
+            -1, -1, -1, 0,
+            1, 1, -1, 0,
+            1, -1, -1, 0,
+            1, 1, -1, 0,
+            -1, -1, -1, 0,
+            -1, 1, -1, 0,
             // front face
-            -1.0f,
-            -1.0f,
-            1.0f,
-            0.0f,
-            0.0f,
-            1.0f,
-            0.0f,
-            0.0f, // bottom-left
-            1.0f,
-            -1.0f,
-            1.0f,
-            0.0f,
-            0.0f,
-            1.0f,
-            1.0f,
-            0.0f, // bottom-right
-            1.0f,
-            1.0f,
-            1.0f,
-            0.0f,
-            0.0f,
-            1.0f,
-            1.0f,
-            1.0f, // top-right
-            1.0f,
-            1.0f,
-            1.0f,
-            0.0f,
-            0.0f,
-            1.0f,
-            1.0f,
-            1.0f, // top-right
-            -1.0f,
-            1.0f,
-            1.0f,
-            0.0f,
-            0.0f,
-            1.0f,
-            0.0f,
-            1.0f, // top-left
-            -1.0f,
-            -1.0f,
-            1.0f,
-            0.0f,
-            0.0f,
-            1.0f,
-            0.0f,
-            0.0f, // bottom-left
+            -1, -1, 1, 0,
+            1, -1, 1, 0,
+            1, 1, 1, 0,
+            1, 1, 1, 0,
+            -1, 1, 1, 0,
+            -1, -1, 1, 0,
             // left face
-            -1.0f,
-            1.0f,
-            1.0f,
-            -1.0f,
-            0.0f,
-            0.0f,
-            1.0f,
-            0.0f, // top-right
-            -1.0f,
-            1.0f,
-            -1.0f,
-            -1.0f,
-            0.0f,
-            0.0f,
-            1.0f,
-            1.0f, // top-left
-            -1.0f,
-            -1.0f,
-            -1.0f,
-            -1.0f,
-            0.0f,
-            0.0f,
-            0.0f,
-            1.0f, // bottom-left
-            -1.0f,
-            -1.0f,
-            -1.0f,
-            -1.0f,
-            0.0f,
-            0.0f,
-            0.0f,
-            1.0f, // bottom-left
-            -1.0f,
-            -1.0f,
-            1.0f,
-            -1.0f,
-            0.0f,
-            0.0f,
-            0.0f,
-            0.0f, // bottom-right
-            -1.0f,
-            1.0f,
-            1.0f,
-            -1.0f,
-            0.0f,
-            0.0f,
-            1.0f,
-            0.0f, // top-right
-                  // right face
-            1.0f,
-            1.0f,
-            1.0f,
-            1.0f,
-            0.0f,
-            0.0f,
-            1.0f,
-            0.0f, // top-left
-            1.0f,
-            -1.0f,
-            -1.0f,
-            1.0f,
-            0.0f,
-            0.0f,
-            0.0f,
-            1.0f, // bottom-right
-            1.0f,
-            1.0f,
-            -1.0f,
-            1.0f,
-            0.0f,
-            0.0f,
-            1.0f,
-            1.0f, // top-right
-            1.0f,
-            -1.0f,
-            -1.0f,
-            1.0f,
-            0.0f,
-            0.0f,
-            0.0f,
-            1.0f, // bottom-right
-            1.0f,
-            1.0f,
-            1.0f,
-            1.0f,
-            0.0f,
-            0.0f,
-            1.0f,
-            0.0f, // top-left
-            1.0f,
-            -1.0f,
-            1.0f,
-            1.0f,
-            0.0f,
-            0.0f,
-            0.0f,
-            0.0f, // bottom-left
+            -1, 1, 1, 0,
+            -1, 1, -1, 0,
+            -1, -1, -1, 0,
+            -1, -1, -1, 0,
+            -1, -1, 1, 0,
+            -1, 1, 1, 0,
+            // right face
+            1, 1, 1, 0,
+            1, -1, -1, 0,
+            1, 1, -1, 0,
+            1, -1, -1, 0,
+            1, 1, 1, 0,
+            1, -1, 1, 0,
             // bottom face
-            -1.0f,
-            -1.0f,
-            -1.0f,
-            0.0f,
-            -1.0f,
-            0.0f,
-            0.0f,
-            1.0f, // top-right
-            1.0f,
-            -1.0f,
-            -1.0f,
-            0.0f,
-            -1.0f,
-            0.0f,
-            1.0f,
-            1.0f, // top-left
-            1.0f,
-            -1.0f,
-            1.0f,
-            0.0f,
-            -1.0f,
-            0.0f,
-            1.0f,
-            0.0f, // bottom-left
-            1.0f,
-            -1.0f,
-            1.0f,
-            0.0f,
-            -1.0f,
-            0.0f,
-            1.0f,
-            0.0f, // bottom-left
-            -1.0f,
-            -1.0f,
-            1.0f,
-            0.0f,
-            -1.0f,
-            0.0f,
-            0.0f,
-            0.0f, // bottom-right
-            -1.0f,
-            -1.0f,
-            -1.0f,
-            0.0f,
-            -1.0f,
-            0.0f,
-            0.0f,
-            1.0f, // top-right
+            -1, -1, -1, 0,
+            1, -1, -1, 0,
+            1, -1, 1, 0,
+            1, -1, 1, 0,
+            -1, -1, 1, 0,
+            -1, -1, -1, 0,
             // top face
-            -1.0f,
-            1.0f,
-            -1.0f,
-            0.0f,
-            1.0f,
-            0.0f,
-            0.0f,
-            1.0f, // top-left
-            1.0f,
-            1.0f,
-            1.0f,
-            0.0f,
-            1.0f,
-            0.0f,
-            1.0f,
-            0.0f, // bottom-right
-            1.0f,
-            1.0f,
-            -1.0f,
-            0.0f,
-            1.0f,
-            0.0f,
-            1.0f,
-            1.0f, // top-right
-            1.0f,
-            1.0f,
-            1.0f,
-            0.0f,
-            1.0f,
-            0.0f,
-            1.0f,
-            0.0f, // bottom-right
-            -1.0f,
-            1.0f,
-            -1.0f,
-            0.0f,
-            1.0f,
-            0.0f,
-            0.0f,
-            1.0f, // top-left
-            -1.0f,
-            1.0f,
-            1.0f,
-            0.0f,
-            1.0f,
-            0.0f,
-            0.0f,
-            0.0f // bottom-left
+            -1, 1, -1, 0,
+            1, 1, 1, 0,
+            1, 1, -1, 0,
+            1, 1, 1, 0,
+            -1, 1, -1, 0,
+            -1, 1, 1, 0
         };
 
         m_cube_vbo = std::make_unique<dw::VertexBuffer>(GL_STATIC_DRAW, sizeof(vertices), vertices);
@@ -1165,13 +3050,11 @@ private:
 
         // Declare vertex attributes.
         dw::VertexAttrib attribs[] = {
-            { 3, GL_FLOAT, false, 0 },
-            { 3, GL_FLOAT, false, (3 * sizeof(float)) },
-            { 2, GL_FLOAT, false, (6 * sizeof(float)) }
+            { 3, GL_BYTE, false, 0 }
         };
 
         // Create vertex array.
-        m_cube_vao = std::make_unique<dw::VertexArray>(m_cube_vbo.get(), nullptr, (8 * sizeof(float)), 3, attribs);
+        m_cube_vao = std::make_unique<dw::VertexArray>(m_cube_vbo.get(), nullptr, (4 * sizeof(int8_t)), 1, attribs);
 
         m_capture_projection = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 10.0f);
         m_capture_views      = {
@@ -1186,60 +3069,31 @@ private:
 
     // -----------------------------------------------------------------------------------------------------------------------------------
 
-    float radical_inverse_vdc(uint32_t bits)
-    {
-        bits = (bits << 16u) | (bits >> 16u);
-        bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
-        bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
-        bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
-        bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
-        return float(bits) * 2.3283064365386963e-10; // / 0x100000000
-    }
-
-    // -----------------------------------------------------------------------------------------------------------------------------------
-
-    glm::vec2 hammersley(uint32_t i, uint32_t N)
-    {
-        return glm::vec2(float(i) / float(N), radical_inverse_vdc(i));
-    }
-
-    // -----------------------------------------------------------------------------------------------------------------------------------
-
+    // Fills the sample directions of every mip. The buffers are created once and updated in place when the sample count
+    // changes.
     void precompute_prefilter_constants()
     {
-        m_sample_directions.clear();
-        m_sample_directions.resize(PREFILTER_MIP_LEVELS);
+        if (m_sample_directions.empty())
+        {
+            for (int mip = 0; mip < PREFILTER_MIP_LEVELS; mip++)
+            {
+                m_sample_directions.push_back(std::make_unique<dw::UniformBuffer>(GL_DYNAMIC_DRAW, sizeof(glm::vec4) * MAX_PREFILTER_SAMPLES, nullptr));
+                m_memory.track(m_sample_directions.back().get(), "Prefilter Samples (Mip " + std::to_string(mip) + ")", GPU_MEMORY_STREAMING, sizeof(glm::vec4) * MAX_PREFILTER_SAMPLES);
+            }
+        }
 
         for (int mip = 0; mip < PREFILTER_MIP_LEVELS; mip++)
         {
-            uint32_t mip_width  = PREFILTER_MAP_SIZE * std::pow(0.5, mip);
-            uint32_t mip_height = PREFILTER_MAP_SIZE * std::pow(0.5, mip);
-
             float roughness = (float)mip / (float)(PREFILTER_MIP_LEVELS - 1);
 
             std::vector<glm::vec4> samples;
 
             samples.resize(MAX_PREFILTER_SAMPLES);
 
-            for (int i = 0; i < m_sample_count; i++)
-            {
-                glm::vec2 Xi = hammersley(i, m_sample_count);
-                float     a  = roughness * roughness;
-
-                float phi       = 2.0f * M_PI * Xi.x;
-                float cos_theta = sqrt((1.0f - Xi.y) / (1.0f + (a * a - 1.0f) * Xi.y));
-                float sin_theta = sqrt(1.0f - cos_theta * cos_theta);
+            // Shared with the CPU prefilter so that both evaluate the same sample set.
+            prefilter_sample_directions(roughness, m_sample_count, samples.data());
 
-                // from spherical coordinates to cartesian coordinates - halfway vector
-                glm::vec3 H;
-                H.x = cos(phi) * sin_theta;
-                H.y = sin(phi) * sin_theta;
-                H.z = cos_theta;
-
-                samples[i] = glm::vec4(H, 0.0f);
-            }
-
-            m_sample_directions[mip] = std::make_unique<dw::UniformBuffer>(GL_DYNAMIC_DRAW, sizeof(glm::vec4) * MAX_PREFILTER_SAMPLES, samples.data());
+            m_sample_directions[mip]->set_data(0, sizeof(glm::vec4) * MAX_PREFILTER_SAMPLES, samples.data());
         }
     }
 
@@ -1254,46 +3108,56 @@ private:
     std::unique_ptr<dw::VertexBuffer> m_cube_vbo;
     std::unique_ptr<dw::VertexArray>  m_cube_vao;
 
-    std::unique_ptr<dw::UniformBuffer> m_object_ubo;
-    std::unique_ptr<dw::UniformBuffer> m_global_ubo;
+    GLState           m_gl;
+    UniformRing       m_uniforms;
+    GpuMemoryRegistry m_memory;
+    FrameGraph        m_frame_graph;
 
-    std::unique_ptr<dw::Texture2D>   m_cubemap_depth;
     std::unique_ptr<dw::Texture2D>   m_env_map;
     std::unique_ptr<dw::TextureCube> m_env_cubemap;
     std::unique_ptr<dw::TextureCube> m_prefilter_cubemap;
     std::unique_ptr<dw::Texture2D>   m_sh;
-    std::unique_ptr<dw::Texture2D>   m_sh_intermediate;
     std::unique_ptr<dw::Texture2D>   m_brdf_lut;
 
-    std::unique_ptr<dw::Texture2D> m_mesh_roughness;
-
-    std::unique_ptr<dw::Shader>  m_cubemap_convert_vs;
-    std::unique_ptr<dw::Shader>  m_cubemap_convert_fs;
-    std::unique_ptr<dw::Program> m_cubemap_convert_program;
-
-    std::unique_ptr<dw::Shader>  m_cubemap_vs;
-    std::unique_ptr<dw::Shader>  m_cubemap_fs;
-    std::unique_ptr<dw::Program> m_cubemap_program;
-
-    std::unique_ptr<dw::Shader>  m_sky_envmap_vs;
-    std::unique_ptr<dw::Shader>  m_sky_envmap_fs;
-    std::unique_ptr<dw::Program> m_sky_envmap_program;
-
-    std::unique_ptr<dw::Shader>  m_mesh_vs;
-    std::unique_ptr<dw::Shader>  m_mesh_fs;
-    std::unique_ptr<dw::Program> m_mesh_program;
+    // Compact alternative to m_prefilter_cubemap. Only allocated when enabled.
+    std::unique_ptr<dw::Texture2D> m_prefilter_octahedral;
 
-    std::unique_ptr<dw::Shader>  m_sh_projection_cs;
-    std::unique_ptr<dw::Program> m_sh_projection_program;
+    // Set read by the shading passes while m_prefilter_cubemap and m_sh are baked. Only allocated when pipelined.
+    std::unique_ptr<dw::TextureCube> m_shading_prefilter_cubemap;
+    std::unique_ptr<dw::Texture2D>   m_shading_sh;
 
-    std::unique_ptr<dw::Shader>  m_sh_add_cs;
-    std::unique_ptr<dw::Program> m_sh_add_program;
+    std::unique_ptr<dw::ShaderStorageBuffer> m_downsample_tiles;
+    std::unique_ptr<dw::ShaderStorageBuffer> m_sh_partials;
 
-    std::unique_ptr<dw::Shader>  m_prefilter_cs;
-    std::unique_ptr<dw::Program> m_prefilter_program;
+    std::unique_ptr<dw::Texture2D> m_mesh_roughness;
 
-    std::unique_ptr<dw::Shader>  m_brdf_cs;
-    std::unique_ptr<dw::Program> m_brdf_program;
+    // Decoded by startup tasks and released once uploaded.
+    HdrImage  m_env_image;
+    MeshAsset m_mesh_asset;
+    bool      m_mesh_asset_valid = false;
+
+    // Shader programs. The cache is declared first so that it outlives every program created from it.
+    ProgramCache                   m_program_cache;
+    std::unique_ptr<ShaderProgram> m_cubemap_convert_program;
+    std::unique_ptr<ShaderProgram> m_cubemap_program;
+    std::unique_ptr<ShaderProgram> m_sky_envmap_program;
+    std::unique_ptr<ShaderProgram> m_mesh_program;
+    std::unique_ptr<ShaderProgram> m_mesh_octahedral_program;
+    std::unique_ptr<ShaderProgram> m_sky_octahedral_program;
+    std::unique_ptr<ShaderProgram> m_cull_program;
+    std::unique_ptr<ShaderProgram> m_sky_sh_program;
+    std::unique_ptr<ShaderProgram> m_sky_view_program;
+    std::unique_ptr<ShaderProgram> m_sky_envmap_lut_program;
+
+    // Compute kernels, one variant per launch layout and specialisation.
+    std::unique_ptr<ShaderPermutations> m_prefilter_permutations;
+    std::unique_ptr<ShaderPermutations> m_prefilter_fast_permutations;
+    std::unique_ptr<ShaderPermutations> m_downsample_permutations;
+    std::unique_ptr<ShaderPermutations> m_equirect_permutations;
+    std::unique_ptr<ShaderPermutations> m_sh_projection_permutations;
+    std::unique_ptr<ShaderPermutations> m_sh_add_permutations;
+    std::unique_ptr<ShaderPermutations> m_brdf_permutations;
+    WorkgroupConfig                     m_workgroups;
 
     // Camera.
     std::unique_ptr<dw::Camera> m_main_camera;
@@ -1304,8 +3168,27 @@ private:
 
     SkyModel m_model;
 
+    AsyncReadback m_readback;
+    size_t        m_readback_tracked_size = 0;
+
+    // Lighting analytics.
+    LightingLog m_lighting_log;
+    char        m_lighting_log_path[256] = "lighting.llog";
+    int         m_lighting_log_interval  = LIGHTING_LOG_SH_INTERVAL;
+    bool        m_log_prefiltered        = false;
+    uint64_t    m_frame_index            = 0;
+
+    // Background baking.
+    ProbeBaker      m_probe_baker;
+    ProbeBakeResult m_background_probe; // Finished bake that has not been applied yet.
+    float           m_background_bake_time   = 0.0f;
+    bool            m_background_bake_active = false; // The applied bake replaces the live sky.
+
     // Mesh
-    dw::Mesh* m_mesh;
+    dw::Mesh*  m_mesh;
+    SceneBatch m_scene;
+    int        m_scene_object_count = 1;
+    bool       m_gpu_culling        = true;
 
     // Camera controls.
     bool  m_show_gui           = true;
@@ -1320,6 +3203,64 @@ private:
     int   m_type               = 0;
     int   m_sample_count       = 32;
     float m_roughness          = 0.0f;
+    int   m_atmosphere_preset  = 0;
+
+    // Atmosphere parameters being edited in the UI, applied to the model once the edit is finished.
+    glm::vec3 m_beta_r_edit = glm::vec3(0.0058f, 0.0135f, 0.0331f);
+    float     m_mie_g_edit  = 0.75f;
+
+    // Prefiltering. The fast filter is only worth its error on the near-specular mips.
+    bool            m_specialize_prefilter                 = true;
+    bool            m_fast_prefilter[PREFILTER_MIP_LEVELS] = { true, true, false, false, false };
+    PrefilterReport m_prefilter_report;
+
+    // CPU prefilter benchmark, one (threads, milliseconds) pair per run.
+    std::vector<glm::vec2> m_cpu_prefilter_timings;
+    float                  m_cpu_prefilter_error[PREFILTER_MIP_LEVELS] = {};
+
+    // Progressive prefiltering.
+    bool         m_progressive_prefilter = false;
+    int          m_progressive_samples   = 4;
+    int32_t      m_progressive_frame     = 0;
+    uint64_t     m_progressive_inputs    = 0;
+    uint32_t     m_env_version           = 0;
+    std::mt19937 m_progressive_rng;
+
+    // Pipelined IBL.
+    bool m_pipelined_ibl     = false;
+    bool m_ibl_history_valid = false;
+
+    // Octahedral prefiltered map.
+    bool m_octahedral_probe = false;
+
+    // Environment mip chain.
+    bool m_compute_downsample = true;
+    bool m_downsample_sh      = true;
+    bool m_sh_partials_valid  = false;
+    bool m_direct_sky_sh      = true;
+    bool m_sky_view_lut       = true;
+    bool m_compute_equirect   = true;
+    bool m_equirect_sh        = true;
+
+    uint32_t m_sky_view_rebuilds = 0;
+
+    // Baked IBL.
+    bool m_use_baked_ibl       = false;
+    bool m_baked_ibl_loaded    = false; // Set once a probe has been loaded, imported or baked in the background.
+    char m_baked_ibl_path[256] = "probe.ibl";
+
+    // Startup timing.
+    float m_startup_time          = 0.0f;
+    bool  m_warm_start            = false;
+    float m_mesh_load_time        = 0.0f;
+    bool  m_mesh_from_cache       = false;
+    float m_mesh_benchmark_source = 0.0f;
+    float m_mesh_benchmark_cached = 0.0f;
+
+    // KTX2 interchange.
+    bool m_ktx2_supercompress  = false;
+    bool m_use_imported_env    = false;
+    bool m_imported_env_loaded = false; // Set once an environment has been imported or a background bake applied.
 };
 
 DW_DECLARE_MAIN(RuntimeIBL)
@@ -0,0 +1,199 @@
+#include "mesh_asset.h"
+#include "disk_cache.h"
+#include <stddef.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <vector>
+
+static_assert(sizeof(MeshAssetSubMesh) == 40, "MeshAssetSubMesh layout changed, bump MESH_ASSET_VERSION");
+static_assert(sizeof(MeshAssetHeader) == 120, "MeshAssetHeader layout changed, bump MESH_ASSET_VERSION");
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static uint64_t align_offset(uint64_t offset)
+{
+    return (offset + MESH_ASSET_ALIGNMENT - 1) & ~uint64_t(MESH_ASSET_ALIGNMENT - 1);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static bool fail(std::string* error, const std::string& msg)
+{
+    if (error)
+        *error = msg;
+
+    return false;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static uint64_t header_checksum(const MeshAssetHeader& header)
+{
+    return disk_cache::hash(&header, offsetof(MeshAssetHeader, header_checksum));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool mesh_source_stamp(const std::string& path, uint64_t* size, int64_t* mtime)
+{
+    struct stat info;
+
+    if (stat(path.c_str(), &info) != 0)
+        return false;
+
+    *size  = uint64_t(info.st_size);
+    *mtime = int64_t(info.st_mtime);
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool MeshAsset::open(const std::string& path, bool verify_checksum, std::string* error)
+{
+    close();
+
+    if (!m_file.open(path))
+        return fail(error, "Failed to map " + path);
+
+    if (!validate(m_file.data(), m_file.size(), verify_checksum, error))
+    {
+        m_file.close();
+        return false;
+    }
+
+    m_header = (const MeshAssetHeader*)m_file.data();
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void MeshAsset::close()
+{
+    m_file.close();
+    m_header = nullptr;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool MeshAsset::validate(const uint8_t* data, size_t size, bool verify_checksum, std::string* error)
+{
+    if (size < sizeof(MeshAssetHeader))
+        return fail(error, "File is smaller than the header");
+
+    const MeshAssetHeader* header = (const MeshAssetHeader*)data;
+
+    if (header->magic != MESH_ASSET_MAGIC)
+        return fail(error, "Bad magic");
+
+    if (header->version != MESH_ASSET_VERSION)
+        return fail(error, "Unsupported version " + std::to_string(header->version));
+
+    if (header->header_size != sizeof(MeshAssetHeader))
+        return fail(error, "Unexpected header size");
+
+    if (header->header_checksum != header_checksum(*header))
+        return fail(error, "Header checksum mismatch");
+
+    if (header->file_size != size)
+        return fail(error, "File size mismatch, file is truncated or padded");
+
+    uint64_t submesh_size = uint64_t(header->submesh_count) * sizeof(MeshAssetSubMesh);
+    uint64_t vertex_size  = uint64_t(header->vertex_count) * header->vertex_stride;
+    uint64_t index_size   = uint64_t(header->index_count) * sizeof(uint32_t);
+
+    if (header->submesh_offset % MESH_ASSET_ALIGNMENT != 0 || header->submesh_offset + submesh_size > size)
+        return fail(error, "Submesh table out of bounds");
+
+    if (header->vertex_offset % MESH_ASSET_ALIGNMENT != 0 || header->vertex_offset + vertex_size > size)
+        return fail(error, "Vertex data out of bounds");
+
+    if (header->index_offset % MESH_ASSET_ALIGNMENT != 0 || header->index_offset + index_size > size)
+        return fail(error, "Index data out of bounds");
+
+    const MeshAssetSubMesh* submeshes = (const MeshAssetSubMesh*)(data + header->submesh_offset);
+
+    for (uint32_t i = 0; i < header->submesh_count; i++)
+    {
+        if (uint64_t(submeshes[i].base_index) + submeshes[i].index_count > header->index_count || submeshes[i].base_vertex >= header->vertex_count)
+            return fail(error, "Submesh " + std::to_string(i) + " out of range");
+    }
+
+    if (verify_checksum)
+    {
+        uint64_t h = disk_cache::hash(submeshes, (size_t)submesh_size);
+        h          = disk_cache::hash(data + header->vertex_offset, (size_t)vertex_size, h);
+        h          = disk_cache::hash(data + header->index_offset, (size_t)index_size, h);
+
+        if (h != header->data_checksum)
+            return fail(error, "Data checksum mismatch");
+    }
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool write_mesh_asset(const std::string&      path,
+                      uint64_t                source_size,
+                      int64_t                 source_mtime,
+                      const void*             vertices,
+                      uint32_t                vertex_stride,
+                      uint32_t                vertex_count,
+                      const uint32_t*         indices,
+                      uint32_t                index_count,
+                      const MeshAssetSubMesh* submeshes,
+                      uint32_t                submesh_count,
+                      const float*            min_extents,
+                      const float*            max_extents,
+                      std::string*            error)
+{
+    if (vertex_count == 0 || index_count == 0 || submesh_count == 0)
+        return fail(error, "Mesh is empty");
+
+    MeshAssetHeader header;
+    memset(&header, 0, sizeof(MeshAssetHeader));
+
+    uint64_t submesh_size = uint64_t(submesh_count) * sizeof(MeshAssetSubMesh);
+    uint64_t vertex_size  = uint64_t(vertex_count) * vertex_stride;
+    uint64_t index_size   = uint64_t(index_count) * sizeof(uint32_t);
+
+    header.magic          = MESH_ASSET_MAGIC;
+    header.version        = MESH_ASSET_VERSION;
+    header.header_size    = sizeof(MeshAssetHeader);
+    header.vertex_stride  = vertex_stride;
+    header.source_size    = source_size;
+    header.source_mtime   = source_mtime;
+    header.vertex_count   = vertex_count;
+    header.index_count    = index_count;
+    header.submesh_count  = submesh_count;
+    header.submesh_offset = align_offset(sizeof(MeshAssetHeader));
+    header.vertex_offset  = align_offset(header.submesh_offset + submesh_size);
+    header.index_offset   = align_offset(header.vertex_offset + vertex_size);
+    header.file_size      = header.index_offset + index_size;
+
+    memcpy(header.min_extents, min_extents, sizeof(float) * 3);
+    memcpy(header.max_extents, max_extents, sizeof(float) * 3);
+
+    uint64_t h           = disk_cache::hash(submeshes, (size_t)submesh_size);
+    h                    = disk_cache::hash(vertices, (size_t)vertex_size, h);
+    h                    = disk_cache::hash(indices, (size_t)index_size, h);
+    header.data_checksum = h;
+
+    header.header_checksum = header_checksum(header);
+
+    std::vector<uint8_t> data((size_t)header.file_size, 0);
+
+    memcpy(data.data(), &header, sizeof(MeshAssetHeader));
+    memcpy(data.data() + header.submesh_offset, submeshes, (size_t)submesh_size);
+    memcpy(data.data() + header.vertex_offset, vertices, (size_t)vertex_size);
+    memcpy(data.data() + header.index_offset, indices, (size_t)index_size);
+
+    if (!disk_cache::write(path, data.data(), data.size()))
+        return fail(error, "Failed to write " + path);
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "mapped_file.h"
+#include <stdint.h>
+#include <string>
+
+// Baked mesh container (.mesh), written the first time a source mesh is imported.
+//
+// [MeshAssetHeader][MeshAssetSubMesh * submesh_count][vertices][indices]
+//
+// Vertices are interleaved in the layout of the vertex buffer and indices are 32-bit, so both blobs can be handed to
+// the buffer upload straight from the file mapping. Indices are stored after the vertex cache, overdraw and vertex fetch
+// optimisations of mesh_optimizer.h. Every section starts on a MESH_ASSET_ALIGNMENT boundary. All values are
+// little-endian.
+
+#define MESH_ASSET_MAGIC 0x48534d50 // 'PMSH'
+#define MESH_ASSET_VERSION 2
+#define MESH_ASSET_ALIGNMENT 256
+
+struct MeshAssetSubMesh
+{
+    uint32_t index_count;
+    uint32_t base_vertex;
+    uint32_t base_index;
+    uint32_t reserved;
+    float    min_extents[3];
+    float    max_extents[3];
+};
+
+struct MeshAssetHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t header_size;
+    uint32_t vertex_stride;
+    uint64_t file_size;
+    uint64_t source_size;  // Size of the source file the asset was baked from.
+    int64_t  source_mtime; // Modification time of the source file, in seconds.
+    uint32_t vertex_count;
+    uint32_t index_count;
+    uint32_t submesh_count;
+    uint32_t reserved;
+    uint64_t submesh_offset;
+    uint64_t vertex_offset;
+    uint64_t index_offset;
+    float    min_extents[3];
+    float    max_extents[3];
+    uint64_t data_checksum;   // FNV-1a of the submesh table, vertices and indices.
+    uint64_t header_checksum; // FNV-1a of every header byte before this field.
+};
+
+// Size and modification time of a source file, used to detect a stale asset. Returns false if the file is missing.
+bool mesh_source_stamp(const std::string& path, uint64_t* size, int64_t* mtime);
+
+// Read-only view of a baked mesh. Pointers point directly into the file mapping and stay valid until close().
+class MeshAsset
+{
+public:
+    // Checksum verification touches every byte of the file, so it is optional for the runtime load path.
+    bool open(const std::string& path, bool verify_checksum, std::string* error = nullptr);
+    void close();
+
+    static bool validate(const uint8_t* data, size_t size, bool verify_checksum, std::string* error);
+
+    inline const MeshAssetHeader&  header() const { return *m_header; }
+    inline const MeshAssetSubMesh* submeshes() const { return (const MeshAssetSubMesh*)(m_file.data() + m_header->submesh_offset); }
+    inline const void*             vertices() const { return m_file.data() + m_header->vertex_offset; }
+    inline const uint32_t*         indices() const { return (const uint32_t*)(m_file.data() + m_header->index_offset); }
+
+private:
+    MappedFile             m_file;
+    const MeshAssetHeader* m_header = nullptr;
+};
+
+// 'vertices' holds 'vertex_count' interleaved vertices of 'vertex_stride' bytes each.
+bool write_mesh_asset(const std::string& path,
+                      uint64_t                source_size,
+                      int64_t                 source_mtime,
+                      const void*             vertices,
+                      uint32_t                vertex_stride,
+                      uint32_t                vertex_count,
+                      const uint32_t*         indices,
+                      uint32_t                index_count,
+                      const MeshAssetSubMesh* submeshes,
+                      uint32_t                submesh_count,
+                      const float*            min_extents,
+                      const float*            max_extents,
+                      std::string*            error = nullptr);
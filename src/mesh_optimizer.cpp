@@ -0,0 +1,448 @@
+#include "mesh_optimizer.h"
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+// Forsyth's scoring parameters.
+#define SCORE_CACHE_SIZE 32
+#define SCORE_CACHE_DECAY_POWER 1.5f
+#define SCORE_LAST_TRIANGLE 0.75f
+#define SCORE_VALENCE_BOOST_SCALE 2.0f
+#define SCORE_VALENCE_BOOST_POWER 0.5f
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static float vertex_score(int cache_position, uint32_t live_triangles)
+{
+    if (live_triangles == 0)
+        return -1.0f;
+
+    float score = 0.0f;
+
+    // The vertices of the last triangle get a fixed score so the next triangle does not simply reuse two of them.
+    if (cache_position >= 0)
+    {
+        if (cache_position < 3)
+            score = SCORE_LAST_TRIANGLE;
+        else
+            score = powf(1.0f - float(cache_position - 3) / float(SCORE_CACHE_SIZE - 3), SCORE_CACHE_DECAY_POWER);
+    }
+
+    // Vertices with few triangles left are finished first so they can leave the cache for good.
+    return score + SCORE_VALENCE_BOOST_SCALE * powf(float(live_triangles), -SCORE_VALENCE_BOOST_POWER);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static void simulate_fifo_cache(const uint32_t* indices, size_t index_count, size_t vertex_count, std::vector<uint8_t>& triangle_misses)
+{
+    std::vector<uint32_t> timestamps(vertex_count, 0);
+    uint32_t              time = VERTEX_CACHE_FIFO_SIZE + 1;
+
+    triangle_misses.assign(index_count / 3, 0);
+
+    for (size_t i = 0; i < index_count; i++)
+    {
+        uint32_t v = indices[i];
+
+        if (time - timestamps[v] > VERTEX_CACHE_FIFO_SIZE)
+        {
+            timestamps[v] = time++;
+            triangle_misses[i / 3]++;
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void optimize_vertex_cache(uint32_t* destination, const uint32_t* indices, size_t index_count, size_t vertex_count)
+{
+    size_t triangle_count = index_count / 3;
+
+    if (triangle_count == 0)
+        return;
+
+    std::vector<uint32_t> input(indices, indices + triangle_count * 3);
+
+    // Triangles that use each vertex. The first 'live[v]' entries of a vertex are the ones not emitted yet.
+    std::vector<uint32_t> offsets(vertex_count + 1, 0);
+    std::vector<uint32_t> live(vertex_count, 0);
+
+    for (size_t i = 0; i < input.size(); i++)
+        live[input[i]]++;
+
+    for (size_t v = 0; v < vertex_count; v++)
+        offsets[v + 1] = offsets[v] + live[v];
+
+    std::vector<uint32_t> adjacency(input.size());
+    std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+
+    for (size_t i = 0; i < input.size(); i++)
+        adjacency[fill[input[i]]++] = uint32_t(i / 3);
+
+    std::vector<int>   cache_position(vertex_count, -1);
+    std::vector<float> scores(vertex_count);
+
+    for (size_t v = 0; v < vertex_count; v++)
+        scores[v] = vertex_score(-1, live[v]);
+
+    std::vector<float> triangle_scores(triangle_count);
+    std::vector<bool>  emitted(triangle_count, false);
+
+    for (size_t t = 0; t < triangle_count; t++)
+        triangle_scores[t] = scores[input[t * 3]] + scores[input[t * 3 + 1]] + scores[input[t * 3 + 2]];
+
+    uint32_t cache[SCORE_CACHE_SIZE + 3];
+    uint32_t new_cache[SCORE_CACHE_SIZE + 3];
+    int      cache_count = 0;
+    size_t   next_input  = 0;
+
+    for (size_t output = 0; output < triangle_count; output++)
+    {
+        // Best triangle touching the cache. When the cache holds nothing useful the search restarts from the next
+        // triangle in input order, which keeps the cost linear.
+        uint32_t best       = ~0u;
+        float    best_score = -1.0f;
+
+        for (int i = 0; i < cache_count; i++)
+        {
+            uint32_t v = cache[i];
+
+            for (uint32_t j = offsets[v]; j < offsets[v] + live[v]; j++)
+            {
+                uint32_t t = adjacency[j];
+
+                if (triangle_scores[t] > best_score)
+                {
+                    best       = t;
+                    best_score = triangle_scores[t];
+                }
+            }
+        }
+
+        if (best == ~0u)
+        {
+            while (emitted[next_input])
+                next_input++;
+
+            best = uint32_t(next_input);
+        }
+
+        const uint32_t* triangle = &input[best * 3];
+
+        destination[output * 3]     = triangle[0];
+        destination[output * 3 + 1] = triangle[1];
+        destination[output * 3 + 2] = triangle[2];
+        emitted[best]               = true;
+
+        for (int k = 0; k < 3; k++)
+        {
+            uint32_t  v     = triangle[k];
+            uint32_t* begin = &adjacency[offsets[v]];
+            uint32_t* end   = begin + live[v];
+
+            *std::find(begin, end, best) = *(end - 1);
+            live[v]--;
+        }
+
+        // The triangle moves to the front of the LRU cache, the rest keeps its order.
+        int new_count = 0;
+
+        for (int k = 0; k < 3; k++)
+            new_cache[new_count++] = triangle[k];
+
+        for (int i = 0; i < cache_count; i++)
+        {
+            uint32_t v = cache[i];
+
+            if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+                new_cache[new_count++] = v;
+        }
+
+        for (int i = 0; i < new_count; i++)
+        {
+            uint32_t v        = new_cache[i];
+            cache_position[v] = i < SCORE_CACHE_SIZE ? i : -1;
+            scores[v]         = vertex_score(cache_position[v], live[v]);
+        }
+
+        for (int i = 0; i < new_count; i++)
+        {
+            uint32_t v = new_cache[i];
+
+            for (uint32_t j = offsets[v]; j < offsets[v] + live[v]; j++)
+            {
+                uint32_t t         = adjacency[j];
+                triangle_scores[t] = scores[input[t * 3]] + scores[input[t * 3 + 1]] + scores[input[t * 3 + 2]];
+            }
+        }
+
+        cache_count = std::min(new_count, SCORE_CACHE_SIZE);
+        memcpy(cache, new_cache, sizeof(uint32_t) * cache_count);
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void optimize_overdraw(uint32_t* destination, const uint32_t* indices, size_t index_count, const float* positions, size_t stride, size_t vertex_count, float threshold)
+{
+    size_t triangle_count = index_count / 3;
+
+    if (triangle_count == 0)
+        return;
+
+    std::vector<uint32_t> input(indices, indices + triangle_count * 3);
+    std::vector<uint8_t>  misses;
+
+    simulate_fifo_cache(input.data(), input.size(), vertex_count, misses);
+
+    // A triangle that misses on all three vertices starts a hard cluster, which can move without costing anything.
+    std::vector<uint32_t> hard_clusters;
+
+    for (size_t t = 0; t < triangle_count; t++)
+    {
+        if (t == 0 || misses[t] == 3)
+            hard_clusters.push_back(uint32_t(t));
+    }
+
+    hard_clusters.push_back(uint32_t(triangle_count));
+
+    // Hard clusters are split further wherever the piece so far, simulated from a cold cache, stays within the
+    // threshold of the ACMR of the whole hard cluster. Every piece then starts cold at no more than that cost.
+    std::vector<uint32_t> timestamps(vertex_count, 0);
+    uint32_t              time = VERTEX_CACHE_FIFO_SIZE + 1;
+    std::vector<uint32_t> clusters;
+
+    for (size_t h = 0; h + 1 < hard_clusters.size(); h++)
+    {
+        uint32_t begin        = hard_clusters[h];
+        uint32_t end          = hard_clusters[h + 1];
+        size_t   total_misses = 0;
+
+        for (uint32_t t = begin; t < end; t++)
+            total_misses += misses[t];
+
+        float    limit          = threshold * float(total_misses) / float(end - begin);
+        uint32_t cluster_begin  = begin;
+        size_t   cluster_misses = 0;
+
+        clusters.push_back(begin);
+
+        for (uint32_t t = begin; t < end; t++)
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                uint32_t v = input[t * 3 + k];
+
+                if (time - timestamps[v] > VERTEX_CACHE_FIFO_SIZE)
+                {
+                    timestamps[v] = time++;
+                    cluster_misses++;
+                }
+            }
+
+            if (t + 1 < end && float(cluster_misses) <= limit * float(t + 1 - cluster_begin))
+            {
+                clusters.push_back(t + 1);
+                cluster_begin  = t + 1;
+                cluster_misses = 0;
+                time += VERTEX_CACHE_FIFO_SIZE + 1;
+            }
+        }
+    }
+
+    clusters.push_back(uint32_t(triangle_count));
+
+    auto position = [&](uint32_t v) { return (const float*)((const uint8_t*)positions + v * stride); };
+
+    float mesh_center[3] = { 0.0f, 0.0f, 0.0f };
+
+    for (size_t v = 0; v < vertex_count; v++)
+    {
+        for (int k = 0; k < 3; k++)
+            mesh_center[k] += position(uint32_t(v))[k] / float(vertex_count);
+    }
+
+    // Area weighted centroid and normal of every cluster.
+    size_t             cluster_count = clusters.size() - 1;
+    std::vector<float> sort_keys(cluster_count);
+
+    for (size_t c = 0; c < cluster_count; c++)
+    {
+        float center[3] = { 0.0f, 0.0f, 0.0f };
+        float normal[3] = { 0.0f, 0.0f, 0.0f };
+        float area      = 0.0f;
+
+        for (uint32_t t = clusters[c]; t < clusters[c + 1]; t++)
+        {
+            const float* p0 = position(input[t * 3]);
+            const float* p1 = position(input[t * 3 + 1]);
+            const float* p2 = position(input[t * 3 + 2]);
+
+            float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+            float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+            float n[3]  = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+            float a     = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+            for (int k = 0; k < 3; k++)
+            {
+                center[k] += (p0[k] + p1[k] + p2[k]) * (a / 3.0f);
+                normal[k] += n[k];
+            }
+
+            area += a;
+        }
+
+        float length = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        float key    = 0.0f;
+
+        if (area > 0.0f && length > 0.0f)
+        {
+            for (int k = 0; k < 3; k++)
+                key += (center[k] / area - mesh_center[k]) * (normal[k] / length);
+        }
+
+        sort_keys[c] = key;
+    }
+
+    std::vector<uint32_t> order(cluster_count);
+
+    for (size_t c = 0; c < cluster_count; c++)
+        order[c] = uint32_t(c);
+
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return sort_keys[a] > sort_keys[b]; });
+
+    size_t output = 0;
+
+    for (uint32_t c : order)
+    {
+        size_t begin = clusters[c] * 3;
+        size_t end   = clusters[c + 1] * 3;
+
+        memcpy(destination + output, &input[begin], sizeof(uint32_t) * (end - begin));
+        output += end - begin;
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+size_t optimize_vertex_fetch_remap(uint32_t* remap, const uint32_t* indices, size_t index_count, size_t vertex_count)
+{
+    std::fill(remap, remap + vertex_count, ~0u);
+
+    uint32_t next = 0;
+
+    for (size_t i = 0; i < index_count; i++)
+    {
+        if (remap[indices[i]] == ~0u)
+            remap[indices[i]] = next++;
+    }
+
+    return next;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+float average_cache_miss_ratio(const uint32_t* indices, size_t index_count, size_t vertex_count)
+{
+    if (index_count < 3)
+        return 0.0f;
+
+    std::vector<uint8_t> misses;
+    simulate_fifo_cache(indices, index_count, vertex_count, misses);
+
+    size_t total = 0;
+
+    for (uint8_t m : misses)
+        total += m;
+
+    return float(total) / float(index_count / 3);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static uint16_t quantize_unorm16(float v)
+{
+    return uint16_t(std::min(std::max(v, 0.0f), 1.0f) * 65535.0f + 0.5f);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static int16_t quantize_snorm16(float v)
+{
+    return int16_t(roundf(std::min(std::max(v, -1.0f), 1.0f) * 32767.0f));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void quantize_vertices(QuantizedVertex* destination, VertexQuantization* quantization, const float* positions, const float* normals, const float* texcoords, size_t stride, size_t vertex_count)
+{
+    auto attribute = [&](const float* base, size_t v) { return (const float*)((const uint8_t*)base + v * stride); };
+
+    float position_min[3] = { INFINITY, INFINITY, INFINITY };
+    float position_max[3] = { -INFINITY, -INFINITY, -INFINITY };
+    float texcoord_min[2] = { INFINITY, INFINITY };
+    float texcoord_max[2] = { -INFINITY, -INFINITY };
+
+    for (size_t v = 0; v < vertex_count; v++)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            position_min[k] = std::min(position_min[k], attribute(positions, v)[k]);
+            position_max[k] = std::max(position_max[k], attribute(positions, v)[k]);
+        }
+
+        for (int k = 0; k < 2; k++)
+        {
+            texcoord_min[k] = std::min(texcoord_min[k], attribute(texcoords, v)[k]);
+            texcoord_max[k] = std::max(texcoord_max[k], attribute(texcoords, v)[k]);
+        }
+    }
+
+    for (int k = 0; k < 3; k++)
+    {
+        quantization->position_offset[k] = vertex_count > 0 ? position_min[k] : 0.0f;
+        quantization->position_scale[k]  = vertex_count > 0 && position_max[k] > position_min[k] ? position_max[k] - position_min[k] : 1.0f;
+    }
+
+    for (int k = 0; k < 2; k++)
+    {
+        quantization->texcoord_offset[k] = vertex_count > 0 ? texcoord_min[k] : 0.0f;
+        quantization->texcoord_scale[k]  = vertex_count > 0 && texcoord_max[k] > texcoord_min[k] ? texcoord_max[k] - texcoord_min[k] : 1.0f;
+    }
+
+    for (size_t v = 0; v < vertex_count; v++)
+    {
+        QuantizedVertex& out = destination[v];
+        const float*     p   = attribute(positions, v);
+        const float*     n   = attribute(normals, v);
+        const float*     uv  = attribute(texcoords, v);
+
+        for (int k = 0; k < 3; k++)
+            out.position[k] = quantize_unorm16((p[k] - quantization->position_offset[k]) / quantization->position_scale[k]);
+
+        out.position[3] = 0;
+
+        // Octahedral encoding: project onto the octahedron, then fold the lower hemisphere over the diagonals.
+        float l1 = fabsf(n[0]) + fabsf(n[1]) + fabsf(n[2]);
+        float x  = l1 > 0.0f ? n[0] / l1 : 0.0f;
+        float y  = l1 > 0.0f ? n[1] / l1 : 0.0f;
+
+        if (n[2] < 0.0f)
+        {
+            float fx = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+            float fy = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+            x        = fx;
+            y        = fy;
+        }
+
+        out.normal[0] = quantize_snorm16(x);
+        out.normal[1] = quantize_snorm16(y);
+
+        for (int k = 0; k < 2; k++)
+            out.texcoord[k] = quantize_unorm16((uv[k] - quantization->texcoord_offset[k]) / quantization->texcoord_scale[k]);
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
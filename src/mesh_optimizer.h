@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Load-time mesh processing: triangle ordering for the post-transform vertex cache and overdraw, vertex ordering for
+// fetch locality and vertex quantization. Indices are local to the vertex range they are passed with.
+
+// Size of the FIFO cache simulated to find cluster boundaries and to report ACMR. Small enough to be conservative on
+// every GPU in use.
+#define VERTEX_CACHE_FIFO_SIZE 16
+
+// Reorders the triangles of 'indices' to maximise post-transform vertex cache hits (Forsyth, "Linear-Speed Vertex
+// Cache Optimisation"). 'destination' may alias 'indices'.
+void optimize_vertex_cache(uint32_t* destination, const uint32_t* indices, size_t index_count, size_t vertex_count);
+
+// Reorders the clusters of an index buffer already optimised for the vertex cache so that triangles facing out of the
+// mesh are drawn first (Sander et al., "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw"). Clusters
+// are split wherever doing so keeps the ACMR within 'threshold' times that of the input. 'positions' holds
+// 'vertex_count' float3 positions 'stride' bytes apart. 'destination' may alias 'indices'.
+void optimize_overdraw(uint32_t* destination, const uint32_t* indices, size_t index_count, const float* positions, size_t stride, size_t vertex_count, float threshold);
+
+// Fills 'remap' with the new position of every vertex when vertices are stored in the order the indices first use them.
+// Unreferenced vertices are mapped to ~0u. Returns the number of referenced vertices.
+size_t optimize_vertex_fetch_remap(uint32_t* remap, const uint32_t* indices, size_t index_count, size_t vertex_count);
+
+// Average number of vertex shader invocations per triangle for a FIFO cache of VERTEX_CACHE_FIFO_SIZE entries.
+float average_cache_miss_ratio(const uint32_t* indices, size_t index_count, size_t vertex_count);
+
+// 16 bytes instead of the 56 of an unpacked vertex. Matches the attribute layout decoded in shader/mesh_vs.glsl.
+struct QuantizedVertex
+{
+    uint16_t position[4]; // unorm16 within the bounds of the mesh, w unused.
+    int16_t  normal[2];   // snorm16 octahedral encoding.
+    uint16_t texcoord[2]; // unorm16 within the texcoord bounds of the mesh.
+};
+
+// Decodes a quantized vertex: value = offset + unorm * scale.
+struct VertexQuantization
+{
+    float position_offset[3];
+    float position_scale[3];
+    float texcoord_offset[2];
+    float texcoord_scale[2];
+};
+
+// Packs 'vertex_count' vertices whose attributes are 'stride' bytes apart and fills in the transform to decode them.
+void quantize_vertices(QuantizedVertex* destination, VertexQuantization* quantization, const float* positions, const float* normals, const float* texcoords, size_t stride, size_t vertex_count);
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+// Runs func(i) for every i in [0, count) on 'num_threads' threads, the calling one included. Indices are handed out
+// one at a time from a shared counter, so a thread that finishes its task early immediately picks up the next one and
+// uneven task costs balance out without any per-thread queues.
+template <typename F>
+void parallel_for(uint32_t count, uint32_t num_threads, F func)
+{
+    std::atomic<uint32_t> next(0);
+
+    auto worker = [&]() {
+        uint32_t i;
+
+        while ((i = next.fetch_add(1)) < count)
+            func(i);
+    };
+
+    std::vector<std::thread> threads;
+
+    for (uint32_t i = 1; i < num_threads; i++)
+        threads.emplace_back(worker);
+
+    worker();
+
+    for (auto& thread : threads)
+        thread.join();
+}
@@ -0,0 +1,368 @@
+#include "prefilter_cpu.h"
+#include "parallel.h"
+#include <algorithm>
+#define _USE_MATH_DEFINES
+#include <math.h>
+
+#define POS_X 0
+#define NEG_X 1
+#define POS_Y 2
+#define NEG_Y 3
+#define POS_Z 4
+#define NEG_Z 5
+
+namespace
+{
+// Samples of one mip that survive the NdotL test. With V = R = N every per-sample term of prefilter_cs.glsl only depends
+// on the tangent space half vector, so they are evaluated once per mip instead of once per texel. Stored as separate
+// arrays so that rotating them into world space vectorizes.
+struct MipSamples
+{
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> z;
+    std::vector<float> weight;
+    std::vector<float> lod;
+    float              total_weight = 0.0f;
+};
+
+struct PrefilterTask
+{
+    uint32_t mip;
+    uint32_t face;
+    uint32_t x;
+    uint32_t y;
+};
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+float radical_inverse_vdc(uint32_t bits)
+{
+    bits = (bits << 16u) | (bits >> 16u);
+    bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+    bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+    bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+    bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+    return float(bits) * 2.3283064365386963e-10; // / 0x100000000
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+glm::vec2 hammersley(uint32_t i, uint32_t N)
+{
+    return glm::vec2(float(i) / float(N), radical_inverse_vdc(i));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Unnormalized direction through face coordinates 's' and 't' in [-1, 1]. Same mapping as calculate_direction() in
+// prefilter_cs.glsl, and valid slightly outside the face as well.
+glm::vec3 face_direction(uint32_t face, float s, float t)
+{
+    switch (face)
+    {
+        case POS_X:
+            return glm::vec3(1.0f, -t, -s);
+        case NEG_X:
+            return glm::vec3(-1.0f, -t, s);
+        case POS_Y:
+            return glm::vec3(s, 1.0f, t);
+        case NEG_Y:
+            return glm::vec3(s, -1.0f, -t);
+        case POS_Z:
+            return glm::vec3(s, -t, 1.0f);
+        default:
+            return glm::vec3(-s, -t, -1.0f);
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Inverse of face_direction(), with the major axis rules of the GL specification. 's' and 't' are returned in [0, 1].
+uint32_t direction_face(const glm::vec3& d, float& s, float& t)
+{
+    float ax = fabsf(d.x);
+    float ay = fabsf(d.y);
+    float az = fabsf(d.z);
+
+    uint32_t face;
+    float    sc, tc, ma;
+
+    if (ax >= ay && ax >= az)
+    {
+        face = d.x > 0.0f ? POS_X : NEG_X;
+        sc   = d.x > 0.0f ? -d.z : d.z;
+        tc   = -d.y;
+        ma   = ax;
+    }
+    else if (ay >= az)
+    {
+        face = d.y > 0.0f ? POS_Y : NEG_Y;
+        sc   = d.x;
+        tc   = d.y > 0.0f ? d.z : -d.z;
+        ma   = ay;
+    }
+    else
+    {
+        face = d.z > 0.0f ? POS_Z : NEG_Z;
+        sc   = d.z > 0.0f ? d.x : -d.x;
+        tc   = -d.y;
+        ma   = az;
+    }
+
+    s = 0.5f * (sc / ma + 1.0f);
+    t = 0.5f * (tc / ma + 1.0f);
+
+    return face;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Texel fetch that wraps onto the adjacent face when (x, y) lies just outside 'face'.
+glm::vec3 fetch(const CpuCubemap& cubemap, uint32_t mip, uint32_t face, int32_t x, int32_t y)
+{
+    int32_t size = int32_t(cubemap.mip_size(mip));
+
+    if (x < 0 || y < 0 || x >= size || y >= size)
+    {
+        float     s = (float(x) + 0.5f) / float(size) * 2.0f - 1.0f;
+        float     t = (float(y) + 0.5f) / float(size) * 2.0f - 1.0f;
+        glm::vec3 d = face_direction(face, s, t);
+
+        face = direction_face(d, s, t);
+        x    = std::min(std::max(int32_t(s * float(size)), 0), size - 1);
+        y    = std::min(std::max(int32_t(t * float(size)), 0), size - 1);
+    }
+
+    return glm::vec3(cubemap.face(mip, face)[y * size + x]);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+glm::vec3 sample_bilinear(const CpuCubemap& cubemap, uint32_t mip, uint32_t face, float s, float t)
+{
+    float size = float(cubemap.mip_size(mip));
+    float x    = s * size - 0.5f;
+    float y    = t * size - 0.5f;
+    float fx   = floorf(x);
+    float fy   = floorf(y);
+    float tx   = x - fx;
+    float ty   = y - fy;
+
+    int32_t x0 = int32_t(fx);
+    int32_t y0 = int32_t(fy);
+
+    glm::vec3 a = fetch(cubemap, mip, face, x0, y0) * (1.0f - tx) + fetch(cubemap, mip, face, x0 + 1, y0) * tx;
+    glm::vec3 b = fetch(cubemap, mip, face, x0, y0 + 1) * (1.0f - tx) + fetch(cubemap, mip, face, x0 + 1, y0 + 1) * tx;
+
+    return a * (1.0f - ty) + b * ty;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+MipSamples prepare_samples(uint32_t sample_count, float roughness, float resolution, uint32_t start_mip)
+{
+    std::vector<glm::vec4> directions(sample_count);
+    prefilter_sample_directions(roughness, sample_count, directions.data());
+
+    float a        = roughness * roughness;
+    float a2       = a * a;
+    float sa_texel = 4.0f * float(M_PI) / (6.0f * resolution * resolution);
+
+    MipSamples samples;
+
+    for (uint32_t i = 0; i < sample_count; i++)
+    {
+        glm::vec3 H = glm::vec3(directions[i]);
+        glm::vec3 L = glm::normalize(2.0f * H.z * H - glm::vec3(0.0f, 0.0f, 1.0f));
+
+        float NdotL = std::max(L.z, 0.0f);
+
+        if (NdotL <= 0.0f)
+            continue;
+
+        float NdotH = std::max(H.z, 0.0f);
+        float denom = NdotH * NdotH * (a2 - 1.0f) + 1.0f;
+        float D     = a2 / (float(M_PI) * denom * denom);
+        float pdf   = D * NdotH / (4.0f * NdotH) + 0.0001f;
+
+        float sa_sample = 1.0f / (float(sample_count) * pdf + 0.0001f);
+        float mip_level = roughness == 0.0f ? 0.0f : 0.5f * log2f(sa_sample / sa_texel);
+
+        samples.x.push_back(L.x);
+        samples.y.push_back(L.y);
+        samples.z.push_back(L.z);
+        samples.weight.push_back(NdotL);
+        samples.lod.push_back(float(start_mip) + mip_level);
+        samples.total_weight += NdotL;
+    }
+
+    return samples;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void prefilter_tile(const CpuCubemap& env, const MipSamples& samples, const PrefilterTask& task, CpuCubemap& prefiltered)
+{
+    uint32_t   size  = prefiltered.mip_size(task.mip);
+    uint32_t   end_x = std::min(task.x + PREFILTER_CPU_TILE_SIZE, size);
+    uint32_t   end_y = std::min(task.y + PREFILTER_CPU_TILE_SIZE, size);
+    glm::vec4* out   = prefiltered.face(task.mip, task.face);
+    size_t     count = samples.weight.size();
+
+    std::vector<float> dx(count);
+    std::vector<float> dy(count);
+    std::vector<float> dz(count);
+
+    for (uint32_t y = task.y; y < end_y; y++)
+    {
+        for (uint32_t x = task.x; x < end_x; x++)
+        {
+            float     s = (float(x) + 0.5f) / float(size) * 2.0f - 1.0f;
+            float     t = (float(y) + 0.5f) / float(size) * 2.0f - 1.0f;
+            glm::vec3 N = glm::normalize(face_direction(task.face, s, t));
+
+            glm::vec3 up        = fabsf(N.z) < 0.999f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+            glm::vec3 tangent   = glm::normalize(glm::cross(up, N));
+            glm::vec3 bitangent = glm::cross(N, tangent);
+
+            // Rotate every sample into world space in one branch-free pass over the arrays.
+            for (size_t i = 0; i < count; i++)
+            {
+                dx[i] = tangent.x * samples.x[i] + bitangent.x * samples.y[i] + N.x * samples.z[i];
+                dy[i] = tangent.y * samples.x[i] + bitangent.y * samples.y[i] + N.y * samples.z[i];
+                dz[i] = tangent.z * samples.x[i] + bitangent.z * samples.y[i] + N.z * samples.z[i];
+            }
+
+            glm::vec3 color = glm::vec3(0.0f);
+
+            for (size_t i = 0; i < count; i++)
+                color += env.sample(glm::vec3(dx[i], dy[i], dz[i]), samples.lod[i]) * samples.weight[i];
+
+            out[y * size + x] = glm::vec4(color / samples.total_weight, 1.0f);
+        }
+    }
+}
+} // namespace
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void CpuCubemap::resize(uint32_t new_size, uint32_t mip_count)
+{
+    size = new_size;
+    mips.resize(mip_count);
+
+    for (uint32_t mip = 0; mip < mip_count; mip++)
+        mips[mip].resize(6 * size_t(mip_size(mip)) * mip_size(mip));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void CpuCubemap::generate_mipmaps(uint32_t num_threads)
+{
+    if (num_threads == 0)
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+
+    for (uint32_t mip = 1; mip < mips.size(); mip++)
+    {
+        parallel_for(6, num_threads, [&](uint32_t f) {
+            uint32_t         dst_size = mip_size(mip);
+            uint32_t         src_size = mip_size(mip - 1);
+            const glm::vec4* src      = face(mip - 1, f);
+            glm::vec4*       dst      = face(mip, f);
+
+            for (uint32_t y = 0; y < dst_size; y++)
+            {
+                for (uint32_t x = 0; x < dst_size; x++)
+                {
+                    const glm::vec4* row0 = src + (2 * y) * src_size + 2 * x;
+                    const glm::vec4* row1 = row0 + src_size;
+
+                    dst[y * dst_size + x] = (row0[0] + row0[1] + row1[0] + row1[1]) * 0.25f;
+                }
+            }
+        });
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+glm::vec3 CpuCubemap::sample(const glm::vec3& direction, float lod) const
+{
+    float    s, t;
+    uint32_t f = direction_face(direction, s, t);
+
+    lod = std::min(std::max(lod, 0.0f), float(mips.size() - 1));
+
+    uint32_t  mip0  = uint32_t(lod);
+    float     blend = lod - float(mip0);
+    glm::vec3 color = sample_bilinear(*this, mip0, f, s, t);
+
+    if (blend > 0.0f)
+        color = color * (1.0f - blend) + sample_bilinear(*this, mip0 + 1, f, s, t) * blend;
+
+    return color;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void prefilter_sample_directions(float roughness, uint32_t count, glm::vec4* directions)
+{
+    float a = roughness * roughness;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        glm::vec2 Xi = hammersley(i, count);
+
+        float phi       = 2.0f * M_PI * Xi.x;
+        float cos_theta = sqrt((1.0f - Xi.y) / (1.0f + (a * a - 1.0f) * Xi.y));
+        float sin_theta = sqrt(1.0f - cos_theta * cos_theta);
+
+        // from spherical coordinates to cartesian coordinates - halfway vector
+        glm::vec3 H;
+        H.x = cos(phi) * sin_theta;
+        H.y = sin(phi) * sin_theta;
+        H.z = cos_theta;
+
+        directions[i] = glm::vec4(H, 0.0f);
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void prefilter_cubemap_cpu(const CpuCubemap& env, uint32_t start_mip, uint32_t sample_count, CpuCubemap& prefiltered, uint32_t num_threads)
+{
+    if (num_threads == 0)
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+
+    uint32_t mip_count  = uint32_t(prefiltered.mips.size());
+    float    resolution = float(env.mip_size(start_mip));
+
+    std::vector<MipSamples>    samples(mip_count);
+    std::vector<PrefilterTask> tasks;
+
+    for (uint32_t mip = 0; mip < mip_count; mip++)
+    {
+        float roughness = mip_count > 1 ? float(mip) / float(mip_count - 1) : 0.0f;
+
+        samples[mip] = prepare_samples(sample_count, roughness, resolution, start_mip);
+
+        uint32_t size = prefiltered.mip_size(mip);
+
+        // Larger mips come first so that the small tail of the list fills the gaps at the end.
+        for (uint32_t face = 0; face < 6; face++)
+        {
+            for (uint32_t y = 0; y < size; y += PREFILTER_CPU_TILE_SIZE)
+            {
+                for (uint32_t x = 0; x < size; x += PREFILTER_CPU_TILE_SIZE)
+                    tasks.push_back({ mip, face, x, y });
+            }
+        }
+    }
+
+    parallel_for(uint32_t(tasks.size()), num_threads, [&](uint32_t i) {
+        prefilter_tile(env, samples[tasks[i].mip], tasks[i], prefiltered);
+    });
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
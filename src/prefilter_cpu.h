@@ -0,0 +1,40 @@
+#pragma once
+
+#include <ogl.h>
+#include <vector>
+
+// CPU port of shader/prefilter_cs.glsl for machines without a GPU. Produces the same prefiltered mip chain from the
+// same sample set, so its output can be uploaded to or compared against the GPU cubemap directly.
+
+// Edge length of the square tiles prefiltering is split into. Every (mip, face, tile) is one task.
+#define PREFILTER_CPU_TILE_SIZE 16
+
+// RGBA32F cubemap in system memory. Faces are stored in GL order (+X, -X, +Y, -Y, +Z, -Z) and texels in GL row order,
+// so a face can be passed to dw::TextureCube::set_data() or compared against glGetTexImage() output as is.
+struct CpuCubemap
+{
+    uint32_t                            size = 0;
+    std::vector<std::vector<glm::vec4>> mips;
+
+    void resize(uint32_t size, uint32_t mip_count);
+
+    // Box filters mip 0 into the rest of the chain.
+    void generate_mipmaps(uint32_t num_threads = 0);
+
+    // Trilinear lookup. Bilinear taps that fall off a face are fetched from the neighbouring face, which matches
+    // GL_TEXTURE_CUBE_MAP_SEAMLESS closely enough for prefiltering.
+    glm::vec3 sample(const glm::vec3& direction, float lod) const;
+
+    inline uint32_t   mip_size(uint32_t mip) const { return size >> mip; }
+    inline glm::vec4* face(uint32_t mip, uint32_t face) { return &mips[mip][size_t(face) * mip_size(mip) * mip_size(mip)]; }
+    inline const glm::vec4* face(uint32_t mip, uint32_t face) const { return &mips[mip][size_t(face) * mip_size(mip) * mip_size(mip)]; }
+};
+
+// GGX importance sampled half vectors in tangent space from a Hammersley sequence of 'count' points. This is the set
+// uploaded to u_SampleDirections for every prefilter mip.
+void prefilter_sample_directions(float roughness, uint32_t count, glm::vec4* directions);
+
+// Fills every mip of 'prefiltered', which has to be resized by the caller. 'env' must carry a full mip chain and
+// 'start_mip' is the level whose texel solid angle the sample LOD is relative to, as u_StartMipLevel on the GPU.
+// 'num_threads' of zero uses every hardware thread.
+void prefilter_cubemap_cpu(const CpuCubemap& env, uint32_t start_mip, uint32_t sample_count, CpuCubemap& prefiltered, uint32_t num_threads = 0);
@@ -0,0 +1,371 @@
+#include "probe_baker.h"
+#include "gpu_memory.h"
+#include "prefilter_cpu.h"
+#include "program_cache.h"
+#include "shader_permutations.h"
+#include <GLFW/glfw3.h>
+#include <logger.h>
+#include <chrono>
+#include <math.h>
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+ProbeBaker::~ProbeBaker()
+{
+    shutdown();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool ProbeBaker::initialize(const ProbeBakeLayout& layout)
+{
+    GLFWwindow* render_context = glfwGetCurrentContext();
+
+    if (!render_context)
+        return false;
+
+    m_layout = layout;
+
+    // The remaining hints still hold the values the render context was created with, so both get the same version.
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    m_context = glfwCreateWindow(1, 1, "Probe Baker", nullptr, render_context);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+
+    // Creating the window may have made its context current.
+    glfwMakeContextCurrent(render_context);
+
+    if (!m_context)
+    {
+        DW_LOG_ERROR("Failed to create a shared GL context for background baking");
+        return false;
+    }
+
+    m_stop   = false;
+    m_thread = std::thread(&ProbeBaker::worker, this);
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void ProbeBaker::shutdown()
+{
+    if (!m_context)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        m_stop = true;
+        m_jobs.clear();
+    }
+
+    m_jobs_cv.notify_all();
+    m_thread.join();
+
+    // Sync objects are shared, so the fences of bakes nobody picked up can be deleted here.
+    for (auto& completed : m_completed)
+    {
+        if (completed.fence)
+            glDeleteSync(completed.fence);
+    }
+
+    m_completed.clear();
+    m_pending = 0;
+
+    glfwDestroyWindow(m_context);
+    m_context = nullptr;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void ProbeBaker::submit(dw::Texture2D* source, const ProbeBakeSettings& settings, Callback callback)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_jobs.push_back({ source, settings, callback });
+    }
+
+    m_pending++;
+    m_jobs_cv.notify_one();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void ProbeBaker::update()
+{
+    while (true)
+    {
+        Completed completed;
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            if (m_completed.empty())
+                return;
+
+            // Bakes finish in submission order, so only the oldest one needs polling.
+            Completed& front = m_completed.front();
+
+            if (front.fence)
+            {
+                GLenum status = glClientWaitSync(front.fence, 0, 0);
+
+                if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+                    return;
+            }
+
+            completed = std::move(front);
+            m_completed.pop_front();
+        }
+
+        if (completed.fence)
+            glDeleteSync(completed.fence);
+
+        m_pending--;
+
+        if (completed.success)
+            completed.callback(completed.result);
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+size_t ProbeBaker::scratch_size() const
+{
+    size_t intermediate = gpu_texture_size(m_layout.sh_intermediate_size * 9, m_layout.sh_intermediate_size, 6, 1, GL_RGBA32F);
+    size_t samples      = sizeof(glm::vec4) * m_layout.max_samples * m_layout.prefilter_mips;
+
+    return intermediate + samples;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void ProbeBaker::worker()
+{
+    glfwMakeContextCurrent(m_context);
+
+    bool ready = create_programs();
+
+    while (true)
+    {
+        Job job;
+
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_jobs_cv.wait(lock, [&]() { return m_stop || !m_jobs.empty(); });
+
+            if (m_stop)
+                break;
+
+            job = m_jobs.front();
+            m_jobs.pop_front();
+        }
+
+        Completed completed;
+
+        auto start        = std::chrono::high_resolution_clock::now();
+        completed.success = ready && bake(job, completed.result);
+        auto end          = std::chrono::high_resolution_clock::now();
+
+        completed.result.time = std::chrono::duration<float, std::milli>(end - start).count();
+        completed.callback    = job.callback;
+
+        if (completed.success)
+        {
+            // Makes the image stores visible to the render context's texture fetches and readbacks once the fence has
+            // signalled. The flush gets the fence to the GPU without another context waiting on this one.
+            glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+            completed.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            glFlush();
+        }
+        else
+        {
+            DW_LOG_ERROR("Background probe bake failed");
+            completed.result = ProbeBakeResult();
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_completed.push_back(std::move(completed));
+    }
+
+    m_sample_directions.clear();
+    m_sh_intermediate.reset();
+    m_prefilter_permutations.reset();
+    m_sh_add_permutations.reset();
+    m_sh_projection_permutations.reset();
+    m_equirect_permutations.reset();
+    m_program_cache.reset();
+
+    glfwMakeContextCurrent(nullptr);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool ProbeBaker::create_programs()
+{
+    // Same base defines as the render thread's programs, so warm starts load the binaries it stored.
+    ShaderDefines equirect_defines;
+    equirect_defines.set("ENVIRONMENT_MAP_SIZE", int(m_layout.environment_size)).set("TILE_SIZE", int(m_layout.tile_size));
+
+    ShaderDefines sh_projection_defines;
+    sh_projection_defines.set("ENVIRONMENT_MAP_SIZE", int(m_layout.irradiance_size)).set("CUBEMAP_MIP_LEVEL", log2f(float(m_layout.environment_size / m_layout.irradiance_size)));
+
+    ShaderDefines prefilter_defines;
+    prefilter_defines.set("MAX_SAMPLES", int(m_layout.max_samples));
+
+    m_program_cache = std::make_unique<ProgramCache>();
+    m_program_cache->initialize(nullptr);
+
+    m_equirect_permutations      = std::make_unique<ShaderPermutations>(*m_program_cache, std::vector<ShaderStage>{ { GL_COMPUTE_SHADER, "shader/equirectangular_to_cubemap_cs.glsl" } }, equirect_defines);
+    m_sh_projection_permutations = std::make_unique<ShaderPermutations>(*m_program_cache, std::vector<ShaderStage>{ { GL_COMPUTE_SHADER, "shader/sh_projection_cs.glsl" } }, sh_projection_defines);
+    m_sh_add_permutations        = std::make_unique<ShaderPermutations>(*m_program_cache, std::vector<ShaderStage>{ { GL_COMPUTE_SHADER, "shader/sh_add_cs.glsl" } });
+    m_prefilter_permutations     = std::make_unique<ShaderPermutations>(*m_program_cache, std::vector<ShaderStage>{ { GL_COMPUTE_SHADER, "shader/prefilter_cs.glsl" } }, prefilter_defines);
+
+    m_sh_intermediate = std::make_unique<dw::Texture2D>(m_layout.sh_intermediate_size * 9, m_layout.sh_intermediate_size, 6, 1, 1, GL_RGBA32F, GL_RGBA, GL_FLOAT);
+
+    m_sh_intermediate->set_min_filter(GL_NEAREST);
+    m_sh_intermediate->set_mag_filter(GL_NEAREST);
+
+    for (uint32_t mip = 0; mip < m_layout.prefilter_mips; mip++)
+        m_sample_directions.push_back(std::make_unique<dw::UniformBuffer>(GL_DYNAMIC_DRAW, sizeof(glm::vec4) * m_layout.max_samples, nullptr));
+
+    if (!m_equirect_permutations->get())
+    {
+        DW_LOG_ERROR("Failed to create the background bake programs");
+        return false;
+    }
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool ProbeBaker::bake(const Job& job, ProbeBakeResult& result)
+{
+    result.env_cubemap = std::make_unique<dw::TextureCube>(m_layout.environment_size, m_layout.environment_size, 1, m_layout.environment_mips, GL_RGBA16F, GL_RGBA, GL_HALF_FLOAT);
+    result.prefiltered = std::make_unique<dw::TextureCube>(m_layout.prefilter_size, m_layout.prefilter_size, 1, m_layout.prefilter_mips, GL_RGBA16F, GL_RGBA, GL_HALF_FLOAT);
+    result.sh          = std::make_unique<dw::Texture2D>(9, 1, 1, 1, 1, GL_RGBA32F, GL_RGBA, GL_FLOAT);
+
+    result.sh->set_min_filter(GL_NEAREST);
+    result.sh->set_mag_filter(GL_NEAREST);
+
+    glBindTexture(GL_TEXTURE_CUBE_MAP, result.env_cubemap->id());
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, m_layout.environment_mips - 1);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+
+    ShaderProgram* equirect = m_equirect_permutations->get();
+
+    if (!equirect || !equirect->link())
+        return false;
+
+    equirect->use();
+
+    job.source->bind(0);
+    result.env_cubemap->bind_image(0, 0, 0, GL_WRITE_ONLY, GL_RGBA16F);
+
+    uint32_t tiles = m_layout.environment_size / m_layout.tile_size;
+
+    glDispatchCompute(tiles, tiles, 6);
+
+    // The rest of the chain is not worth the downsampler's work buffers here, the driver's filter is good enough.
+    glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT);
+    result.env_cubemap->generate_mipmaps();
+
+    return project_sh(job.settings, result) && prefilter(job.settings, result);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool ProbeBaker::project_sh(const ProbeBakeSettings& settings, ProbeBakeResult& result)
+{
+    const WorkgroupLayout& layout = settings.workgroups.sh_projection;
+
+    ShaderDefines projection_defines;
+    projection_defines.set("LOCAL_SIZE", layout.x).set("LOCAL_SIZE_Z", layout.z);
+
+    ShaderDefines add_defines;
+    add_defines.set("SH_INTERMEDIATE_SIZE", int(m_layout.irradiance_size) / layout.x);
+
+    ShaderProgram* projection = m_sh_projection_permutations->get(projection_defines);
+    ShaderProgram* add        = m_sh_add_permutations->get(add_defines);
+
+    if (!projection || !add || !projection->link() || !add->link())
+        return false;
+
+    projection->use();
+
+    projection->set_uniform("u_Width", float(m_layout.irradiance_size));
+    projection->set_uniform("u_Height", float(m_layout.irradiance_size));
+
+    if (projection->set_uniform("s_Cubemap", 1))
+        result.env_cubemap->bind(1);
+
+    m_sh_intermediate->bind_image(0, 0, 0, GL_WRITE_ONLY, GL_RGBA32F);
+
+    glDispatchCompute(m_layout.irradiance_size / layout.x, m_layout.irradiance_size / layout.y, 6 / layout.z);
+
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+    add->use();
+
+    result.sh->bind_image(0, 0, 0, GL_WRITE_ONLY, GL_RGBA32F);
+
+    if (add->set_uniform("s_SHIntermediate", 1))
+        m_sh_intermediate->bind(1);
+
+    glDispatchCompute(9, 1, 1);
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool ProbeBaker::prefilter(const ProbeBakeSettings& settings, ProbeBakeResult& result)
+{
+    const WorkgroupLayout& layout = settings.workgroups.prefilter;
+
+    ShaderDefines defines;
+    defines.set("LOCAL_SIZE_X", layout.x).set("LOCAL_SIZE_Y", layout.y).set("LOCAL_SIZE_Z", layout.z).set("MIP_BATCH", 1);
+
+    ShaderProgram* program = m_prefilter_permutations->get(defines);
+
+    if (!program || !program->link())
+        return false;
+
+    program->use();
+
+    if (program->set_uniform("s_EnvMap", 1))
+        result.env_cubemap->bind(1);
+
+    std::vector<glm::vec4> samples(m_layout.max_samples);
+
+    program->set_uniform("u_StartMipLevel", int32_t(m_layout.environment_size / m_layout.prefilter_size) - 1);
+    program->set_uniform("u_RoughnessStep", 1.0f / float(m_layout.prefilter_mips - 1));
+    program->set_uniform("u_SampleCount", settings.sample_count);
+
+    // One dispatch per mip, each flushed on its own, so that the driver can schedule the render context's frames in
+    // between instead of behind the whole bake.
+    for (uint32_t mip = 0; mip < m_layout.prefilter_mips; mip++)
+    {
+        float    roughness = float(mip) / float(m_layout.prefilter_mips - 1);
+        uint32_t mip_size  = m_layout.prefilter_size >> mip;
+
+        prefilter_sample_directions(roughness, settings.sample_count, samples.data());
+
+        m_sample_directions[mip]->set_data(0, sizeof(glm::vec4) * m_layout.max_samples, samples.data());
+        m_sample_directions[mip]->bind_base(0);
+
+        result.prefiltered->bind_image(0, mip, 0, GL_WRITE_ONLY, GL_RGBA16F);
+
+        program->set_uniform("u_Roughness", roughness);
+        program->set_uniform("u_Width", float(mip_size));
+
+        glDispatchCompute(workgroup_count(mip_size, layout.x), workgroup_count(mip_size, layout.y), 6 / layout.z);
+        glFlush();
+    }
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
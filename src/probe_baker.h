@@ -0,0 +1,115 @@
+#pragma once
+
+#include <ogl.h>
+#include "workgroup_tuning.h"
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct GLFWwindow;
+class ProgramCache;
+class ShaderPermutations;
+
+// Texture sizes of a baked probe. They match the textures of the render thread, so a result can replace them.
+struct ProbeBakeLayout
+{
+    uint32_t environment_size     = 512;
+    uint32_t environment_mips     = 9;
+    uint32_t irradiance_size      = 128; // Face size of the environment mip the SH is projected from.
+    uint32_t sh_intermediate_size = 16;
+    uint32_t prefilter_size       = 256;
+    uint32_t prefilter_mips       = 5;
+    uint32_t tile_size            = 64; // Of the equirectangular conversion.
+    uint32_t max_samples          = 64;
+};
+
+// Copied into the job, so the UI can change while a bake runs.
+struct ProbeBakeSettings
+{
+    WorkgroupConfig workgroups;
+    int32_t         sample_count = 64;
+};
+
+struct ProbeBakeResult
+{
+    std::unique_ptr<dw::TextureCube> env_cubemap;
+    std::unique_ptr<dw::TextureCube> prefiltered;
+    std::unique_ptr<dw::Texture2D>   sh;
+    float                            time = 0.0f; // Wall time of the job on the worker in milliseconds.
+};
+
+// Bakes probes from an equirectangular source on a worker thread with a hidden GL context that shares objects with the
+// render context. A bake converts the source, builds the mip chain, projects SH9 and prefilters every mip with GGX
+// importance sampling into textures of its own, so nothing the render thread uses is touched while it runs. Finished
+// bakes are fenced on the worker and handed to the render thread once the fence has signalled, which never waits on
+// them. The worker compiles its own programs, since uniform state lives in the program objects both contexts share.
+class ProbeBaker
+{
+public:
+    // Runs on the render thread. Takes ownership of the baked textures.
+    typedef std::function<void(ProbeBakeResult& result)> Callback;
+
+    ~ProbeBaker();
+
+    // Must be called on the thread owning the render context. Returns false if no shared context could be created.
+    bool initialize(const ProbeBakeLayout& layout);
+    void shutdown();
+
+    // 'source' must stay alive until the callback has run or shutdown() has returned.
+    void submit(dw::Texture2D* source, const ProbeBakeSettings& settings, Callback callback);
+
+    // Hands over the bakes whose fence has signalled. Never blocks.
+    void update();
+
+    // Memory of the worker's scratch textures and sample buffers, for the registry of the render thread.
+    size_t scratch_size() const;
+
+    inline bool     initialized() const { return m_context != nullptr; }
+    inline uint32_t pending() const { return m_pending; }
+
+private:
+    struct Job
+    {
+        dw::Texture2D*    source;
+        ProbeBakeSettings settings;
+        Callback          callback;
+    };
+
+    struct Completed
+    {
+        ProbeBakeResult result;
+        Callback        callback;
+        GLsync          fence   = nullptr;
+        bool            success = false;
+    };
+
+    void worker();
+    bool create_programs();
+    bool bake(const Job& job, ProbeBakeResult& result);
+    bool project_sh(const ProbeBakeSettings& settings, ProbeBakeResult& result);
+    bool prefilter(const ProbeBakeSettings& settings, ProbeBakeResult& result);
+
+private:
+    ProbeBakeLayout         m_layout;
+    GLFWwindow*             m_context = nullptr;
+    std::thread             m_thread;
+    std::mutex              m_mutex;
+    std::condition_variable m_jobs_cv;
+    std::deque<Job>         m_jobs;
+    std::deque<Completed>   m_completed;
+    bool                    m_stop    = false;
+    uint32_t                m_pending = 0; // Submitted and not handed over yet. Render thread only.
+
+    // Owned by the worker and only touched with its context current.
+    std::unique_ptr<ProgramCache>                   m_program_cache;
+    std::unique_ptr<ShaderPermutations>             m_equirect_permutations;
+    std::unique_ptr<ShaderPermutations>             m_sh_projection_permutations;
+    std::unique_ptr<ShaderPermutations>             m_sh_add_permutations;
+    std::unique_ptr<ShaderPermutations>             m_prefilter_permutations;
+    std::unique_ptr<dw::Texture2D>                  m_sh_intermediate;
+    std::vector<std::unique_ptr<dw::UniformBuffer>> m_sample_directions;
+};
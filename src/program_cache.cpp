@@ -0,0 +1,482 @@
+#include "program_cache.h"
+#include "disk_cache.h"
+#include "gl_state.h"
+#include <logger.h>
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <fstream>
+#include <string.h>
+
+#define PROGRAM_BINARY_MAGIC 0x4e494250 // 'PBIN'
+#define GLSL_VERSION "#version 430 core\n"
+#define MAX_INCLUDE_DEPTH 8
+
+typedef void(APIENTRY* MaxShaderCompilerThreadsFn)(GLuint count);
+
+struct ProgramBinaryHeader
+{
+    uint32_t magic;
+    uint32_t format;
+    uint64_t key;
+};
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static std::string directory_of(const std::string& path)
+{
+    size_t slash = path.find_last_of("/\\");
+    return slash == std::string::npos ? "" : path.substr(0, slash + 1);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+// Reads a shader and splices in '#include <file>' directives relative to the including file, matching the framework.
+static bool read_source(const std::string& path, std::string& source, int depth = 0)
+{
+    std::ifstream file(path);
+
+    if (!file.is_open() || depth > MAX_INCLUDE_DEPTH)
+    {
+        DW_LOG_ERROR("Failed to read shader: " + path);
+        return false;
+    }
+
+    std::string line;
+
+    while (std::getline(file, line))
+    {
+        size_t directive = line.find("#include");
+
+        if (directive != std::string::npos && line.find_first_not_of(" \t") == directive)
+        {
+            size_t begin = line.find_first_of("<\"", directive);
+            size_t end   = line.find_first_of(">\"", begin + 1);
+
+            if (begin == std::string::npos || end == std::string::npos)
+            {
+                DW_LOG_ERROR("Malformed include in shader: " + path);
+                return false;
+            }
+
+            if (!read_source(directory_of(path) + line.substr(begin + 1, end - begin - 1), source, depth + 1))
+                return false;
+        }
+        else
+            source += line + "\n";
+    }
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static std::string shader_log(GLuint shader)
+{
+    GLint length = 0;
+    glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+
+    std::string log(std::max(length, 1), '\0');
+    glGetShaderInfoLog(shader, length, nullptr, &log[0]);
+
+    return log;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static std::string program_log(GLuint program)
+{
+    GLint length = 0;
+    glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+
+    std::string log(std::max(length, 1), '\0');
+    glGetProgramInfoLog(program, length, nullptr, &log[0]);
+
+    return log;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+ShaderProgram::ShaderProgram(ProgramCache* cache, const std::string& name, uint64_t key) :
+    m_cache(cache), m_name(name), m_key(key)
+{
+    m_id = glCreateProgram();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+ShaderProgram::~ShaderProgram()
+{
+    if (m_pending)
+        m_cache->forget(this);
+
+    for (auto shader : m_shaders)
+        glDeleteShader(shader);
+
+    glDeleteProgram(m_id);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool ShaderProgram::link()
+{
+    if (!m_pending)
+        return m_linked;
+
+    m_pending = false;
+    m_cache->forget(this);
+
+    // Blocks until the driver has finished compiling and linking.
+    GLint status = GL_FALSE;
+    glGetProgramiv(m_id, GL_LINK_STATUS, &status);
+
+    m_linked = status == GL_TRUE;
+
+    if (!m_linked)
+    {
+        for (auto shader : m_shaders)
+        {
+            glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+
+            if (status != GL_TRUE)
+                DW_LOG_ERROR("Failed to compile " + m_name + ": " + shader_log(shader));
+        }
+
+        DW_LOG_ERROR("Failed to link " + m_name + ": " + program_log(m_id));
+    }
+
+    for (auto shader : m_shaders)
+    {
+        glDetachShader(m_id, shader);
+        glDeleteShader(shader);
+    }
+
+    m_shaders.clear();
+
+    if (m_linked)
+        m_cache->store_binary(this);
+
+    return m_linked;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void ShaderProgram::use()
+{
+    link();
+
+    if (!m_cache->m_state || m_cache->m_state->use_program(m_id))
+        glUseProgram(m_id);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void ShaderProgram::uniform_block_binding(const std::string& name, int binding)
+{
+    link();
+
+    GLuint index = glGetUniformBlockIndex(m_id, name.c_str());
+
+    if (index != GL_INVALID_INDEX)
+        glUniformBlockBinding(m_id, index, binding);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+GLint ShaderProgram::location(const std::string& name)
+{
+    if (m_cache->m_state)
+        m_cache->m_state->count_uniform_update();
+
+    auto it = m_locations.find(name);
+
+    if (it != m_locations.end())
+        return it->second;
+
+    link();
+
+    GLint location    = glGetUniformLocation(m_id, name.c_str());
+    m_locations[name] = location;
+
+    return location;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool ShaderProgram::set_uniform(const std::string& name, int value)
+{
+    GLint loc = location(name);
+
+    if (loc == -1)
+        return false;
+
+    glProgramUniform1i(m_id, loc, value);
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool ShaderProgram::set_uniform(const std::string& name, float value)
+{
+    GLint loc = location(name);
+
+    if (loc == -1)
+        return false;
+
+    glProgramUniform1f(m_id, loc, value);
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool ShaderProgram::set_uniform(const std::string& name, const glm::vec2& value)
+{
+    GLint loc = location(name);
+
+    if (loc == -1)
+        return false;
+
+    glProgramUniform2f(m_id, loc, value.x, value.y);
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool ShaderProgram::set_uniform(const std::string& name, const glm::vec3& value)
+{
+    GLint loc = location(name);
+
+    if (loc == -1)
+        return false;
+
+    glProgramUniform3f(m_id, loc, value.x, value.y, value.z);
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool ShaderProgram::set_uniform(const std::string& name, const glm::vec4& value)
+{
+    GLint loc = location(name);
+
+    if (loc == -1)
+        return false;
+
+    glProgramUniform4f(m_id, loc, value.x, value.y, value.z, value.w);
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool ShaderProgram::set_uniform(const std::string& name, const glm::mat3& value)
+{
+    GLint loc = location(name);
+
+    if (loc == -1)
+        return false;
+
+    glProgramUniformMatrix3fv(m_id, loc, 1, GL_FALSE, &value[0][0]);
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool ShaderProgram::set_uniform(const std::string& name, const glm::mat4& value)
+{
+    GLint loc = location(name);
+
+    if (loc == -1)
+        return false;
+
+    glProgramUniformMatrix4fv(m_id, loc, 1, GL_FALSE, &value[0][0]);
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void ProgramCache::initialize(GLState* state)
+{
+    m_state = state;
+
+    const char* strings[] = { (const char*)glGetString(GL_VENDOR), (const char*)glGetString(GL_RENDERER), (const char*)glGetString(GL_VERSION) };
+
+    m_driver_hash = disk_cache::hash(GLSL_VERSION);
+
+    for (auto str : strings)
+        m_driver_hash = disk_cache::hash(str ? str : "", m_driver_hash);
+
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+
+    m_binary_supported = formats > 0;
+
+    if (!m_binary_supported)
+        DW_LOG_WARNING("Driver exposes no program binary formats, shaders will be compiled on every start");
+
+    GLint extensions = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &extensions);
+
+    for (GLint i = 0; i < extensions && !m_parallel_compile; i++)
+    {
+        const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+
+        if (strcmp(extension, "GL_KHR_parallel_shader_compile") == 0 || strcmp(extension, "GL_ARB_parallel_shader_compile") == 0)
+        {
+            bool khr = extension[3] == 'K';
+
+            MaxShaderCompilerThreadsFn max_threads = (MaxShaderCompilerThreadsFn)glfwGetProcAddress(khr ? "glMaxShaderCompilerThreadsKHR" : "glMaxShaderCompilerThreadsARB");
+
+            // Let the driver pick as many compiler threads as it likes.
+            if (max_threads)
+            {
+                max_threads(0xFFFFFFFF);
+                m_parallel_compile = true;
+            }
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+std::unique_ptr<ShaderProgram> ProgramCache::create(const std::vector<ShaderStage>& stages, const std::vector<std::string>& defines)
+{
+    std::string              name;
+    std::vector<std::string> sources;
+    uint64_t                 key = m_driver_hash;
+
+    for (const auto& stage : stages)
+    {
+        std::string source = GLSL_VERSION;
+
+        for (const auto& define : defines)
+            source += "#define " + define + "\n";
+
+        if (!read_source(stage.path, source))
+            return nullptr;
+
+        key = disk_cache::hash(&stage.type, sizeof(GLenum), key);
+        key = disk_cache::hash(source, key);
+
+        name += (name.empty() ? "" : " + ") + stage.path;
+        sources.push_back(source);
+    }
+
+    for (const auto& define : defines)
+        name += " " + define;
+
+    m_program_count++;
+
+    std::unique_ptr<ShaderProgram> program(new ShaderProgram(this, name, key));
+
+    if (load_binary(program.get()))
+    {
+        m_cached_count++;
+        return program;
+    }
+
+    for (uint32_t i = 0; i < stages.size(); i++)
+    {
+        const char* source = sources[i].c_str();
+        GLuint      shader = glCreateShader(stages[i].type);
+
+        glShaderSource(shader, 1, &source, nullptr);
+        glCompileShader(shader);
+        glAttachShader(program->m_id, shader);
+
+        program->m_shaders.push_back(shader);
+    }
+
+    if (m_binary_supported)
+        glProgramParameteri(program->m_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
+    // Compile status is deliberately not queried here so that the driver can keep working while the caller does
+    // something else. link() picks up the result.
+    glLinkProgram(program->m_id);
+
+    program->m_pending = true;
+    m_pending.push_back(program.get());
+
+    return program;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool ProgramCache::finish()
+{
+    bool success = true;
+
+    while (!m_pending.empty())
+        success &= m_pending.front()->link();
+
+    return success;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool ProgramCache::load_binary(ShaderProgram* program)
+{
+    std::vector<uint8_t> data;
+
+    if (!m_binary_supported || !disk_cache::read(disk_cache::path("program_" + disk_cache::to_hex(program->m_key) + ".bin"), data))
+        return false;
+
+    if (data.size() <= sizeof(ProgramBinaryHeader))
+        return false;
+
+    ProgramBinaryHeader header;
+    memcpy(&header, data.data(), sizeof(ProgramBinaryHeader));
+
+    if (header.magic != PROGRAM_BINARY_MAGIC || header.key != program->m_key)
+        return false;
+
+    glProgramBinary(program->m_id, header.format, data.data() + sizeof(ProgramBinaryHeader), GLsizei(data.size() - sizeof(ProgramBinaryHeader)));
+
+    // Drivers reject binaries from other driver builds, in which case we fall back to compiling.
+    GLint status = GL_FALSE;
+    glGetProgramiv(program->m_id, GL_LINK_STATUS, &status);
+
+    program->m_linked     = status == GL_TRUE;
+    program->m_from_cache = program->m_linked;
+
+    return program->m_linked;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void ProgramCache::store_binary(ShaderProgram* program)
+{
+    if (!m_binary_supported)
+        return;
+
+    GLint length = 0;
+    glGetProgramiv(program->m_id, GL_PROGRAM_BINARY_LENGTH, &length);
+
+    if (length <= 0)
+        return;
+
+    std::vector<uint8_t> data(sizeof(ProgramBinaryHeader) + length);
+    GLenum               format = 0;
+
+    glGetProgramBinary(program->m_id, length, nullptr, &format, data.data() + sizeof(ProgramBinaryHeader));
+
+    ProgramBinaryHeader header = { PROGRAM_BINARY_MAGIC, format, program->m_key };
+    memcpy(data.data(), &header, sizeof(ProgramBinaryHeader));
+
+    if (!disk_cache::write(disk_cache::path("program_" + disk_cache::to_hex(program->m_key) + ".bin"), data.data(), data.size()))
+        DW_LOG_WARNING("Failed to write program binary for " + program->m_name);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void ProgramCache::forget(ShaderProgram* program)
+{
+    m_pending.erase(std::remove(m_pending.begin(), m_pending.end(), program), m_pending.end());
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
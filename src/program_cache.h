@@ -0,0 +1,96 @@
+#pragma once
+
+#include <ogl.h>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class GLState;
+class ProgramCache;
+
+struct ShaderStage
+{
+    GLenum      type;
+    std::string path;
+};
+
+// Linked GL program with the subset of the dw::Program interface used by the sample. A program created from source
+// links in the background and is only waited on the first time it is used.
+class ShaderProgram
+{
+public:
+    ~ShaderProgram();
+
+    // Waits for a pending compile, logs any errors and stores the binary. Returns false if the program failed to link.
+    bool link();
+    void use();
+    void uniform_block_binding(const std::string& name, int binding);
+
+    bool set_uniform(const std::string& name, int value);
+    bool set_uniform(const std::string& name, float value);
+    bool set_uniform(const std::string& name, const glm::vec2& value);
+    bool set_uniform(const std::string& name, const glm::vec3& value);
+    bool set_uniform(const std::string& name, const glm::vec4& value);
+    bool set_uniform(const std::string& name, const glm::mat3& value);
+    bool set_uniform(const std::string& name, const glm::mat4& value);
+
+    inline GLuint             id() const { return m_id; }
+    inline bool               from_cache() const { return m_from_cache; }
+    inline const std::string& name() const { return m_name; }
+
+private:
+    friend class ProgramCache;
+
+    ShaderProgram(ProgramCache* cache, const std::string& name, uint64_t key);
+
+    GLint location(const std::string& name);
+
+private:
+    ProgramCache*                          m_cache;
+    std::string                            m_name;
+    uint64_t                               m_key;
+    GLuint                                 m_id;
+    std::vector<GLuint>                    m_shaders;
+    bool                                   m_pending    = false;
+    bool                                   m_linked     = false;
+    bool                                   m_from_cache = false;
+    std::unordered_map<std::string, GLint> m_locations;
+};
+
+// Creates programs from GLSL files and keeps their glProgramBinary blobs in the disk cache, keyed by the preprocessed
+// sources and the driver. A warm start never invokes the GLSL compiler. Cold compiles are issued without waiting and
+// run on the driver's compiler threads when GL_KHR_parallel_shader_compile is available.
+class ProgramCache
+{
+public:
+    // Programs bind through 'state', which also counts their uniform updates. It may be nullptr.
+    void initialize(GLState* state);
+
+    // Returns nullptr if a source file could not be read. Compile and link errors are reported by link().
+    std::unique_ptr<ShaderProgram> create(const std::vector<ShaderStage>& stages, const std::vector<std::string>& defines = std::vector<std::string>());
+
+    // Links every program still in flight. Returns false if any of them failed.
+    bool finish();
+
+    inline uint64_t driver_hash() const { return m_driver_hash; }
+    inline bool     parallel_compile() const { return m_parallel_compile; }
+    inline uint32_t program_count() const { return m_program_count; }
+    inline uint32_t cached_count() const { return m_cached_count; }
+
+private:
+    friend class ShaderProgram;
+
+    bool load_binary(ShaderProgram* program);
+    void store_binary(ShaderProgram* program);
+    void forget(ShaderProgram* program);
+
+private:
+    GLState*                    m_state            = nullptr;
+    uint64_t                    m_driver_hash      = 0;
+    bool                        m_binary_supported = false;
+    bool                        m_parallel_compile = false;
+    uint32_t                    m_program_count    = 0;
+    uint32_t                    m_cached_count     = 0;
+    std::vector<ShaderProgram*> m_pending;
+};
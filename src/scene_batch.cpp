@@ -0,0 +1,167 @@
+#include "scene_batch.h"
+#include "gl_state.h"
+#include "program_cache.h"
+#include <algorithm>
+#include <stddef.h>
+
+#define CULL_WORK_GROUP_SIZE 64
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void SceneBatch::initialize(dw::Mesh* mesh)
+{
+    m_mesh = mesh;
+    m_commands.clear();
+
+    dw::SubMesh* submeshes = mesh->sub_meshes();
+
+    for (uint32_t i = 0; i < mesh->sub_mesh_count(); i++)
+        m_commands.push_back({ submeshes[i].index_count, 0, submeshes[i].base_index, int32_t(submeshes[i].base_vertex), 0 });
+
+    const dw::Vertex*            vertices = mesh->vertices();
+    std::vector<QuantizedVertex> quantized(mesh->vertex_count());
+
+    quantize_vertices(quantized.data(), &m_quantization, &vertices[0].position[0], &vertices[0].normal[0], &vertices[0].tex_coord[0], sizeof(dw::Vertex), quantized.size());
+
+    m_vbo = std::make_unique<dw::VertexBuffer>(GL_STATIC_DRAW, sizeof(QuantizedVertex) * quantized.size(), quantized.data());
+
+    // Indices are relative to the base vertex of their submesh, so they usually fit in 16 bits.
+    const uint32_t* indices   = mesh->indices();
+    uint32_t        max_index = 0;
+
+    for (uint32_t i = 0; i < mesh->index_count(); i++)
+        max_index = std::max(max_index, indices[i]);
+
+    if (max_index <= UINT16_MAX)
+    {
+        std::vector<uint16_t> short_indices(indices, indices + mesh->index_count());
+
+        m_index_type = GL_UNSIGNED_SHORT;
+        m_ibo        = std::make_unique<dw::IndexBuffer>(GL_STATIC_DRAW, sizeof(uint16_t) * short_indices.size(), short_indices.data());
+    }
+    else
+    {
+        m_index_type = GL_UNSIGNED_INT;
+        m_ibo        = std::make_unique<dw::IndexBuffer>(GL_STATIC_DRAW, sizeof(uint32_t) * mesh->index_count(), (void*)indices);
+    }
+
+    // Same locations as the unpacked layout, the shader decodes the normalized values.
+    dw::VertexAttrib attribs[] = {
+        { 3, GL_UNSIGNED_SHORT, true, offsetof(QuantizedVertex, position) },
+        { 2, GL_UNSIGNED_SHORT, true, offsetof(QuantizedVertex, texcoord) },
+        { 2, GL_SHORT, true, offsetof(QuantizedVertex, normal) }
+    };
+
+    m_vao = std::make_unique<dw::VertexArray>(m_vbo.get(), m_ibo.get(), sizeof(QuantizedVertex), 3, attribs);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void SceneBatch::set_instances(const std::vector<SceneInstance>& instances)
+{
+    std::vector<SceneInstance> data = instances;
+
+    glm::vec3 center = (m_mesh->max_extents() + m_mesh->min_extents()) * 0.5f;
+    float     radius = glm::length(m_mesh->max_extents() - m_mesh->min_extents()) * 0.5f;
+
+    for (auto& instance : data)
+    {
+        float scale = std::max(glm::length(glm::vec3(instance.model[0])), std::max(glm::length(glm::vec3(instance.model[1])), glm::length(glm::vec3(instance.model[2]))));
+
+        instance.bounds = glm::vec4(glm::vec3(instance.model * glm::vec4(center, 1.0f)), radius * scale);
+    }
+
+    m_instance_count = uint32_t(data.size());
+
+    std::vector<uint32_t> indices(m_instance_count);
+
+    for (uint32_t i = 0; i < m_instance_count; i++)
+        indices[i] = i;
+
+    std::vector<DrawElementsIndirectCommand> commands = m_commands;
+
+    for (auto& command : commands)
+        command.instance_count = m_instance_count;
+
+    m_instances       = std::make_unique<dw::ShaderStorageBuffer>(GL_STATIC_DRAW, sizeof(SceneInstance) * data.size(), data.data());
+    m_all_indices     = std::make_unique<dw::ShaderStorageBuffer>(GL_STATIC_DRAW, sizeof(uint32_t) * indices.size(), indices.data());
+    m_visible_indices = std::make_unique<dw::ShaderStorageBuffer>(GL_DYNAMIC_COPY, sizeof(uint32_t) * indices.size(), nullptr);
+    m_all_commands    = std::make_unique<dw::ShaderStorageBuffer>(GL_STATIC_DRAW, sizeof(DrawElementsIndirectCommand) * commands.size(), commands.data());
+    m_culled_commands = std::make_unique<dw::ShaderStorageBuffer>(GL_DYNAMIC_COPY, sizeof(DrawElementsIndirectCommand) * commands.size(), nullptr);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void SceneBatch::cull(GLState& state, ShaderProgram* program, const glm::mat4& view_projection)
+{
+    if (m_instance_count == 0 || !program->link())
+        return;
+
+    // The kernel only ever increments the instance counts, so they start at zero every frame.
+    m_culled_commands->set_data(0, sizeof(DrawElementsIndirectCommand) * m_commands.size(), m_commands.data());
+
+    glm::vec4 planes[6];
+    extract_frustum_planes(view_projection, planes);
+
+    program->use();
+
+    for (int i = 0; i < 6; i++)
+        program->set_uniform("u_FrustumPlanes[" + std::to_string(i) + "]", planes[i]);
+
+    program->set_uniform("u_InstanceCount", int(m_instance_count));
+    program->set_uniform("u_CommandCount", int(m_commands.size()));
+
+    m_instances->bind_base(0);
+    m_visible_indices->bind_base(1);
+    m_culled_commands->bind_base(2);
+
+    state.dispatch((m_instance_count + CULL_WORK_GROUP_SIZE - 1) / CULL_WORK_GROUP_SIZE, 1, 1);
+
+    state.memory_barrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void SceneBatch::draw(GLState& state, bool culled)
+{
+    if (m_instance_count == 0)
+        return;
+
+    state.bind_vertex_array(m_vao.get());
+
+    m_instances->bind_base(0);
+
+    if (culled)
+        m_visible_indices->bind_base(1);
+    else
+        m_all_indices->bind_base(1);
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, culled ? m_culled_commands->id() : m_all_commands->id());
+
+    state.multi_draw_elements_indirect(GL_TRIANGLES, m_index_type, int32_t(m_commands.size()));
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void extract_frustum_planes(const glm::mat4& view_projection, glm::vec4 planes[6])
+{
+    glm::vec4 row_x = glm::vec4(view_projection[0][0], view_projection[1][0], view_projection[2][0], view_projection[3][0]);
+    glm::vec4 row_y = glm::vec4(view_projection[0][1], view_projection[1][1], view_projection[2][1], view_projection[3][1]);
+    glm::vec4 row_z = glm::vec4(view_projection[0][2], view_projection[1][2], view_projection[2][2], view_projection[3][2]);
+    glm::vec4 row_w = glm::vec4(view_projection[0][3], view_projection[1][3], view_projection[2][3], view_projection[3][3]);
+
+    // Left, right, bottom, top, near, far.
+    planes[0] = row_w + row_x;
+    planes[1] = row_w - row_x;
+    planes[2] = row_w + row_y;
+    planes[3] = row_w - row_y;
+    planes[4] = row_w + row_z;
+    planes[5] = row_w - row_z;
+
+    for (int i = 0; i < 6; i++)
+        planes[i] /= glm::length(glm::vec3(planes[i]));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <ogl.h>
+#include <mesh.h>
+#include "mesh_optimizer.h"
+#include <memory>
+#include <vector>
+
+class GLState;
+class ShaderProgram;
+
+// Per-object data, read by the mesh shaders through the visible index of the instance. Matches 'Instance' in the
+// shaders (std430).
+struct SceneInstance
+{
+    glm::mat4 model;
+    glm::vec4 bounds;   // World space bounding sphere, filled in by SceneBatch: xyz centre, w radius.
+    glm::vec4 material; // x: roughness (negative samples the roughness texture), y: metallic.
+    glm::vec4 albedo;
+};
+
+// Layout consumed by glMultiDrawElementsIndirect.
+struct DrawElementsIndirectCommand
+{
+    uint32_t count;
+    uint32_t instance_count;
+    uint32_t first_index;
+    int32_t  base_vertex;
+    uint32_t base_instance;
+};
+
+// Every instance of one mesh, drawn with a single glMultiDrawElementsIndirect that holds one command per submesh. The
+// CPU cost of a frame does not depend on the number of instances. With culling enabled a compute pass compacts the
+// instances that intersect the view frustum and writes the instance counts of the commands on the GPU.
+//
+// The batch keeps its own quantized copy of the vertices (QuantizedVertex) and 16-bit indices when they fit, the vertex
+// array of the mesh is not used for drawing.
+class SceneBatch
+{
+public:
+    // Quantizes the vertices of 'mesh' and uploads them along with its indices.
+    void initialize(dw::Mesh* mesh);
+
+    // Uploads the instances. Their bounding spheres are computed from the mesh extents, 'bounds' is ignored.
+    void set_instances(const std::vector<SceneInstance>& instances);
+
+    // Runs the culling kernel (shader/cull_cs.glsl) against the frustum of 'view_projection'.
+    void cull(GLState& state, ShaderProgram* program, const glm::mat4& view_projection);
+
+    // Binds the instance data to SSBO bindings 0 and 1 and issues the draw. 'culled' selects the output of the last
+    // cull() over the full instance list. The decode transform of quantization() has to be bound by the caller.
+    void draw(GLState& state, bool culled);
+
+    inline uint32_t instance_count() const { return m_instance_count; }
+    inline uint32_t command_count() const { return uint32_t(m_commands.size()); }
+    inline uint32_t vertex_size() const { return sizeof(QuantizedVertex); }
+    inline uint32_t index_size() const { return m_index_type == GL_UNSIGNED_SHORT ? 2 : 4; }
+
+    inline const VertexQuantization& quantization() const { return m_quantization; }
+
+private:
+    dw::Mesh*                                m_mesh           = nullptr;
+    uint32_t                                 m_instance_count = 0;
+    std::vector<DrawElementsIndirectCommand> m_commands;
+    VertexQuantization                       m_quantization;
+    GLenum                                   m_index_type = GL_UNSIGNED_INT;
+    std::unique_ptr<dw::VertexBuffer>        m_vbo;
+    std::unique_ptr<dw::IndexBuffer>         m_ibo;
+    std::unique_ptr<dw::VertexArray>         m_vao;
+    std::unique_ptr<dw::ShaderStorageBuffer> m_instances;
+    std::unique_ptr<dw::ShaderStorageBuffer> m_all_indices;
+    std::unique_ptr<dw::ShaderStorageBuffer> m_visible_indices;
+    std::unique_ptr<dw::ShaderStorageBuffer> m_all_commands;
+    std::unique_ptr<dw::ShaderStorageBuffer> m_culled_commands;
+};
+
+// Normalised planes of the frustum of 'view_projection', pointing inwards.
+void extract_frustum_planes(const glm::mat4& view_projection, glm::vec4 planes[6]);
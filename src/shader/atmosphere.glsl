@@ -30,15 +30,21 @@
 //  Author: Eric Bruneton
 //
 
-uniform sampler2D s_Transmittance;
-uniform sampler2D s_Irradiance;
-uniform sampler3D s_Inscatter;
-
-uniform vec3 EARTH_POS;
-uniform vec3  SUN_DIR;
-uniform float SUN_INTENSITY;
-uniform vec3  betaR;
-uniform float mieG;
+#include <uniforms.glsl>
+
+layout(binding = 3) uniform sampler2D s_Transmittance;
+layout(binding = 4) uniform sampler2D s_Irradiance;
+layout(binding = 5) uniform sampler3D s_Inscatter;
+
+// SkyUniforms in main.cpp.
+layout(std140, binding = SKY_UNIFORMS_BINDING) uniform SkyUniforms
+{
+    vec3  betaR;
+    float mieG;
+    vec3  EARTH_POS;
+    float SUN_INTENSITY;
+    vec3  SUN_DIR;
+};
 
 #define M_PI 3.141592
 #define Rg 6360000.0
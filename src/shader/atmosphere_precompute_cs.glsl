@@ -0,0 +1,459 @@
+// ------------------------------------------------------------------
+// CONSTANTS --------------------------------------------------------
+// ------------------------------------------------------------------
+
+// Compute port of Bruneton's precomputation passes. Exactly one of
+// the PASS_* defines is provided when compiling this shader. Keep in
+// sync with the CPU implementation in atmosphere_precompute.cpp.
+
+#define LOCAL_SIZE 8
+#define M_PI 3.14159265
+#define Rg 6360.0
+#define Rt 6420.0
+#define RL 6421.0
+#define TRANSMITTANCE_W 256
+#define TRANSMITTANCE_H 64
+#define IRRADIANCE_W 64
+#define IRRADIANCE_H 16
+#define RES_R 32.0
+#define RES_MU 128.0
+#define RES_MU_S 32.0
+#define RES_NU 8.0
+#define TRANSMITTANCE_INTEGRAL_SAMPLES 500
+#define INSCATTER_INTEGRAL_SAMPLES 50
+#define IRRADIANCE_INTEGRAL_SAMPLES 32
+#define INSCATTER_SPHERICAL_INTEGRAL_SAMPLES 16
+
+// ------------------------------------------------------------------
+// INPUTS -----------------------------------------------------------
+// ------------------------------------------------------------------
+
+layout(local_size_x = LOCAL_SIZE, local_size_y = LOCAL_SIZE, local_size_z = 1) in;
+
+// ------------------------------------------------------------------
+// OUTPUTS ----------------------------------------------------------
+// ------------------------------------------------------------------
+
+#if defined(PASS_TRANSMITTANCE)
+layout(binding = 0, rgba32f) uniform image2D i_Transmittance;
+#elif defined(PASS_IRRADIANCE_1)
+layout(binding = 0, rgba32f) uniform image2D i_DeltaE;
+#elif defined(PASS_INSCATTER_1)
+layout(binding = 0, rgba32f) uniform image3D i_DeltaSR;
+layout(binding = 1, rgba32f) uniform image3D i_DeltaSM;
+layout(binding = 2, rgba32f) uniform image3D i_Inscatter;
+#elif defined(PASS_INSCATTER_S)
+layout(binding = 0, rgba32f) uniform image3D i_DeltaJ;
+#elif defined(PASS_IRRADIANCE_N)
+layout(binding = 0, rgba32f) uniform image2D i_DeltaE;
+layout(binding = 1, rgba32f) uniform image2D i_Irradiance;
+#elif defined(PASS_INSCATTER_N)
+layout(binding = 0, rgba32f) uniform image3D i_DeltaSR;
+layout(binding = 1, rgba32f) uniform image3D i_Inscatter;
+#endif
+
+// ------------------------------------------------------------------
+// SAMPLERS ---------------------------------------------------------
+// ------------------------------------------------------------------
+
+uniform sampler2D s_Transmittance;
+uniform sampler2D s_DeltaE;
+uniform sampler3D s_DeltaSR;
+uniform sampler3D s_DeltaSM;
+uniform sampler3D s_DeltaJ;
+
+// ------------------------------------------------------------------
+// UNIFORMS ---------------------------------------------------------
+// ------------------------------------------------------------------
+
+uniform vec3  u_BetaR;
+uniform vec3  u_BetaMSca;
+uniform vec3  u_BetaMEx;
+uniform float u_MieG;
+uniform float u_HR;
+uniform float u_HM;
+uniform float u_GroundReflectance;
+uniform int   u_First;
+
+// ------------------------------------------------------------------
+// FUNCTIONS --------------------------------------------------------
+// ------------------------------------------------------------------
+
+vec4 layer_bounds(int layer, out float r)
+{
+    r = float(layer) / (RES_R - 1.0);
+    r = r * r;
+    r = sqrt(Rg * Rg + r * (Rt * Rt - Rg * Rg)) + (layer == 0 ? 0.01 : (layer == int(RES_R) - 1 ? -0.001 : 0.0));
+
+    float dmin  = Rt - r;
+    float dmax  = sqrt(r * r - Rg * Rg) + sqrt(Rt * Rt - Rg * Rg);
+    float dminp = r - Rg;
+    float dmaxp = sqrt(r * r - Rg * Rg);
+
+    return vec4(dmin, dmax, dminp, dmaxp);
+}
+
+// ------------------------------------------------------------------
+
+void get_mu_mu_s_nu(float x, float y, float r, vec4 dhdH, out float mu, out float mu_s, out float nu)
+{
+    if (y < RES_MU / 2.0)
+    {
+        float d = 1.0 - y / (RES_MU / 2.0 - 1.0);
+        d       = min(max(dhdH.z, d * dhdH.w), dhdH.w * 0.999);
+        mu      = (Rg * Rg - r * r - d * d) / (2.0 * r * d);
+        mu      = min(mu, -sqrt(1.0 - (Rg / r) * (Rg / r)) - 0.001);
+    }
+    else
+    {
+        float d = (y - RES_MU / 2.0) / (RES_MU / 2.0 - 1.0);
+        d       = min(max(dhdH.x, d * dhdH.y), dhdH.y * 0.999);
+        mu      = (Rt * Rt - r * r - d * d) / (2.0 * r * d);
+    }
+
+    mu_s = mod(x, RES_MU_S) / (RES_MU_S - 1.0);
+    mu_s = tan((2.0 * mu_s - 1.0 + 0.26) * 1.1) / tan(1.26 * 1.1);
+    nu   = -1.0 + floor(x / RES_MU_S) / (RES_NU - 1.0) * 2.0;
+}
+
+// ------------------------------------------------------------------
+
+void get_irradiance_r_mu_s(float x, float y, out float r, out float mu_s)
+{
+    r    = Rg + y / (float(IRRADIANCE_H) - 1.0) * (Rt - Rg);
+    mu_s = -0.2 + x / (float(IRRADIANCE_W) - 1.0) * (1.0 + 0.2);
+}
+
+// ------------------------------------------------------------------
+
+vec4 texture_4d(sampler3D table, float r, float mu, float mu_s, float nu)
+{
+    float H   = sqrt(Rt * Rt - Rg * Rg);
+    float rho = sqrt(max(r * r - Rg * Rg, 0.0));
+
+    float rmu   = r * mu;
+    float delta = rmu * rmu - r * r + Rg * Rg;
+    vec4  cst   = rmu < 0.0 && delta > 0.0 ? vec4(1.0, 0.0, 0.0, 0.5 - 0.5 / RES_MU) : vec4(-1.0, H * H, H, 0.5 + 0.5 / RES_MU);
+    float u_r   = 0.5 / RES_R + rho / H * (1.0 - 1.0 / RES_R);
+    float u_mu  = cst.w + (rmu * cst.x + sqrt(max(delta + cst.y, 0.0))) / (rho + cst.z) * (0.5 - 1.0 / RES_MU);
+    float u_mus = 0.5 / RES_MU_S + (atan(max(mu_s, -0.1975) * tan(1.26 * 1.1)) / 1.1 + (1.0 - 0.26)) * 0.5 * (1.0 - 1.0 / RES_MU_S);
+
+    float lep  = (nu + 1.0) / 2.0 * (RES_NU - 1.0);
+    float u_nu = floor(lep);
+    lep        = lep - u_nu;
+
+    return texture(table, vec3((u_nu + u_mus) / RES_NU, u_mu, u_r)) * (1.0 - lep) + texture(table, vec3((u_nu + u_mus + 1.0) / RES_NU, u_mu, u_r)) * lep;
+}
+
+// ------------------------------------------------------------------
+
+float limit(float r, float mu)
+{
+    float dout   = -r * mu + sqrt(r * r * (mu * mu - 1.0) + RL * RL);
+    float delta2 = r * r * (mu * mu - 1.0) + Rg * Rg;
+
+    if (delta2 >= 0.0)
+    {
+        float din = -r * mu - sqrt(delta2);
+
+        if (din >= 0.0)
+            dout = min(dout, din);
+    }
+
+    return dout;
+}
+
+// ------------------------------------------------------------------
+
+vec3 transmittance(float r, float mu)
+{
+    float u_r  = sqrt(max((r - Rg) / (Rt - Rg), 0.0));
+    float u_mu = atan((mu + 0.15) / (1.0 + 0.15) * tan(1.5)) / 1.5;
+
+    return texture(s_Transmittance, vec2(u_mu, u_r)).rgb;
+}
+
+// ------------------------------------------------------------------
+
+vec3 transmittance(float r, float mu, float d)
+{
+    float r1  = sqrt(r * r + d * d + 2.0 * r * mu * d);
+    float mu1 = (r * mu + d) / r1;
+
+    if (mu > 0.0)
+        return min(transmittance(r, mu) / transmittance(r1, mu1), 1.0);
+    else
+        return min(transmittance(r1, -mu1) / transmittance(r, -mu), 1.0);
+}
+
+// ------------------------------------------------------------------
+
+vec3 irradiance(sampler2D table, float r, float mu_s)
+{
+    float u_r   = (r - Rg) / (Rt - Rg);
+    float u_mus = (mu_s + 0.2) / (1.0 + 0.2);
+
+    return texture(table, vec2(u_mus, u_r)).rgb;
+}
+
+// ------------------------------------------------------------------
+
+float phase_function_r(float mu)
+{
+    return (3.0 / (16.0 * M_PI)) * (1.0 + mu * mu);
+}
+
+// ------------------------------------------------------------------
+
+float phase_function_m(float mu)
+{
+    return 1.5 * 1.0 / (4.0 * M_PI) * (1.0 - u_MieG * u_MieG) * pow(1.0 + (u_MieG * u_MieG) - 2.0 * u_MieG * mu, -3.0 / 2.0) * (1.0 + mu * mu) / (2.0 + u_MieG * u_MieG);
+}
+
+// ------------------------------------------------------------------
+
+float optical_depth(float H, float r, float mu)
+{
+    float result = 0.0;
+    float dx     = limit(r, mu) / float(TRANSMITTANCE_INTEGRAL_SAMPLES);
+    float yi     = exp(-(r - Rg) / H);
+
+    for (int i = 1; i <= TRANSMITTANCE_INTEGRAL_SAMPLES; ++i)
+    {
+        float xj = float(i) * dx;
+        float yj = exp(-(sqrt(r * r + xj * xj + 2.0 * xj * r * mu) - Rg) / H);
+        result += (yi + yj) / 2.0 * dx;
+        yi = yj;
+    }
+
+    return mu < -sqrt(1.0 - (Rg / r) * (Rg / r)) ? 1e9 : result;
+}
+
+// ------------------------------------------------------------------
+
+void inscatter_1_integrand(float r, float mu, float mu_s, float nu, float t, out vec3 ray, out vec3 mie)
+{
+    ray = vec3(0.0);
+    mie = vec3(0.0);
+
+    float ri    = sqrt(r * r + t * t + 2.0 * r * mu * t);
+    float mu_si = (nu * t + mu_s * r) / ri;
+    ri          = max(Rg, ri);
+
+    if (mu_si >= -sqrt(1.0 - Rg * Rg / (ri * ri)))
+    {
+        vec3 ti = transmittance(r, mu, t) * transmittance(ri, mu_si);
+        ray     = exp(-(ri - Rg) / u_HR) * ti;
+        mie     = exp(-(ri - Rg) / u_HM) * ti;
+    }
+}
+
+// ------------------------------------------------------------------
+
+vec3 inscatter_s(float r, float mu, float mu_s, float nu)
+{
+    const float dphi   = M_PI / float(INSCATTER_SPHERICAL_INTEGRAL_SAMPLES);
+    const float dtheta = M_PI / float(INSCATTER_SPHERICAL_INTEGRAL_SAMPLES);
+
+    r    = clamp(r, Rg, Rt);
+    mu   = clamp(mu, -1.0, 1.0);
+    mu_s = clamp(mu_s, -1.0, 1.0);
+
+    float var = sqrt(1.0 - mu * mu) * sqrt(1.0 - mu_s * mu_s);
+    nu        = clamp(nu, mu_s * mu - var, mu_s * mu + var);
+
+    float cthetamin = -sqrt(1.0 - (Rg / r) * (Rg / r));
+
+    vec3  v  = vec3(sqrt(1.0 - mu * mu), 0.0, mu);
+    float sx = v.x == 0.0 ? 0.0 : (nu - mu_s * mu) / v.x;
+    vec3  s  = vec3(sx, sqrt(max(0.0, 1.0 - sx * sx - mu_s * mu_s)), mu_s);
+
+    vec3 density_r = u_BetaR * exp(-(r - Rg) / u_HR);
+    vec3 density_m = u_BetaMSca * exp(-(r - Rg) / u_HM);
+    vec3 raymie    = vec3(0.0);
+
+    for (int itheta = 0; itheta < INSCATTER_SPHERICAL_INTEGRAL_SAMPLES; ++itheta)
+    {
+        float theta  = (float(itheta) + 0.5) * dtheta;
+        float ctheta = cos(theta);
+        float stheta = sin(theta);
+
+        float greflectance = 0.0;
+        float dground      = 0.0;
+        vec3  gtransp      = vec3(0.0);
+
+        if (ctheta < cthetamin)
+        {
+            // Ground is visible in direction w, add the light reflected by it.
+            greflectance = u_GroundReflectance / M_PI;
+            dground      = -r * ctheta - sqrt(r * r * (ctheta * ctheta - 1.0) + Rg * Rg);
+            gtransp      = transmittance(Rg, -(r * ctheta + dground) / Rg, dground);
+        }
+
+        for (int iphi = 0; iphi < 2 * INSCATTER_SPHERICAL_INTEGRAL_SAMPLES; ++iphi)
+        {
+            float phi = (float(iphi) + 0.5) * dphi;
+            float dw  = dtheta * dphi * stheta;
+            vec3  w   = vec3(cos(phi) * stheta, sin(phi) * stheta, ctheta);
+
+            float nu1 = dot(s, w);
+            float nu2 = dot(v, w);
+            float pr2 = phase_function_r(nu2);
+            float pm2 = phase_function_m(nu2);
+
+            vec3 gnormal     = (vec3(0.0, 0.0, r) + dground * w) / Rg;
+            vec3 girradiance = irradiance(s_DeltaE, Rg, dot(gnormal, s));
+
+            vec3 raymie1 = greflectance * girradiance * gtransp;
+
+            if (u_First == 1)
+            {
+                float pr1  = phase_function_r(nu1);
+                float pm1  = phase_function_m(nu1);
+                vec3  ray1 = texture_4d(s_DeltaSR, r, w.z, mu_s, nu1).rgb;
+                vec3  mie1 = texture_4d(s_DeltaSM, r, w.z, mu_s, nu1).rgb;
+                raymie1 += ray1 * pr1 + mie1 * pm1;
+            }
+            else
+                raymie1 += texture_4d(s_DeltaSR, r, w.z, mu_s, nu1).rgb;
+
+            raymie += raymie1 * (density_r * pr2 + density_m * pm2) * dw;
+        }
+    }
+
+    return raymie;
+}
+
+// ------------------------------------------------------------------
+// MAIN -------------------------------------------------------------
+// ------------------------------------------------------------------
+
+void main()
+{
+    ivec3 coord = ivec3(gl_GlobalInvocationID);
+    float x     = float(coord.x);
+    float y     = float(coord.y);
+
+#if defined(PASS_TRANSMITTANCE)
+    float r  = (y + 0.5) / float(TRANSMITTANCE_H);
+    float mu = (x + 0.5) / float(TRANSMITTANCE_W);
+
+    r  = Rg + (r * r) * (Rt - Rg);
+    mu = -0.15 + tan(1.5 * mu) / tan(1.5) * (1.0 + 0.15);
+
+    vec3 depth = u_BetaR * optical_depth(u_HR, r, mu) + u_BetaMEx * optical_depth(u_HM, r, mu);
+
+    imageStore(i_Transmittance, coord.xy, vec4(exp(-depth), 0.0));
+#elif defined(PASS_IRRADIANCE_1)
+    float r, mu_s;
+    get_irradiance_r_mu_s(x, y, r, mu_s);
+
+    imageStore(i_DeltaE, coord.xy, vec4(transmittance(r, mu_s) * max(mu_s, 0.0), 0.0));
+#elif defined(PASS_INSCATTER_1)
+    float r;
+    vec4  dhdH = layer_bounds(coord.z, r);
+
+    float mu, mu_s, nu;
+    get_mu_mu_s_nu(x, y, r, dhdH, mu, mu_s, nu);
+
+    vec3  ray = vec3(0.0);
+    vec3  mie = vec3(0.0);
+    float dx  = limit(r, mu) / float(INSCATTER_INTEGRAL_SAMPLES);
+
+    vec3 ray_i, mie_i;
+    inscatter_1_integrand(r, mu, mu_s, nu, 0.0, ray_i, mie_i);
+
+    for (int i = 1; i <= INSCATTER_INTEGRAL_SAMPLES; ++i)
+    {
+        float xj = float(i) * dx;
+        vec3  ray_j, mie_j;
+        inscatter_1_integrand(r, mu, mu_s, nu, xj, ray_j, mie_j);
+
+        ray += (ray_i + ray_j) / 2.0 * dx;
+        mie += (mie_i + mie_j) / 2.0 * dx;
+        ray_i = ray_j;
+        mie_i = mie_j;
+    }
+
+    ray *= u_BetaR;
+    mie *= u_BetaMSca;
+
+    imageStore(i_DeltaSR, coord, vec4(ray, 0.0));
+    imageStore(i_DeltaSM, coord, vec4(mie, 0.0));
+    imageStore(i_Inscatter, coord, vec4(ray, mie.r));
+#elif defined(PASS_INSCATTER_S)
+    float r;
+    vec4  dhdH = layer_bounds(coord.z, r);
+
+    float mu, mu_s, nu;
+    get_mu_mu_s_nu(x, y, r, dhdH, mu, mu_s, nu);
+
+    imageStore(i_DeltaJ, coord, vec4(inscatter_s(r, mu, mu_s, nu), 0.0));
+#elif defined(PASS_IRRADIANCE_N)
+    float r, mu_s;
+    get_irradiance_r_mu_s(x, y, r, mu_s);
+
+    const float dphi   = M_PI / float(IRRADIANCE_INTEGRAL_SAMPLES);
+    const float dtheta = M_PI / float(IRRADIANCE_INTEGRAL_SAMPLES);
+
+    vec3 s      = vec3(max(sqrt(1.0 - mu_s * mu_s), 0.0), 0.0, mu_s);
+    vec3 result = vec3(0.0);
+
+    for (int iphi = 0; iphi < 2 * IRRADIANCE_INTEGRAL_SAMPLES; ++iphi)
+    {
+        float phi = (float(iphi) + 0.5) * dphi;
+
+        for (int itheta = 0; itheta < IRRADIANCE_INTEGRAL_SAMPLES / 2; ++itheta)
+        {
+            float theta = (float(itheta) + 0.5) * dtheta;
+            float dw    = dtheta * dphi * sin(theta);
+            vec3  w     = vec3(cos(phi) * sin(theta), sin(phi) * sin(theta), cos(theta));
+            float nu    = dot(s, w);
+
+            if (u_First == 1)
+            {
+                float pr1  = phase_function_r(nu);
+                float pm1  = phase_function_m(nu);
+                vec3  ray1 = texture_4d(s_DeltaSR, r, w.z, mu_s, nu).rgb;
+                vec3  mie1 = texture_4d(s_DeltaSM, r, w.z, mu_s, nu).rgb;
+                result += (ray1 * pr1 + mie1 * pm1) * w.z * dw;
+            }
+            else
+                result += texture_4d(s_DeltaSR, r, w.z, mu_s, nu).rgb * w.z * dw;
+        }
+    }
+
+    imageStore(i_DeltaE, coord.xy, vec4(result, 0.0));
+    imageStore(i_Irradiance, coord.xy, imageLoad(i_Irradiance, coord.xy) + vec4(result, 0.0));
+#elif defined(PASS_INSCATTER_N)
+    float r;
+    vec4  dhdH = layer_bounds(coord.z, r);
+
+    float mu, mu_s, nu;
+    get_mu_mu_s_nu(x, y, r, dhdH, mu, mu_s, nu);
+
+    vec3  raymie = vec3(0.0);
+    float dx     = limit(r, mu) / float(INSCATTER_INTEGRAL_SAMPLES);
+    vec3  raymie_i;
+
+    for (int i = 0; i <= INSCATTER_INTEGRAL_SAMPLES; ++i)
+    {
+        float t     = float(i) * dx;
+        float ri    = sqrt(r * r + t * t + 2.0 * r * mu * t);
+        float mui   = (r * mu + t) / ri;
+        float mu_si = (nu * t + mu_s * r) / ri;
+
+        vec3 raymie_j = texture_4d(s_DeltaJ, ri, mui, mu_si, nu).rgb * transmittance(r, mu, t);
+
+        if (i > 0)
+            raymie += (raymie_i + raymie_j) / 2.0 * dx;
+
+        raymie_i = raymie_j;
+    }
+
+    imageStore(i_DeltaSR, coord, vec4(raymie, 0.0));
+    imageStore(i_Inscatter, coord, imageLoad(i_Inscatter, coord) + vec4(raymie / phase_function_r(nu), 0.0));
+#endif
+}
+
+// ------------------------------------------------------------------
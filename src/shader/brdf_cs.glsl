@@ -2,15 +2,25 @@
 // CONSTANTS --------------------------------------------------------
 // ------------------------------------------------------------------
 
-#define LOCAL_SIZE 8
+#ifndef LOCAL_SIZE_X
+#    define LOCAL_SIZE_X 8
+#endif
+#ifndef LOCAL_SIZE_Y
+#    define LOCAL_SIZE_Y 8
+#endif
+#ifndef SAMPLE_COUNT
+#    define SAMPLE_COUNT 1024u
+#endif
+#ifndef BRDF_LUT_SIZE
+#    define BRDF_LUT_SIZE 512
+#endif
 #define PI 3.14159265359
-#define BRDF_LUT_SIZE 512
 
 // ------------------------------------------------------------------
 // INPUTS -----------------------------------------------------------
 // ------------------------------------------------------------------
 
-layout(local_size_x = LOCAL_SIZE, local_size_y = LOCAL_SIZE, local_size_z = 1) in;
+layout(local_size_x = LOCAL_SIZE_X, local_size_y = LOCAL_SIZE_Y, local_size_z = 1) in;
 
 // ------------------------------------------------------------------
 // OUTPUTS ----------------------------------------------------------
@@ -106,7 +116,6 @@ vec2 integrate_brdf(float NdotV, float roughness)
 
     vec3 N = vec3(0.0, 0.0, 1.0);
 
-    const uint SAMPLE_COUNT = 1024u;
     for (uint i = 0u; i < SAMPLE_COUNT; ++i)
     {
         // generates a sample vector that's biased towards the
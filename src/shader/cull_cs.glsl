@@ -0,0 +1,92 @@
+// ------------------------------------------------------------------
+// CONSTANTS --------------------------------------------------------
+// ------------------------------------------------------------------
+
+#define LOCAL_SIZE 64
+
+// ------------------------------------------------------------------
+// INPUTS -----------------------------------------------------------
+// ------------------------------------------------------------------
+
+layout(local_size_x = LOCAL_SIZE, local_size_y = 1, local_size_z = 1) in;
+
+// ------------------------------------------------------------------
+// STRUCTURES -------------------------------------------------------
+// ------------------------------------------------------------------
+
+struct Instance
+{
+    mat4 model;
+    vec4 bounds;
+    vec4 material;
+    vec4 albedo;
+};
+
+// ------------------------------------------------------------------
+
+struct DrawCommand
+{
+    uint count;
+    uint instance_count;
+    uint first_index;
+    int  base_vertex;
+    uint base_instance;
+};
+
+// ------------------------------------------------------------------
+// BUFFERS ----------------------------------------------------------
+// ------------------------------------------------------------------
+
+layout(std430, binding = 0) readonly buffer InstanceBuffer
+{
+    Instance instances[];
+};
+
+layout(std430, binding = 1) writeonly buffer VisibleBuffer
+{
+    uint visible[];
+};
+
+layout(std430, binding = 2) buffer DrawBuffer
+{
+    DrawCommand commands[];
+};
+
+// ------------------------------------------------------------------
+// UNIFORMS ---------------------------------------------------------
+// ------------------------------------------------------------------
+
+uniform vec4 u_FrustumPlanes[6];
+uniform int  u_InstanceCount;
+uniform int  u_CommandCount;
+
+// ------------------------------------------------------------------
+// MAIN -------------------------------------------------------------
+// ------------------------------------------------------------------
+
+void main()
+{
+    uint index = gl_GlobalInvocationID.x;
+
+    if (index >= uint(u_InstanceCount))
+        return;
+
+    vec4 bounds = instances[index].bounds;
+
+    for (int i = 0; i < 6; i++)
+    {
+        if (dot(u_FrustumPlanes[i].xyz, bounds.xyz) + u_FrustumPlanes[i].w < -bounds.w)
+            return;
+    }
+
+    // Every submesh draws the same list of visible instances, so the first command hands out the slots and the rest
+    // only need their counts to match.
+    uint slot = atomicAdd(commands[0].instance_count, 1u);
+
+    for (int i = 1; i < u_CommandCount; i++)
+        atomicAdd(commands[i].instance_count, 1u);
+
+    visible[slot] = index;
+}
+
+// ------------------------------------------------------------------
@@ -0,0 +1,321 @@
+// ------------------------------------------------------------------
+// CONSTANTS --------------------------------------------------------
+// ------------------------------------------------------------------
+
+#ifndef ENVIRONMENT_MAP_SIZE
+#    define ENVIRONMENT_MAP_SIZE 512
+#endif
+#ifndef MIP_COUNT
+#    define MIP_COUNT 9
+#endif
+#define LOCAL_SIZE 16
+// Each workgroup reduces a TILE_SIZE x TILE_SIZE block of mip 0 down to a single texel of mip TILE_MIPS.
+#define TILE_SIZE 64
+#define TILE_MIPS 6
+#define TILE_COUNT (ENVIRONMENT_MAP_SIZE / TILE_SIZE)
+#define SH_MIP 2
+#define SH_GROUP_HALF (LOCAL_SIZE * LOCAL_SIZE / 2)
+#define POS_X 0
+#define NEG_X 1
+#define POS_Y 2
+#define NEG_Y 3
+#define POS_Z 4
+#define NEG_Z 5
+
+// ------------------------------------------------------------------
+// INPUTS -----------------------------------------------------------
+// ------------------------------------------------------------------
+
+layout(local_size_x = LOCAL_SIZE, local_size_y = LOCAL_SIZE, local_size_z = 1) in;
+
+// ------------------------------------------------------------------
+// OUTPUTS ----------------------------------------------------------
+// ------------------------------------------------------------------
+
+// Mips 1 to MIP_COUNT - 1.
+layout(binding = 0, rgba16f) writeonly uniform imageCube i_Mips[MIP_COUNT - 1];
+
+// Single texel result of every workgroup, and per face the number of workgroups that are done.
+layout(std430, binding = 0) coherent buffer TileBuffer
+{
+    vec4 tiles[6 * TILE_COUNT * TILE_COUNT];
+    uint counters[6];
+};
+
+#ifdef EMIT_SH
+// SH9 partial sums of every workgroup, laid out as [face][tile y][tile x][coefficient].
+layout(std430, binding = 1) writeonly buffer SHBuffer
+{
+    vec4 sh_partials[];
+};
+#endif
+
+// ------------------------------------------------------------------
+// SAMPLERS ---------------------------------------------------------
+// ------------------------------------------------------------------
+
+uniform samplerCube s_EnvMap;
+
+// ------------------------------------------------------------------
+// STRUCTURES -------------------------------------------------------
+// ------------------------------------------------------------------
+
+struct SH9
+{
+    float c[9];
+};
+
+// ------------------------------------------------------------------
+// FUNCTIONS --------------------------------------------------------
+// ------------------------------------------------------------------
+
+float area_integral(float x, float y)
+{
+    return atan(x * y, sqrt(x * x + y * y + 1));
+}
+
+// ------------------------------------------------------------------
+
+float unlerp(float val, float max_val)
+{
+    return (val + 0.5) / max_val;
+}
+
+// ------------------------------------------------------------------
+
+void project_onto_sh9(in vec3 dir, inout SH9 sh)
+{
+    // Band 0
+    sh.c[0] = 0.282095;
+
+    // Band 1
+    sh.c[1] = -0.488603 * dir.y;
+    sh.c[2] = 0.488603 * dir.z;
+    sh.c[3] = -0.488603 * dir.x;
+
+    // Band 2
+    sh.c[4] = 1.092548 * dir.x * dir.y;
+    sh.c[5] = -1.092548 * dir.y * dir.z;
+    sh.c[6] = 0.315392 * (3.0 * dir.z * dir.z - 1.0);
+    sh.c[7] = -1.092548 * dir.x * dir.z;
+    sh.c[8] = 0.546274 * (dir.x * dir.x - dir.y * dir.y);
+}
+
+// ------------------------------------------------------------------
+
+float calculate_solid_angle(uint x, uint y, float size)
+{
+    float s = unlerp(float(x), size) * 2.0 - 1.0;
+    float t = unlerp(float(y), size) * 2.0 - 1.0;
+
+    // assumes square face
+    float half_texel_size = 1.0 / size;
+    float x0              = s - half_texel_size;
+    float y0              = t - half_texel_size;
+    float x1              = s + half_texel_size;
+    float y1              = t + half_texel_size;
+
+    return area_integral(x0, y0) - area_integral(x0, y1) - area_integral(x1, y0) + area_integral(x1, y1);
+}
+
+// ------------------------------------------------------------------
+
+vec3 calculate_direction(uint face, uint face_x, uint face_y, float size)
+{
+    float s = unlerp(float(face_x), size) * 2.0 - 1.0;
+    float t = unlerp(float(face_y), size) * 2.0 - 1.0;
+    float x, y, z;
+
+    switch (face)
+    {
+        case POS_Z:
+            x = s;
+            y = -t;
+            z = 1;
+            break;
+        case NEG_Z:
+            x = -s;
+            y = -t;
+            z = -1;
+            break;
+        case NEG_X:
+            x = -1;
+            y = -t;
+            z = s;
+            break;
+        case POS_X:
+            x = 1;
+            y = -t;
+            z = -s;
+            break;
+        case POS_Y:
+            x = s;
+            y = 1;
+            z = t;
+            break;
+        case NEG_Y:
+            x = s;
+            y = -1;
+            z = -t;
+            break;
+    }
+
+    return normalize(vec3(x, y, z));
+}
+
+// ------------------------------------------------------------------
+// SHARED -----------------------------------------------------------
+// ------------------------------------------------------------------
+
+shared vec4 g_texels[LOCAL_SIZE][LOCAL_SIZE];
+shared bool g_last;
+#ifdef EMIT_SH
+shared vec4 g_sh_coeffs[9][SH_GROUP_HALF];
+#endif
+
+// ------------------------------------------------------------------
+// MAIN -------------------------------------------------------------
+// ------------------------------------------------------------------
+
+void main()
+{
+    uint  face = gl_WorkGroupID.z;
+    uvec2 tile = gl_WorkGroupID.xy;
+    uvec2 id   = gl_LocalInvocationID.xy;
+
+    // Mip 1 and 2: every thread writes a 2x2 block of mip 1. The centre of a mip 1 texel is the shared corner of four
+    // mip 0 texels, so a single bilinear fetch returns their average.
+    uvec2 mip1_base = tile * (TILE_SIZE / 2) + id * 2;
+    vec4  sum       = vec4(0.0);
+
+    for (uint j = 0; j < 2; j++)
+    {
+        for (uint i = 0; i < 2; i++)
+        {
+            uvec2 p     = mip1_base + uvec2(i, j);
+            vec4  color = vec4(textureLod(s_EnvMap, calculate_direction(face, p.x, p.y, float(ENVIRONMENT_MAP_SIZE / 2)), 0.0).rgb, 1.0);
+
+            imageStore(i_Mips[0], ivec3(p, face), color);
+            sum += color;
+        }
+    }
+
+    uvec2 mip2_pos = tile * (TILE_SIZE / 4) + id;
+    vec4  mip2     = sum * 0.25;
+
+    imageStore(i_Mips[1], ivec3(mip2_pos, face), mip2);
+
+    g_texels[id.y][id.x] = mip2;
+
+#ifdef EMIT_SH
+    // Project the mip 2 texel while it is still in a register, same as the SH projection kernel does from memory.
+    SH9 basis;
+
+    vec3  dir         = calculate_direction(face, mip2_pos.x, mip2_pos.y, float(ENVIRONMENT_MAP_SIZE >> SH_MIP));
+    float solid_angle = calculate_solid_angle(mip2_pos.x, mip2_pos.y, float(ENVIRONMENT_MAP_SIZE >> SH_MIP));
+    uint  index       = id.y * LOCAL_SIZE + id.x;
+
+    project_onto_sh9(dir, basis);
+
+    // Fold the upper half of the group onto the lower half, then reduce the lower half as a tree.
+    if (index >= SH_GROUP_HALF)
+    {
+        for (int i = 0; i < 9; i++)
+            g_sh_coeffs[i][index - SH_GROUP_HALF] = vec4(mip2.rgb * basis.c[i] * solid_angle, solid_angle);
+    }
+
+    barrier();
+
+    if (index < SH_GROUP_HALF)
+    {
+        for (int i = 0; i < 9; i++)
+            g_sh_coeffs[i][index] += vec4(mip2.rgb * basis.c[i] * solid_angle, solid_angle);
+    }
+
+    barrier();
+
+    for (uint stride = SH_GROUP_HALF / 2; stride > 0; stride >>= 1)
+    {
+        if (index < stride)
+        {
+            for (int i = 0; i < 9; i++)
+                g_sh_coeffs[i][index] += g_sh_coeffs[i][index + stride];
+        }
+
+        barrier();
+    }
+
+    if (index < 9)
+        sh_partials[((face * TILE_COUNT + tile.y) * TILE_COUNT + tile.x) * 9 + index] = g_sh_coeffs[index][0];
+#endif
+
+    barrier();
+
+    // Mip 3 to TILE_MIPS from shared memory.
+    for (int level = 3; level <= TILE_MIPS; level++)
+    {
+        uint size   = uint(TILE_SIZE) >> level;
+        bool active = id.x < size && id.y < size;
+        vec4 color  = vec4(0.0);
+
+        if (active)
+            color = 0.25 * (g_texels[id.y * 2][id.x * 2] + g_texels[id.y * 2][id.x * 2 + 1] + g_texels[id.y * 2 + 1][id.x * 2] + g_texels[id.y * 2 + 1][id.x * 2 + 1]);
+
+        barrier();
+
+        if (active)
+        {
+            g_texels[id.y][id.x] = color;
+            imageStore(i_Mips[level - 1], ivec3(tile * size + id, face), color);
+        }
+
+        barrier();
+    }
+
+    // The rest of the chain depends on every tile of the face. The last workgroup of the face to get here finishes it,
+    // which keeps the whole chain in a single dispatch.
+    if (id.x == 0 && id.y == 0)
+    {
+        tiles[(face * TILE_COUNT + tile.y) * TILE_COUNT + tile.x] = g_texels[0][0];
+
+        memoryBarrierBuffer();
+
+        g_last = atomicAdd(counters[face], 1u) == TILE_COUNT * TILE_COUNT - 1;
+    }
+
+    barrier();
+
+    if (!g_last)
+        return;
+
+    if (id.x < TILE_COUNT && id.y < TILE_COUNT)
+        g_texels[id.y][id.x] = tiles[(face * TILE_COUNT + id.y) * TILE_COUNT + id.x];
+
+    barrier();
+
+    for (int level = TILE_MIPS + 1; level < MIP_COUNT; level++)
+    {
+        uint size   = uint(TILE_COUNT) >> (level - TILE_MIPS);
+        bool active = id.x < size && id.y < size;
+        vec4 color  = vec4(0.0);
+
+        if (active)
+            color = 0.25 * (g_texels[id.y * 2][id.x * 2] + g_texels[id.y * 2][id.x * 2 + 1] + g_texels[id.y * 2 + 1][id.x * 2] + g_texels[id.y * 2 + 1][id.x * 2 + 1]);
+
+        barrier();
+
+        if (active)
+        {
+            g_texels[id.y][id.x] = color;
+            imageStore(i_Mips[level - 1], ivec3(id, face), color);
+        }
+
+        barrier();
+    }
+
+    // Leave the counter at zero for the next dispatch.
+    if (id.x == 0 && id.y == 0)
+        counters[face] = 0;
+}
+
+// ------------------------------------------------------------------
@@ -0,0 +1,250 @@
+// ------------------------------------------------------------------
+// CONSTANTS --------------------------------------------------------
+// ------------------------------------------------------------------
+
+#ifndef ENVIRONMENT_MAP_SIZE
+#    define ENVIRONMENT_MAP_SIZE 512
+#endif
+// Every workgroup converts a TILE_SIZE x TILE_SIZE block of one face, the same tiling as downsample_cs.glsl.
+#ifndef TILE_SIZE
+#    define TILE_SIZE 64
+#endif
+#define LOCAL_SIZE 16
+#define TILE_COUNT (ENVIRONMENT_MAP_SIZE / TILE_SIZE)
+#define TEXELS_PER_THREAD (TILE_SIZE / LOCAL_SIZE)
+#define GROUP_COUNT (6 * TILE_COUNT * TILE_COUNT)
+#define SH_GROUP_HALF (LOCAL_SIZE * LOCAL_SIZE / 2)
+#define PI 3.14159265359
+#define POS_X 0
+#define NEG_X 1
+#define POS_Y 2
+#define NEG_Y 3
+#define POS_Z 4
+#define NEG_Z 5
+
+// ------------------------------------------------------------------
+// INPUTS -----------------------------------------------------------
+// ------------------------------------------------------------------
+
+layout(local_size_x = LOCAL_SIZE, local_size_y = LOCAL_SIZE, local_size_z = 1) in;
+
+// ------------------------------------------------------------------
+// OUTPUTS ----------------------------------------------------------
+// ------------------------------------------------------------------
+
+// Mip 0 of the environment map.
+layout(binding = 0, rgba16f) writeonly uniform imageCube i_EnvMap;
+
+#ifdef EMIT_SH
+// SH9 partial sums of every workgroup, laid out as [face][tile y][tile x][coefficient] like the ones written by
+// downsample_cs.glsl, so that sh_add_cs.glsl reduces either.
+layout(std430, binding = 1) writeonly buffer SHBuffer
+{
+    vec4 sh_partials[];
+};
+#endif
+
+// ------------------------------------------------------------------
+// SAMPLERS ---------------------------------------------------------
+// ------------------------------------------------------------------
+
+layout(binding = 0) uniform sampler2D s_EnvMap;
+
+// ------------------------------------------------------------------
+// STRUCTURES -------------------------------------------------------
+// ------------------------------------------------------------------
+
+struct SH9
+{
+    float c[9];
+};
+
+// ------------------------------------------------------------------
+// FUNCTIONS --------------------------------------------------------
+// ------------------------------------------------------------------
+
+float unlerp(float val, float max_val)
+{
+    return (val + 0.5) / max_val;
+}
+
+// ------------------------------------------------------------------
+
+void project_onto_sh9(in vec3 dir, inout SH9 sh)
+{
+    // Band 0
+    sh.c[0] = 0.282095;
+
+    // Band 1
+    sh.c[1] = -0.488603 * dir.y;
+    sh.c[2] = 0.488603 * dir.z;
+    sh.c[3] = -0.488603 * dir.x;
+
+    // Band 2
+    sh.c[4] = 1.092548 * dir.x * dir.y;
+    sh.c[5] = -1.092548 * dir.y * dir.z;
+    sh.c[6] = 0.315392 * (3.0 * dir.z * dir.z - 1.0);
+    sh.c[7] = -1.092548 * dir.x * dir.z;
+    sh.c[8] = 0.546274 * (dir.x * dir.x - dir.y * dir.y);
+}
+
+// ------------------------------------------------------------------
+
+vec3 calculate_direction(uint face, uint face_x, uint face_y, float size)
+{
+    float s = unlerp(float(face_x), size) * 2.0 - 1.0;
+    float t = unlerp(float(face_y), size) * 2.0 - 1.0;
+    float x, y, z;
+
+    switch (face)
+    {
+        case POS_Z:
+            x = s;
+            y = -t;
+            z = 1;
+            break;
+        case NEG_Z:
+            x = -s;
+            y = -t;
+            z = -1;
+            break;
+        case NEG_X:
+            x = -1;
+            y = -t;
+            z = s;
+            break;
+        case POS_X:
+            x = 1;
+            y = -t;
+            z = -s;
+            break;
+        case POS_Y:
+            x = s;
+            y = 1;
+            z = t;
+            break;
+        case NEG_Y:
+            x = s;
+            y = -1;
+            z = -t;
+            break;
+    }
+
+    return normalize(vec3(x, y, z));
+}
+
+// ------------------------------------------------------------------
+
+// Same mapping as equirectangular_to_cubemap_fs.glsl.
+vec2 sample_spherical_map(vec3 v)
+{
+    return vec2(atan(v.z, v.x) / (2.0 * PI), asin(v.y) / PI) + 0.5;
+}
+
+// ------------------------------------------------------------------
+// SHARED -----------------------------------------------------------
+// ------------------------------------------------------------------
+
+#ifdef EMIT_SH
+shared vec4 g_sh_coeffs[9][SH_GROUP_HALF];
+#endif
+
+// ------------------------------------------------------------------
+// MAIN -------------------------------------------------------------
+// ------------------------------------------------------------------
+
+void main()
+{
+    uint  face = gl_WorkGroupID.z;
+    uvec2 tile = gl_WorkGroupID.xy;
+    uvec2 id   = gl_LocalInvocationID.xy;
+
+    ivec2 equirect_size = textureSize(s_EnvMap, 0);
+
+    // Match the texel footprint of the face centre, where a cube texel spans 2 / ENVIRONMENT_MAP_SIZE radians.
+    float lod = max(log2(float(equirect_size.x) / (PI * float(ENVIRONMENT_MAP_SIZE))), 0.0);
+
+    // Neighbouring threads write neighbouring texels on every iteration.
+    for (uint j = 0; j < TEXELS_PER_THREAD; j++)
+    {
+        for (uint i = 0; i < TEXELS_PER_THREAD; i++)
+        {
+            uvec2 p   = tile * TILE_SIZE + uvec2(i, j) * LOCAL_SIZE + id;
+            vec3  dir = calculate_direction(face, p.x, p.y, float(ENVIRONMENT_MAP_SIZE));
+
+            imageStore(i_EnvMap, ivec3(p, face), vec4(textureLod(s_EnvMap, sample_spherical_map(dir), lod).rgb, 1.0));
+        }
+    }
+
+#ifdef EMIT_SH
+    // Project the equirectangular texels themselves rather than the resampled cube. The dispatch walks them in a grid
+    // stride loop and every texel is weighted by its exact solid angle, d_phi * (sin(lat_1) - sin(lat_0)), which
+    // adds up to 4 pi over the image.
+    uint  index  = id.y * LOCAL_SIZE + id.x;
+    uint  group  = (face * TILE_COUNT + tile.y) * TILE_COUNT + tile.x;
+    uint  texel  = group * LOCAL_SIZE * LOCAL_SIZE + index;
+    uint  count  = uint(equirect_size.x * equirect_size.y);
+    float d_phi  = 2.0 * PI / float(equirect_size.x);
+    float weight = 0.0;
+    vec3  sh[9];
+
+    for (int i = 0; i < 9; i++)
+        sh[i] = vec3(0.0);
+
+    for (; texel < count; texel += GROUP_COUNT * LOCAL_SIZE * LOCAL_SIZE)
+    {
+        uint x = texel % uint(equirect_size.x);
+        uint y = texel / uint(equirect_size.x);
+
+        float phi   = (unlerp(float(x), float(equirect_size.x)) - 0.5) * 2.0 * PI;
+        float lat   = (unlerp(float(y), float(equirect_size.y)) - 0.5) * PI;
+        float lat_0 = (float(y) / float(equirect_size.y) - 0.5) * PI;
+        float lat_1 = (float(y + 1) / float(equirect_size.y) - 0.5) * PI;
+
+        vec3  dir         = vec3(cos(lat) * cos(phi), sin(lat), cos(lat) * sin(phi));
+        float solid_angle = d_phi * (sin(lat_1) - sin(lat_0));
+        vec3  color       = texelFetch(s_EnvMap, ivec2(x, y), 0).rgb;
+
+        SH9 basis;
+        project_onto_sh9(dir, basis);
+
+        for (int i = 0; i < 9; i++)
+            sh[i] += color * basis.c[i] * solid_angle;
+
+        weight += solid_angle;
+    }
+
+    // Fold the upper half of the group onto the lower half, then reduce the lower half as a tree.
+    if (index >= SH_GROUP_HALF)
+    {
+        for (int i = 0; i < 9; i++)
+            g_sh_coeffs[i][index - SH_GROUP_HALF] = vec4(sh[i], weight);
+    }
+
+    barrier();
+
+    if (index < SH_GROUP_HALF)
+    {
+        for (int i = 0; i < 9; i++)
+            g_sh_coeffs[i][index] += vec4(sh[i], weight);
+    }
+
+    barrier();
+
+    for (uint stride = SH_GROUP_HALF / 2; stride > 0; stride >>= 1)
+    {
+        if (index < stride)
+        {
+            for (int i = 0; i < 9; i++)
+                g_sh_coeffs[i][index] += g_sh_coeffs[i][index + stride];
+        }
+
+        barrier();
+    }
+
+    if (index < 9)
+        sh_partials[group * 9 + index] = g_sh_coeffs[index][0];
+#endif
+}
+
+// ------------------------------------------------------------------
@@ -14,7 +14,7 @@ out vec3 FS_OUT_Color;
 // SAMPLERS ---------------------------------------------------------
 // ------------------------------------------------------------------
 
-uniform sampler2D s_EnvMap;
+layout(binding = 0) uniform sampler2D s_EnvMap;
 
 // ------------------------------------------------------------------
 // FUNCTIONS  -------------------------------------------------------
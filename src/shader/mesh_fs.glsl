@@ -1,3 +1,6 @@
+#include <uniforms.glsl>
+#include <octahedral.glsl>
+
 const float Pi       = 3.141592654;
 const float CosineA0 = Pi;
 const float CosineA1 = (2.0 * Pi) / 3.0;
@@ -5,17 +8,21 @@ const float CosineA2 = Pi * 0.25;
 
 out vec4 PS_OUT_Color;
 
-in vec3 PS_IN_FragPos;
-in vec3 PS_IN_Normal;
-in vec2 PS_IN_TexCoord;
-
-uniform sampler2D s_Roughness;
+in vec3      PS_IN_FragPos;
+in vec3      PS_IN_Normal;
+in vec2      PS_IN_TexCoord;
+flat in vec4 PS_IN_Material;
+flat in vec3 PS_IN_Albedo;
 
-uniform sampler2D s_BRDF;
-uniform sampler2D s_IrradianceSH;
-uniform samplerCube s_Prefiltered;
+layout(binding = 3) uniform sampler2D s_Roughness;
 
-uniform vec3 u_CameraPos;
+layout(binding = 0) uniform sampler2D s_BRDF;
+layout(binding = 1) uniform sampler2D s_IrradianceSH;
+#ifdef OCTAHEDRAL_PROBE
+layout(binding = 2) uniform sampler2D s_Prefiltered;
+#else
+layout(binding = 2) uniform samplerCube s_Prefiltered;
+#endif
 
 struct SH9
 {
@@ -124,9 +131,9 @@ vec3 evaluate_sh9_irradiance(in vec3 direction)
 void main()
 {
     // material properties
-    vec3  albedo    = vec3(1.0);
-    float metallic  = 1.0;
-    float roughness = texture(s_Roughness, PS_IN_TexCoord).r;
+    vec3  albedo    = PS_IN_Albedo;
+    float metallic  = PS_IN_Material.y;
+    float roughness = PS_IN_Material.x < 0.0 ? texture(s_Roughness, PS_IN_TexCoord).r : PS_IN_Material.x;
 
     // input lighting data
     vec3 N = PS_IN_Normal;
@@ -153,9 +160,13 @@ void main()
 
     // sample both the pre-filter map and the BRDF lut and combine them together as per the Split-Sum approximation to get the IBL specular part.
     const float MAX_REFLECTION_LOD = 4.0;
-    vec3        prefilteredColor   = textureLod(s_Prefiltered, R, roughness * MAX_REFLECTION_LOD).rgb;
-    vec2        brdf               = texture(s_BRDF, vec2(max(dot(N, V), 0.0), roughness)).rg;
-    vec3        specular           = prefilteredColor * (F * brdf.x + brdf.y);
+#ifdef OCTAHEDRAL_PROBE
+    vec3 prefilteredColor = octahedral_sample_lod(s_Prefiltered, R, roughness * MAX_REFLECTION_LOD);
+#else
+    vec3 prefilteredColor = textureLod(s_Prefiltered, R, roughness * MAX_REFLECTION_LOD).rgb;
+#endif
+    vec2 brdf     = texture(s_BRDF, vec2(max(dot(N, V), 0.0), roughness)).rg;
+    vec3 specular = prefilteredColor * (F * brdf.x + brdf.y);
 
     vec3 ambient = (kD * diffuse + specular) * 0.3;
 
@@ -1,26 +1,71 @@
+#include <uniforms.glsl>
+
+// Quantized vertex (QuantizedVertex in mesh_optimizer.h): unorm16 position and texcoord within the mesh bounds and a
+// snorm16 octahedral normal.
 layout(location = 0) in vec3 VS_IN_Position;
 layout(location = 1) in vec2 VS_IN_Texcoord;
-layout(location = 2) in vec3 VS_IN_Normal;
-layout(location = 3) in vec3 VS_IN_Tangent;
-layout(location = 4) in vec3 VS_IN_Bitangent;
+layout(location = 2) in vec2 VS_IN_Normal;
+
+out vec3      PS_IN_FragPos;
+out vec3      PS_IN_Normal;
+out vec2      PS_IN_TexCoord;
+flat out vec4 PS_IN_Material;
+flat out vec3 PS_IN_Albedo;
+
+struct Instance
+{
+    mat4 model;
+    vec4 bounds;
+    vec4 material;
+    vec4 albedo;
+};
 
-out vec3 PS_IN_FragPos;
-out vec3 PS_IN_Normal;
-out vec2 PS_IN_TexCoord;
+layout(std430, binding = 0) readonly buffer InstanceBuffer
+{
+    Instance instances[];
+};
+
+// Indices of the instances to draw, either all of them or the ones that survived culling.
+layout(std430, binding = 1) readonly buffer VisibleBuffer
+{
+    uint visible[];
+};
 
-uniform mat4 u_Model;
-uniform mat4 u_View;
-uniform mat4 u_Projection;
+// Decode transform of the quantized vertices (MeshUniforms in main.cpp).
+layout(std140, binding = OBJECT_UNIFORMS_BINDING) uniform MeshUniforms
+{
+    vec3 u_PositionOffset;
+    vec3 u_PositionScale;
+    vec4 u_TexCoordTransform; // xy: offset, zw: scale
+};
+
+vec3 octahedral_decode(vec2 e)
+{
+    vec3  n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+
+    return normalize(n);
+}
 
 void main()
 {
-    vec4 world_pos = u_Model * vec4(VS_IN_Position, 1.0f);
+    Instance instance = instances[visible[gl_InstanceID]];
+
+    vec3 position = u_PositionOffset + VS_IN_Position * u_PositionScale;
+    vec2 texcoord = u_TexCoordTransform.xy + VS_IN_Texcoord * u_TexCoordTransform.zw;
+
+    vec4 world_pos = instance.model * vec4(position, 1.0f);
     PS_IN_FragPos  = world_pos.xyz;
-    PS_IN_TexCoord = VS_IN_Texcoord * 4.0;
+    PS_IN_TexCoord = texcoord * 4.0;
+    PS_IN_Material = instance.material;
+    PS_IN_Albedo   = instance.albedo.rgb;
 
-    mat3 model_mat = mat3(u_Model);
+    mat3 model_mat = mat3(instance.model);
 
-    PS_IN_Normal = normalize(model_mat * VS_IN_Normal);
+    PS_IN_Normal = normalize(model_mat * octahedral_decode(VS_IN_Normal));
 
     gl_Position = u_Projection * u_View * world_pos;
 }
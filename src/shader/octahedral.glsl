@@ -0,0 +1,90 @@
+// ------------------------------------------------------------------
+// OCTAHEDRAL MAPPING -----------------------------------------------
+// ------------------------------------------------------------------
+
+// Octahedral parameterisation of the sphere onto a single square, with +Y at the centre and -Y folded out to the
+// corners. Every mip of an octahedral map carries a one texel border that duplicates the texels across the fold, so
+// bilinear filtering never leaves the mip and needs no seamless filtering support.
+
+vec2 octahedral_sign(vec2 v)
+{
+    return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+// ------------------------------------------------------------------
+
+// Returns a point in [-1, 1]^2.
+vec2 octahedral_encode(vec3 dir)
+{
+    dir /= abs(dir.x) + abs(dir.y) + abs(dir.z);
+
+    vec2 p = dir.xz;
+
+    if (dir.y < 0.0)
+        p = (1.0 - abs(p.yx)) * octahedral_sign(p);
+
+    return p;
+}
+
+// ------------------------------------------------------------------
+
+vec3 octahedral_decode(vec2 p)
+{
+    vec3 dir = vec3(p.x, 1.0 - abs(p.x) - abs(p.y), p.y);
+
+    if (dir.y < 0.0)
+        dir.xz = (1.0 - abs(dir.zx)) * octahedral_sign(dir.xz);
+
+    return normalize(dir);
+}
+
+// ------------------------------------------------------------------
+
+// Direction stored by texel 'p' of a 'size' x 'size' mip. The square folds onto itself along its edges, so a border
+// texel past an edge holds the interior texel mirrored across the midpoint of that edge, and a corner the opposite
+// corner.
+vec3 octahedral_texel_direction(ivec2 p, int size)
+{
+    int   interior = size - 2;
+    ivec2 q        = p - 1;
+
+    if (q.x < 0 || q.x >= interior)
+    {
+        q.x = clamp(q.x, 0, interior - 1);
+        q.y = interior - 1 - q.y;
+    }
+
+    if (q.y < 0 || q.y >= interior)
+    {
+        q.y = clamp(q.y, 0, interior - 1);
+        q.x = interior - 1 - q.x;
+    }
+
+    return octahedral_decode((vec2(q) + 0.5) / float(interior) * 2.0 - 1.0);
+}
+
+// ------------------------------------------------------------------
+
+// Texture coordinates of 'dir' in a 'size' x 'size' mip, inside its border.
+vec2 octahedral_uv(vec3 dir, float size)
+{
+    return (1.0 + (octahedral_encode(dir) * 0.5 + 0.5) * (size - 2.0)) / size;
+}
+
+// ------------------------------------------------------------------
+
+// Trilinear lookup. The border shifts the coordinates of every mip differently, so the two levels are fetched
+// separately at their own coordinates and blended.
+vec3 octahedral_sample_lod(sampler2D s, vec3 dir, float lod)
+{
+    float max_lod = float(textureQueryLevels(s) - 1);
+    float lod_0   = min(floor(lod), max_lod);
+    float lod_1   = min(lod_0 + 1.0, max_lod);
+
+    vec3 color_0 = textureLod(s, octahedral_uv(dir, float(textureSize(s, int(lod_0)).x)), lod_0).rgb;
+    vec3 color_1 = textureLod(s, octahedral_uv(dir, float(textureSize(s, int(lod_1)).x)), lod_1).rgb;
+
+    return mix(color_0, color_1, clamp(lod - lod_0, 0.0, 1.0));
+}
+
+// ------------------------------------------------------------------
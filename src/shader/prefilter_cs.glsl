@@ -1,8 +1,31 @@
+#include <octahedral.glsl>
+
 // ------------------------------------------------------------------
 // CONSTANTS --------------------------------------------------------
 // ------------------------------------------------------------------
 
-#define LOCAL_SIZE 8
+#ifndef LOCAL_SIZE_X
+#    define LOCAL_SIZE_X 8
+#endif
+#ifndef LOCAL_SIZE_Y
+#    define LOCAL_SIZE_Y 8
+#endif
+#ifndef LOCAL_SIZE_Z
+#    define LOCAL_SIZE_Z 1
+#endif
+// Number of consecutive mips written by one dispatch. gl_GlobalInvocationID.z is 6 * mip + face, or just the mip for
+// octahedral maps.
+#ifndef MIP_BATCH
+#    define MIP_BATCH 1
+#endif
+#ifdef OCTAHEDRAL
+#    define LAYER_COUNT 1
+#else
+#    define LAYER_COUNT 6
+#endif
+#ifndef MAX_SAMPLES
+#    define MAX_SAMPLES 64
+#endif
 #define POS_X 0
 #define NEG_X 1
 #define POS_Y 2
@@ -10,28 +33,46 @@
 #define POS_Z 4
 #define NEG_Z 5
 #define PI 3.14159265359
-#define MAX_SAMPLES 64
+
+// Specialised variants bake the sample count and (for single mip dispatches) the roughness into the kernel so that the
+// sample loop has a constant trip count and the roughness dependent terms fold away.
+#ifdef SAMPLE_COUNT
+#    define NUM_SAMPLES SAMPLE_COUNT
+#else
+#    define NUM_SAMPLES u_SampleCount
+#endif
+
+// Progressive variants only take u_SubsetSize samples of the set per dispatch and add them to the previous contents of
+// the cubemap, which hold the NdotL weighted mean of every sample so far in rgb and the sum of their weights in alpha.
+// The mip level selection still uses the size of the full set the subsets add up to.
 
 // ------------------------------------------------------------------
 // INPUTS -----------------------------------------------------------
 // ------------------------------------------------------------------
 
-layout(local_size_x = LOCAL_SIZE, local_size_y = LOCAL_SIZE, local_size_z = 1) in;
+layout(local_size_x = LOCAL_SIZE_X, local_size_y = LOCAL_SIZE_Y, local_size_z = LOCAL_SIZE_Z) in;
 
 // ------------------------------------------------------------------
 // OUTPUTS ----------------------------------------------------------
 // ------------------------------------------------------------------
 
-layout(binding = 0, rgba16f) uniform imageCube i_Prefiltered;
+#ifdef OCTAHEDRAL
+layout(binding = 0, rgba16f) uniform image2D i_Prefiltered[MIP_BATCH];
+#    define PREFILTERED_COORD ivec2(gl_GlobalInvocationID.xy)
+#else
+layout(binding = 0, rgba16f) uniform imageCube i_Prefiltered[MIP_BATCH];
+#    define PREFILTERED_COORD ivec3(gl_GlobalInvocationID.xy, face)
+#endif
 
 // ------------------------------------------------------------------
 // UNIFORM BUFFERS --------------------------------------------------
 // ------------------------------------------------------------------
 
-layout(std140) uniform u_SampleDirections
+layout(std140, binding = 0) uniform u_SampleDirections
 {
     vec4 sample_directions[MAX_SAMPLES];
-};
+}
+u_Directions[MIP_BATCH];
 
 // ------------------------------------------------------------------
 // SAMPLERS ---------------------------------------------------------
@@ -39,10 +80,17 @@ layout(std140) uniform u_SampleDirections
 
 uniform samplerCube s_EnvMap;
 uniform float       u_Roughness;
+uniform float       u_RoughnessStep;
 uniform float       u_Width;
-uniform float       u_Height;
 uniform int         u_StartMipLevel;
 uniform int         u_SampleCount;
+#ifdef PROGRESSIVE
+uniform int   u_SubsetOffset;
+uniform int   u_SubsetStride;
+uniform int   u_SubsetSize;
+uniform float u_SubsetRotation;
+uniform int   u_Accumulate; // Zero for the first subset, which discards the previous contents.
+#endif
 
 // ------------------------------------------------------------------
 // FUNCTIONS --------------------------------------------------------
@@ -55,10 +103,10 @@ float unlerp(float val, float max_val)
 
 // ------------------------------------------------------------------
 
-vec3 calculate_direction(uint face, uint face_x, uint face_y)
+vec3 calculate_direction(uint face, uint face_x, uint face_y, float size)
 {
-    float s = unlerp(float(face_x), u_Width) * 2.0 - 1.0;
-    float t = unlerp(float(face_y), u_Height) * 2.0 - 1.0;
+    float s = unlerp(float(face_x), size) * 2.0 - 1.0;
+    float t = unlerp(float(face_y), size) * 2.0 - 1.0;
     float x, y, z;
 
     switch (face)
@@ -126,7 +174,27 @@ float distribution_ggx(vec3 N, vec3 H, float roughness)
 
 void main()
 {
-    vec3 N = calculate_direction(gl_GlobalInvocationID.z, gl_GlobalInvocationID.x, gl_GlobalInvocationID.y);
+    // Workgroups never straddle two mips since LOCAL_SIZE_Z divides LAYER_COUNT, which keeps 'batch' dynamically uniform.
+    uint  batch = gl_GlobalInvocationID.z / LAYER_COUNT;
+    uint  face  = gl_GlobalInvocationID.z % LAYER_COUNT;
+    float width = u_Width / float(1u << batch);
+
+    // Dispatches are rounded up to whole workgroups and every mip of a batch shares the grid of the largest one.
+    if (gl_GlobalInvocationID.x >= uint(width) || gl_GlobalInvocationID.y >= uint(width))
+        return;
+
+#if MIP_BATCH == 1 && defined(ROUGHNESS)
+    const float roughness = ROUGHNESS;
+#else
+    float roughness = u_Roughness + float(batch) * u_RoughnessStep;
+#endif
+
+#ifdef OCTAHEDRAL
+    // Border texels are filtered like the interior texel they mirror, which makes them equal to it.
+    vec3 N = octahedral_texel_direction(ivec2(gl_GlobalInvocationID.xy), int(width));
+#else
+    vec3 N = calculate_direction(face, gl_GlobalInvocationID.x, gl_GlobalInvocationID.y, width);
+#endif
 
     // make the simplyfying assumption that V equals R equals the normal
     vec3  R          = N;
@@ -142,12 +210,28 @@ void main()
     vec3 tangent   = normalize(cross(up, N));
     vec3 bitangent = cross(N, tangent);
 
+#ifdef PROGRESSIVE
+    // Rotating the frame around N rotates the whole subset, so later passes over the set see new directions.
+    float c = cos(u_SubsetRotation);
+    float s = sin(u_SubsetRotation);
+
+    mat3 tangent_to_world = mat3(c * tangent + s * bitangent, c * bitangent - s * tangent, N);
+
+    for (int j = 0; j < u_SubsetSize; ++j)
+    {
+        int i = u_SubsetOffset + j * u_SubsetStride;
+
+        // The last subsets come up short when the subset size does not divide the sample count.
+        if (i >= NUM_SAMPLES)
+            break;
+#else
     mat3 tangent_to_world = mat3(tangent, bitangent, N);
 
-    for (uint i = 0u; i < u_SampleCount; ++i)
+    for (int i = 0; i < NUM_SAMPLES; ++i)
     {
+#endif
         // generates a sample vector that's biased towards the preferred alignment direction (importance sampling).
-        vec3 H = tangent_to_world * sample_directions[i].xyz;
+        vec3 H = tangent_to_world * u_Directions[batch].sample_directions[i].xyz;
         vec3 L = normalize(2.0 * dot(V, H) * H - V);
 
         float NdotL = max(dot(N, L), 0.0);
@@ -155,24 +239,38 @@ void main()
         if (NdotL > 0.0)
         {
             // sample from the environment's mip level based on roughness/pdf
-            float D     = distribution_ggx(N, H, u_Roughness);
+            float D     = distribution_ggx(N, H, roughness);
             float NdotH = max(dot(N, H), 0.0);
             float HdotV = max(dot(H, V), 0.0);
             float pdf   = D * NdotH / (4.0 * HdotV) + 0.0001;
 
             float sa_texel  = 4.0 * PI / (6.0 * resolution * resolution);
-            float sa_sample = 1.0 / (float(u_SampleCount) * pdf + 0.0001);
+            float sa_sample = 1.0 / (float(NUM_SAMPLES) * pdf + 0.0001);
 
-            float mip_level = u_Roughness == 0.0 ? 0.0 : 0.5 * log2(sa_sample / sa_texel);
+            float mip_level = roughness == 0.0 ? 0.0 : 0.5 * log2(sa_sample / sa_texel);
 
             prefiltered_color += textureLod(s_EnvMap, L, u_StartMipLevel + mip_level).rgb * NdotL;
             total_weight += NdotL;
         }
     }
 
+#ifdef PROGRESSIVE
+    vec4 history = u_Accumulate != 0 ? imageLoad(i_Prefiltered[batch], PREFILTERED_COORD) : vec4(0.0);
+
+    // Sums and weights add up across frames, so the first pass over the set converges to the full-sample estimate up to
+    // the fp16 rounding the mean and the weight go through in the target after every frame. A small subset can miss the
+    // hemisphere entirely, in which case this frame adds nothing.
+    float accumulated_weight = history.a + total_weight;
+
+    if (accumulated_weight > 0.0)
+        prefiltered_color = (history.rgb * history.a + prefiltered_color) / accumulated_weight;
+
+    imageStore(i_Prefiltered[batch], PREFILTERED_COORD, vec4(prefiltered_color, accumulated_weight));
+#else
     prefiltered_color = prefiltered_color / total_weight;
 
-    imageStore(i_Prefiltered, ivec3(gl_GlobalInvocationID), vec4(prefiltered_color, 1.0));
+    imageStore(i_Prefiltered[batch], PREFILTERED_COORD, vec4(prefiltered_color, 1.0));
+#endif
 }
 
 // ------------------------------------------------------------------
\ No newline at end of file
@@ -0,0 +1,183 @@
+// ------------------------------------------------------------------
+// CONSTANTS --------------------------------------------------------
+// ------------------------------------------------------------------
+
+#ifndef LOCAL_SIZE_X
+#    define LOCAL_SIZE_X 8
+#endif
+#ifndef LOCAL_SIZE_Y
+#    define LOCAL_SIZE_Y 8
+#endif
+#ifndef LOCAL_SIZE_Z
+#    define LOCAL_SIZE_Z 1
+#endif
+// The kernel is a (2 * FILTER_RADIUS + 1)^2 grid of taps spanning FILTER_EXTENT standard deviations of the lobe.
+#ifndef FILTER_RADIUS
+#    define FILTER_RADIUS 2
+#endif
+#define FILTER_EXTENT 2.5
+#define POS_X 0
+#define NEG_X 1
+#define POS_Y 2
+#define NEG_Y 3
+#define POS_Z 4
+#define NEG_Z 5
+#define PI 3.14159265359
+
+// ------------------------------------------------------------------
+// INPUTS -----------------------------------------------------------
+// ------------------------------------------------------------------
+
+layout(local_size_x = LOCAL_SIZE_X, local_size_y = LOCAL_SIZE_Y, local_size_z = LOCAL_SIZE_Z) in;
+
+// ------------------------------------------------------------------
+// OUTPUTS ----------------------------------------------------------
+// ------------------------------------------------------------------
+
+layout(binding = 0, rgba16f) uniform imageCube i_Prefiltered;
+
+// ------------------------------------------------------------------
+// SAMPLERS ---------------------------------------------------------
+// ------------------------------------------------------------------
+
+uniform samplerCube s_EnvMap;
+uniform float       u_Roughness;
+uniform float       u_Width;
+uniform float       u_EnvWidth;
+uniform int         u_StartMipLevel;
+
+// ------------------------------------------------------------------
+// FUNCTIONS --------------------------------------------------------
+// ------------------------------------------------------------------
+
+float unlerp(float val, float max_val)
+{
+    return (val + 0.5) / max_val;
+}
+
+// ------------------------------------------------------------------
+
+vec3 calculate_direction(uint face, uint face_x, uint face_y, float size)
+{
+    float s = unlerp(float(face_x), size) * 2.0 - 1.0;
+    float t = unlerp(float(face_y), size) * 2.0 - 1.0;
+    float x, y, z;
+
+    switch (face)
+    {
+        case POS_Z:
+            x = s;
+            y = -t;
+            z = 1;
+            break;
+        case NEG_Z:
+            x = -s;
+            y = -t;
+            z = -1;
+            break;
+        case NEG_X:
+            x = -1;
+            y = -t;
+            z = s;
+            break;
+        case POS_X:
+            x = 1;
+            y = -t;
+            z = -s;
+            break;
+        case POS_Y:
+            x = s;
+            y = 1;
+            z = t;
+            break;
+        case NEG_Y:
+            x = s;
+            y = -1;
+            z = -t;
+            break;
+    }
+
+    return normalize(vec3(x, y, z));
+}
+
+// ------------------------------------------------------------------
+
+float distribution_ggx(vec3 N, vec3 H, float roughness)
+{
+    float a      = roughness * roughness;
+    float a2     = a * a;
+    float NdotH  = max(dot(N, H), 0.0);
+    float NdotH2 = NdotH * NdotH;
+
+    float nom   = a2;
+    float denom = (NdotH2 * (a2 - 1.0) + 1.0);
+    denom       = PI * denom * denom;
+
+    return nom / denom;
+}
+
+// ------------------------------------------------------------------
+// MAIN -------------------------------------------------------------
+// ------------------------------------------------------------------
+
+void main()
+{
+    if (gl_GlobalInvocationID.x >= uint(u_Width) || gl_GlobalInvocationID.y >= uint(u_Width))
+        return;
+
+    vec3 N = calculate_direction(gl_GlobalInvocationID.z, gl_GlobalInvocationID.x, gl_GlobalInvocationID.y, u_Width);
+
+    // Angular standard deviation of the reflected GGX lobe (V = N) from a spherical gaussian fit of the NDF.
+    float alpha = u_Roughness * u_Roughness;
+    float sigma = 1.41421356 * alpha;
+
+    if (sigma < 1e-4)
+    {
+        imageStore(i_Prefiltered, ivec3(gl_GlobalInvocationID), vec4(textureLod(s_EnvMap, N, float(u_StartMipLevel)).rgb, 1.0));
+        return;
+    }
+
+    // Read from the pyramid level whose texels are as wide as the tap spacing, so that trilinear filtering covers the
+    // gaps between taps and the kernel stays small no matter how wide the lobe is.
+    float spacing     = FILTER_EXTENT * sigma / float(FILTER_RADIUS);
+    float texel_angle = 0.5 * PI / u_EnvWidth;
+    float lod         = max(float(u_StartMipLevel), log2(spacing / texel_angle));
+
+    vec3 up        = abs(N.z) < 0.999 ? vec3(0.0, 0.0, 1.0) : vec3(1.0, 0.0, 0.0);
+    vec3 tangent   = normalize(cross(up, N));
+    vec3 bitangent = cross(N, tangent);
+
+    vec3  prefiltered_color = vec3(0.0);
+    float total_weight      = 0.0;
+
+    for (int j = -FILTER_RADIUS; j <= FILTER_RADIUS; j++)
+    {
+        for (int i = -FILTER_RADIUS; i <= FILTER_RADIUS; i++)
+        {
+            // Taps are laid out on the exponential map around N, which keeps them evenly spaced in angle and lets the
+            // lookup cross cube edges without any per-face handling.
+            vec2  offset = vec2(float(i), float(j)) * spacing;
+            float theta  = length(offset);
+            vec2  dir    = theta > 0.0 ? offset / theta : vec2(0.0);
+            vec3  L      = cos(theta) * N + sin(theta) * (dir.x * tangent + dir.y * bitangent);
+
+            float NdotL = dot(N, L);
+
+            if (NdotL > 0.0)
+            {
+                // Same integrand as the importance sampled path, pdf(L) * NdotL, times the solid angle of the tap. With
+                // V = N the pdf reduces to D(H) / 4 and the constant cancels in the normalisation.
+                vec3  H        = normalize(N + L);
+                float jacobian = theta > 0.0 ? sin(theta) / theta : 1.0;
+                float weight   = distribution_ggx(N, H, u_Roughness) * NdotL * jacobian;
+
+                prefiltered_color += textureLod(s_EnvMap, L, lod).rgb * weight;
+                total_weight += weight;
+            }
+        }
+    }
+
+    imageStore(i_Prefiltered, ivec3(gl_GlobalInvocationID), vec4(prefiltered_color / total_weight, 1.0));
+}
+
+// ------------------------------------------------------------------
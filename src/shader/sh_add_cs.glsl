@@ -2,9 +2,9 @@
 // CONSTANTS ---------------------------------------------------------
 // ------------------------------------------------------------------
 
-#define LOCAL_SIZE 8
-#define ENVIRONMENT_MAP_SIZE 128
-#define SH_INTERMEDIATE_SIZE 16
+#ifndef SH_INTERMEDIATE_SIZE
+#    define SH_INTERMEDIATE_SIZE 16
+#endif
 #define NUM_CUBEMAP_FACES 6
 
 const float Pi = 3.141592654;
@@ -25,7 +25,15 @@ layout(binding = 0, rgba32f) uniform image2D i_SH;
 // SAMPLERS ---------------------------------------------------------
 // ------------------------------------------------------------------
 
+#ifdef SH_INTERMEDIATE_BUFFER
+// Partial sums written by the environment map downsampler, laid out as [face][y][x][coefficient].
+layout(std430, binding = 1) readonly buffer SHBuffer
+{
+    vec4 sh_partials[];
+};
+#else
 uniform sampler2DArray s_SHIntermediate;
+#endif
 
 // ------------------------------------------------------------------
 // SHARED -----------------------------------------------------------
@@ -48,8 +56,12 @@ void main()
     // Add up coefficients along X axis.
     for (uint i = 0; i < SH_INTERMEDIATE_SIZE; i++)
     {
+#ifdef SH_INTERMEDIATE_BUFFER
+        vec4 val = sh_partials[((gl_GlobalInvocationID.z * SH_INTERMEDIATE_SIZE + gl_GlobalInvocationID.y) * SH_INTERMEDIATE_SIZE + i) * 9 + gl_GlobalInvocationID.x];
+#else
         ivec3 p   = ivec3(gl_GlobalInvocationID.x * SH_INTERMEDIATE_SIZE + i, gl_GlobalInvocationID.y, gl_GlobalInvocationID.z);
         vec4  val = texelFetch(s_SHIntermediate, p, 0);
+#endif
 
         g_sh_coeffs[gl_GlobalInvocationID.y][gl_GlobalInvocationID.z] += val.rgb;
         g_weights[gl_GlobalInvocationID.y][gl_GlobalInvocationID.z] += val.a;
@@ -2,10 +2,20 @@
 // CONSTANTS --------------------------------------------------------
 // ------------------------------------------------------------------
 
-#define LOCAL_SIZE 8
-#define ENVIRONMENT_MAP_SIZE 128
+#ifndef LOCAL_SIZE
+#    define LOCAL_SIZE 8
+#endif
+// Number of cube faces reduced by one workgroup, 1 or 6.
+#ifndef LOCAL_SIZE_Z
+#    define LOCAL_SIZE_Z 1
+#endif
+#ifndef ENVIRONMENT_MAP_SIZE
+#    define ENVIRONMENT_MAP_SIZE 128
+#endif
+#ifndef CUBEMAP_MIP_LEVEL
+#    define CUBEMAP_MIP_LEVEL 2.0
+#endif
 #define SH_INTERMEDIATE_SIZE (ENVIRONMENT_MAP_SIZE / LOCAL_SIZE)
-#define CUBEMAP_MIP_LEVEL 2.0
 #define POS_X 0
 #define NEG_X 1
 #define POS_Y 2
@@ -17,7 +27,7 @@
 // INPUTS -----------------------------------------------------------
 // ------------------------------------------------------------------
 
-layout(local_size_x = LOCAL_SIZE, local_size_y = LOCAL_SIZE, local_size_z = 1) in;
+layout(local_size_x = LOCAL_SIZE, local_size_y = LOCAL_SIZE, local_size_z = LOCAL_SIZE_Z) in;
 
 // ------------------------------------------------------------------
 // OUTPUTS ----------------------------------------------------------
@@ -157,8 +167,8 @@ vec3 calculate_direction(uint face, uint face_x, uint face_y)
 // SHARED -----------------------------------------------------------
 // ------------------------------------------------------------------
 
-shared SH9Color g_sh_coeffs[LOCAL_SIZE][LOCAL_SIZE];
-shared float    g_weights[LOCAL_SIZE][LOCAL_SIZE];
+shared SH9Color g_sh_coeffs[LOCAL_SIZE_Z][LOCAL_SIZE][LOCAL_SIZE];
+shared float    g_weights[LOCAL_SIZE_Z][LOCAL_SIZE][LOCAL_SIZE];
 
 // ------------------------------------------------------------------
 // MAIN -------------------------------------------------------------
@@ -166,9 +176,11 @@ shared float    g_weights[LOCAL_SIZE][LOCAL_SIZE];
 
 void main()
 {
+    uint lz = gl_LocalInvocationID.z;
+
     // Initialize shared memory
     for (int i = 0; i < 9; i++)
-        g_sh_coeffs[gl_LocalInvocationID.x][gl_LocalInvocationID.y].c[i] = vec3(0.0);
+        g_sh_coeffs[lz][gl_LocalInvocationID.x][gl_LocalInvocationID.y].c[i] = vec3(0.0);
 
     barrier();
 
@@ -181,10 +193,10 @@ void main()
 
     project_onto_sh9(dir, basis);
 
-    g_weights[gl_LocalInvocationID.x][gl_LocalInvocationID.y] = solid_angle;
+    g_weights[lz][gl_LocalInvocationID.x][gl_LocalInvocationID.y] = solid_angle;
 
     for (int i = 0; i < 9; i++)
-        g_sh_coeffs[gl_LocalInvocationID.x][gl_LocalInvocationID.y].c[i] += texel * basis.c[i] * solid_angle;
+        g_sh_coeffs[lz][gl_LocalInvocationID.x][gl_LocalInvocationID.y].c[i] += texel * basis.c[i] * solid_angle;
 
     barrier();
 
@@ -193,10 +205,10 @@ void main()
     {
         for (int shared_idx = 1; shared_idx < LOCAL_SIZE; shared_idx++)
         {
-            g_weights[0][gl_LocalInvocationID.y] += g_weights[shared_idx][gl_LocalInvocationID.y];
+            g_weights[lz][0][gl_LocalInvocationID.y] += g_weights[lz][shared_idx][gl_LocalInvocationID.y];
 
             for (int coef_idx = 0; coef_idx < 9; coef_idx++)
-                g_sh_coeffs[0][gl_LocalInvocationID.y].c[coef_idx] += g_sh_coeffs[shared_idx][gl_LocalInvocationID.y].c[coef_idx];
+                g_sh_coeffs[lz][0][gl_LocalInvocationID.y].c[coef_idx] += g_sh_coeffs[lz][shared_idx][gl_LocalInvocationID.y].c[coef_idx];
         }
     }
 
@@ -207,17 +219,17 @@ void main()
     {
         for (int shared_idx = 1; shared_idx < LOCAL_SIZE; shared_idx++)
         {
-            g_weights[0][0] += g_weights[0][shared_idx];
+            g_weights[lz][0][0] += g_weights[lz][0][shared_idx];
 
             for (int coef_idx = 0; coef_idx < 9; coef_idx++)
-                g_sh_coeffs[0][0].c[coef_idx] += g_sh_coeffs[0][shared_idx].c[coef_idx];
+                g_sh_coeffs[lz][0][0].c[coef_idx] += g_sh_coeffs[lz][0][shared_idx].c[coef_idx];
         }
 
         // Write out the SH9 coefficients.
         for (int coef_idx = 0; coef_idx < 9; coef_idx++)
         {
             ivec3 p = ivec3((SH_INTERMEDIATE_SIZE * coef_idx) + (gl_GlobalInvocationID.x / LOCAL_SIZE), gl_GlobalInvocationID.y / LOCAL_SIZE, gl_GlobalInvocationID.z);
-            imageStore(i_Cubemap, p, vec4(g_sh_coeffs[0][0].c[coef_idx], g_weights[0][0]));
+            imageStore(i_Cubemap, p, vec4(g_sh_coeffs[lz][0][0].c[coef_idx], g_weights[lz][0][0]));
         }
     }
 }
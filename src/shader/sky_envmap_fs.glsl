@@ -1,4 +1,6 @@
+#include <uniforms.glsl>
 #include <atmosphere.glsl>
+#include <sky_view.glsl>
 
 // ------------------------------------------------------------------
 // OUPUT ------------------------------------------------------------
@@ -12,11 +14,9 @@ out vec4 PS_OUT_Color;
 
 in vec3 PS_IN_WorldPos;
 
-// ------------------------------------------------------------------
-// UNIFORM ----------------------------------------------------------
-// ------------------------------------------------------------------
-
-uniform vec3 u_CameraPos;
+#ifdef SKY_VIEW_LUT
+layout(binding = 6) uniform sampler2D s_SkyView;
+#endif
 
 // ------------------------------------------------------------------
 // MAIN -------------------------------------------------------------
@@ -30,9 +30,21 @@ void main()
 
     vec3 sunColor = vec3(sun, sun, sun) * SUN_INTENSITY;
 
+#ifdef SKY_VIEW_LUT
+    vec3 col = texture(s_SkyView, sky_view_uv(dir, SUN_DIR, vec2(textureSize(s_SkyView, 0)))).rgb;
+
+    // Only the few texels inside the sun disk evaluate the atmosphere for its extinction.
+    if (sun > 0.0)
+    {
+        vec3 extinction;
+        SkyRadiance(u_CameraPos, dir, extinction);
+        col += sunColor * extinction;
+    }
+#else
     vec3 extinction;
     vec3 inscatter = SkyRadiance(u_CameraPos, dir, extinction);
     vec3 col       = sunColor * extinction + inscatter;
+#endif
 
     PS_OUT_Color = vec4(col, 1.0);
 }
@@ -1,9 +1,9 @@
+#include <uniforms.glsl>
+
 layout(location = 0) in vec3 position;
 layout(location = 1) in vec3 normal;
 layout(location = 2) in vec2 texcoord;
 
-uniform mat4 u_Projection;
-uniform mat4 u_View;
 
 out vec3 PS_IN_WorldPos;
 
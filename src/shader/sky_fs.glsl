@@ -1,16 +1,24 @@
-#define SH_DEBUG
+#include <uniforms.glsl>
+#include <octahedral.glsl>
 
 out vec3 PS_OUT_Color;
 
 in vec3 FS_IN_WorldPos;
 
-uniform samplerCube s_Cubemap;
-uniform samplerCube s_Prefilter;
-uniform sampler2D s_SH;
+layout(binding = 0) uniform samplerCube s_Cubemap;
+#ifdef OCTAHEDRAL_PROBE
+layout(binding = 1) uniform sampler2D s_Prefilter;
+#else
+layout(binding = 1) uniform samplerCube s_Prefilter;
+#endif
+layout(binding = 2) uniform sampler2D s_SH;
 
-uniform int   u_Type;
-uniform float u_Roughness;
-uniform vec3 u_CameraPos;
+// SkyboxUniforms in main.cpp.
+layout(std140, binding = OBJECT_UNIFORMS_BINDING) uniform SkyboxUniforms
+{
+    int   u_Type;
+    float u_Roughness;
+};
 
 const float Pi       = 3.141592654;
 const float CosineA0 = Pi;
@@ -130,7 +138,13 @@ void main()
         env_color = env_color / Pi;
     }
     else if (u_Type == 2) // Prefilter
+    {
+#ifdef OCTAHEDRAL_PROBE
+        env_color = octahedral_sample_lod(s_Prefilter, normalize(FS_IN_WorldPos), u_Roughness);
+#else
         env_color = textureLod(s_Prefilter, FS_IN_WorldPos, u_Roughness).rgb;
+#endif
+    }
 
     // HDR tonemap and gamma correct
     env_color = env_color / (env_color + vec3(1.0));
@@ -0,0 +1,122 @@
+#include <atmosphere.glsl>
+
+// ------------------------------------------------------------------
+// CONSTANTS --------------------------------------------------------
+// ------------------------------------------------------------------
+
+// One invocation per sky direction, all in a single workgroup.
+#ifndef SAMPLE_COUNT
+#    define SAMPLE_COUNT 256
+#endif
+#define GOLDEN_ANGLE 2.39996323
+// Cosine of the angular radius of the sun disk drawn by sky_envmap_fs.glsl.
+#define SUN_COS_RADIUS cos(M_PI / 360.0)
+
+// ------------------------------------------------------------------
+// INPUTS -----------------------------------------------------------
+// ------------------------------------------------------------------
+
+layout(local_size_x = SAMPLE_COUNT, local_size_y = 1, local_size_z = 1) in;
+
+// ------------------------------------------------------------------
+// OUTPUTS ----------------------------------------------------------
+// ------------------------------------------------------------------
+
+layout(binding = 0, rgba32f) uniform image2D i_SH;
+
+// ------------------------------------------------------------------
+// STRUCTURES -------------------------------------------------------
+// ------------------------------------------------------------------
+
+struct SH9
+{
+    float c[9];
+};
+
+// ------------------------------------------------------------------
+// FUNCTIONS --------------------------------------------------------
+// ------------------------------------------------------------------
+
+void project_onto_sh9(in vec3 dir, inout SH9 sh)
+{
+    // Band 0
+    sh.c[0] = 0.282095;
+
+    // Band 1
+    sh.c[1] = -0.488603 * dir.y;
+    sh.c[2] = 0.488603 * dir.z;
+    sh.c[3] = -0.488603 * dir.x;
+
+    // Band 2
+    sh.c[4] = 1.092548 * dir.x * dir.y;
+    sh.c[5] = -1.092548 * dir.y * dir.z;
+    sh.c[6] = 0.315392 * (3.0 * dir.z * dir.z - 1.0);
+    sh.c[7] = -1.092548 * dir.x * dir.z;
+    sh.c[8] = 0.546274 * (dir.x * dir.x - dir.y * dir.y);
+}
+
+// ------------------------------------------------------------------
+
+// Fibonacci sphere around the up axis. Every point owns an equal area cell, so all samples weigh 4 pi / SAMPLE_COUNT,
+// and the rings follow the horizon, along which the sky changes the most.
+vec3 sample_direction(uint i)
+{
+    float y   = 1.0 - (2.0 * float(i) + 1.0) / float(SAMPLE_COUNT);
+    float r   = sqrt(max(1.0 - y * y, 0.0));
+    float phi = float(i) * GOLDEN_ANGLE;
+
+    return vec3(r * cos(phi), y, r * sin(phi));
+}
+
+// ------------------------------------------------------------------
+// SHARED -----------------------------------------------------------
+// ------------------------------------------------------------------
+
+shared vec3 g_radiance[SAMPLE_COUNT];
+shared vec3 g_direction[SAMPLE_COUNT];
+
+// ------------------------------------------------------------------
+// MAIN -------------------------------------------------------------
+// ------------------------------------------------------------------
+
+void main()
+{
+    uint i = gl_LocalInvocationIndex;
+
+    vec3 dir = sample_direction(i);
+    vec3 extinction;
+
+    g_radiance[i]  = SkyRadiance(u_CameraPos, dir, extinction);
+    g_direction[i] = dir;
+
+    barrier();
+
+    if (i < 9)
+    {
+        vec3 sum = vec3(0.0);
+        SH9  basis;
+
+        for (uint j = 0; j < SAMPLE_COUNT; j++)
+        {
+            project_onto_sh9(g_direction[j], basis);
+            sum += g_radiance[j] * basis.c[i];
+        }
+
+        sum *= 4.0 * M_PI / float(SAMPLE_COUNT);
+
+        // The sun disk is far smaller than the sample spacing, so it is added analytically as a point of the same
+        // power as the disk in the captured environment map.
+        vec3 sun_extinction;
+        SkyRadiance(u_CameraPos, SUN_DIR, sun_extinction);
+
+        float sun_solid_angle = 2.0 * M_PI * (1.0 - SUN_COS_RADIUS);
+
+        project_onto_sh9(SUN_DIR, basis);
+        sum += SUN_INTENSITY * sun_extinction * sun_solid_angle * basis.c[i];
+
+        // Alpha holds the total weight like the output of sh_add_cs.glsl.
+        imageStore(i_SH, ivec2(i, 0), vec4(sum, 4.0 * M_PI));
+    }
+}
+
+// ------------------------------------------------------------------
@@ -0,0 +1,45 @@
+// ------------------------------------------------------------------
+// SKY-VIEW MAPPING -------------------------------------------------
+// ------------------------------------------------------------------
+
+// Latitude/longitude parameterisation of the sky around the sun, with +Y up. U is the azimuth relative to the sun and
+// only covers [0, pi], since the sky is mirror symmetric about the vertical plane through the sun. V is the elevation,
+// with its square root taken on either side of the horizon, so that texels bunch up where the sky changes the fastest.
+// Texel centres sit on the edges of the range, so clamping never blends across the azimuth seam.
+
+// Azimuth of 'dir' around +Y, zero along +Z. Directions straight up or down have none, any value is fine for them.
+float sky_view_azimuth(vec3 dir)
+{
+    return dot(dir.xz, dir.xz) > 1e-8 ? atan(dir.x, dir.z) : 0.0;
+}
+
+// ------------------------------------------------------------------
+
+// Texture coordinates of 'dir' in a sky-view LUT of 'size' texels.
+vec2 sky_view_uv(vec3 dir, vec3 sun_dir, vec2 size)
+{
+    float azimuth = abs(sky_view_azimuth(dir) - sky_view_azimuth(sun_dir));
+    azimuth       = azimuth > M_PI ? 2.0 * M_PI - azimuth : azimuth;
+
+    float elevation = asin(clamp(dir.y, -1.0, 1.0));
+
+    vec2 uv = vec2(azimuth / M_PI, 0.5 + 0.5 * sign(elevation) * sqrt(abs(elevation) / (0.5 * M_PI)));
+
+    return (uv * (size - 1.0) + 0.5) / size;
+}
+
+// ------------------------------------------------------------------
+
+// Direction stored by texel 'p' of a sky-view LUT of 'size' texels. Inverse of sky_view_uv().
+vec3 sky_view_direction(ivec2 p, ivec2 size, vec3 sun_dir)
+{
+    vec2 uv = vec2(p) / vec2(size - 1);
+
+    float v         = uv.y * 2.0 - 1.0;
+    float elevation = sign(v) * v * v * 0.5 * M_PI;
+    float azimuth   = sky_view_azimuth(sun_dir) + uv.x * M_PI;
+
+    return vec3(cos(elevation) * sin(azimuth), sin(elevation), cos(elevation) * cos(azimuth));
+}
+
+// ------------------------------------------------------------------
@@ -0,0 +1,35 @@
+#include <atmosphere.glsl>
+#include <sky_view.glsl>
+
+// ------------------------------------------------------------------
+// INPUTS -----------------------------------------------------------
+// ------------------------------------------------------------------
+
+layout(local_size_x = 8, local_size_y = 8, local_size_z = 1) in;
+
+// ------------------------------------------------------------------
+// OUTPUTS ----------------------------------------------------------
+// ------------------------------------------------------------------
+
+layout(binding = 0, rgba16f) uniform image2D i_SkyView;
+
+// ------------------------------------------------------------------
+// MAIN -------------------------------------------------------------
+// ------------------------------------------------------------------
+
+void main()
+{
+    ivec2 size = imageSize(i_SkyView);
+    ivec2 p    = ivec2(gl_GlobalInvocationID.xy);
+
+    if (p.x >= size.x || p.y >= size.y)
+        return;
+
+    // Inscattered light only. The sun disk is far smaller than a texel, so the capture adds it itself.
+    vec3 extinction;
+    vec3 inscatter = SkyRadiance(u_CameraPos, sky_view_direction(p, size, SUN_DIR), extinction);
+
+    imageStore(i_SkyView, p, vec4(inscatter, 1.0));
+}
+
+// ------------------------------------------------------------------
@@ -1,3 +1,5 @@
+#include <uniforms.glsl>
+
 layout(location = 0) in vec3 VS_IN_Position;
 
 // ------------------------------------------------------------------
@@ -10,8 +12,7 @@ out vec3 FS_IN_WorldPos;
 // UNIFORMS  --------------------------------------------------------
 // ------------------------------------------------------------------
 
-uniform mat4 u_Projection;
-uniform mat4 u_View;
+// u_View and u_Projection come from CameraUniforms.
 
 // ------------------------------------------------------------------
 // MAIN  ------------------------------------------------------------
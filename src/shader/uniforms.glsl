@@ -0,0 +1,27 @@
+#ifndef UNIFORMS_GLSL
+#define UNIFORMS_GLSL
+
+// ------------------------------------------------------------------
+// CONSTANTS --------------------------------------------------------
+// ------------------------------------------------------------------
+
+// Uniform block bindings, filled from the uniform ring every frame. Must match UNIFORM_BINDING_* in main.cpp. They
+// start above the bindings the prefilter kernels use for their sample directions.
+#define CAMERA_UNIFORMS_BINDING 8
+#define SKY_UNIFORMS_BINDING 9
+#define OBJECT_UNIFORMS_BINDING 10
+
+// ------------------------------------------------------------------
+// UNIFORMS ---------------------------------------------------------
+// ------------------------------------------------------------------
+
+layout(std140, binding = CAMERA_UNIFORMS_BINDING) uniform CameraUniforms
+{
+    mat4 u_View;
+    mat4 u_Projection;
+    vec3 u_CameraPos;
+};
+
+// ------------------------------------------------------------------
+
+#endif
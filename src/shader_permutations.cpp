@@ -0,0 +1,88 @@
+#include "shader_permutations.h"
+#include <algorithm>
+#include <iomanip>
+#include <locale>
+#include <sstream>
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+ShaderDefines& ShaderDefines::set(const std::string& name)
+{
+    m_defines.push_back(name);
+    return *this;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+ShaderDefines& ShaderDefines::set(const std::string& name, int value)
+{
+    m_defines.push_back(name + " " + std::to_string(value));
+    return *this;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+ShaderDefines& ShaderDefines::set(const std::string& name, float value)
+{
+    // std::to_string follows the global C locale, which may use a decimal comma. The classic locale always writes '.',
+    // and enough digits to round-trip the value, so the define and the cache key match on every machine.
+    std::ostringstream stream;
+
+    stream.imbue(std::locale::classic());
+    stream << std::setprecision(9) << value;
+
+    std::string literal = stream.str();
+
+    // Integral values come out without a point, which would make the literal an int in GLSL.
+    if (literal.find_first_of(".e") == std::string::npos)
+        literal += ".0";
+
+    m_defines.push_back(name + " " + literal);
+    return *this;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+std::string ShaderDefines::key() const
+{
+    std::vector<std::string> sorted = m_defines;
+    std::sort(sorted.begin(), sorted.end());
+
+    std::string key;
+
+    for (const auto& define : sorted)
+        key += define + "\n";
+
+    return key;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+ShaderPermutations::ShaderPermutations(ProgramCache& cache, const std::vector<ShaderStage>& stages, const ShaderDefines& base) :
+    m_cache(cache), m_stages(stages), m_base(base)
+{
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+ShaderProgram* ShaderPermutations::get(const ShaderDefines& defines)
+{
+    std::string key = defines.key();
+    auto        it  = m_variants.find(key);
+
+    if (it != m_variants.end())
+        return it->second.get();
+
+    std::vector<std::string> all = m_base.list();
+    all.insert(all.end(), defines.list().begin(), defines.list().end());
+
+    std::unique_ptr<ShaderProgram> program = m_cache.create(m_stages, all);
+    ShaderProgram*                 result  = program.get();
+
+    // Failed variants are remembered as well so that a missing file is not re-read every frame.
+    m_variants[key] = std::move(program);
+
+    return result;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "program_cache.h"
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Set of #defines selecting one variant of a shader. Shaders guard their tunable constants with #ifndef so that any of
+// them can be overridden here and folded by the compiler.
+class ShaderDefines
+{
+public:
+    ShaderDefines& set(const std::string& name);
+    ShaderDefines& set(const std::string& name, int value);
+    ShaderDefines& set(const std::string& name, float value);
+
+    // Order independent, so {A, B} and {B, A} map to the same variant.
+    std::string key() const;
+
+    inline const std::vector<std::string>& list() const { return m_defines; }
+
+private:
+    std::vector<std::string> m_defines;
+};
+
+// All variants of one set of shader stages. Variants are compiled through the ProgramCache on first request, so a
+// specialisation costs a compile (or a binary load on warm starts) once and a hash lookup afterwards.
+class ShaderPermutations
+{
+public:
+    ShaderPermutations(ProgramCache& cache, const std::vector<ShaderStage>& stages, const ShaderDefines& base = ShaderDefines());
+
+    // Returns nullptr if the sources could not be read. Link errors are reported on first use.
+    ShaderProgram* get(const ShaderDefines& defines = ShaderDefines());
+
+    inline size_t variant_count() const { return m_variants.size(); }
+
+private:
+    ProgramCache&                                                   m_cache;
+    std::vector<ShaderStage>                                        m_stages;
+    ShaderDefines                                                   m_base;
+    std::unordered_map<std::string, std::unique_ptr<ShaderProgram>> m_variants;
+};
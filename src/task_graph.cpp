@@ -0,0 +1,203 @@
+#include "task_graph.h"
+#include <logger.h>
+#include <algorithm>
+#include <thread>
+#include <stdio.h>
+
+#define TASK_TIMELINE_WIDTH 48
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+uint32_t TaskGraph::add(const std::string& name, TaskQueue queue, Function function, std::initializer_list<uint32_t> dependencies)
+{
+    uint32_t id = uint32_t(m_tasks.size());
+
+    Task task;
+
+    task.name             = name;
+    task.queue            = queue;
+    task.function         = function;
+    task.dependency_count = uint32_t(dependencies.size());
+
+    for (uint32_t dependency : dependencies)
+        m_tasks[dependency].dependents.push_back(id);
+
+    m_tasks.push_back(task);
+
+    return id;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool TaskGraph::run(uint32_t num_threads)
+{
+    uint32_t worker_tasks = 0;
+
+    for (auto& task : m_tasks)
+    {
+        task.pending  = task.dependency_count;
+        task.finished = false;
+
+        if (task.queue == TASK_WORKER)
+            worker_tasks++;
+    }
+
+    if (num_threads == 0)
+        num_threads = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+
+    // Idle workers would only add thread creation to the startup time.
+    num_threads = std::min(num_threads, worker_tasks);
+
+    for (int i = 0; i < TASK_QUEUE_COUNT; i++)
+        m_ready[i].clear();
+
+    for (uint32_t i = 0; i < m_tasks.size(); i++)
+    {
+        if (m_tasks[i].pending == 0)
+            m_ready[m_tasks[i].queue].push_back(i);
+    }
+
+    m_remaining = uint32_t(m_tasks.size());
+    m_running   = 0;
+    m_failed    = false;
+    m_start     = std::chrono::high_resolution_clock::now();
+
+    std::vector<std::thread> threads;
+
+    for (uint32_t i = 0; i < num_threads; i++)
+        threads.emplace_back(&TaskGraph::worker, this, i + 1);
+
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        while (true)
+        {
+            // After a failure nothing new starts, but the tasks in flight may still reference state owned by the caller.
+            m_ready_cv.wait(lock, [&]() { return m_remaining == 0 || (m_failed ? m_running == 0 : !m_ready[TASK_MAIN].empty()); });
+
+            if (m_remaining == 0 || m_failed)
+                break;
+
+            uint32_t task = m_ready[TASK_MAIN].front();
+            m_ready[TASK_MAIN].pop_front();
+            m_running++;
+
+            lock.unlock();
+            execute(task, 0);
+            lock.lock();
+        }
+    }
+
+    m_ready_cv.notify_all();
+
+    for (auto& thread : threads)
+        thread.join();
+
+    m_duration = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - m_start).count();
+
+    return !m_failed;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void TaskGraph::worker(uint32_t thread)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (true)
+    {
+        m_ready_cv.wait(lock, [&]() { return m_remaining == 0 || m_failed || !m_ready[TASK_WORKER].empty(); });
+
+        if (m_remaining == 0 || m_failed)
+            return;
+
+        uint32_t task = m_ready[TASK_WORKER].front();
+        m_ready[TASK_WORKER].pop_front();
+        m_running++;
+
+        lock.unlock();
+        execute(task, thread);
+        lock.lock();
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void TaskGraph::execute(uint32_t id, uint32_t thread)
+{
+    Task& task = m_tasks[id];
+
+    auto start   = std::chrono::high_resolution_clock::now();
+    bool success = task.function();
+    auto end     = std::chrono::high_resolution_clock::now();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    task.thread   = thread;
+    task.start    = std::chrono::duration<float, std::milli>(start - m_start).count();
+    task.end      = std::chrono::duration<float, std::milli>(end - m_start).count();
+    task.finished = true;
+
+    m_running--;
+    m_remaining--;
+
+    if (!success)
+    {
+        DW_LOG_ERROR("Task failed: " + task.name);
+        m_failed = true;
+    }
+    else
+    {
+        for (uint32_t dependent : task.dependents)
+        {
+            if (--m_tasks[dependent].pending == 0)
+                m_ready[m_tasks[dependent].queue].push_back(dependent);
+        }
+    }
+
+    m_ready_cv.notify_all();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void TaskGraph::print_timeline() const
+{
+    std::vector<const Task*> order;
+    float                    busy = 0.0f;
+
+    for (auto& task : m_tasks)
+    {
+        if (task.finished)
+        {
+            order.push_back(&task);
+            busy += task.end - task.start;
+        }
+    }
+
+    std::sort(order.begin(), order.end(), [](const Task* a, const Task* b) { return a->start < b->start; });
+
+    DW_LOG_INFO("Startup timeline: " + std::to_string(m_duration) + " ms wall, " + std::to_string(busy) + " ms of tasks");
+
+    float scale = float(TASK_TIMELINE_WIDTH) / std::max(m_duration, 0.001f);
+
+    for (const Task* task : order)
+    {
+        char bar[TASK_TIMELINE_WIDTH + 1];
+        int  first = std::min(int(task->start * scale), TASK_TIMELINE_WIDTH - 1);
+        int  last  = std::max(std::min(int(task->end * scale), TASK_TIMELINE_WIDTH - 1), first);
+
+        for (int i = 0; i < TASK_TIMELINE_WIDTH; i++)
+            bar[i] = i >= first && i <= last ? '#' : '.';
+
+        bar[TASK_TIMELINE_WIDTH] = '\0';
+
+        std::string thread = task->thread == 0 ? "main" : "worker " + std::to_string(task->thread);
+
+        char line[256];
+        snprintf(line, sizeof(line), "  %-24s %-9s %8.2f - %8.2f ms |%s|", task->name.c_str(), thread.c_str(), task->start, task->end, bar);
+
+        DW_LOG_INFO(line);
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <initializer_list>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+enum TaskQueue
+{
+    TASK_WORKER = 0, // Any pool thread. Must not touch GL.
+    TASK_MAIN,       // The thread calling run(), which owns the GL context.
+    TASK_QUEUE_COUNT
+};
+
+// Small dependency graph for startup work. CPU tasks run on a pool of worker threads while the calling thread runs the
+// GL tasks in the order their dependencies complete, so uploads start as soon as their data is ready. Every task is
+// timed for the startup timeline.
+class TaskGraph
+{
+public:
+    // Returns false to fail the graph.
+    typedef std::function<bool()> Function;
+
+    // Dependencies are ids returned by earlier add() calls, so the graph is acyclic by construction.
+    uint32_t add(const std::string& name, TaskQueue queue, Function function, std::initializer_list<uint32_t> dependencies = {});
+
+    // Runs every task and returns once they have all finished. After a failure no further tasks are started and the
+    // ones in flight are waited for. 'num_threads' of zero uses one worker per hardware thread beyond the calling one.
+    bool run(uint32_t num_threads = 0);
+
+    // Logs when and where every task ran, ordered by start time.
+    void print_timeline() const;
+
+    // Wall time of the last run() in milliseconds.
+    inline float duration() const { return m_duration; }
+
+private:
+    struct Task
+    {
+        std::string           name;
+        TaskQueue             queue;
+        Function              function;
+        std::vector<uint32_t> dependents;
+        uint32_t              dependency_count = 0;
+        uint32_t              pending          = 0;
+        uint32_t              thread           = 0; // 0 is the calling thread, workers start at 1.
+        float                 start            = 0.0f;
+        float                 end              = 0.0f;
+        bool                  finished         = false;
+    };
+
+    void execute(uint32_t task, uint32_t thread);
+    void worker(uint32_t thread);
+
+private:
+    std::vector<Task>                              m_tasks;
+    std::deque<uint32_t>                           m_ready[TASK_QUEUE_COUNT];
+    std::mutex                                     m_mutex;
+    std::condition_variable                        m_ready_cv;
+    std::chrono::high_resolution_clock::time_point m_start;
+    uint32_t                                       m_remaining = 0;
+    uint32_t                                       m_running   = 0;
+    bool                                           m_failed    = false;
+    float                                          m_duration  = 0.0f;
+};
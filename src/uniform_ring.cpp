@@ -0,0 +1,134 @@
+#include "uniform_ring.h"
+#include "gl_state.h"
+#include <logger.h>
+#include <chrono>
+
+#define UNIFORM_RING_WAIT_TIMEOUT 1000000000 // 1 second in nanoseconds.
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+UniformRing::~UniformRing()
+{
+    for (int i = 0; i < UNIFORM_RING_FRAMES; i++)
+    {
+        if (m_fences[i])
+            glDeleteSync(m_fences[i]);
+    }
+
+    if (m_buffer)
+    {
+        glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+        glUnmapBuffer(GL_UNIFORM_BUFFER);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        glDeleteBuffers(1, &m_buffer);
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool UniformRing::initialize(size_t region_size, GLState* state)
+{
+    m_state = state;
+
+    GLint alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+
+    m_alignment   = alignment > 0 ? size_t(alignment) : 256;
+    m_region_size = (region_size + m_alignment - 1) / m_alignment * m_alignment;
+
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+    glGenBuffers(1, &m_buffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+    glBufferStorage(GL_UNIFORM_BUFFER, m_region_size * UNIFORM_RING_FRAMES, nullptr, flags);
+
+    m_mapped = (uint8_t*)glMapBufferRange(GL_UNIFORM_BUFFER, 0, m_region_size * UNIFORM_RING_FRAMES, flags);
+
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    if (!m_mapped)
+    {
+        DW_LOG_ERROR("Failed to map uniform ring buffer");
+        return false;
+    }
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void UniformRing::next_frame()
+{
+    m_bytes_last_frame = m_bytes_this_frame;
+    m_bytes_this_frame = 0;
+    m_wait_time        = 0.0f;
+
+    advance();
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+UniformAllocation UniformRing::allocate(size_t size)
+{
+    UniformAllocation allocation;
+
+    if (size > m_region_size)
+    {
+        DW_LOG_ERROR("Uniform allocation of " + std::to_string(size) + " bytes is larger than the ring region");
+        return allocation;
+    }
+
+    if (m_offset + size > m_region_size)
+    {
+        m_overflow_count++;
+        advance();
+    }
+
+    allocation.offset = GLintptr(m_region * m_region_size + m_offset);
+    allocation.size   = GLsizeiptr(size);
+    allocation.data   = m_mapped + allocation.offset;
+
+    m_offset += (size + m_alignment - 1) / m_alignment * m_alignment;
+    m_bytes_this_frame += size;
+
+    return allocation;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void UniformRing::bind(uint32_t binding, const UniformAllocation& allocation)
+{
+    if (!allocation.data)
+        return;
+
+    if (m_state)
+        m_state->count_uniform_update();
+
+    glBindBufferRange(GL_UNIFORM_BUFFER, binding, m_buffer, allocation.offset, allocation.size);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+void UniformRing::advance()
+{
+    m_fences[m_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    m_region = (m_region + 1) % UNIFORM_RING_FRAMES;
+    m_offset = 0;
+
+    // The region was last written UNIFORM_RING_FRAMES fences ago, so this normally returns straight away.
+    if (m_fences[m_region])
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+
+        glClientWaitSync(m_fences[m_region], GL_SYNC_FLUSH_COMMANDS_BIT, UNIFORM_RING_WAIT_TIMEOUT);
+        glDeleteSync(m_fences[m_region]);
+
+        auto end = std::chrono::high_resolution_clock::now();
+        m_wait_time += std::chrono::duration<float, std::milli>(end - start).count();
+
+        m_fences[m_region] = nullptr;
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
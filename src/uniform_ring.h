@@ -0,0 +1,69 @@
+#pragma once
+
+#include <ogl.h>
+#include <string.h>
+
+class GLState;
+
+// Number of frames the CPU may run ahead of the GPU before it waits.
+#define UNIFORM_RING_FRAMES 3
+
+// Range of the ring written by the CPU. Valid until the frame it was allocated in has completed on the GPU.
+struct UniformAllocation
+{
+    void*      data   = nullptr;
+    GLintptr   offset = 0;
+    GLsizeiptr size   = 0;
+};
+
+// Persistently mapped uniform buffer split into UNIFORM_RING_FRAMES regions. Per-frame constants are written straight
+// into the mapping and bound as ranges, so there is no buffer reallocation, no glBufferSubData and no name lookup per
+// value. A fence guards every region and is only waited on when the CPU wraps around to a region the GPU still reads.
+class UniformRing
+{
+public:
+    ~UniformRing();
+
+    // 'region_size' is the space available to a single frame. Binds are counted as uniform updates by 'state', which may
+    // be nullptr.
+    bool initialize(size_t region_size, GLState* state);
+
+    // Fences the current region and moves on to the next one. Called once at the end of every frame.
+    void next_frame();
+
+    // Never fails for sizes up to the region size. A frame that runs out of space moves on to the next region early.
+    UniformAllocation allocate(size_t size);
+
+    void bind(uint32_t binding, const UniformAllocation& allocation);
+
+    // Copies 'data' into the ring and binds it to the uniform block 'binding'.
+    template <typename T>
+    void push(uint32_t binding, const T& data)
+    {
+        UniformAllocation allocation = allocate(sizeof(T));
+        memcpy(allocation.data, &data, sizeof(T));
+        bind(binding, allocation);
+    }
+
+    inline size_t   bytes_last_frame() const { return m_bytes_last_frame; }
+    // Time spent waiting on fences since the start of the frame, in milliseconds.
+    inline float    wait_time() const { return m_wait_time; }
+    inline uint32_t overflow_count() const { return m_overflow_count; }
+
+private:
+    void advance();
+
+private:
+    GLState* m_state            = nullptr;
+    GLuint   m_buffer           = 0;
+    uint8_t* m_mapped           = nullptr;
+    size_t   m_region_size      = 0;
+    size_t   m_alignment        = 256;
+    uint32_t m_region           = 0;
+    size_t   m_offset           = 0;
+    size_t   m_bytes_this_frame = 0;
+    size_t   m_bytes_last_frame = 0;
+    float    m_wait_time        = 0.0f;
+    uint32_t m_overflow_count   = 0;
+    GLsync   m_fences[UNIFORM_RING_FRAMES] = {};
+};
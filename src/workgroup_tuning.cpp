@@ -0,0 +1,138 @@
+#include "workgroup_tuning.h"
+#include "disk_cache.h"
+#include <ogl.h>
+#include <algorithm>
+#include <float.h>
+#include <string.h>
+
+#define WORKGROUP_CONFIG_MAGIC 0x46434757 // 'WGCF'
+#define WORKGROUP_CONFIG_VERSION 1
+
+struct WorkgroupConfigFile
+{
+    uint32_t        magic;
+    uint32_t        version;
+    WorkgroupConfig config;
+};
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static std::string config_path(uint64_t device_hash)
+{
+    return disk_cache::path("workgroups_" + disk_cache::to_hex(device_hash) + ".bin");
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static bool valid_layout(const WorkgroupLayout& layout)
+{
+    return layout.x > 0 && layout.y > 0 && (layout.z == 1 || layout.z == 6);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static std::string layout_string(const WorkgroupLayout& layout)
+{
+    return std::to_string(layout.x) + "x" + std::to_string(layout.y) + "x" + std::to_string(layout.z);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool WorkgroupConfig::load(uint64_t device_hash, int32_t prefilter_mip_levels, int32_t min_sh_size)
+{
+    std::vector<uint8_t> data;
+
+    if (!disk_cache::read(config_path(device_hash), data) || data.size() != sizeof(WorkgroupConfigFile))
+        return false;
+
+    WorkgroupConfigFile file;
+    memcpy(&file, data.data(), sizeof(WorkgroupConfigFile));
+
+    if (file.magic != WORKGROUP_CONFIG_MAGIC || file.version != WORKGROUP_CONFIG_VERSION)
+        return false;
+
+    const WorkgroupConfig& config = file.config;
+
+    if (!valid_layout(config.prefilter) || !valid_layout(config.sh_projection) || !valid_layout(config.brdf))
+        return false;
+
+    if (config.prefilter_batch < 1 || config.prefilter_batch >= prefilter_mip_levels || config.sh_projection.x < min_sh_size)
+        return false;
+
+    *this = config;
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+bool WorkgroupConfig::save(uint64_t device_hash) const
+{
+    WorkgroupConfigFile file = { WORKGROUP_CONFIG_MAGIC, WORKGROUP_CONFIG_VERSION, *this };
+    return disk_cache::write(config_path(device_hash), &file, sizeof(WorkgroupConfigFile));
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+std::string WorkgroupConfig::to_string() const
+{
+    return "prefilter " + layout_string(prefilter) + " (batch " + std::to_string(prefilter_batch) + "), sh " + layout_string(sh_projection) + ", brdf " + layout_string(brdf);
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+std::vector<WorkgroupLayout> workgroup_candidates(const std::vector<WorkgroupLayout>& xy, const std::vector<int32_t>& z)
+{
+    GLint max_invocations = 0;
+    GLint max_size[3]     = { 0, 0, 0 };
+
+    glGetIntegerv(GL_MAX_COMPUTE_WORK_GROUP_INVOCATIONS, &max_invocations);
+
+    for (int i = 0; i < 3; i++)
+        glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_SIZE, i, &max_size[i]);
+
+    std::vector<WorkgroupLayout> candidates;
+
+    for (const auto& layout : xy)
+    {
+        for (auto faces : z)
+        {
+            if (layout.x > max_size[0] || layout.y > max_size[1] || faces > max_size[2] || layout.x * layout.y * faces > max_invocations)
+                continue;
+
+            candidates.push_back({ layout.x, layout.y, faces });
+        }
+    }
+
+    return candidates;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+float time_gpu(const std::function<void()>& dispatch, int iterations)
+{
+    GLuint query;
+    glGenQueries(1, &query);
+
+    dispatch();
+
+    float best = FLT_MAX;
+
+    for (int i = 0; i < iterations; i++)
+    {
+        glBeginQuery(GL_TIME_ELAPSED, query);
+        dispatch();
+        glEndQuery(GL_TIME_ELAPSED);
+
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+
+        best = std::min(best, float(elapsed) / 1000000.0f);
+    }
+
+    glDeleteQueries(1, &query);
+
+    return best;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdint.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Thread layout of one compute kernel. 'z' is the number of cube faces handled by a single workgroup (1 or 6).
+struct WorkgroupLayout
+{
+    int32_t x;
+    int32_t y;
+    int32_t z;
+};
+
+// Launch configuration of the IBL compute kernels. The defaults are the original 8x8 layouts, tuned values are
+// stored per device in the disk cache.
+struct WorkgroupConfig
+{
+    WorkgroupLayout prefilter       = { 8, 8, 1 };
+    int32_t         prefilter_batch = 1; // Number of trailing (smallest) prefilter mips written by one dispatch.
+    WorkgroupLayout sh_projection   = { 8, 8, 1 };
+    WorkgroupLayout brdf            = { 8, 8, 1 };
+
+    // Rejects configurations that do not fit the kernels: a batch must leave at least one mip outside of it, and the SH
+    // projection needs 'min_sh_size' threads per side to fit its intermediate texture.
+    bool        load(uint64_t device_hash, int32_t prefilter_mip_levels, int32_t min_sh_size);
+    bool        save(uint64_t device_hash) const;
+    std::string to_string() const;
+};
+
+inline uint32_t workgroup_count(uint32_t size, int32_t local_size)
+{
+    return (size + local_size - 1) / local_size;
+}
+
+// Layouts from 'xy' combined with every entry of 'z' that fit within the device's compute limits.
+std::vector<WorkgroupLayout> workgroup_candidates(const std::vector<WorkgroupLayout>& xy, const std::vector<int32_t>& z);
+
+// Runs 'dispatch' once to warm up, then returns the fastest of 'iterations' runs in milliseconds of GPU time.
+float time_gpu(const std::function<void()>& dispatch, int iterations);
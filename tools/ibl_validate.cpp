@@ -0,0 +1,135 @@
+#include <ibl_asset.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+// Offline checker for baked IBL probes. Verifies the container and reports per-mip statistics so that broken bakes
+// (NaNs, black faces) are caught before they ship.
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static float half_to_float(uint16_t h)
+{
+    uint32_t sign     = (h >> 15) & 0x1;
+    uint32_t exponent = (h >> 10) & 0x1f;
+    uint32_t mantissa = h & 0x3ff;
+    float    value;
+
+    if (exponent == 0)
+        value = ldexpf((float)mantissa, -24);
+    else if (exponent == 31)
+        value = mantissa ? NAN : INFINITY;
+    else
+        value = ldexpf((float)(mantissa | 0x400), (int)exponent - 25);
+
+    return sign ? -value : value;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+static float texel_component(const uint8_t* data, uint32_t format, size_t index)
+{
+    if (format == IBL_PIXEL_FORMAT_RGBA16F)
+    {
+        uint16_t h;
+        memcpy(&h, data + index * sizeof(uint16_t), sizeof(uint16_t));
+        return half_to_float(h);
+    }
+    else
+    {
+        float f;
+        memcpy(&f, data + index * sizeof(float), sizeof(float));
+        return f;
+    }
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        printf("usage: IBLValidate <probe.ibl> [--no-checksums]\n");
+        return 2;
+    }
+
+    bool verify_checksums = !(argc > 2 && strcmp(argv[2], "--no-checksums") == 0);
+
+    IBLAsset    asset;
+    std::string error;
+
+    if (!asset.open(argv[1], verify_checksums, &error))
+    {
+        printf("%s: INVALID (%s)\n", argv[1], error.c_str());
+        return 1;
+    }
+
+    const IBLAssetHeader& header = asset.header();
+
+    printf("%s\n", argv[1]);
+    printf("  version   : %u\n", header.version);
+    printf("  file size : %llu bytes\n", (unsigned long long)header.file_size);
+    printf("  cubemap   : %ux%u, %u mips, %s\n", header.cubemap_size, header.cubemap_size, header.mip_count, header.cubemap_format == IBL_PIXEL_FORMAT_RGBA16F ? "RGBA16F" : "RGBA32F");
+    printf("  checksums : %s\n", verify_checksums ? "verified" : "skipped");
+
+    const float* sh = (const float*)asset.sh();
+
+    printf("  sh9       :");
+    for (int i = 0; i < IBL_ASSET_SH_COEFFICIENTS; i++)
+        printf(" (%.3f %.3f %.3f)", sh[i * 4], sh[i * 4 + 1], sh[i * 4 + 2]);
+    printf("\n");
+
+    int bad_texels = 0;
+
+    for (uint32_t mip = 0; mip < header.mip_count; mip++)
+    {
+        for (uint32_t face = 0; face < IBL_ASSET_FACE_COUNT; face++)
+        {
+            const uint8_t* data        = (const uint8_t*)asset.face(mip, face);
+            size_t         texel_count = size_t(header.mips[mip].width) * header.mips[mip].height;
+            float          min_value   = INFINITY;
+            float          max_value   = -INFINITY;
+            int            non_finite  = 0;
+
+            for (size_t i = 0; i < texel_count; i++)
+            {
+                for (int c = 0; c < 3; c++)
+                {
+                    float v = texel_component(data, header.cubemap_format, i * 4 + c);
+
+                    if (!isfinite(v))
+                    {
+                        non_finite++;
+                        continue;
+                    }
+
+                    min_value = fminf(min_value, v);
+                    max_value = fmaxf(max_value, v);
+                }
+            }
+
+            bad_texels += non_finite;
+
+            printf("  mip %u face %u : %4ux%-4u min %10.4f max %10.4f%s\n",
+                   mip,
+                   face,
+                   header.mips[mip].width,
+                   header.mips[mip].height,
+                   min_value,
+                   max_value,
+                   non_finite ? " NON-FINITE VALUES" : "");
+        }
+    }
+
+    if (bad_texels > 0)
+    {
+        printf("%s: INVALID (%d non-finite components)\n", argv[1], bad_texels);
+        return 1;
+    }
+
+    printf("%s: OK\n", argv[1]);
+
+    return 0;
+}
+
+// -----------------------------------------------------------------------------------------------------------------------------------